@@ -3,7 +3,9 @@ noinst_HEADERS +=\
 	api/documentvaluelist.h\
 	api/editdistance.h\
 	api/enquireinternal.h\
+	api/filtercacheinternal.h\
 	api/leafpostlist.h\
+	api/msetcacheinternal.h\
 	api/msetinternal.h\
 	api/result.h\
 	api/postingiteratorinternal.h\
@@ -22,6 +24,7 @@ EXTRA_DIST +=\
 	api/Makefile
 
 lib_src +=\
+	api/bulkloader.cc\
 	api/compactor.cc\
 	api/constinfo.cc\
 	api/database.cc\
@@ -33,10 +36,12 @@ lib_src +=\
 	api/enquire.cc\
 	api/error.cc\
 	api/expanddecider.cc\
+	api/filtercache.cc\
 	api/keymaker.cc\
 	api/leafpostlist.cc\
 	api/matchspy.cc\
 	api/mset.cc\
+	api/msetcache.cc\
 	api/msetiterator.cc\
 	api/result.cc\
 	api/positioniterator.cc\
@@ -47,6 +52,7 @@ lib_src +=\
 	api/queryinternal.cc\
 	api/registry.cc\
 	api/rset.cc\
+	api/segmenteddatabase.cc\
 	api/smallvector.cc\
 	api/sortable-serialise.cc\
 	api/terminfo.cc\
@@ -0,0 +1,318 @@
+/** @file
+ * @brief Build a new database from a stream of documents
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include <config.h>
+
+#include <xapian/bulkloader.h>
+
+#include <xapian/compactor.h>
+#include <xapian/constants.h>
+#include <xapian/database.h>
+#include <xapian/document.h>
+#include <xapian/error.h>
+
+#include "debuglog.h"
+#include "fileutils.h"
+#include "safesysstat.h"
+#include "safeunistd.h"
+#include "str.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace Xapian {
+
+class BulkLoader::Internal {
+    /** The most runs to merge at once.
+     *
+     *  This bounds the number of databases (and so files) open at once
+     *  during a merge.  If there are more runs than this, finish() merges
+     *  them in passes, each of which merges groups of MERGE_FANIN runs into
+     *  intermediate runs, so each document gets merged about log(number of
+     *  runs) / log(MERGE_FANIN) times in all.
+     */
+    static constexpr size_t MERGE_FANIN = 16;
+
+    /// The path to create the database at.
+    string path;
+
+    /// Flags for the final merge.
+    int flags;
+
+    /// The number of documents in each run.
+    Xapian::doccount run_size;
+
+    /// The block size to use.
+    int block_size;
+
+    /// Directory to create the runs in.
+    string tmpdir;
+
+    /// The run currently being indexed, if any.
+    WritableDatabase run;
+
+    /// The number of documents in the current run.
+    Xapian::doccount run_doccount = 0;
+
+    /// The number of documents added.
+    Xapian::doccount doccount = 0;
+
+    /// Number used to name the next run.
+    unsigned next_run_number = 0;
+
+    /// The paths of the completed runs, in docid order.
+    vector<string> runs;
+
+    /// User metadata to set.
+    map<string, string> metadata;
+
+    /// Has finish() been called?
+    bool finished = false;
+
+    /// Return the path for a new run.
+    string new_run_path() {
+	return tmpdir + "/run" + str(next_run_number++);
+    }
+
+    /// Start a new run.
+    void start_run();
+
+    /// Finish the current run.
+    void end_run();
+
+    /** Merge runs.
+     *
+     *  @param begin	Index in runs of the first run to merge.
+     *  @param end	Index in runs one after the last run to merge.
+     *  @param output	The path to write the merged database to.
+     *  @param merge_flags	Flags to pass to Database::compact().
+     *  @param compactor	Compactor to pass to Database::compact() (may be
+     *				NULL).
+     */
+    void merge_runs(size_t begin, size_t end, const string& output,
+		    int merge_flags, Compactor* compactor);
+
+    /// Merge all the runs into the output database.
+    void merge_all_runs(Compactor* compactor);
+
+    /// Remove the temporary databases.
+    void remove_runs();
+
+  public:
+    Internal(const string& path_, int flags_,
+	     Xapian::doccount run_size_, int block_size_)
+	: path(path_),
+	  flags(flags_ & ~DBCOMPACT_NO_RENUMBER),
+	  run_size(run_size_ ? run_size_ : 10000),
+	  block_size(block_size_),
+	  tmpdir(path_ + ".tmp") { }
+
+    ~Internal() {
+	try {
+	    remove_runs();
+	} catch (...) {
+	    // Ignore errors in destructors.
+	}
+    }
+
+    Xapian::docid add_document(const Document& document);
+
+    void set_metadata(const string& key, const string& value) {
+	if (key.empty())
+	    throw InvalidArgumentError("Empty metadata keys are invalid");
+	metadata[key] = value;
+    }
+
+    Xapian::doccount get_doccount() const { return doccount; }
+
+    void finish(Compactor* compactor);
+};
+
+void
+BulkLoader::Internal::start_run()
+{
+    if (mkdir(tmpdir.c_str(), 0755) < 0 && errno != EEXIST) {
+	throw DatabaseCreateError("Cannot create directory '" + tmpdir + "'",
+				  errno);
+    }
+    runs.push_back(new_run_path());
+    run = WritableDatabase(runs.back(),
+			   DB_CREATE_OR_OVERWRITE | DB_BACKEND_GLASS |
+			   DB_NO_SYNC,
+			   block_size);
+}
+
+void
+BulkLoader::Internal::end_run()
+{
+    run.commit();
+    run.close();
+    run = WritableDatabase();
+    run_doccount = 0;
+}
+
+void
+BulkLoader::Internal::merge_runs(size_t begin, size_t end,
+				 const string& output,
+				 int merge_flags, Compactor* compactor)
+{
+    LOGCALL_VOID(API, "BulkLoader::Internal::merge_runs", begin | end | output | merge_flags | compactor);
+    Database db;
+    for (size_t i = begin; i != end; ++i) {
+	db.add_database(Database(runs[i], DB_BACKEND_GLASS));
+    }
+    // Every run numbers its documents from 1, so renumbering concatenates
+    // the runs in order.
+    if (compactor) {
+	db.compact(output, merge_flags, block_size, *compactor);
+    } else {
+	db.compact(output, merge_flags, block_size);
+    }
+}
+
+void
+BulkLoader::Internal::merge_all_runs(Compactor* compactor)
+{
+    while (runs.size() > MERGE_FANIN) {
+	// Merge each group of MERGE_FANIN runs into an intermediate run.  The
+	// runs before i are the output of this pass so far.
+	size_t i = 0;
+	while (i != runs.size()) {
+	    size_t n = min(MERGE_FANIN, runs.size() - i);
+	    if (n > 1) {
+		// Add the output to runs first so remove_runs() cleans it up
+		// if the merge fails.
+		runs.insert(runs.begin() + i, new_run_path());
+		merge_runs(i + 1, i + 1 + n, runs[i], DB_BACKEND_GLASS, NULL);
+		for (size_t j = i + 1; j != i + 1 + n; ++j) {
+		    removedir(runs[j]);
+		}
+		runs.erase(runs.begin() + i + 1, runs.begin() + i + 1 + n);
+	    }
+	    ++i;
+	}
+    }
+    merge_runs(0, runs.size(), path, flags, compactor);
+}
+
+void
+BulkLoader::Internal::remove_runs()
+{
+    run = WritableDatabase();
+    for (auto& i : runs) {
+	removedir(i);
+    }
+    runs.clear();
+    if (rmdir(tmpdir.c_str()) < 0 && errno != ENOENT) {
+	throw DatabaseError("Cannot remove directory '" + tmpdir + "'", errno);
+    }
+}
+
+Xapian::docid
+BulkLoader::Internal::add_document(const Document& document)
+{
+    if (finished)
+	throw InvalidOperationError("BulkLoader::finish() has been called");
+    if (run_doccount == 0)
+	start_run();
+    run.add_document(document);
+    if (++run_doccount == run_size)
+	end_run();
+    return ++doccount;
+}
+
+void
+BulkLoader::Internal::finish(Compactor* compactor)
+{
+    if (finished)
+	throw InvalidOperationError("BulkLoader::finish() has already been "
+				    "called");
+    finished = true;
+    bool run_open = (run_doccount != 0);
+    if (!run_open && (runs.empty() || !metadata.empty())) {
+	// We need a run to hold the metadata, or to produce an empty
+	// database if no documents were added.
+	start_run();
+	run_open = true;
+    }
+    if (run_open) {
+	for (auto& i : metadata) {
+	    run.set_metadata(i.first, i.second);
+	}
+	run.commit();
+	run.close();
+	run = WritableDatabase();
+    }
+    merge_all_runs(compactor);
+    remove_runs();
+}
+
+BulkLoader::BulkLoader(const string& path, int flags,
+		       Xapian::doccount run_size, int block_size)
+    : internal(new Internal(path, flags, run_size, block_size))
+{
+    LOGCALL_CTOR(API, "BulkLoader", path | flags | run_size | block_size);
+}
+
+BulkLoader::~BulkLoader()
+{
+    LOGCALL_DTOR(API, "BulkLoader");
+}
+
+Xapian::docid
+BulkLoader::add_document(const Document& document)
+{
+    LOGCALL(API, Xapian::docid, "BulkLoader::add_document", document);
+    RETURN(internal->add_document(document));
+}
+
+void
+BulkLoader::set_metadata(const string& key, const string& value)
+{
+    LOGCALL_VOID(API, "BulkLoader::set_metadata", key | value);
+    internal->set_metadata(key, value);
+}
+
+Xapian::doccount
+BulkLoader::get_doccount() const
+{
+    LOGCALL(API, Xapian::doccount, "BulkLoader::get_doccount", NO_ARGS);
+    RETURN(internal->get_doccount());
+}
+
+void
+BulkLoader::finish()
+{
+    LOGCALL_VOID(API, "BulkLoader::finish", NO_ARGS);
+    internal->finish(NULL);
+}
+
+void
+BulkLoader::finish(Compactor& compactor)
+{
+    LOGCALL_VOID(API, "BulkLoader::finish", compactor);
+    internal->finish(&compactor);
+}
+
+}
@@ -26,6 +26,8 @@
 
 #include <algorithm>
 #include <fstream>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 #include <cerrno>
@@ -120,6 +122,30 @@ backend_mismatch(const Xapian::Database::Internal* db, int backend1,
     throw Xapian::InvalidArgumentError(msg);
 }
 
+/// Compactor which serialises calls to another from multiple threads.
+class SerialisedCompactor : public Xapian::Compactor {
+    Xapian::Compactor* compactor;
+
+    mutex compactor_mutex;
+
+  public:
+    explicit SerialisedCompactor(Xapian::Compactor* compactor_)
+	: compactor(compactor_) {
+	set_threads(compactor->get_threads());
+    }
+
+    void set_status(const string& table, const string& status) {
+	lock_guard<mutex> lock(compactor_mutex);
+	compactor->set_status(table, status);
+    }
+
+    string resolve_duplicate_metadata(const string& key,
+				      size_t num_tags, const string tags[]) {
+	lock_guard<mutex> lock(compactor_mutex);
+	return compactor->resolve_duplicate_metadata(key, num_tags, tags);
+    }
+};
+
 namespace Xapian {
 
 void
@@ -337,6 +363,14 @@ Database::compact_(const string * output_ptr, int fd, unsigned flags,
 	}
     }
 
+    // If tables are compacted in parallel, the backend may call compactor
+    // from several threads.
+    unique_ptr<SerialisedCompactor> serialised_compactor;
+    if (compactor && compactor->get_threads() > 1) {
+	serialised_compactor.reset(new SerialisedCompactor(compactor));
+	compactor = serialised_compactor.get();
+    }
+
 #if defined XAPIAN_HAS_GLASS_BACKEND || defined XAPIAN_HAS_HONEY_BACKEND
     Xapian::Compactor::compaction_level compaction =
 	static_cast<Xapian::Compactor::compaction_level>(flags & (Xapian::Compactor::STANDARD|Xapian::Compactor::FULL|Xapian::Compactor::FULLER));
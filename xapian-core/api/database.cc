@@ -23,6 +23,7 @@
 
 #include <xapian/database.h>
 
+#include "backends/blockcache.h"
 #include "backends/databaseinternal.h"
 #include "backends/empty_database.h"
 #include "backends/multi/multi_database.h"
@@ -41,6 +42,7 @@
 #include <cstdlib> // For abs().
 #include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
 using namespace std;
@@ -337,6 +339,22 @@ Database::valuestream_begin(Xapian::valueno slot) const
     return ValueIterator(internal->open_value_list(slot));
 }
 
+void
+Database::add_value_column(Xapian::valueno slot, unsigned width)
+{
+    if (width == 0 || width > 254) {
+	throw Xapian::InvalidArgumentError("Value column width must be "
+					   "between 1 and 254");
+    }
+    internal->add_value_column(slot, width);
+}
+
+void
+Database::add_value_dictionary(Xapian::valueno slot)
+{
+    internal->add_value_dictionary(slot);
+}
+
 Xapian::termcount
 Database::get_doclength(Xapian::docid did) const
 {
@@ -514,6 +532,36 @@ Database::get_revision() const
     return internal->get_revision();
 }
 
+void
+Database::set_block_cache_size(size_t max_size)
+{
+    BlockCache::get_instance().set_max_size(max_size);
+}
+
+size_t
+Database::get_block_cache_size()
+{
+    return BlockCache::get_instance().get_max_size();
+}
+
+size_t
+Database::get_block_cache_hits()
+{
+    return BlockCache::get_instance().get_hits();
+}
+
+size_t
+Database::get_block_cache_misses()
+{
+    return BlockCache::get_instance().get_misses();
+}
+
+size_t
+Database::get_block_cache_evictions()
+{
+    return BlockCache::get_instance().get_evictions();
+}
+
 string
 Database::reconstruct_text(Xapian::docid did,
 			   size_t length,
@@ -530,6 +578,12 @@ WritableDatabase::commit()
     internal->commit();
 }
 
+void
+WritableDatabase::wait_for_durable(Xapian::rev revision)
+{
+    internal->wait_for_durable(revision);
+}
+
 void
 WritableDatabase::begin_transaction(bool flushed)
 {
@@ -548,6 +602,17 @@ WritableDatabase::add_document(const Document& doc)
     return internal->add_document(doc);
 }
 
+Xapian::docid
+WritableDatabase::add_documents(const vector<Document>& docs,
+				unsigned n_threads)
+{
+    if (docs.empty())
+	return 0;
+    if (n_threads == 0)
+	n_threads = max(thread::hardware_concurrency(), 1u);
+    return internal->add_documents(docs, n_threads);
+}
+
 void
 WritableDatabase::delete_document(Xapian::docid did)
 {
@@ -26,7 +26,10 @@
 #include "expand/esetinternal.h"
 #include "expand/expandweight.h"
 #include "matcher/matcher.h"
+#include "msetcacheinternal.h"
 #include "msetinternal.h"
+#include "pack.h"
+#include "serialise-double.h"
 #include "vectortermlist.h"
 #include "weight/weightinternal.h"
 #include "xapian/database.h"
@@ -35,6 +38,8 @@
 #include "xapian/intrusive_ptr.h"
 #include "xapian/keymaker.h"
 #include "xapian/matchspy.h"
+#include "xapian/filtercache.h"
+#include "xapian/msetcache.h"
 #include "xapian/query.h"
 #include "xapian/rset.h"
 #include "xapian/weight.h"
@@ -195,6 +200,32 @@ Enquire::set_time_limit(double time_limit)
     internal->time_limit = time_limit;
 }
 
+void
+Enquire::set_match_threads(unsigned n_threads)
+{
+    internal->match_threads = n_threads;
+}
+
+void
+Enquire::set_mset_cache(const MSetCache& cache)
+{
+    if (cache.get_max_size() == 0) {
+	internal->mset_cache.reset();
+    } else {
+	internal->mset_cache = cache.internal;
+    }
+}
+
+void
+Enquire::set_filter_cache(const FilterCache& cache)
+{
+    if (cache.get_max_size() == 0) {
+	internal->filter_cache.reset();
+    } else {
+	internal->filter_cache = cache.internal;
+    }
+}
+
 MSet
 Enquire::get_mset(doccount first,
 		  doccount maxitems,
@@ -251,6 +282,48 @@ Enquire::get_description() const
 Enquire::Internal::Internal(const Database& db_)
     : db(db_) {}
 
+string
+Enquire::Internal::get_mset_cache_key(doccount first,
+				      doccount maxitems,
+				      doccount checkatleast) const
+{
+    string key;
+    if (!db.internal->append_revision_key(key))
+	return string();
+
+    try {
+	pack_string(key, query.serialise());
+	pack_string(key, weight->name());
+	pack_string(key, weight->serialise());
+	if (sort_functor.get()) {
+	    pack_bool(key, true);
+	    pack_string(key, sort_functor->name());
+	    pack_string(key, sort_functor->serialise());
+	} else {
+	    pack_bool(key, false);
+	}
+    } catch (const Xapian::UnimplementedError&) {
+	// Something doesn't support serialisation, so we can't build a key.
+	return string();
+    }
+
+    pack_uint(key, query_length);
+    pack_uint(key, unsigned(order));
+    pack_uint(key, unsigned(sort_by));
+    pack_uint(key, sort_key);
+    pack_bool(key, sort_val_reverse);
+    pack_uint(key, collapse_key);
+    pack_uint(key, collapse_max);
+    pack_uint(key, unsigned(percent_threshold));
+    key += serialise_double(weight_threshold);
+    // Matching in parallel can give different estimates.
+    pack_uint(key, match_threads);
+    pack_uint(key, first);
+    pack_uint(key, maxitems);
+    pack_uint(key, checkatleast);
+    return key;
+}
+
 MSet
 Enquire::Internal::get_mset(doccount first,
 			    doccount maxitems,
@@ -279,6 +352,22 @@ Enquire::Internal::get_mset(doccount first,
 	query_length = query.get_length();
     }
 
+    // MatchDecider and MatchSpy objects need to see the matching documents,
+    // and a time limit makes the results depend on how long the match takes.
+    string cache_key;
+    if (mset_cache && (!rset || rset->empty()) && !mdecider &&
+	matchspies.empty() && time_limit <= 0.0) {
+	cache_key = get_mset_cache_key(first, maxitems, checkatleast);
+	string serialised;
+	if (!cache_key.empty() && mset_cache->find(cache_key, serialised)) {
+	    MSet mset;
+	    const char* p = serialised.data();
+	    mset.internal->unserialise(p, p + serialised.size());
+	    mset.internal->set_enquire(this);
+	    return mset;
+	}
+    }
+
     Xapian::doccount first_orig = first;
     {
 	Xapian::doccount docs = db.get_doccount();
@@ -307,6 +396,7 @@ Enquire::Internal::get_mset(doccount first,
 		    sort_val_reverse,
 		    time_limit,
 		    matchspies);
+    match.set_filter_cache(filter_cache.get());
 
     MSet mset = match.get_mset(first,
 			       maxitems,
@@ -324,7 +414,8 @@ Enquire::Internal::get_mset(doccount first,
 			       sort_by,
 			       sort_val_reverse,
 			       time_limit,
-			       matchspies);
+			       matchspies,
+			       match_threads);
 
     if (first_orig != first && mset.internal.get()) {
 	mset.internal->set_first(first_orig);
@@ -336,6 +427,10 @@ Enquire::Internal::get_mset(doccount first,
 	mset.internal->set_stats(stats.release());
     }
 
+    if (!cache_key.empty()) {
+	mset_cache->add(cache_key, mset.internal->serialise());
+    }
+
     return mset;
 }
 
@@ -25,10 +25,12 @@
 #include "xapian/constants.h"
 #include "xapian/database.h"
 #include "xapian/enquire.h"
+#include "xapian/filtercache.h"
 #include "xapian/intrusive_ptr.h"
 #include "xapian/keymaker.h"
 #include "xapian/matchspy.h"
 #include "xapian/mset.h" // Only needed to forward declare MSet::Internal.
+#include "xapian/msetcache.h"
 #include "xapian/query.h"
 
 #include <memory>
@@ -79,10 +81,26 @@ class Enquire::Internal : public Xapian::Internal::intrusive_base {
 
     double time_limit = 0.0;
 
+    unsigned match_threads = 0;
+
+    /// Cache of search results (NULL if not caching).
+    std::shared_ptr<Xapian::MSetCache::Internal> mset_cache;
+
+    /// Cache of filters (NULL if not caching).
+    std::shared_ptr<Xapian::FilterCache::Internal> filter_cache;
+
     enum { EXPAND_TRAD, EXPAND_BO1 } eweight = EXPAND_TRAD;
 
     double expand_k = 1.0;
 
+    /** Build the key for caching the results of a call to get_mset().
+     *
+     *  @return The key, or an empty string if the results can't be cached.
+     */
+    std::string get_mset_cache_key(doccount first,
+				   doccount maxitems,
+				   doccount checkatleast) const;
+
   public:
     explicit
     Internal(const Database& db_);
@@ -0,0 +1,100 @@
+/** @file filtercache.cc
+ * @brief Cache of boolean filters which can be shared between Enquire objects
+ */
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include <xapian/filtercache.h>
+
+#include "filtercacheinternal.h"
+#include "str.h"
+
+#include <string>
+
+using namespace std;
+
+namespace Xapian {
+
+FilterCache::FilterCache(const FilterCache&) = default;
+
+FilterCache&
+FilterCache::operator=(const FilterCache&) = default;
+
+FilterCache::FilterCache(FilterCache &&) = default;
+
+FilterCache&
+FilterCache::operator=(FilterCache &&) = default;
+
+FilterCache::FilterCache(size_t max_size)
+    : internal(std::make_shared<Internal>(max_size)) {}
+
+FilterCache::~FilterCache() {}
+
+size_t
+FilterCache::get_max_size() const
+{
+    return internal->get_max_size();
+}
+
+size_t
+FilterCache::get_size() const
+{
+    return internal->get_size();
+}
+
+size_t
+FilterCache::get_entry_count() const
+{
+    return internal->get_entry_count();
+}
+
+size_t
+FilterCache::get_hits() const
+{
+    return internal->get_hits();
+}
+
+size_t
+FilterCache::get_misses() const
+{
+    return internal->get_misses();
+}
+
+void
+FilterCache::clear()
+{
+    internal->clear();
+}
+
+string
+FilterCache::get_description() const
+{
+    string desc = "FilterCache(max_size=";
+    desc += str(internal->get_max_size());
+    desc += ", size=";
+    desc += str(internal->get_size());
+    desc += ", entries=";
+    desc += str(internal->get_entry_count());
+    desc += ", hits=";
+    desc += str(internal->get_hits());
+    desc += ", misses=";
+    desc += str(internal->get_misses());
+    desc += ')';
+    return desc;
+}
+
+}
@@ -0,0 +1,76 @@
+/** @file filtercacheinternal.h
+ * @brief Cache of boolean filters which can be shared between Enquire objects
+ */
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef XAPIAN_INCLUDED_FILTERCACHEINTERNAL_H
+#define XAPIAN_INCLUDED_FILTERCACHEINTERNAL_H
+
+#include "xapian/filtercache.h"
+
+#include "lrucache.h"
+#include "matcher/docidbitmap.h"
+#include "xapian/types.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace Xapian {
+
+/// A cached filter for one shard.
+struct FilterCacheEntry {
+    /** The documents matching the filter.
+     *
+     *  NULL if the filter can't be replaced by a bitmap (we cache this so we
+     *  don't keep trying).
+     */
+    std::shared_ptr<const DocidBitmap> bitmap;
+
+    /// How much building the filter's postlist increases total_subqs.
+    Xapian::termcount total_subqs = 0;
+
+    /// What the filter's count_matching_subqs() returns for every match.
+    Xapian::termcount matching_subqs = 0;
+};
+
+/// Size we account for each entry in a FilterCache.
+struct FilterCacheEntrySize {
+    /// Allowance for the memory used to store each entry, besides the key.
+    static constexpr size_t ENTRY_OVERHEAD = 128;
+
+    size_t operator()(const std::string& key,
+		      const FilterCacheEntry& entry) const {
+	// The key is stored in both the list of entries and the index.
+	size_t result = 2 * key.size() + ENTRY_OVERHEAD;
+	if (entry.bitmap)
+	    result += entry.bitmap->get_bytes_used();
+	return result;
+    }
+};
+
+/// Xapian::FilterCache internals.
+class FilterCache::Internal
+    : public LRUCache<FilterCacheEntry, FilterCacheEntrySize> {
+  public:
+    typedef FilterCacheEntry Entry;
+
+    using LRUCache::LRUCache;
+};
+
+}
+
+#endif // XAPIAN_INCLUDED_FILTERCACHEINTERNAL_H
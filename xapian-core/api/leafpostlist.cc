@@ -28,6 +28,8 @@
 #include "omassert.h"
 #include "debuglog.h"
 
+#include <algorithm>
+
 using namespace std;
 
 LeafPostList::~LeafPostList()
@@ -69,6 +71,48 @@ LeafPostList::recalc_maxweight()
     return weight ? weight->get_maxpart() : 0;
 }
 
+Xapian::doccount
+LeafPostList::next_batch(Xapian::docid* dids,
+			 Xapian::termcount* wdfs,
+			 Xapian::doccount n)
+{
+    Xapian::doccount i = 0;
+    do {
+	(void)next(0.0);
+	if (at_end())
+	    break;
+	dids[i] = get_docid();
+	wdfs[i] = get_wdf();
+    } while (++i != n);
+    return i;
+}
+
+void
+LeafPostList::get_weights(Xapian::doccount n,
+			  const Xapian::termcount* wdfs,
+			  const Xapian::termcount* doclens,
+			  const Xapian::termcount* unique_terms,
+			  double* weights) const
+{
+    if (!weight) {
+	fill_n(weights, n, 0.0);
+	return;
+    }
+    weight->get_sumparts(n, wdfs, doclens, unique_terms, weights);
+}
+
+Xapian::termcount
+LeafPostList::get_block_wdf_max() const
+{
+    return Xapian::termcount(-1);
+}
+
+double
+LeafPostList::get_block_maxweight() const
+{
+    return weight ? weight->get_maxpart_for_wdf(get_block_wdf_max()) : 0;
+}
+
 TermFreqs
 LeafPostList::get_termfreq_est_using_stats(
 	const Xapian::Weight::Internal & stats) const
@@ -74,7 +74,8 @@ class LeafPostList : public PostList {
 				   Xapian::Weight::Internal * stats,
 				   Xapian::termcount qlen,
 				   Xapian::termcount wqf,
-				   double factor)
+				   double factor,
+				   bool add_max_part)
     {
 	weight_->init_(*stats, qlen, term, wqf, factor);
 	// There should be an existing LazyWeight set already.
@@ -82,6 +83,8 @@ class LeafPostList : public PostList {
 	const Xapian::Weight * const_weight_ = weight_;
 	std::swap(weight, const_weight_);
 	delete const_weight_;
+	if (!add_max_part)
+	    return weight->get_maxpart();
 	stats->termfreqs[term].max_part += weight->get_maxpart();
 	return stats->termfreqs[term].max_part;
     }
@@ -102,6 +105,92 @@ class LeafPostList : public PostList {
 
     double recalc_maxweight();
 
+    /** Advance and read a batch of postings.
+     *
+     *  This is like calling next(0.0) up to @a n times and reading the docid
+     *  and wdf after each call, but backends can override it to avoid the
+     *  virtual method calls per posting.
+     *
+     *  Fewer than @a n postings may be read (for example, an implementation
+     *  may stop at the end of a block so that a subsequent call to next() or
+     *  skip_to() has the chance to skip whole blocks).  Afterwards the
+     *  postlist is positioned on the last posting read, except that at_end()
+     *  may be true instead if there are no postings after it.
+     *
+     *  @param dids	Array to store docids in.
+     *  @param wdfs	Array to store the corresponding wdfs in.
+     *  @param n	The maximum number of postings to read (must be > 0).
+     *
+     *  @return The number of postings read (0 if and only if we were already
+     *		on the last posting).
+     */
+    virtual Xapian::doccount next_batch(Xapian::docid* dids,
+					Xapian::termcount* wdfs,
+					Xapian::doccount n);
+
+    /** Calculate the weights for a batch of postings.
+     *
+     *  Returns the same values get_weight() would if we were positioned on
+     *  each of the postings in turn.  If set_termweight() hasn't been called,
+     *  the weights are all 0.
+     *
+     *  @param n	    The number of postings.
+     *  @param wdfs	    The wdf of each posting.
+     *  @param doclens	    The length of each document.
+     *  @param unique_terms The number of unique terms in each document.
+     *  @param weights	    Array of @a n entries to store the weights in.
+     */
+    void get_weights(Xapian::doccount n,
+		     const Xapian::termcount* wdfs,
+		     const Xapian::termcount* doclens,
+		     const Xapian::termcount* unique_terms,
+		     double* weights) const;
+
+    /** Return the weight contribution for a posting with wdf @a wdf.
+     *
+     *  This is for use when postings have been read ahead with next_batch(),
+     *  so the current wdf isn't the one we want the weight for.
+     */
+    double get_weight_for_wdf(Xapian::termcount wdf,
+			      Xapian::termcount doclen,
+			      Xapian::termcount unique_terms) const {
+	return weight ? weight->get_sumpart(wdf, doclen, unique_terms) : 0;
+    }
+
+    /** Does get_weights() need the document lengths?
+     *
+     *  If not, zeros can be passed for these.
+     */
+    bool get_weights_needs_doclength() const {
+	return weight && weight->get_sumpart_needs_doclength_();
+    }
+
+    /** Does get_weights() need the numbers of unique terms?
+     *
+     *  If not, zeros can be passed for these.
+     */
+    bool get_weights_needs_unique_terms() const {
+	return weight && weight->get_sumpart_needs_uniqueterms_();
+    }
+
+    /** Return an upper bound on the wdf of entries in the current block.
+     *
+     *  Backends which store the maximum wdf for each block of postings
+     *  should override this.  The default implementation returns the
+     *  largest possible wdf value.
+     */
+    virtual Xapian::termcount get_block_wdf_max() const;
+
+    /** Return an upper bound on get_weight() for entries in the current
+     *  block.
+     *
+     *  Subclasses can use this to skip over whole blocks which can't reach
+     *  the w_min passed to next() or skip_to().
+     *
+     *  If set_termweight() hasn't been called, this returns 0.
+     */
+    double get_block_maxweight() const;
+
     TermFreqs get_termfreq_est_using_stats(
 	const Xapian::Weight::Internal & stats) const;
 
@@ -33,6 +33,9 @@
 #include <string>
 #include <vector>
 
+#include "backends/databaseinternal.h"
+#include "backends/documentinternal.h"
+#include "backends/valuedictionary.h"
 #include "debuglog.h"
 #include "heap.h"
 #include "omassert.h"
@@ -304,10 +307,54 @@ get_most_frequent_items(vector<StringAndFrequency> & result,
     }
 }
 
+struct ValueCountMatchSpy::Internal::OrdinalCounts {
+    /// The shard's dictionary (which stays valid if the shard drops it).
+    shared_ptr<const ValueDictionary> dict;
+
+    /// The count for each ordinal in dict (index 0 counts no value).
+    vector<Xapian::doccount> counts;
+};
+
+/// Add any counts by ordinal to the counts by value.
+static void
+flush_ordinal_counts(ValueCountMatchSpy::Internal& spy)
+{
+    auto& ordinal_counts = spy.ordinal_counts;
+    if (!ordinal_counts || !ordinal_counts->dict)
+	return;
+    const ValueDictionary& dict = *ordinal_counts->dict;
+    const auto& counts = ordinal_counts->counts;
+    for (uint32_t ordinal = 1; ordinal != counts.size(); ++ordinal) {
+	if (counts[ordinal])
+	    spy.values[dict.get_value(ordinal)] += counts[ordinal];
+    }
+    ordinal_counts->dict.reset();
+    ordinal_counts->counts.clear();
+}
+
 void
 ValueCountMatchSpy::operator()(const Document &doc, double) {
     Assert(internal.get());
     ++(internal->total);
+    const Document::Internal& doc_internal = *doc.internal;
+    auto db = doc_internal.get_database();
+    if (db && !doc_internal.values_modified()) {
+	const auto& dict = db->get_value_dictionary(internal->slot);
+	if (dict) {
+	    auto& ordinal_counts = internal->ordinal_counts;
+	    if (!ordinal_counts) {
+		ordinal_counts = make_shared<Internal::OrdinalCounts>();
+	    }
+	    if (ordinal_counts->dict != dict) {
+		// Starting on another shard (or the dictionary was reloaded).
+		flush_ordinal_counts(*internal);
+		ordinal_counts->dict = dict;
+		ordinal_counts->counts.resize(dict->size() + 1);
+	    }
+	    ++ordinal_counts->counts[dict->get_ordinal(doc_internal.get_docid())];
+	    return;
+	}
+    }
     string val(doc.get_value(internal->slot));
     if (!val.empty()) ++(internal->values[val]);
 }
@@ -316,6 +363,7 @@ TermIterator
 ValueCountMatchSpy::values_begin() const
 {
     Assert(internal.get());
+    flush_ordinal_counts(*internal);
     return Xapian::TermIterator(new ValueCountTermList(internal.get()));
 }
 
@@ -323,6 +371,7 @@ TermIterator
 ValueCountMatchSpy::top_values_begin(size_t maxvalues) const
 {
     Assert(internal.get());
+    flush_ordinal_counts(*internal);
     unique_ptr<StringAndFreqTermList> termlist(nullptr);
     if (usual(maxvalues > 0)) {
 	termlist.reset(new StringAndFreqTermList);
@@ -369,6 +418,7 @@ string
 ValueCountMatchSpy::serialise_results() const {
     LOGCALL(REMOTE, string, "ValueCountMatchSpy::serialise_results", NO_ARGS);
     Assert(internal.get());
+    flush_ordinal_counts(*internal);
     string result;
     pack_uint(result, internal->total);
     for (auto&& item : internal->values) {
@@ -406,6 +456,7 @@ string
 ValueCountMatchSpy::get_description() const {
     string d = "ValueCountMatchSpy(";
     if (internal.get()) {
+	flush_ordinal_counts(*internal);
 	d += str(internal->total);
 	d += " docs seen, looking in ";
 	d += str(internal->values.size());
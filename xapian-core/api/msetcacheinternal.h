@@ -0,0 +1,55 @@
+/** @file msetcacheinternal.h
+ * @brief Cache of search results which can be shared between Enquire objects
+ */
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef XAPIAN_INCLUDED_MSETCACHEINTERNAL_H
+#define XAPIAN_INCLUDED_MSETCACHEINTERNAL_H
+
+#include "xapian/msetcache.h"
+
+#include "lrucache.h"
+
+#include <cstddef>
+#include <string>
+
+namespace Xapian {
+
+/// Size we account for each entry in an MSetCache.
+struct MSetCacheEntrySize {
+    /// Allowance for the memory used to store each entry, besides the strings.
+    static constexpr size_t ENTRY_OVERHEAD = 128;
+
+    size_t operator()(const std::string& key,
+		      const std::string& value) const {
+	// The key is stored in both the list of entries and the index.
+	return 2 * key.size() + value.size() + ENTRY_OVERHEAD;
+    }
+};
+
+/** Xapian::MSetCache internals.
+ *
+ *  The values are serialised MSet objects.
+ */
+class MSetCache::Internal
+    : public LRUCache<std::string, MSetCacheEntrySize> {
+  public:
+    using LRUCache::LRUCache;
+};
+
+}
+
+#endif // XAPIAN_INCLUDED_MSETCACHEINTERNAL_H
@@ -29,10 +29,14 @@
 #include "xapian/unicode.h"
 
 #include "api/editdistance.h"
+#include "api/filtercacheinternal.h"
 #include "heap.h"
 #include "leafpostlist.h"
 #include "matcher/andmaybepostlist.h"
 #include "matcher/andnotpostlist.h"
+#include "matcher/batchpostlist.h"
+#include "matcher/bitmappostlist.h"
+#include "matcher/blockandpostlist.h"
 #include "matcher/boolorpostlist.h"
 #include "matcher/exactphrasepostlist.h"
 #include "matcher/externalpostlist.h"
@@ -58,6 +62,7 @@
 #include "unicode/description_append.h"
 
 #include <algorithm>
+#include <cmath>
 #include <functional>
 #include <list>
 #include <memory>
@@ -82,6 +87,12 @@ struct PostListAndTermFreq {
     PostList* pl;
     Xapian::doccount tf = 0;
 
+    /** If set, this is pl and it can be read in batches.
+     *
+     *  Used by OrContext - see OrContext::add_batch_postlist().
+     */
+    LeafPostList* batch_leaf = nullptr;
+
     PostListAndTermFreq() : pl(nullptr) {}
 
     explicit
@@ -386,13 +397,67 @@ done_skip_to:
 }
 
 class BoolOrContext : public Context<PostList*> {
+    /** Are all the postlists for terms?
+     *
+     *  Term postlists are unweighted here so don't contribute to
+     *  count_matching_subqs(), which means their union can be evaluated as a
+     *  bitmap.
+     */
+    bool only_terms = true;
+
+    /** Were wdf or positions needed when we were constructed?
+     *
+     *  For wildcard expansions, qopt->in_synonym is restored before
+     *  postlist() is called.
+     */
+    bool need_wdf_or_positions;
+
+    /// Is it worth evaluating the union by decoding it into a bitmap?
+    bool use_bitmap() const;
+
   public:
+    /// Fewer postlists than this are always combined using a heap.
+    static constexpr size_t BITMAP_MIN_POSTLISTS = 16;
+
     BoolOrContext(QueryOptimiser* qopt_, size_t reserve)
-	: Context(qopt_, reserve) { }
+	: Context(qopt_, reserve),
+	  need_wdf_or_positions(qopt_->in_synonym || qopt_->need_positions) { }
+
+    /// Add a postlist which may not be for a term.
+    void add_other_postlist(PostList* pl) {
+	only_terms = false;
+	add_postlist(pl);
+    }
 
     PostList * postlist();
 };
 
+bool
+BoolOrContext::use_bitmap() const
+{
+    // A bitmap can't supply wdf or positions.
+    if (!only_terms || need_wdf_or_positions ||
+	qopt->in_synonym || qopt->need_positions)
+	return false;
+    size_t n = pls.size();
+    if (n < BITMAP_MIN_POSTLISTS)
+	return false;
+
+    // Maintaining the heap costs O(log(n)) per posting, whereas decoding into
+    // a bitmap costs O(1) per posting plus a pass over a bitset covering the
+    // docid range.  When matching a range of docids, both only process the
+    // postings in that range (the bitmap decode stops at the end of the
+    // range) so both costs scale by the fraction of the docids the range
+    // covers and we can compare them for the whole shard.
+    double postings = 0;
+    for (auto pl : pls) {
+	postings += pl->get_termfreq_est();
+    }
+    double heap_cost = postings * log2(double(n));
+    double bitmap_cost = postings + qopt->db.get_lastdocid() / 64.0;
+    return bitmap_cost < heap_cost;
+}
+
 PostList *
 BoolOrContext::postlist()
 {
@@ -405,7 +470,8 @@ BoolOrContext::postlist()
 	    pl = pls[0];
 	    break;
 	default:
-	    pl = new BoolOrPostList(pls.begin(), pls.end(), qopt->db_size);
+	    pl = new BoolOrPostList(pls.begin(), pls.end(), qopt->db_size,
+				    use_bitmap(), qopt->matcher);
     }
 
     // Empty pls so our destructor doesn't delete them all!
@@ -418,6 +484,16 @@ class OrContext : public Context<PostListAndTermFreq> {
     OrContext(QueryOptimiser* qopt_, size_t reserve)
 	: Context(qopt_, reserve) { }
 
+    /** Add a weighted LeafPostList which can be read in batches.
+     *
+     *  The postlist will be wrapped in a BatchPostList if it ends up as one
+     *  of the subqueries of an OrPostList.
+     */
+    void add_batch_postlist(LeafPostList* pl) {
+	pls.emplace_back(pl);
+	pls.back().batch_leaf = pl;
+    }
+
     /// Select the best set_size postlists from the last out_of added.
     void select_elite_set(size_t set_size, size_t out_of);
 
@@ -451,6 +527,15 @@ OrContext::postlist()
     init_tf();
     Heap::make(pls.begin(), pls.end(), ComparePostListTermFreqAscending());
 
+    // We expect to look at most of the postings of the subqueries of an OR,
+    // so it's worth reading leaf postlists in batches.
+    for (auto&& elt : pls) {
+	if (elt.batch_leaf) {
+	    elt.pl = new BatchPostList(elt.batch_leaf, qopt->db);
+	    elt.batch_leaf = nullptr;
+	}
+    }
+
     // Now build a tree of binary OrPostList objects.
     //
     // The algorithm used to build the tree is like that used to build an
@@ -564,6 +649,9 @@ class AndContext : public Context<PostList*> {
      */
     bool match_all = false;
 
+    /// True if all the PostLists in pls are LeafPostList objects.
+    bool all_leaves = true;
+
   public:
     AndContext(QueryOptimiser* qopt_, size_t reserve)
 	: Context(qopt_, reserve) { }
@@ -575,9 +663,14 @@ class AndContext : public Context<PostList*> {
 	    return false;
 	}
 	pls.emplace_back(pl);
+	all_leaves = false;
 	return true;
     }
 
+    void add_leaf_postlist(LeafPostList* pl) {
+	pls.emplace_back(pl);
+    }
+
     void set_match_all() { match_all = true; }
 
     void add_pos_filter(Query::op op_,
@@ -651,6 +744,11 @@ AndContext::postlist()
     unique_ptr<PostList> pl;
     if (pls.size() == 1) {
 	pl.reset(pls[0]);
+    } else if (all_leaves && pos_filters.empty() && !qopt->need_positions) {
+	// BlockAndPostList reads ahead in its sub-postlists, which is only OK
+	// if nothing needs their positional information.
+	pl.reset(new BlockAndPostList(pls.begin(), pls.end(),
+				      matcher, db_size));
     } else {
 	pl.reset(new MultiAndPostList(pls.begin(), pls.end(),
 				      matcher, db_size));
@@ -1003,7 +1101,7 @@ void
 Query::Internal::postlist_sub_bool_or_like(BoolOrContext& ctx,
 					   QueryOptimiser * qopt) const
 {
-    ctx.add_postlist(postlist(qopt, 0.0));
+    ctx.add_other_postlist(postlist(qopt, 0.0));
 }
 
 void
@@ -1115,6 +1213,36 @@ QueryTerm::postlist(QueryOptimiser * qopt, double factor) const
     RETURN(qopt->open_post_list(term, wqf, factor));
 }
 
+void
+QueryTerm::postlist_sub_or_like(OrContext& ctx,
+				QueryOptimiser* qopt,
+				double factor,
+				bool keep_zero_weight) const
+{
+    if (factor == 0.0 || qopt->need_positions || qopt->in_synonym) {
+	Query::Internal::postlist_sub_or_like(ctx, qopt, factor,
+					      keep_zero_weight);
+	return;
+    }
+
+    Xapian::termcount save_total_subqs = qopt->get_total_subqs();
+    qopt->inc_total_subqs();
+    unique_ptr<LeafPostList> pl(qopt->open_post_list(term, wqf, factor));
+    if (!keep_zero_weight && pl->recalc_maxweight() == 0.0) {
+	// This subquery can't contribute any weight, so can be discarded.
+	qopt->set_total_subqs(save_total_subqs);
+	return;
+    }
+    ctx.add_batch_postlist(pl.release());
+}
+
+void
+QueryTerm::postlist_sub_bool_or_like(BoolOrContext& ctx,
+				     QueryOptimiser* qopt) const
+{
+    ctx.add_postlist(postlist(qopt, 0.0));
+}
+
 bool
 QueryTerm::postlist_sub_and_like(AndContext& ctx,
 				 QueryOptimiser* qopt,
@@ -1125,7 +1253,10 @@ QueryTerm::postlist_sub_and_like(AndContext& ctx,
 	ctx.set_match_all();
 	return true;
     }
-    return ctx.add_postlist(postlist(qopt, factor));
+    if (factor != 0.0)
+	qopt->inc_total_subqs();
+    ctx.add_leaf_postlist(qopt->open_post_list(term, wqf, factor));
+    return true;
 }
 
 PostList*
@@ -2382,16 +2513,99 @@ QueryAndMaybe::postlist_sub_and_like(AndContext& ctx,
     return true;
 }
 
+bool
+QueryFilter::filter_from_cache(QueryOptimiser* qopt, PostList*& pl) const
+{
+    auto cache = qopt->get_filter_cache();
+    if (!cache || qopt->need_positions || qopt->in_synonym)
+	return false;
+    if (subqueries.size() == 2) {
+	// A single term is already a posting list, so there's little to gain.
+	auto type = subqueries[1].get_type();
+	if (type == Query::LEAF_TERM || type == Query::LEAF_MATCH_ALL)
+	    return false;
+    }
+
+    string key;
+    if (!qopt->db.append_revision_key(key))
+	return false;
+    try {
+	for (size_t i = 1; i != subqueries.size(); ++i) {
+	    pack_string(key, subqueries[i].serialise());
+	}
+    } catch (const Xapian::UnimplementedError&) {
+	// Something doesn't support serialisation, so we can't build a key.
+	return false;
+    }
+
+    FilterCache::Internal::Entry entry;
+    if (!cache->find(key, entry)) {
+	// Run the filter subqueries and store the docids they match.
+	Xapian::termcount save_total_subqs = qopt->get_total_subqs();
+	AndContext ctx(qopt, subqueries.size() - 1);
+	unique_ptr<PostList> fpl;
+	bool matches_nothing = false;
+	for (size_t i = 1; i != subqueries.size(); ++i) {
+	    if (!subqueries[i].internal->postlist_sub_and_like(ctx, qopt,
+							       0.0)) {
+		matches_nothing = true;
+		break;
+	    }
+	}
+	if (!matches_nothing)
+	    fpl.reset(ctx.postlist());
+	entry.total_subqs = qopt->get_total_subqs() - save_total_subqs;
+	qopt->set_total_subqs(save_total_subqs);
+
+	auto bitmap = make_shared<DocidBitmap>();
+	bool first = true;
+	while (fpl) {
+	    PostList* result = fpl->next(0.0);
+	    if (result) fpl.reset(result);
+	    if (fpl->at_end()) break;
+	    // The bitmap can only stand in for the filter if it would always
+	    // give the same count_matching_subqs(), which it will unless there
+	    // are weird things like value ranges in an OR.
+	    Xapian::termcount subqs = fpl->count_matching_subqs();
+	    if (first) {
+		entry.matching_subqs = subqs;
+		first = false;
+	    } else if (subqs != entry.matching_subqs) {
+		bitmap.reset();
+		break;
+	    }
+	    bitmap->add(fpl->get_docid());
+	}
+	if (bitmap) {
+	    bitmap->done();
+	    entry.bitmap = std::move(bitmap);
+	}
+	cache->add(key, entry);
+    }
+
+    if (!entry.bitmap)
+	return false;
+    qopt->set_total_subqs(qopt->get_total_subqs() + entry.total_subqs);
+    pl = NULL;
+    if (entry.bitmap->get_size() != 0)
+	pl = new BitmapPostList(entry.bitmap, entry.matching_subqs);
+    return true;
+}
+
 PostList*
 QueryFilter::postlist(QueryOptimiser * qopt, double factor) const
 {
     LOGCALL(QUERY, PostList*, "QueryFilter::postlist", qopt | factor);
+    if (subqueries.size() != 2) {
+	// Several filters are combined using an AndContext.
+	RETURN(QueryAndLike::postlist(qopt, factor));
+    }
     // FIXME: Combine and-like stuff, like QueryOptimiser.
-    AssertEq(subqueries.size(), 2);
     PostList * pls[2];
     unique_ptr<PostList> l(subqueries[0].internal->postlist(qopt, factor));
     if (!l.get()) RETURN(NULL);
-    pls[1] = subqueries[1].internal->postlist(qopt, 0.0);
+    if (!filter_from_cache(qopt, pls[1]))
+	pls[1] = subqueries[1].internal->postlist(qopt, 0.0);
     if (!pls[1]) RETURN(NULL);
     pls[0] = l.release();
     RETURN(new MultiAndPostList(pls, pls + 2, qopt->matcher, qopt->db_size));
@@ -2400,14 +2614,20 @@ QueryFilter::postlist(QueryOptimiser * qopt, double factor) const
 bool
 QueryFilter::postlist_sub_and_like(AndContext& ctx, QueryOptimiser * qopt, double factor) const
 {
+    // MatchNothing subqueries should have been removed by done().
+    Assert(subqueries[0].internal.get());
+    if (!subqueries[0].internal->postlist_sub_and_like(ctx, qopt, factor))
+	return false;
+    PostList* pl;
+    if (filter_from_cache(qopt, pl))
+	return ctx.add_postlist(pl);
+
+    // Second and subsequent subqueries are unweighted.
     QueryVector::const_iterator i;
-    for (i = subqueries.begin(); i != subqueries.end(); ++i) {
-	// MatchNothing subqueries should have been removed by done().
+    for (i = subqueries.begin() + 1; i != subqueries.end(); ++i) {
 	Assert((*i).internal.get());
-	if (!(*i).internal->postlist_sub_and_like(ctx, qopt, factor))
+	if (!(*i).internal->postlist_sub_and_like(ctx, qopt, 0.0))
 	    return false;
-	// Second and subsequent subqueries are unweighted.
-	factor = 0.0;
     }
     return true;
 }
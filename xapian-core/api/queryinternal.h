@@ -62,6 +62,12 @@ class QueryTerm : public Query::Internal {
 
     PostList* postlist(QueryOptimiser * qopt, double factor) const;
 
+    void postlist_sub_or_like(OrContext& ctx, QueryOptimiser* qopt,
+			      double factor, bool keep_zero_weight) const;
+
+    void postlist_sub_bool_or_like(BoolOrContext& ctx,
+				   QueryOptimiser* qopt) const;
+
     bool postlist_sub_and_like(AndContext& ctx,
 			       QueryOptimiser* qopt,
 			       double factor) const;
@@ -83,6 +89,8 @@ class QueryPostingSource : public Query::Internal {
   public:
     explicit QueryPostingSource(PostingSource * source_);
 
+    PostingSource* get_posting_source() const { return source.get(); }
+
     PostList* postlist(QueryOptimiser *qopt, double factor) const;
 
     void serialise(std::string & result) const;
@@ -338,6 +346,16 @@ class QueryAndMaybe : public QueryBranch {
 class QueryFilter : public QueryAndLike {
     Xapian::Query::op get_op() const;
 
+    /** Get a postlist for the filter subqueries from the filter cache.
+     *
+     *  @param qopt	The QueryOptimiser.
+     *  @param pl	Set to the postlist, or NULL if the filter matches
+     *			nothing.
+     *
+     *  @return false if the cache can't be used.
+     */
+    bool filter_from_cache(QueryOptimiser* qopt, PostList*& pl) const;
+
   public:
     explicit QueryFilter(size_t n_subqueries) : QueryAndLike(n_subqueries) { }
 
@@ -0,0 +1,894 @@
+/** @file
+ * @brief Writable database made of segments merged in the background
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include <config.h>
+
+#include <xapian/segmenteddatabase.h>
+
+#include <xapian/compactor.h>
+#include <xapian/constants.h>
+#include <xapian/database.h>
+#include <xapian/document.h>
+#include <xapian/error.h>
+
+#include "backends/deletionlistdatabase.h"
+#include "backends/flint_lock.h"
+#include "debuglog.h"
+#include "filetests.h"
+#include "fileutils.h"
+#include "io_utils.h"
+#include "omassert.h"
+#include "parseint.h"
+#include "safedirent.h"
+#include "safesysstat.h"
+#include "safeunistd.h"
+#include "str.h"
+#include "stringutils.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace Xapian {
+
+class SegmentedDatabase::Internal {
+    /** A sealed segment.
+     *
+     *  Sealed segments are honey databases, so they're never modified.
+     *  Documents deleted from them are listed in a deletion list file,
+     *  which readers apply (see DeletionListDatabase).
+     */
+    struct Segment {
+	/// Directory name of the segment, relative to the database directory.
+	string name;
+
+	/// How many rounds of merging produced this segment.
+	unsigned tier;
+
+	/// Is this segment being merged?
+	bool merging = false;
+
+	/** Is this segment listed in the stub file?
+	 *
+	 *  A segment sealed by add_document() is only listed at the next
+	 *  commit(), and can't be merged before then.
+	 */
+	bool published = false;
+
+	/// The documents deleted from this segment.
+	set<Xapian::docid> deleted;
+
+	/// The documents in deleted which haven't been committed yet.
+	set<Xapian::docid> pending;
+
+	/// The deletion list file in the stub file (empty if none).
+	string deleted_file;
+
+	/// Used to look up terms to delete by (opened when first needed).
+	Database reader;
+
+	/// Is reader open?
+	bool reader_open = false;
+
+	Segment(const string& name_, unsigned tier_)
+	    : name(name_), tier(tier_) { }
+    };
+
+    /// The database directory.
+    string path;
+
+    /// The number of documents after which the active segment is sealed.
+    Xapian::doccount segment_size;
+
+    /// How many segments of the same tier to merge at once.
+    unsigned merge_factor;
+
+    /// Lock preventing other SegmentedDatabase objects opening the database.
+    FlintLock lock;
+
+    /** Protects the members below which the merge thread uses.
+     *
+     *  The merge thread doesn't use the active segment, so the main thread
+     *  can use it without holding the mutex.  Neither thread holds the
+     *  mutex while compacting or copying documents.
+     */
+    mutable mutex segments_mutex;
+
+    /// The sealed segments, oldest first.
+    vector<unique_ptr<Segment>> segments;
+
+    /// Number used to name the next segment or deletion list file.
+    unsigned next_segment_number = 0;
+
+    /// Is a merge thread running?
+    bool merge_running = false;
+
+    /// The first exception thrown by the merge thread and not yet reported.
+    exception_ptr merge_error;
+
+    /// Have the segments changed since the stub file was written?
+    bool stub_changed = false;
+
+    /** Files and segments to remove once the stub file is written.
+     *
+     *  These are still listed in the stub file on disk, but not in
+     *  segments.
+     */
+    vector<string> obsolete;
+
+    /// The active segment, if there is one.
+    WritableDatabase active;
+
+    /// Is there an active segment?
+    bool active_open = false;
+
+    /// The merge thread.
+    thread merge_thread;
+
+    /// Has close() been called?
+    bool closed = false;
+
+    /// Return the path of a file or directory in the database directory.
+    string segment_path(const string& name) const {
+	return path + "/" + name;
+    }
+
+    /// Return the path of the active segment.
+    string active_path() const { return segment_path("active"); }
+
+    /// Return the name for a new segment of tier @a tier.
+    string new_segment_name(unsigned tier) {
+	return "t" + str(tier) + "_" + str(next_segment_number++);
+    }
+
+    /// Return the name for a new deletion list file for @a segment.
+    string new_deletion_file_name(const Segment& segment) {
+	return segment.name + ".del" + str(next_segment_number++);
+    }
+
+    /// Read the stub file listing the segments of an existing database.
+    void read_stub();
+
+    /** Remove files and directories which the stub file doesn't refer to.
+     *
+     *  These are left behind if we didn't close cleanly (for example, the
+     *  active segment, or the output of an unfinished merge).
+     */
+    void remove_unused_files();
+
+    /// Write the stub file listing the published segments.
+    void write_stub() const;
+
+    /** Write the stub file and collect the files it no longer refers to.
+     *
+     *  The mutex must be held.  If writing the stub file fails, it'll be
+     *  tried again by the next call.
+     *
+     *  @param[out] unused	The files and directories to remove, which
+     *				should be done once the mutex is released.
+     */
+    void publish(vector<string>& unused);
+
+    /// Remove files and directories, ignoring errors.
+    static void remove_files(const vector<string>& paths);
+
+    /** Seal the active segment.
+     *
+     *  The active segment is compacted to a honey segment, which is listed
+     *  in the stub file by the next commit().
+     */
+    void seal_active();
+
+    /// Check the database hasn't been closed.
+    void check_open() const {
+	if (closed)
+	    throw InvalidOperationError("SegmentedDatabase has been closed");
+    }
+
+    /** Choose segments to merge, and mark them as being merged.
+     *
+     *  We merge the oldest merge_factor segments of the lowest tier which
+     *  has that many published segments not already being merged.
+     *
+     *  @return true if a merge was chosen.
+     */
+    bool choose_merge(vector<Segment*>& inputs);
+
+    /// Merge segments until there's nothing left worth merging.
+    void merge_loop();
+
+    /** Merge @a inputs into a new segment called @a output.
+     *
+     *  The merge runs without the mutex held, and then the mutex is taken to
+     *  replace the inputs with the new segment.
+     *
+     *  @param inputs	The segments to merge.
+     *  @param purge	The deleted documents to leave out of the new segment,
+     *			for each input.
+     *  @param output	The name of the new segment.
+     */
+    void merge(const vector<Segment*>& inputs,
+	       const vector<set<Xapian::docid>>& purge,
+	       const string& output);
+
+    /// Take any exception the merge thread has thrown (the mutex must be held).
+    exception_ptr take_merge_error() {
+	exception_ptr e = merge_error;
+	merge_error = nullptr;
+	return e;
+    }
+
+  public:
+    Internal(const string& path_, Xapian::doccount segment_size_,
+	     unsigned merge_factor_);
+
+    ~Internal() {
+	if (merge_thread.joinable())
+	    merge_thread.join();
+    }
+
+    void add_document(const Document& document);
+
+    void delete_document(const string& unique_term);
+
+    void commit();
+
+    void wait_for_merges();
+
+    size_t get_segment_count() const {
+	lock_guard<mutex> guard(segments_mutex);
+	return segments.size() + active_open;
+    }
+
+    void close();
+};
+
+/** Parse a segment name of the form "t<tier>_<number>".
+ *
+ *  @return true if @a name is a valid segment name.
+ */
+static bool
+parse_segment_name(const string& name, unsigned& tier, unsigned& number)
+{
+    string::size_type underscore = name.find('_');
+    return startswith(name, 't') &&
+	   underscore != string::npos &&
+	   parse_unsigned(name.substr(1, underscore - 1).c_str(), tier) &&
+	   parse_unsigned(name.c_str() + underscore + 1, number);
+}
+
+SegmentedDatabase::Internal::Internal(const string& path_,
+				      Xapian::doccount segment_size_,
+				      unsigned merge_factor_)
+    : path(path_),
+      segment_size(segment_size_ ? segment_size_ : 10000),
+      merge_factor(merge_factor_ ? merge_factor_ : 10),
+      lock(path_)
+{
+    if (merge_factor < 2)
+	throw InvalidArgumentError("merge_factor must be at least 2");
+
+    if (mkdir(path.c_str(), 0755) < 0) {
+	int mkdir_errno = errno;
+	if (mkdir_errno != EEXIST || !dir_exists(path)) {
+	    throw DatabaseCreateError("Cannot create directory '" + path + "'",
+				      mkdir_errno);
+	}
+    }
+
+    string explanation;
+    FlintLock::reason why = lock.lock(true, false, explanation);
+    if (why != FlintLock::SUCCESS) {
+	lock.throw_databaselockerror(why, path, explanation);
+    }
+
+    if (file_exists(path + "/XAPIANDB")) {
+	read_stub();
+	remove_unused_files();
+    } else {
+	// Write an empty stub so readers can open the database straight away.
+	write_stub();
+    }
+}
+
+void
+SegmentedDatabase::Internal::read_stub()
+{
+    string stub_file = path + "/XAPIANDB";
+    ifstream stub(stub_file.c_str());
+    if (!stub) {
+	throw DatabaseOpeningError("Couldn't open stub database file: " +
+				   stub_file, errno);
+    }
+    string line;
+    while (getline(stub, line)) {
+	if (line.empty() || line[0] == '#')
+	    continue;
+	unsigned tier, number;
+	if (startswith(line, "honey ")) {
+	    string name(line, 6);
+	    if (parse_segment_name(name, tier, number)) {
+		unique_ptr<Segment> segment(new Segment(name, tier));
+		segment->published = true;
+		segments.push_back(std::move(segment));
+		next_segment_number = max(next_segment_number, number + 1);
+		continue;
+	    }
+	} else if (startswith(line, "deleted ") && !segments.empty()) {
+	    // A deletion list for the segment on the previous line, named
+	    // "<segment>.del<number>".
+	    Segment& segment = *segments.back();
+	    string file(line, 8);
+	    string prefix = segment.name + ".del";
+	    if (segment.deleted_file.empty() &&
+		startswith(file, prefix) &&
+		parse_unsigned(file.c_str() + prefix.size(), number)) {
+		vector<Xapian::docid> dids;
+		DeletionListDatabase::read_file(segment_path(file), dids);
+		segment.deleted.insert(dids.begin(), dids.end());
+		segment.deleted_file = file;
+		next_segment_number = max(next_segment_number, number + 1);
+		continue;
+	    }
+	}
+	throw DatabaseCorruptError("Bad line in segmented database stub "
+				   "file '" + stub_file + "': " + line);
+    }
+}
+
+void
+SegmentedDatabase::Internal::remove_unused_files()
+{
+    set<string> used;
+    for (auto& segment : segments) {
+	used.insert(segment->name);
+	if (!segment->deleted_file.empty())
+	    used.insert(segment->deleted_file);
+    }
+
+    vector<string> unused;
+    DIR* dir = opendir(path.c_str());
+    if (dir == NULL) {
+	throw DatabaseOpeningError("Cannot open directory '" + path + "'",
+				   errno);
+    }
+    while (struct dirent* entry = readdir(dir)) {
+	string name(entry->d_name);
+	// Only touch names we might have created: segments (and the
+	// temporary databases and deletion lists named after them), the
+	// active segment, and a stub file we didn't finish writing.
+	bool ours = (name.size() > 1 && name[0] == 't' && C_isdigit(name[1])) ||
+		    name == "active" ||
+		    name == "XAPIANDB.tmp";
+	if (ours && used.find(name) == used.end())
+	    unused.push_back(segment_path(name));
+    }
+    closedir(dir);
+    remove_files(unused);
+}
+
+void
+SegmentedDatabase::Internal::write_stub() const
+{
+    string stub_file = path + "/XAPIANDB";
+    string new_stub_file = stub_file + ".tmp";
+    {
+	ofstream new_stub(new_stub_file.c_str());
+	new_stub << "# Segments written by Xapian::SegmentedDatabase\n";
+	for (auto& segment : segments) {
+	    if (!segment->published)
+		continue;
+	    new_stub << "honey " << segment->name << '\n';
+	    if (!segment->deleted_file.empty())
+		new_stub << "deleted " << segment->deleted_file << '\n';
+	}
+	if (!new_stub.flush()) {
+	    throw DatabaseError("Couldn't write '" + new_stub_file + "'",
+				errno);
+	}
+    }
+    if (!io_tmp_rename(new_stub_file, stub_file)) {
+	string msg = "Cannot rename '";
+	msg += new_stub_file;
+	msg += "' to '";
+	msg += stub_file;
+	msg += '\'';
+	throw DatabaseError(msg, errno);
+    }
+}
+
+void
+SegmentedDatabase::Internal::publish(vector<string>& unused)
+{
+    stub_changed = true;
+    write_stub();
+    stub_changed = false;
+    unused.insert(unused.end(), obsolete.begin(), obsolete.end());
+    obsolete.clear();
+}
+
+void
+SegmentedDatabase::Internal::remove_files(const vector<string>& paths)
+{
+    // Readers which already have these open can carry on using them after
+    // they're removed (on platforms which allow this).
+    for (auto& p : paths) {
+	try {
+	    if (dir_exists(p)) {
+		removedir(p);
+	    } else {
+		unlink(p.c_str());
+	    }
+	} catch (const Error&) {
+	    // A file we failed to remove is just wasted space.
+	}
+    }
+}
+
+void
+SegmentedDatabase::Internal::seal_active()
+{
+    active.commit();
+    if (active.get_doccount() != 0) {
+	string name;
+	{
+	    lock_guard<mutex> guard(segments_mutex);
+	    name = new_segment_name(0);
+	}
+	try {
+	    Database db(active_path(), DB_BACKEND_GLASS);
+	    db.compact(segment_path(name), DB_BACKEND_HONEY | Compactor::FULL);
+	} catch (...) {
+	    // Leave the active segment open so we can try again.
+	    remove_files({segment_path(name)});
+	    throw;
+	}
+	lock_guard<mutex> guard(segments_mutex);
+	segments.emplace_back(new Segment(name, 0));
+    }
+    active.close();
+    active = WritableDatabase();
+    active_open = false;
+    remove_files({active_path()});
+}
+
+bool
+SegmentedDatabase::Internal::choose_merge(vector<Segment*>& inputs)
+{
+    // The tiers in ascending order, with the segments of each which can be
+    // merged, oldest first.
+    vector<pair<unsigned, vector<Segment*>>> tiers;
+    for (auto& segment : segments) {
+	if (segment->merging || !segment->published)
+	    continue;
+	auto i = lower_bound(tiers.begin(), tiers.end(),
+			     make_pair(segment->tier, vector<Segment*>()));
+	if (i == tiers.end() || i->first != segment->tier)
+	    i = tiers.insert(i, make_pair(segment->tier, vector<Segment*>()));
+	i->second.push_back(segment.get());
+    }
+    for (auto& tier : tiers) {
+	if (tier.second.size() >= merge_factor) {
+	    inputs.assign(tier.second.begin(),
+			  tier.second.begin() + merge_factor);
+	    for (auto segment : inputs) {
+		segment->merging = true;
+	    }
+	    return true;
+	}
+    }
+    return false;
+}
+
+void
+SegmentedDatabase::Internal::merge_loop()
+{
+    while (true) {
+	vector<Segment*> inputs;
+	vector<set<Xapian::docid>> purge;
+	string output;
+	{
+	    lock_guard<mutex> guard(segments_mutex);
+	    if (!choose_merge(inputs)) {
+		merge_running = false;
+		return;
+	    }
+	    // Leave out the documents whose deletion has been committed.
+	    // Deletions which are still pending are carried over to the new
+	    // segment, since they may yet be committed.
+	    for (auto segment : inputs) {
+		purge.emplace_back();
+		set_difference(segment->deleted.begin(), segment->deleted.end(),
+			       segment->pending.begin(), segment->pending.end(),
+			       inserter(purge.back(), purge.back().end()));
+	    }
+	    output = new_segment_name(inputs[0]->tier + 1);
+	}
+	try {
+	    merge(inputs, purge, output);
+	} catch (...) {
+	    lock_guard<mutex> guard(segments_mutex);
+	    // Only one merge runs at once, so any segments marked as being
+	    // merged were inputs to this one.
+	    for (auto& segment : segments) {
+		segment->merging = false;
+	    }
+	    if (!merge_error)
+		merge_error = current_exception();
+	    merge_running = false;
+	    return;
+	}
+    }
+}
+
+void
+SegmentedDatabase::Internal::merge(const vector<Segment*>& inputs,
+				   const vector<set<Xapian::docid>>& purge,
+				   const string& output)
+{
+    LOGCALL_VOID(API, "SegmentedDatabase::Internal::merge", inputs.size() | output);
+    // Segments are never modified, and only the merge thread removes them,
+    // so we can read the inputs without holding the mutex.
+    vector<Database> shards;
+    Database db;
+    for (auto segment : inputs) {
+	shards.emplace_back(segment_path(segment->name), DB_BACKEND_HONEY);
+	db.add_database(shards.back());
+    }
+
+    // Work out how compaction will renumber the documents in each input, so
+    // we can map deleted docids to the new segment.  This must match what
+    // Database::compact() does.
+    vector<Xapian::docid> offset;
+    Xapian::docid tot_off = 0;
+    Xapian::doccount live = 0;
+    bool purging = false;
+    for (size_t i = 0; i != shards.size(); ++i) {
+	Xapian::docid first = 0, last = 0;
+	if (shards[i].get_doccount() != 0)
+	    shards[i].internal->get_used_docid_range(first, last);
+	if (first)
+	    tot_off -= (first - 1);
+	offset.push_back(tot_off);
+	tot_off += last;
+	live += shards[i].get_doccount() - purge[i].size();
+	if (!purge[i].empty())
+	    purging = true;
+    }
+
+    string output_path = segment_path(output);
+    string tmp_path = output_path + ".tmp";
+    string deleted_file;
+    try {
+	if (live == 0) {
+	    // Everything has been deleted, so the inputs are just removed.
+	} else if (!purging) {
+	    db.compact(output_path, DB_BACKEND_HONEY | Compactor::FULL);
+	} else {
+	    // Honey databases can only be compacted to honey, so copy the
+	    // documents we're keeping to a temporary glass database with the
+	    // docids compaction would give them, then compact that.
+	    {
+		WritableDatabase tmp(tmp_path,
+				     DB_CREATE_OR_OVERWRITE | DB_BACKEND_GLASS);
+		for (size_t i = 0; i != shards.size(); ++i) {
+		    const Database& shard = shards[i];
+		    for (auto p = shard.postlist_begin(string());
+			 p != shard.postlist_end(string()); ++p) {
+			Xapian::docid did = *p;
+			if (purge[i].find(did) != purge[i].end())
+			    continue;
+			tmp.replace_document(did + offset[i],
+					     shard.get_document(did));
+		    }
+		}
+		tmp.commit();
+	    }
+	    Database(tmp_path, DB_BACKEND_GLASS).compact(output_path,
+							 DB_BACKEND_HONEY |
+							 Compactor::FULL |
+							 DBCOMPACT_NO_RENUMBER);
+	    removedir(tmp_path);
+	}
+    } catch (...) {
+	remove_files({tmp_path, output_path});
+	throw;
+    }
+
+    unique_lock<mutex> guard(segments_mutex);
+
+    // Carry over deletions made since we chose the inputs, and those which
+    // are still pending.
+    unique_ptr<Segment> merged;
+    if (live != 0) {
+	merged.reset(new Segment(output, inputs[0]->tier + 1));
+	merged->published = true;
+    }
+    set<Xapian::docid> committed;
+    vector<string> removable;
+    for (size_t i = 0; i != inputs.size(); ++i) {
+	const Segment& input = *inputs[i];
+	for (Xapian::docid did : input.deleted) {
+	    if (purge[i].find(did) != purge[i].end())
+		continue;
+	    // If nothing is left, there can't be any more deletions.
+	    Assert(merged);
+	    merged->deleted.insert(did + offset[i]);
+	    if (input.pending.find(did) != input.pending.end()) {
+		merged->pending.insert(did + offset[i]);
+	    } else {
+		committed.insert(did + offset[i]);
+	    }
+	}
+	removable.push_back(segment_path(input.name));
+	if (!input.deleted_file.empty())
+	    removable.push_back(segment_path(input.deleted_file));
+    }
+    if (!committed.empty()) {
+	string file = new_deletion_file_name(*merged);
+	try {
+	    DeletionListDatabase::write_file(segment_path(file), committed);
+	} catch (...) {
+	    guard.unlock();
+	    remove_files({segment_path(file), output_path});
+	    throw;
+	}
+	merged->deleted_file = file;
+    }
+
+    // Put the merged segment where the oldest input was.
+    vector<unique_ptr<Segment>> new_segments;
+    new_segments.reserve(segments.size() - inputs.size() + 1);
+    vector<unique_ptr<Segment>> old_segments;
+    for (auto& segment : segments) {
+	if (find(inputs.begin(), inputs.end(), segment.get()) == inputs.end()) {
+	    new_segments.push_back(std::move(segment));
+	    continue;
+	}
+	if (old_segments.empty() && merged) {
+	    new_segments.push_back(std::move(merged));
+	}
+	old_segments.push_back(std::move(segment));
+    }
+    swap(segments, new_segments);
+    obsolete.insert(obsolete.end(), removable.begin(), removable.end());
+
+    // If this fails, the next commit() will write the stub file.
+    vector<string> unused;
+    publish(unused);
+    guard.unlock();
+
+    old_segments.clear();
+    remove_files(unused);
+}
+
+void
+SegmentedDatabase::Internal::add_document(const Document& document)
+{
+    check_open();
+    if (!active_open) {
+	active = WritableDatabase(active_path(),
+				  DB_CREATE_OR_OVERWRITE | DB_BACKEND_GLASS);
+	active_open = true;
+    }
+    active.add_document(document);
+    if (active.get_doccount() >= segment_size)
+	seal_active();
+}
+
+void
+SegmentedDatabase::Internal::delete_document(const string& unique_term)
+{
+    check_open();
+    if (unique_term.empty())
+	throw InvalidArgumentError("Empty termnames are invalid");
+    if (active_open)
+	active.delete_document(unique_term);
+
+    lock_guard<mutex> guard(segments_mutex);
+    for (auto& segment : segments) {
+	if (!segment->reader_open) {
+	    segment->reader = Database(segment_path(segment->name),
+				       DB_BACKEND_HONEY);
+	    segment->reader_open = true;
+	}
+	const Database& reader = segment->reader;
+	for (auto p = reader.postlist_begin(unique_term);
+	     p != reader.postlist_end(unique_term); ++p) {
+	    if (segment->deleted.insert(*p).second)
+		segment->pending.insert(*p);
+	}
+    }
+}
+
+void
+SegmentedDatabase::Internal::commit()
+{
+    check_open();
+    if (active_open)
+	seal_active();
+
+    vector<string> unused;
+    exception_ptr e;
+    {
+	lock_guard<mutex> guard(segments_mutex);
+
+	// Write new deletion lists and list the new segments in a single
+	// update of the stub file, so readers see all the changes or none.
+	for (auto& segment : segments) {
+	    if (!segment->pending.empty()) {
+		string file = new_deletion_file_name(*segment);
+		DeletionListDatabase::write_file(segment_path(file),
+						 segment->deleted);
+		if (!segment->deleted_file.empty())
+		    obsolete.push_back(segment_path(segment->deleted_file));
+		segment->deleted_file = file;
+		segment->pending.clear();
+		stub_changed = true;
+	    }
+	    if (!segment->published) {
+		segment->published = true;
+		stub_changed = true;
+	    }
+	}
+
+	if (stub_changed)
+	    publish(unused);
+
+	if (!merge_running) {
+	    // If the last merge thread has finished, clean it up.
+	    if (merge_thread.joinable())
+		merge_thread.join();
+	    vector<Segment*> inputs;
+	    if (choose_merge(inputs)) {
+		// Let the merge thread choose for itself.
+		for (auto segment : inputs) {
+		    segment->merging = false;
+		}
+		merge_running = true;
+		try {
+		    merge_thread = thread(&Internal::merge_loop, this);
+		} catch (const system_error&) {
+		    // Try again at the next commit.
+		    merge_running = false;
+		}
+	    }
+	}
+
+	e = take_merge_error();
+    }
+    remove_files(unused);
+    if (e)
+	rethrow_exception(e);
+}
+
+void
+SegmentedDatabase::Internal::wait_for_merges()
+{
+    if (merge_thread.joinable())
+	merge_thread.join();
+    lock_guard<mutex> guard(segments_mutex);
+    exception_ptr e = take_merge_error();
+    if (e)
+	rethrow_exception(e);
+}
+
+void
+SegmentedDatabase::Internal::close()
+{
+    if (closed)
+	return;
+    commit();
+    wait_for_merges();
+    vector<string> unused;
+    {
+	lock_guard<mutex> guard(segments_mutex);
+	// A merge may have failed to write the stub file.
+	if (stub_changed)
+	    publish(unused);
+	for (auto& segment : segments) {
+	    segment->reader = Database();
+	}
+    }
+    remove_files(unused);
+    closed = true;
+    lock.release();
+}
+
+SegmentedDatabase::SegmentedDatabase(const string& path,
+				     Xapian::doccount segment_size,
+				     unsigned merge_factor)
+    : internal(new Internal(path, segment_size, merge_factor))
+{
+    LOGCALL_CTOR(API, "SegmentedDatabase", path | segment_size | merge_factor);
+}
+
+SegmentedDatabase::~SegmentedDatabase()
+{
+    LOGCALL_DTOR(API, "SegmentedDatabase");
+    try {
+	internal->close();
+    } catch (...) {
+	// Ignore errors in destructors.
+    }
+}
+
+void
+SegmentedDatabase::add_document(const Document& document)
+{
+    LOGCALL_VOID(API, "SegmentedDatabase::add_document", document);
+    internal->add_document(document);
+}
+
+void
+SegmentedDatabase::delete_document(const string& unique_term)
+{
+    LOGCALL_VOID(API, "SegmentedDatabase::delete_document", unique_term);
+    internal->delete_document(unique_term);
+}
+
+void
+SegmentedDatabase::replace_document(const string& unique_term,
+				    const Document& document)
+{
+    LOGCALL_VOID(API, "SegmentedDatabase::replace_document", unique_term | document);
+    internal->delete_document(unique_term);
+    internal->add_document(document);
+}
+
+void
+SegmentedDatabase::commit()
+{
+    LOGCALL_VOID(API, "SegmentedDatabase::commit", NO_ARGS);
+    internal->commit();
+}
+
+void
+SegmentedDatabase::wait_for_merges()
+{
+    LOGCALL_VOID(API, "SegmentedDatabase::wait_for_merges", NO_ARGS);
+    internal->wait_for_merges();
+}
+
+size_t
+SegmentedDatabase::get_segment_count() const
+{
+    LOGCALL(API, size_t, "SegmentedDatabase::get_segment_count", NO_ARGS);
+    RETURN(internal->get_segment_count());
+}
+
+void
+SegmentedDatabase::close()
+{
+    LOGCALL_VOID(API, "SegmentedDatabase::close", NO_ARGS);
+    internal->close();
+}
+
+}
@@ -1,11 +1,13 @@
 noinst_HEADERS +=\
 	backends/alltermslist.h\
 	backends/backends.h\
+	backends/blockcache.h\
 	backends/byte_length_strings.h\
 	backends/contiguousalldocspostlist.h\
 	backends/databasehelpers.h\
 	backends/databaseinternal.h\
 	backends/databasereplicator.h\
+	backends/deletionlistdatabase.h\
 	backends/documentinternal.h\
 	backends/empty_database.h\
 	backends/flint_lock.h\
@@ -14,6 +16,8 @@ noinst_HEADERS +=\
 	backends/prefix_compressed_strings.h\
 	backends/slowvaluelist.h\
 	backends/uuids.h\
+	backends/valuecolumn.h\
+	backends/valuedictionary.h\
 	backends/valuelist.h\
 	backends/valuestats.h
 
@@ -22,15 +26,19 @@ EXTRA_DIST +=\
 
 lib_src +=\
 	backends/alltermslist.cc\
+	backends/blockcache.cc\
 	backends/dbcheck.cc\
 	backends/databasehelpers.cc\
 	backends/databaseinternal.cc\
 	backends/databasereplicator.cc\
 	backends/dbfactory.cc\
+	backends/deletionlistdatabase.cc\
 	backends/documentinternal.cc\
 	backends/empty_database.cc\
 	backends/slowvaluelist.cc\
 	backends/uuids.cc\
+	backends/valuecolumn.cc\
+	backends/valuedictionary.cc\
 	backends/valuelist.cc
 
 if BUILD_BACKEND_REMOTE
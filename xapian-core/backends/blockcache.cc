@@ -0,0 +1,184 @@
+/** @file blockcache.cc
+ * @brief Process-wide cache of database blocks
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "blockcache.h"
+
+#include "parseint.h"
+#include "xapian/error.h"
+
+#include <cstdlib>
+#include <iterator>
+
+using namespace std;
+
+/// Mix a 64-bit value into a hash.
+static inline uint64_t
+hash_mix(uint64_t h, uint64_t v)
+{
+    h ^= v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    return h;
+}
+
+size_t
+BlockCache::KeyHash::operator()(const Key& key) const
+{
+    uint64_t u1, u2;
+    memcpy(&u1, key.file.uuid, sizeof(u1));
+    memcpy(&u2, key.file.uuid + sizeof(u1), sizeof(u2));
+    uint64_t h = hash_mix(u1, u2);
+    h = hash_mix(h, key.file.dev);
+    h = hash_mix(h, key.file.ino);
+    h = hash_mix(h, key.file.offset);
+    h = hash_mix(h, (uint64_t(key.rev) << 32) | key.n);
+    // Fold the high bits down as we pick the shard using the low bits.
+    return size_t(h ^ (h >> 32));
+}
+
+void
+BlockCache::Shard::trim(size_t max_size_)
+{
+    while (size > max_size_) {
+	auto it = std::prev(entries.end());
+	size -= it->second.size();
+	index.erase(it->first);
+	entries.erase(it);
+	++evictions;
+    }
+}
+
+BlockCache::BlockCache() : max_size(0)
+{
+    const char *p = getenv("XAPIAN_BLOCK_CACHE_SIZE");
+    if (p && *p) {
+	size_t size;
+	if (!parse_unsigned(p, size)) {
+	    throw Xapian::InvalidArgumentError("XAPIAN_BLOCK_CACHE_SIZE must "
+					       "be a non-negative integer");
+	}
+	max_size = size;
+    }
+}
+
+BlockCache&
+BlockCache::get_instance()
+{
+    static BlockCache instance;
+    return instance;
+}
+
+void
+BlockCache::set_max_size(size_t max_size_)
+{
+    max_size = max_size_;
+    for (Shard& shard : shards) {
+	lock_guard<mutex> lock(shard.mutex);
+	shard.trim(max_size_ / NUM_SHARDS);
+    }
+}
+
+size_t
+BlockCache::get_size()
+{
+    size_t result = 0;
+    for (Shard& shard : shards) {
+	lock_guard<mutex> lock(shard.mutex);
+	result += shard.size;
+    }
+    return result;
+}
+
+size_t
+BlockCache::get_hits()
+{
+    size_t result = 0;
+    for (Shard& shard : shards) {
+	lock_guard<mutex> lock(shard.mutex);
+	result += shard.hits;
+    }
+    return result;
+}
+
+size_t
+BlockCache::get_misses()
+{
+    size_t result = 0;
+    for (Shard& shard : shards) {
+	lock_guard<mutex> lock(shard.mutex);
+	result += shard.misses;
+    }
+    return result;
+}
+
+size_t
+BlockCache::get_evictions()
+{
+    size_t result = 0;
+    for (Shard& shard : shards) {
+	lock_guard<mutex> lock(shard.mutex);
+	result += shard.evictions;
+    }
+    return result;
+}
+
+bool
+BlockCache::find(const Key& key, uint8_t* p, unsigned block_size)
+{
+    Shard& shard = get_shard(key);
+    lock_guard<mutex> lock(shard.mutex);
+    auto i = shard.index.find(key);
+    if (i == shard.index.end()) {
+	++shard.misses;
+	return false;
+    }
+    const string& block = i->second->second;
+    if (rare(block.size() != block_size)) {
+	// Shouldn't happen as the block size is fixed when a database is
+	// created, but don't return a block of the wrong size if it does.
+	++shard.misses;
+	return false;
+    }
+    ++shard.hits;
+    // Move the entry to the front of the list as it's now the most recently
+    // used.
+    shard.entries.splice(shard.entries.begin(), shard.entries, i->second);
+    memcpy(p, block.data(), block_size);
+    return true;
+}
+
+void
+BlockCache::add(const Key& key, const uint8_t* p, unsigned block_size)
+{
+    size_t shard_max_size = max_size.load(memory_order_relaxed) / NUM_SHARDS;
+    if (block_size > shard_max_size)
+	return;
+
+    Shard& shard = get_shard(key);
+    lock_guard<mutex> lock(shard.mutex);
+    if (shard.index.find(key) != shard.index.end()) {
+	// Another reader added this block since we looked it up.
+	return;
+    }
+    shard.entries.emplace_front(key,
+				string(reinterpret_cast<const char*>(p),
+				       block_size));
+    shard.index.emplace(key, shard.entries.begin());
+    shard.size += block_size;
+    shard.trim(shard_max_size);
+}
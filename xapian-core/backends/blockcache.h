@@ -0,0 +1,192 @@
+/** @file blockcache.h
+ * @brief Process-wide cache of database blocks
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef XAPIAN_INCLUDED_BLOCKCACHE_H
+#define XAPIAN_INCLUDED_BLOCKCACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "backends/uuids.h"
+
+/** Process-wide cache of database blocks.
+ *
+ *  Blocks are cached by the identity of the file they come from, the block
+ *  number and the revision of the reader.  It's up to the backend to only
+ *  add a block if the version read is the one which any reader of that
+ *  revision would see, and to not use the cache when the file can be
+ *  modified in place (e.g. for a writable database).
+ *
+ *  The cache is split into shards, each with its own lock and least recently
+ *  used list, so that threads reading different blocks rarely contend.
+ */
+class BlockCache {
+  public:
+    /// Identifies a table within a database file.
+    struct FileId {
+	/// The UUID of the database.
+	char uuid[Uuid::BINARY_SIZE];
+
+	/// The device the file is on.
+	uint64_t dev;
+
+	/// The inode of the file.
+	uint64_t ino;
+
+	/// The offset of the table within the file.
+	uint64_t offset;
+
+	FileId() : dev(0), ino(0), offset(0) {
+	    std::memset(uuid, 0, sizeof(uuid));
+	}
+    };
+
+    /// The key for a cached block.
+    struct Key {
+	FileId file;
+
+	/// The block number.
+	uint32_t n;
+
+	/// The revision of the reader.
+	uint32_t rev;
+
+	Key(const FileId& file_, uint32_t n_, uint32_t rev_)
+	    : file(file_), n(n_), rev(rev_) { }
+
+	bool operator==(const Key& o) const {
+	    return n == o.n && rev == o.rev &&
+		   file.ino == o.file.ino && file.dev == o.file.dev &&
+		   file.offset == o.file.offset &&
+		   std::memcmp(file.uuid, o.file.uuid, sizeof(file.uuid)) == 0;
+	}
+    };
+
+  private:
+    struct KeyHash {
+	size_t operator()(const Key& key) const;
+    };
+
+    /// A single shard of the cache, holding a subset of the keys.
+    struct Shard {
+	typedef std::list<std::pair<Key, std::string>> lru_list;
+
+	/// Protects all the members below.
+	std::mutex mutex;
+
+	/// The cached blocks, most recently used first.
+	lru_list entries;
+
+	/// Index of entries by key.
+	std::unordered_map<Key, lru_list::iterator, KeyHash> index;
+
+	/// The total size of the cached blocks in bytes.
+	size_t size = 0;
+
+	size_t hits = 0;
+
+	size_t misses = 0;
+
+	size_t evictions = 0;
+
+	/// Discard least recently used entries until size <= max_size.
+	void trim(size_t max_size);
+    };
+
+    /// The number of shards - must be a power of 2.
+    static constexpr unsigned NUM_SHARDS = 16;
+
+    Shard shards[NUM_SHARDS];
+
+    /** The maximum total size of the cached blocks in bytes.
+     *
+     *  0 means the cache is disabled.
+     */
+    std::atomic<size_t> max_size;
+
+    BlockCache();
+
+    /// Don't allow assignment.
+    void operator=(const BlockCache &) = delete;
+
+    /// Don't allow copying.
+    BlockCache(const BlockCache &) = delete;
+
+    Shard& get_shard(const Key& key) {
+	return shards[KeyHash()(key) & (NUM_SHARDS - 1)];
+    }
+
+  public:
+    /** Return the process-wide cache.
+     *
+     *  The initial maximum size is taken from environment variable
+     *  XAPIAN_BLOCK_CACHE_SIZE (in bytes, default 0 which disables the
+     *  cache).
+     */
+    static BlockCache& get_instance();
+
+    /// Is the cache enabled?
+    bool enabled() const {
+	return max_size.load(std::memory_order_relaxed) != 0;
+    }
+
+    /** Set the maximum total size of the cached blocks in bytes.
+     *
+     *  Setting 0 disables the cache and discards all the cached blocks.
+     */
+    void set_max_size(size_t max_size_);
+
+    size_t get_max_size() const {
+	return max_size.load(std::memory_order_relaxed);
+    }
+
+    /// Return the total size of the cached blocks in bytes.
+    size_t get_size();
+
+    size_t get_hits();
+
+    size_t get_misses();
+
+    size_t get_evictions();
+
+    /** Look up a block.
+     *
+     *  @param key		The key to look up.
+     *  @param p		Where to copy the block to if found.
+     *  @param block_size	The size of the block.
+     *
+     *  @return true if the block was found.
+     */
+    bool find(const Key& key, uint8_t* p, unsigned block_size);
+
+    /** Add a block.
+     *
+     *  @param key		The key for the block.
+     *  @param p		The block contents.
+     *  @param block_size	The size of the block.
+     */
+    void add(const Key& key, const uint8_t* p, unsigned block_size);
+};
+
+#endif // XAPIAN_INCLUDED_BLOCKCACHE_H
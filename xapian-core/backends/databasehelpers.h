@@ -60,7 +60,8 @@ template<typename A1,
 	 typename A3,
 	 typename A4,
 	 typename A5,
-	 typename A6>
+	 typename A6,
+	 typename A7>
 void
 read_stub_file(const std::string& file,
 	       A1 action_auto,
@@ -68,11 +69,15 @@ read_stub_file(const std::string& file,
 	       A3 action_honey,
 	       A4 action_remote_prog,
 	       A5 action_remote_tcp,
-	       A6 action_inmemory)
+	       A6 action_inmemory,
+	       A7 action_deleted)
 {
     // A stub database is a text file with one or more lines of this format:
     // <dbtype> <serialised db object>
     //
+    // A line of the form "deleted <path>" gives a deletion list file for the
+    // database on the previous line (these are written by SegmentedDatabase).
+    //
     // Lines which start with a "#" character are ignored.
     //
     // Any paths specified in stub database files which are relative will be
@@ -178,6 +183,12 @@ read_stub_file(const std::string& file,
 #endif
 	}
 
+	if (type == "deleted" && !line.empty()) {
+	    resolve_relative_path(line, file);
+	    action_deleted(line);
+	    continue;
+	}
+
 	if (type == "chert") {
 	    auto msg = "Chert backend no longer supported";
 	    throw Xapian::FeatureUnavailableError(msg);
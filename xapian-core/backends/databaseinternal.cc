@@ -34,6 +34,7 @@
 #include <algorithm>
 #include <memory>
 #include <string>
+#include <vector>
 
 using namespace std;
 using Xapian::Internal::intrusive_ptr;
@@ -63,6 +64,14 @@ Database::Internal::readahead_for_query(const Xapian::Query &) const
 {
 }
 
+bool
+Database::Internal::get_cached_doclengths(Xapian::doccount,
+					  const Xapian::docid*,
+					  Xapian::termcount*) const
+{
+    return false;
+}
+
 Xapian::termcount
 Database::Internal::get_unique_terms_lower_bound() const
 {
@@ -103,6 +112,11 @@ Database::Internal::commit()
     invalid_operation("WritableDatabase::commit() called with a read-only shard");
 }
 
+void
+Database::Internal::wait_for_durable(Xapian::rev)
+{
+}
+
 void
 Database::Internal::cancel()
 {
@@ -176,6 +190,17 @@ Database::Internal::add_document(const Xapian::Document &)
 		      "read-only shard");
 }
 
+Xapian::docid
+Database::Internal::add_documents(const vector<Xapian::Document>& docs,
+				  unsigned)
+{
+    Xapian::docid first_did = add_document(docs[0]);
+    for (size_t i = 1; i != docs.size(); ++i) {
+	(void)add_document(docs[i]);
+    }
+    return first_did;
+}
+
 void
 Database::Internal::delete_document(Xapian::docid)
 {
@@ -270,6 +295,23 @@ Database::Internal::open_value_list(Xapian::valueno slot) const
     return new SlowValueList(this, slot);
 }
 
+void
+Database::Internal::add_value_column(Xapian::valueno, unsigned)
+{
+}
+
+void
+Database::Internal::add_value_dictionary(Xapian::valueno)
+{
+}
+
+const shared_ptr<const ValueDictionary>&
+Database::Internal::get_value_dictionary(Xapian::valueno) const
+{
+    static const shared_ptr<const ValueDictionary> none;
+    return none;
+}
+
 TermList *
 Database::Internal::open_spelling_termlist(const string &) const
 {
@@ -397,6 +439,12 @@ Database::Internal::get_uuid() const
     return string();
 }
 
+bool
+Database::Internal::append_revision_key(string&) const
+{
+    return false;
+}
+
 void
 Database::Internal::invalidate_doc_object(Xapian::Document::Internal*) const
 {
@@ -410,6 +458,58 @@ Database::Internal::get_used_docid_range(Xapian::docid &,
     throw Xapian::UnimplementedError("This backend doesn't implement get_used_docid_range()");
 }
 
+Database::Internal*
+Database::Internal::open_copy() const
+{
+    return NULL;
+}
+
+void
+Database::Internal::get_copies(size_t n, vector<Xapian::Database>& result) const
+{
+    auto same_revision = [this](const Xapian::Database::Internal& copy) {
+	return copy.get_revision() == get_revision() &&
+	       copy.get_uuid() == get_uuid();
+    };
+
+    // Drop any copies which we can't bring to the same revision - this
+    // happens if this shard has been reopened but the copy can't follow
+    // (or the other way around).
+    auto i = copies.begin();
+    while (i != copies.end()) {
+	auto& copy = *i->internal;
+	if (!same_revision(copy)) {
+	    try {
+		(void)copy.reopen();
+	    } catch (const Xapian::Error&) {
+	    }
+	    if (!same_revision(copy)) {
+		i = copies.erase(i);
+		continue;
+	    }
+	}
+	++i;
+    }
+
+    while (copies.size() < n) {
+	Xapian::Database copy;
+	try {
+	    Internal* internal = open_copy();
+	    if (!internal)
+		break;
+	    copy = Xapian::Database(internal);
+	} catch (const Xapian::Error&) {
+	    break;
+	}
+	if (!same_revision(*copy.internal))
+	    break;
+	copies.push_back(std::move(copy));
+    }
+
+    n = min(n, copies.size());
+    result.insert(result.end(), copies.begin(), copies.begin() + n);
+}
+
 bool
 Database::Internal::locked() const
 {
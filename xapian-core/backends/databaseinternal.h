@@ -33,13 +33,16 @@
 #include <xapian/types.h>
 #include <xapian/valueiterator.h>
 
+#include <memory>
 #include <string>
+#include <vector>
 
 typedef Xapian::TermIterator::Internal TermList;
 typedef Xapian::PositionIterator::Internal PositionList;
 typedef Xapian::ValueIterator::Internal ValueList;
 
 class LeafPostList;
+class ValueDictionary;
 
 namespace Xapian {
 namespace Internal {
@@ -66,6 +69,9 @@ class Database::Internal : public Xapian::Internal::intrusive_base {
     /// The "action required" helper for the dtor_called() helper.
     void dtor_called_();
 
+    /// Other Database objects for this shard returned by get_copies().
+    mutable std::vector<Xapian::Database> copies;
+
   protected:
     /// Transaction state enum.
     enum transaction_state {
@@ -89,11 +95,6 @@ class Database::Internal : public Xapian::Internal::intrusive_base {
     /// Current transaction state.
     transaction_state state;
 
-    /// Test if this shard is read-only.
-    bool is_read_only() const {
-	return state == TRANSACTION_READONLY;
-    }
-
     /// Test if a transaction is currently active.
     bool transaction_active() const { return state > 0; }
 
@@ -116,6 +117,19 @@ class Database::Internal : public Xapian::Internal::intrusive_base {
 	    dtor_called_();
     }
 
+    /** Open another Database::Internal object for this shard.
+     *
+     *  The new object should be opened with the same options as this one.
+     *  The default implementation returns NULL, which is right for backends
+     *  which can't be opened again.
+     *
+     *  Used by get_copies().
+     */
+    virtual Internal* open_copy() const;
+
+    /// Drop any Database objects kept by get_copies().
+    void drop_copies() const { copies.clear(); }
+
   public:
     /** We have virtual methods and want to be able to delete derived classes
      *  using a pointer to the base class, so we need a virtual destructor.
@@ -126,6 +140,11 @@ class Database::Internal : public Xapian::Internal::intrusive_base {
 
     virtual size_type size() const;
 
+    /// Test if this shard is read-only.
+    bool is_read_only() const {
+	return state == TRANSACTION_READONLY;
+    }
+
     virtual void keep_alive();
 
     virtual void readahead_for_query(const Query& query) const;
@@ -146,6 +165,23 @@ class Database::Internal : public Xapian::Internal::intrusive_base {
      */
     virtual termcount get_unique_terms(docid did) const = 0;
 
+    /** Get the lengths of a batch of documents if they're held in memory.
+     *
+     *  This allows postings to be weighted in batches without reading each
+     *  document's length separately.  The default implementation returns
+     *  false, which is right for backends which don't keep the document
+     *  lengths in memory.
+     *
+     *  @param n	The number of documents.
+     *  @param dids	The document ids.
+     *  @param doclens	Array of @a n entries to store the lengths in.
+     *
+     *  @return	true if the lengths were stored in @a doclens.
+     */
+    virtual bool get_cached_doclengths(doccount n,
+				       const docid* dids,
+				       termcount* doclens) const;
+
     /** Returns frequencies for a term.
      *
      *  @param term		The term to get frequencies for
@@ -229,6 +265,38 @@ class Database::Internal : public Xapian::Internal::intrusive_base {
      */
     virtual ValueList* open_value_list(valueno slot) const;
 
+    /** Keep the values in a slot in memory as a fixed-width column.
+     *
+     *  The default implementation does nothing, which is right for backends
+     *  which don't support value columns.
+     *
+     *  @param slot	The value slot.
+     *  @param width	The number of bytes to store inline for each document.
+     */
+    virtual void add_value_column(valueno slot, unsigned width);
+
+    /** Keep a dictionary of the distinct values in a slot in memory.
+     *
+     *  The default implementation does nothing, which is right for backends
+     *  which don't support value dictionaries.
+     *
+     *  @param slot	The value slot.
+     */
+    virtual void add_value_dictionary(valueno slot);
+
+    /** Get the dictionary of the distinct values in a slot.
+     *
+     *  The dictionary is loaded if it hasn't been already.
+     *
+     *  @param slot	The value slot.
+     *
+     *  @return	The dictionary, or an empty pointer if there isn't one for
+     *		@a slot (the default implementation always returns an empty
+     *		pointer).
+     */
+    virtual const std::shared_ptr<const ValueDictionary>&
+	get_value_dictionary(valueno slot) const;
+
     virtual TermList* open_term_list(docid did) const = 0;
 
     /** Like open_term_list() but without MultiTermList wrapper.
@@ -368,6 +436,15 @@ class Database::Internal : public Xapian::Internal::intrusive_base {
     /** Commit pending modifications to the database. */
     virtual void commit();
 
+    /** Wait until a committed revision is durable.
+     *
+     *  The default implementation does nothing, which is right for backends
+     *  where commit() only returns once the changes are durable.
+     *
+     *  @param revision	The revision to wait for, or 0 for the latest.
+     */
+    virtual void wait_for_durable(Xapian::rev revision);
+
     /** Cancel pending modifications to the database. */
     virtual void cancel();
 
@@ -383,6 +460,20 @@ class Database::Internal : public Xapian::Internal::intrusive_base {
 
     virtual docid add_document(const Document& document);
 
+    /** Add a batch of documents.
+     *
+     *  The default implementation calls add_document() for each document in
+     *  turn.
+     *
+     *  @param docs		The documents to add (not empty).
+     *  @param n_threads	The maximum number of threads to use (at least
+     *				1).
+     *
+     *  @return The document ID allocated to the first document.
+     */
+    virtual docid add_documents(const std::vector<Document>& docs,
+				unsigned n_threads);
+
     virtual void delete_document(docid did);
 
     /** Delete any documents indexed by a term from the database. */
@@ -437,6 +528,18 @@ class Database::Internal : public Xapian::Internal::intrusive_base {
      */
     virtual std::string get_uuid() const;
 
+    /** Append a key identifying the revision of each shard to @a key.
+     *
+     *  This is used to key cached search results, so it must change if the
+     *  content of the database as seen through this object might have
+     *  changed.
+     *
+     *  @return true if the revision can be identified, or false if not (in
+     *		which case @a key may have been partly updated).  The default
+     *		implementation returns false.
+     */
+    virtual bool append_revision_key(std::string& key) const;
+
     /** Notify the database that document is no longer valid.
      *
      *  This is used to invalidate references to a document kept by a
@@ -459,12 +562,28 @@ class Database::Internal : public Xapian::Internal::intrusive_base {
 
     /** Find lowest and highest docids actually in use.
      *
-     *  Only used by compaction, so only needs to be implemented by
-     *  backends which support compaction.
+     *  Only used by compaction and when splitting a shard into docid ranges
+     *  to match in parallel, so only needs to be implemented by backends
+     *  which support those.
      */
     virtual void get_used_docid_range(docid& first,
 				      docid& last) const;
 
+    /** Get other Database objects for this shard.
+     *
+     *  These are at the same revision as this shard and are used to match
+     *  ranges of its docids in parallel, since a Database::Internal object
+     *  isn't thread-safe.  They're kept for reuse by later matches, and
+     *  reopened if this shard is reopened.
+     *
+     *  @param n	The number of objects wanted.
+     *  @param result	Vector to append the objects to.  Fewer than @a n are
+     *			appended if the backend doesn't support opening the
+     *			shard again, or if the shard on disk is no longer at
+     *			the same revision.
+     */
+    void get_copies(size_t n, std::vector<Xapian::Database>& result) const;
+
     /** Return true if the database is open for writing.
      *
      *  If this is a WritableDatabase, always returns true.
@@ -32,6 +32,7 @@
 #include "backends.h"
 #include "databasehelpers.h"
 #include "debuglog.h"
+#include "deletionlistdatabase.h"
 #include "filetests.h"
 #include "fileutils.h"
 #include "posixy_wrapper.h"
@@ -54,55 +55,107 @@
 // Database::Internal.
 #include "backends/databaseinternal.h"
 
+#include <memory>
 #include <string>
+#include <vector>
 
 using namespace std;
 
 namespace Xapian {
 
+#ifdef XAPIAN_HAS_GLASS_BACKEND
+/// Open a glass database for reading, handling DB_CACHE_DOC_STATS and
+/// DB_MMAP.
+template<typename T>
+static GlassDatabase*
+open_glass(T path_or_fd, int flags)
+{
+    unique_ptr<GlassDatabase> db(new GlassDatabase(path_or_fd));
+    if (flags & DB_CACHE_DOC_STATS)
+	db->enable_doc_stats_cache();
+    if (flags & DB_MMAP)
+	db->enable_mmap();
+    return db.release();
+}
+#endif
+
+#ifdef XAPIAN_HAS_HONEY_BACKEND
+/// Open a honey database, handling DB_MMAP.
+template<typename T>
+static HoneyDatabase*
+open_honey(T path_or_fd, int flags)
+{
+    unique_ptr<HoneyDatabase> db(new HoneyDatabase(path_or_fd));
+    if (flags & DB_MMAP)
+	db->enable_mmap();
+    return db.release();
+}
+#endif
+
 static void
-open_stub(Database& db, const string& file)
+open_stub(Database& db, const string& file, int flags)
 {
+    // Pass on flags which affect how the databases are read, but not the
+    // backend type.
+    flags &= ~DB_BACKEND_MASK_;
+    // We collect the databases first so that a "deleted" line can wrap the
+    // database on the line before it.
+    vector<Database> dbs;
     read_stub_file(file,
-		   [&db](const string& path) {
-		       db.add_database(Database(path));
+		   [&dbs, flags](const string& path) {
+		       dbs.emplace_back(path, flags);
 		   },
-		   [&db](const string& path) {
+		   [&dbs, flags](const string& path) {
 #ifdef XAPIAN_HAS_GLASS_BACKEND
-		       db.add_database(Database(new GlassDatabase(path)));
+		       dbs.emplace_back(open_glass(path, flags));
 #else
 		       (void)path;
+		       (void)flags;
 #endif
 		   },
-		   [&db](const string& path) {
+		   [&dbs, flags](const string& path) {
 #ifdef XAPIAN_HAS_HONEY_BACKEND
-		       db.add_database(Database(new HoneyDatabase(path)));
+		       dbs.emplace_back(open_honey(path, flags));
 #else
 		       (void)path;
+		       (void)flags;
 #endif
 		   },
-		   [&db](const string& prog, const string& args) {
+		   [&dbs](const string& prog, const string& args) {
 #ifdef XAPIAN_HAS_REMOTE_BACKEND
-		       db.add_database(Remote::open(prog, args));
+		       dbs.push_back(Remote::open(prog, args));
 #else
 		       (void)prog;
 		       (void)args;
 #endif
 		   },
-		   [&db](const string& host, unsigned port) {
+		   [&dbs](const string& host, unsigned port) {
 #ifdef XAPIAN_HAS_REMOTE_BACKEND
-		       db.add_database(Remote::open(host, port));
+		       dbs.push_back(Remote::open(host, port));
 #else
 		       (void)host;
 		       (void)port;
 #endif
 		   },
-		   [&db]() {
+		   [&dbs]() {
 #ifdef XAPIAN_HAS_INMEMORY_BACKEND
-		       db.add_database(Database(string(), DB_BACKEND_INMEMORY));
+		       dbs.emplace_back(string(), DB_BACKEND_INMEMORY);
 #endif
+		   },
+		   [&dbs, &file](const string& path) {
+		       if (dbs.empty() || dbs.back().internal->size() != 1) {
+			   string msg = file;
+			   msg += ": Deletion list must follow a single database";
+			   throw DatabaseOpeningError(msg);
+		       }
+		       dbs.back() = Database(new DeletionListDatabase(dbs.back(),
+								      path));
 		   });
 
+    for (auto& sub : dbs) {
+	db.add_database(sub);
+    }
+
     // Allowing a stub database with no databases listed allows things like
     // a "search all databases" feature to be implemented by generating a
     // stub database file without having to special case there not being any
@@ -148,6 +201,11 @@ open_stub(WritableDatabase& db, const string& file, int flags)
 		   [&db]() {
 		       db.add_database(WritableDatabase(string(),
 							DB_BACKEND_INMEMORY));
+		   },
+		   [](const string&) {
+		       auto msg = "Databases with deletion lists don't support "
+				  "writing";
+		       throw Xapian::DatabaseOpeningError(msg);
 		   });
 
     if (db.internal->size() == 0) {
@@ -166,20 +224,20 @@ Database::Database(const string& path, int flags)
 	    throw FeatureUnavailableError("Chert backend no longer supported");
 	case DB_BACKEND_GLASS:
 #ifdef XAPIAN_HAS_GLASS_BACKEND
-	    internal = new GlassDatabase(path);
+	    internal = open_glass(path, flags);
 	    return;
 #else
 	    throw FeatureUnavailableError("Glass backend disabled");
 #endif
 	case DB_BACKEND_HONEY:
 #ifdef XAPIAN_HAS_HONEY_BACKEND
-	    internal = new HoneyDatabase(path);
+	    internal = open_honey(path, flags);
 	    return;
 #else
 	    throw FeatureUnavailableError("Honey backend disabled");
 #endif
 	case DB_BACKEND_STUB:
-	    open_stub(*this, path);
+	    open_stub(*this, path, flags);
 	    return;
 	case DB_BACKEND_INMEMORY:
 #ifdef XAPIAN_HAS_INMEMORY_BACKEND
@@ -204,7 +262,7 @@ Database::Database(const string& path, int flags)
 	    case BACKEND_GLASS:
 #ifdef XAPIAN_HAS_GLASS_BACKEND
 		// Single file glass format.
-		internal = new GlassDatabase(fd);
+		internal = open_glass(fd, flags);
 		return;
 #else
 		throw FeatureUnavailableError("Glass backend disabled");
@@ -212,14 +270,14 @@ Database::Database(const string& path, int flags)
 	    case BACKEND_HONEY:
 #ifdef XAPIAN_HAS_HONEY_BACKEND
 		// Single file honey format.
-		internal = new HoneyDatabase(fd);
+		internal = open_honey(fd, flags);
 		return;
 #else
 		throw FeatureUnavailableError("Honey backend disabled");
 #endif
 	}
 
-	open_stub(*this, path);
+	open_stub(*this, path, flags);
 	return;
     }
 
@@ -229,14 +287,14 @@ Database::Database(const string& path, int flags)
 
 #ifdef XAPIAN_HAS_GLASS_BACKEND
     if (file_exists(path + "/iamglass")) {
-	internal = new GlassDatabase(path);
+	internal = open_glass(path, flags);
 	return;
     }
 #endif
 
 #ifdef XAPIAN_HAS_HONEY_BACKEND
     if (file_exists(path + "/iamhoney")) {
-	internal = new HoneyDatabase(path);
+	internal = open_honey(path, flags);
 	return;
     }
 #endif
@@ -245,7 +303,7 @@ Database::Database(const string& path, int flags)
     string stub_file = path;
     stub_file += "/XAPIANDB";
     if (usual(file_exists(stub_file))) {
-	open_stub(*this, stub_file);
+	open_stub(*this, stub_file, flags);
 	return;
     }
 
@@ -287,7 +345,7 @@ database_factory(int fd, int flags)
     switch (type) {
 	case 0:
 	case DB_BACKEND_GLASS:
-	    return new GlassDatabase(fd);
+	    return open_glass(fd, flags);
     }
 #else
     (void)flags;
@@ -0,0 +1,687 @@
+/** @file
+ * @brief A database with a list of documents to treat as deleted
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include <config.h>
+
+#include "deletionlistdatabase.h"
+
+#include "api/leafpostlist.h"
+#include "api/termlist.h"
+#include "backends/backends.h"
+#include "backends/valuelist.h"
+#include "expand/expandweight.h"
+#include "pack.h"
+#include "str.h"
+
+#include "xapian/document.h"
+#include "xapian/error.h"
+
+#include <cerrno>
+#include <fstream>
+#include <iterator>
+
+using namespace std;
+using Xapian::Internal::intrusive_ptr;
+
+/// A postlist which skips the deleted documents.
+class DeletionListPostList : public LeafPostList {
+    /// The database (which holds the deletion list).
+    intrusive_ptr<const DeletionListDatabase> db;
+
+    /// The postlist from the wrapped database.
+    LeafPostList* pl;
+
+    /// The term frequency without the deleted documents.
+    Xapian::doccount termfreq;
+
+    /// Handle a pruned postlist being returned.
+    void replace(PostList* res) {
+	if (res) {
+	    delete pl;
+	    pl = static_cast<LeafPostList*>(res);
+	}
+    }
+
+    /// Move forward past any deleted documents.
+    void skip_deleted() {
+	while (!pl->at_end() && db->is_deleted(pl->get_docid())) {
+	    replace(pl->next(0.0));
+	}
+    }
+
+  public:
+    DeletionListPostList(const DeletionListDatabase* db_,
+			 LeafPostList* pl_,
+			 const string& term_,
+			 Xapian::doccount termfreq_)
+	: LeafPostList(term_), db(db_), pl(pl_), termfreq(termfreq_) { }
+
+    ~DeletionListPostList() { delete pl; }
+
+    Xapian::doccount get_termfreq() const { return termfreq; }
+
+    Xapian::docid get_docid() const { return pl->get_docid(); }
+
+    Xapian::termcount get_wdf() const { return pl->get_wdf(); }
+
+    bool at_end() const { return pl->at_end(); }
+
+    PositionList* read_position_list() { return pl->read_position_list(); }
+
+    PositionList* open_position_list() const {
+	return pl->open_position_list();
+    }
+
+    Xapian::termcount get_block_wdf_max() const {
+	return pl->get_block_wdf_max();
+    }
+
+    // The wrapped postlist doesn't have our weight object, so it can't skip
+    // blocks by weight and we pass it a w_min of 0.
+    PostList* next(double) {
+	replace(pl->next(0.0));
+	skip_deleted();
+	return NULL;
+    }
+
+    PostList* skip_to(Xapian::docid did, double) {
+	replace(pl->skip_to(did, 0.0));
+	skip_deleted();
+	return NULL;
+    }
+
+    string get_description() const {
+	return "DeletionListPostList(" + pl->get_description() + ")";
+    }
+};
+
+/// A value stream which skips the deleted documents.
+class DeletionListValueList : public ValueList {
+    /// The database (which holds the deletion list).
+    intrusive_ptr<const DeletionListDatabase> db;
+
+    /// The value stream from the wrapped database.
+    ValueList* vl;
+
+    /// Move forward past any deleted documents.
+    void skip_deleted() {
+	while (!vl->at_end() && db->is_deleted(vl->get_docid())) {
+	    vl->next();
+	}
+    }
+
+  public:
+    DeletionListValueList(const DeletionListDatabase* db_, ValueList* vl_)
+	: db(db_), vl(vl_) { }
+
+    ~DeletionListValueList() { delete vl; }
+
+    Xapian::docid get_docid() const { return vl->get_docid(); }
+
+    string get_value() const { return vl->get_value(); }
+
+    bool get_value_view(const char*& p, size_t& len) const {
+	return vl->get_value_view(p, len);
+    }
+
+    Xapian::valueno get_valueno() const { return vl->get_valueno(); }
+
+    bool at_end() const { return vl->at_end(); }
+
+    void next() {
+	vl->next();
+	skip_deleted();
+    }
+
+    void skip_to(Xapian::docid did) {
+	vl->skip_to(did);
+	skip_deleted();
+    }
+
+    bool check(Xapian::docid did) {
+	if (!vl->check(did))
+	    return false;
+	// We're positioned as skip_to() would leave us.
+	skip_deleted();
+	return true;
+    }
+
+    void next_in_range(const string& lo, const string& hi) {
+	vl->next_in_range(lo, hi);
+	skip_deleted();
+    }
+
+    void skip_to_in_range(Xapian::docid did,
+			  const string& lo, const string& hi) {
+	vl->skip_to_in_range(did, lo, hi);
+	skip_deleted();
+    }
+
+    string get_description() const {
+	return "DeletionListValueList(" + vl->get_description() + ")";
+    }
+};
+
+/** A termlist which reports term frequencies without the deleted documents.
+ *
+ *  Used for the termlist of a document and for the list of all terms (for
+ *  which terms only indexing deleted documents are skipped).
+ */
+class DeletionListTermList : public TermList {
+    /// The database (which holds the deletion list).
+    intrusive_ptr<const DeletionListDatabase> db;
+
+    /// The termlist from the wrapped database.
+    TermList* tl;
+
+    /// The document's length (for a document's termlist).
+    Xapian::termcount doclen;
+
+    /// Skip terms which only index deleted documents?
+    bool skip_unused;
+
+    /// Handle a pruned termlist being returned.
+    void replace(TermList* res) {
+	if (res) {
+	    delete tl;
+	    tl = res;
+	}
+    }
+
+    /// Move forward past terms which only index deleted documents.
+    void skip_unused_terms() {
+	if (!skip_unused)
+	    return;
+	while (!tl->at_end() && get_termfreq() == 0) {
+	    replace(tl->next());
+	}
+    }
+
+  public:
+    DeletionListTermList(const DeletionListDatabase* db_, TermList* tl_,
+			 Xapian::termcount doclen_, bool skip_unused_)
+	: db(db_), tl(tl_), doclen(doclen_), skip_unused(skip_unused_) { }
+
+    ~DeletionListTermList() { delete tl; }
+
+    Xapian::termcount get_approx_size() const { return tl->get_approx_size(); }
+
+    void accumulate_stats(Xapian::Internal::ExpandStats& stats) const {
+	stats.accumulate(get_wdf(), doclen, get_termfreq(),
+			 db->get_doccount());
+    }
+
+    string get_termname() const { return tl->get_termname(); }
+
+    Xapian::termcount get_wdf() const { return tl->get_wdf(); }
+
+    Xapian::doccount get_termfreq() const {
+	return tl->get_termfreq() - db->get_deleted_termfreq(get_termname());
+    }
+
+    TermList* next() {
+	replace(tl->next());
+	skip_unused_terms();
+	return NULL;
+    }
+
+    TermList* skip_to(const string& term) {
+	replace(tl->skip_to(term));
+	skip_unused_terms();
+	return NULL;
+    }
+
+    bool at_end() const { return tl->at_end(); }
+
+    Xapian::termcount positionlist_count() const {
+	return tl->positionlist_count();
+    }
+
+    const Xapian::VecCOW<Xapian::termpos>* get_vec_termpos() const {
+	return tl->get_vec_termpos();
+    }
+
+    PositionList* positionlist_begin() const {
+	return tl->positionlist_begin();
+    }
+};
+
+DeletionListDatabase::DeletionListDatabase(const Xapian::Database& db_,
+					   const string& file_)
+    : Xapian::Database::Internal(TRANSACTION_READONLY),
+      db(db_),
+      file(file_)
+{
+    read_file(file, deleted);
+
+    // Find the statistics of the deleted documents, so we can subtract them.
+    for (Xapian::docid did : deleted) {
+	Xapian::Document doc;
+	try {
+	    doc = db.get_document(did);
+	} catch (const Xapian::DocNotFoundError&) {
+	    throw Xapian::DatabaseCorruptError("Deletion list '" + file +
+					       "' lists document " + str(did) +
+					       " which doesn't exist");
+	}
+	deleted_length += db.get_doclength(did);
+	for (auto t = doc.termlist_begin(); t != doc.termlist_end(); ++t) {
+	    DeletedFreqs& freqs = deleted_freqs[*t];
+	    ++freqs.termfreq;
+	    freqs.collfreq += t.get_wdf();
+	}
+	for (auto v = doc.values_begin(); v != doc.values_end(); ++v) {
+	    ++deleted_value_freqs[v.get_valueno()];
+	}
+    }
+}
+
+void
+DeletionListDatabase::read_file(const string& file, vector<Xapian::docid>& result)
+{
+    ifstream in(file.c_str(), ios::binary);
+    if (!in) {
+	throw Xapian::DatabaseOpeningError("Couldn't open deletion list '" +
+					   file + "'", errno);
+    }
+    string data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    if (in.bad()) {
+	throw Xapian::DatabaseError("Couldn't read deletion list '" + file +
+				    "'", errno);
+    }
+
+    result.clear();
+    const char* p = data.data();
+    const char* end = p + data.size();
+    Xapian::docid did = 0;
+    while (p != end) {
+	Xapian::docid delta;
+	if (!unpack_uint(&p, end, &delta) || delta == 0 ||
+	    did + delta < did) {
+	    throw Xapian::DatabaseCorruptError("Bad deletion list '" + file +
+					       "'");
+	}
+	did += delta;
+	result.push_back(did);
+    }
+}
+
+void
+DeletionListDatabase::write_file(const string& file,
+				 const set<Xapian::docid>& dids)
+{
+    string data;
+    Xapian::docid prev = 0;
+    for (Xapian::docid did : dids) {
+	pack_uint(data, did - prev);
+	prev = did;
+    }
+    ofstream out(file.c_str(), ios::binary);
+    if (!out.write(data.data(), data.size()) || !out.flush()) {
+	throw Xapian::DatabaseError("Couldn't write deletion list '" + file +
+				    "'", errno);
+    }
+}
+
+void
+DeletionListDatabase::check_not_deleted(Xapian::docid did) const
+{
+    if (is_deleted(did)) {
+	throw Xapian::DocNotFoundError("Document " + str(did) +
+				       " not found");
+    }
+}
+
+Xapian::doccount
+DeletionListDatabase::get_deleted_termfreq(const string& term) const
+{
+    auto i = deleted_freqs.find(term);
+    return i == deleted_freqs.end() ? 0 : i->second.termfreq;
+}
+
+void
+DeletionListDatabase::readahead_for_query(const Xapian::Query& query) const
+{
+    db.internal->readahead_for_query(query);
+}
+
+void
+DeletionListDatabase::keep_alive()
+{
+    db.keep_alive();
+}
+
+Xapian::doccount
+DeletionListDatabase::get_doccount() const
+{
+    return db.get_doccount() - deleted.size();
+}
+
+Xapian::docid
+DeletionListDatabase::get_lastdocid() const
+{
+    return db.get_lastdocid();
+}
+
+Xapian::totallength
+DeletionListDatabase::get_total_length() const
+{
+    return db.get_total_length() - deleted_length;
+}
+
+Xapian::termcount
+DeletionListDatabase::get_doclength(Xapian::docid did) const
+{
+    check_not_deleted(did);
+    return db.internal->get_doclength(did);
+}
+
+Xapian::termcount
+DeletionListDatabase::get_unique_terms(Xapian::docid did) const
+{
+    check_not_deleted(did);
+    return db.internal->get_unique_terms(did);
+}
+
+bool
+DeletionListDatabase::get_cached_doclengths(Xapian::doccount n,
+					    const Xapian::docid* dids,
+					    Xapian::termcount* doclens) const
+{
+    // The matcher only asks for documents which a postlist returned, which
+    // won't be deleted ones.
+    return db.internal->get_cached_doclengths(n, dids, doclens);
+}
+
+void
+DeletionListDatabase::get_freqs(const string& term,
+				Xapian::doccount* termfreq_ptr,
+				Xapian::termcount* collfreq_ptr) const
+{
+    db.internal->get_freqs(term, termfreq_ptr, collfreq_ptr);
+    auto i = deleted_freqs.find(term);
+    if (i == deleted_freqs.end())
+	return;
+    if (termfreq_ptr)
+	*termfreq_ptr -= i->second.termfreq;
+    if (collfreq_ptr)
+	*collfreq_ptr -= i->second.collfreq;
+}
+
+Xapian::doccount
+DeletionListDatabase::get_value_freq(Xapian::valueno slot) const
+{
+    Xapian::doccount freq = db.get_value_freq(slot);
+    auto i = deleted_value_freqs.find(slot);
+    if (i != deleted_value_freqs.end())
+	freq -= i->second;
+    return freq;
+}
+
+// The bounds of the wrapped database are still valid bounds.
+
+string
+DeletionListDatabase::get_value_lower_bound(Xapian::valueno slot) const
+{
+    return db.get_value_lower_bound(slot);
+}
+
+string
+DeletionListDatabase::get_value_upper_bound(Xapian::valueno slot) const
+{
+    return db.get_value_upper_bound(slot);
+}
+
+Xapian::termcount
+DeletionListDatabase::get_doclength_lower_bound() const
+{
+    return db.get_doclength_lower_bound();
+}
+
+Xapian::termcount
+DeletionListDatabase::get_doclength_upper_bound() const
+{
+    return db.get_doclength_upper_bound();
+}
+
+Xapian::termcount
+DeletionListDatabase::get_wdf_upper_bound(const string& term) const
+{
+    return db.get_wdf_upper_bound(term);
+}
+
+Xapian::termcount
+DeletionListDatabase::get_unique_terms_lower_bound() const
+{
+    return db.internal->get_unique_terms_lower_bound();
+}
+
+Xapian::termcount
+DeletionListDatabase::get_unique_terms_upper_bound() const
+{
+    return db.internal->get_unique_terms_upper_bound();
+}
+
+bool
+DeletionListDatabase::term_exists(const string& term) const
+{
+    if (term.empty())
+	return get_doccount() != 0;
+    Xapian::doccount termfreq;
+    get_freqs(term, &termfreq, NULL);
+    return termfreq != 0;
+}
+
+bool
+DeletionListDatabase::has_positions() const
+{
+    return db.has_positions();
+}
+
+PostList*
+DeletionListDatabase::open_post_list(const string& term) const
+{
+    return DeletionListDatabase::open_leaf_post_list(term, false);
+}
+
+LeafPostList*
+DeletionListDatabase::open_leaf_post_list(const string& term,
+					  bool need_read_pos) const
+{
+    LeafPostList* pl = db.internal->open_leaf_post_list(term, need_read_pos);
+    if (!pl)
+	return NULL;
+    Xapian::doccount termfreq;
+    if (term.empty()) {
+	termfreq = get_doccount();
+    } else {
+	get_freqs(term, &termfreq, NULL);
+    }
+    return new DeletionListPostList(this, pl, term, termfreq);
+}
+
+ValueList*
+DeletionListDatabase::open_value_list(Xapian::valueno slot) const
+{
+    return new DeletionListValueList(this, db.internal->open_value_list(slot));
+}
+
+TermList*
+DeletionListDatabase::open_term_list(Xapian::docid did) const
+{
+    check_not_deleted(did);
+    Xapian::termcount doclen = db.internal->get_doclength(did);
+    return new DeletionListTermList(this, db.internal->open_term_list(did),
+				    doclen, false);
+}
+
+TermList*
+DeletionListDatabase::open_term_list_direct(Xapian::docid did) const
+{
+    check_not_deleted(did);
+    Xapian::termcount doclen = db.internal->get_doclength(did);
+    return new DeletionListTermList(this,
+				    db.internal->open_term_list_direct(did),
+				    doclen, false);
+}
+
+TermList*
+DeletionListDatabase::open_allterms(const string& prefix) const
+{
+    return new DeletionListTermList(this, db.internal->open_allterms(prefix),
+				    0, true);
+}
+
+PositionList*
+DeletionListDatabase::open_position_list(Xapian::docid did,
+					 const string& term) const
+{
+    check_not_deleted(did);
+    return db.internal->open_position_list(did, term);
+}
+
+Xapian::Document::Internal*
+DeletionListDatabase::open_document(Xapian::docid did, bool lazy) const
+{
+    check_not_deleted(did);
+    return db.internal->open_document(did, lazy);
+}
+
+TermList*
+DeletionListDatabase::open_spelling_termlist(const string& word) const
+{
+    return db.internal->open_spelling_termlist(word);
+}
+
+TermList*
+DeletionListDatabase::open_spelling_wordlist() const
+{
+    return db.internal->open_spelling_wordlist();
+}
+
+Xapian::doccount
+DeletionListDatabase::get_spelling_frequency(const string& word) const
+{
+    return db.internal->get_spelling_frequency(word);
+}
+
+TermList*
+DeletionListDatabase::open_synonym_termlist(const string& term) const
+{
+    return db.internal->open_synonym_termlist(term);
+}
+
+TermList*
+DeletionListDatabase::open_synonym_keylist(const string& prefix) const
+{
+    return db.internal->open_synonym_keylist(prefix);
+}
+
+string
+DeletionListDatabase::get_metadata(const string& key) const
+{
+    return db.get_metadata(key);
+}
+
+TermList*
+DeletionListDatabase::open_metadata_keylist(const string& prefix) const
+{
+    return db.internal->open_metadata_keylist(prefix);
+}
+
+bool
+DeletionListDatabase::reopen()
+{
+    // The deletion list is for the revision we opened, so we don't follow
+    // changes to the wrapped database.
+    return false;
+}
+
+void
+DeletionListDatabase::close()
+{
+    db.close();
+}
+
+void
+DeletionListDatabase::request_document(Xapian::docid did) const
+{
+    db.internal->request_document(did);
+}
+
+Xapian::rev
+DeletionListDatabase::get_revision() const
+{
+    return db.get_revision();
+}
+
+string
+DeletionListDatabase::get_uuid() const
+{
+    return db.get_uuid();
+}
+
+bool
+DeletionListDatabase::append_revision_key(string& key) const
+{
+    if (!db.internal->append_revision_key(key))
+	return false;
+    // A different deletion list means different documents.
+    key += file;
+    key += '\0';
+    return true;
+}
+
+int
+DeletionListDatabase::get_backend_info(string* path) const
+{
+    if (path)
+	*path = file;
+    return BACKEND_UNKNOWN;
+}
+
+void
+DeletionListDatabase::get_used_docid_range(Xapian::docid& first,
+					   Xapian::docid& last) const
+{
+    db.internal->get_used_docid_range(first, last);
+}
+
+string
+DeletionListDatabase::reconstruct_text(Xapian::docid did,
+				       size_t length,
+				       const string& prefix,
+				       Xapian::termpos start_pos,
+				       Xapian::termpos end_pos) const
+{
+    check_not_deleted(did);
+    return db.internal->reconstruct_text(did, length, prefix,
+					 start_pos, end_pos);
+}
+
+string
+DeletionListDatabase::get_description() const
+{
+    string desc = "DeletionListDatabase(";
+    desc += db.internal->get_description();
+    desc += ", ";
+    desc += str(deleted.size());
+    desc += " deleted)";
+    return desc;
+}
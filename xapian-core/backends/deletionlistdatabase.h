@@ -0,0 +1,211 @@
+/** @file
+ * @brief A database with a list of documents to treat as deleted
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_DELETIONLISTDATABASE_H
+#define XAPIAN_INCLUDED_DELETIONLISTDATABASE_H
+
+#include "backends/databaseinternal.h"
+
+#include "xapian/database.h"
+#include "xapian/types.h"
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+/** A read-only database with a list of documents to treat as deleted.
+ *
+ *  This wraps another database and hides the documents listed in a deletion
+ *  list file, adjusting the statistics to match.  It's used for the segments
+ *  of a database written by Xapian::SegmentedDatabase, which are never
+ *  modified: deletions are recorded in a deletion list file named on a
+ *  "deleted" line after the segment's line in the stub file.
+ *
+ *  The deletion list file holds the deleted docids in ascending order, each
+ *  stored as the difference from the previous one (the first from 0) using
+ *  pack_uint().
+ */
+class DeletionListDatabase : public Xapian::Database::Internal {
+    /// Frequencies of a term in the deleted documents.
+    struct DeletedFreqs {
+	Xapian::doccount termfreq = 0;
+
+	Xapian::termcount collfreq = 0;
+    };
+
+    /// The database we're wrapping.
+    Xapian::Database db;
+
+    /// The deletion list file.
+    std::string file;
+
+    /// The deleted docids, in ascending order.
+    std::vector<Xapian::docid> deleted;
+
+    /// The total length of the deleted documents.
+    Xapian::totallength deleted_length = 0;
+
+    /// The frequencies of each term in the deleted documents.
+    std::map<std::string, DeletedFreqs> deleted_freqs;
+
+    /// The number of deleted documents with a value in each slot.
+    std::map<Xapian::valueno, Xapian::doccount> deleted_value_freqs;
+
+    /// Throw DocNotFoundError if document @a did has been deleted.
+    void check_not_deleted(Xapian::docid did) const;
+
+  public:
+    /** Open a database with a deletion list.
+     *
+     *  @param db_	The database to wrap (must have a single shard).
+     *  @param file_	The deletion list file.
+     */
+    DeletionListDatabase(const Xapian::Database& db_,
+			 const std::string& file_);
+
+    /** Read a deletion list file.
+     *
+     *  @param file		The file to read.
+     *  @param[out] result	The docids read, in ascending order.
+     */
+    static void read_file(const std::string& file,
+			  std::vector<Xapian::docid>& result);
+
+    /// Write a deletion list file listing @a dids.
+    static void write_file(const std::string& file,
+			   const std::set<Xapian::docid>& dids);
+
+    /// Has document @a did been deleted?
+    bool is_deleted(Xapian::docid did) const {
+	return std::binary_search(deleted.begin(), deleted.end(), did);
+    }
+
+    /// Return the number of deleted documents which @a term indexes.
+    Xapian::doccount get_deleted_termfreq(const std::string& term) const;
+
+    void readahead_for_query(const Xapian::Query& query) const;
+
+    void keep_alive();
+
+    Xapian::doccount get_doccount() const;
+
+    Xapian::docid get_lastdocid() const;
+
+    Xapian::totallength get_total_length() const;
+
+    Xapian::termcount get_doclength(Xapian::docid did) const;
+
+    Xapian::termcount get_unique_terms(Xapian::docid did) const;
+
+    bool get_cached_doclengths(Xapian::doccount n,
+			       const Xapian::docid* dids,
+			       Xapian::termcount* doclens) const;
+
+    void get_freqs(const std::string& term,
+		   Xapian::doccount* termfreq_ptr,
+		   Xapian::termcount* collfreq_ptr) const;
+
+    Xapian::doccount get_value_freq(Xapian::valueno slot) const;
+
+    std::string get_value_lower_bound(Xapian::valueno slot) const;
+
+    std::string get_value_upper_bound(Xapian::valueno slot) const;
+
+    Xapian::termcount get_doclength_lower_bound() const;
+
+    Xapian::termcount get_doclength_upper_bound() const;
+
+    Xapian::termcount get_wdf_upper_bound(const std::string& term) const;
+
+    Xapian::termcount get_unique_terms_lower_bound() const;
+
+    Xapian::termcount get_unique_terms_upper_bound() const;
+
+    bool term_exists(const std::string& term) const;
+
+    bool has_positions() const;
+
+    PostList* open_post_list(const std::string& term) const;
+
+    LeafPostList* open_leaf_post_list(const std::string& term,
+				      bool need_read_pos) const;
+
+    ValueList* open_value_list(Xapian::valueno slot) const;
+
+    TermList* open_term_list(Xapian::docid did) const;
+
+    TermList* open_term_list_direct(Xapian::docid did) const;
+
+    TermList* open_allterms(const std::string& prefix) const;
+
+    PositionList* open_position_list(Xapian::docid did,
+				     const std::string& term) const;
+
+    Xapian::Document::Internal* open_document(Xapian::docid did,
+					      bool lazy) const;
+
+    TermList* open_spelling_termlist(const std::string& word) const;
+
+    TermList* open_spelling_wordlist() const;
+
+    Xapian::doccount get_spelling_frequency(const std::string& word) const;
+
+    TermList* open_synonym_termlist(const std::string& term) const;
+
+    TermList* open_synonym_keylist(const std::string& prefix) const;
+
+    std::string get_metadata(const std::string& key) const;
+
+    TermList* open_metadata_keylist(const std::string& prefix) const;
+
+    bool reopen();
+
+    void close();
+
+    void request_document(Xapian::docid did) const;
+
+    Xapian::rev get_revision() const;
+
+    std::string get_uuid() const;
+
+    bool append_revision_key(std::string& key) const;
+
+    /** Return BACKEND_UNKNOWN.
+     *
+     *  This stops anything which handles specific backends (for example,
+     *  compaction) from using the wrapped database directly, which would
+     *  ignore the deletion list.
+     */
+    int get_backend_info(std::string* path) const;
+
+    void get_used_docid_range(Xapian::docid& first,
+			      Xapian::docid& last) const;
+
+    std::string reconstruct_text(Xapian::docid did,
+				 size_t length,
+				 const std::string& prefix,
+				 Xapian::termpos start_pos,
+				 Xapian::termpos end_pos) const;
+
+    std::string get_description() const;
+};
+
+#endif // XAPIAN_INCLUDED_DELETIONLISTDATABASE_H
@@ -30,6 +30,7 @@
 #include "backends/databaseinternal.h"
 #include "overflow.h"
 
+#include <limits>
 #include <map>
 #include <memory>
 #include <string>
@@ -230,6 +231,17 @@ class Document::Internal : public Xapian::Internal::intrusive_base {
      */
     Xapian::docid get_docid() const { return did; }
 
+    /** Get the database this document came from.
+     *
+     *  If this document didn't come from a database, this will be NULL.
+     *
+     *  Note that this is the sub-database when multiple databases are being
+     *  searched.
+     */
+    const Xapian::Database::Internal* get_database() const {
+	return database.get();
+    }
+
     /// Get the document data.
     std::string get_data() const {
 	if (data)
@@ -13,6 +13,7 @@ noinst_HEADERS +=\
 	backends/glass/glass_dbcheck.h\
 	backends/glass/glass_defs.h\
 	backends/glass/glass_docdata.h\
+	backends/glass/glass_docstats.h\
 	backends/glass/glass_document.h\
 	backends/glass/glass_freelist.h\
 	backends/glass/glass_inverter.h\
@@ -23,6 +24,7 @@ noinst_HEADERS +=\
 	backends/glass/glass_replicate_internal.h\
 	backends/glass/glass_spelling.h\
 	backends/glass/glass_spellingwordslist.h\
+	backends/glass/glass_syncer.h\
 	backends/glass/glass_synonym.h\
 	backends/glass/glass_table.h\
 	backends/glass/glass_termlist.h\
@@ -48,6 +50,7 @@ lib_src +=\
 	backends/glass/glass_postlist.cc\
 	backends/glass/glass_spelling.cc\
 	backends/glass/glass_spellingwordslist.cc\
+	backends/glass/glass_syncer.cc\
 	backends/glass/glass_synonym.cc\
 	backends/glass/glass_table.cc\
 	backends/glass/glass_termlist.cc\
@@ -28,6 +28,7 @@
 
 #include <algorithm>
 #include <memory>
+#include <mutex>
 #include <queue>
 
 #include <cerrno>
@@ -42,6 +43,9 @@
 #include "filetests.h"
 #include "internaltypes.h"
 #include "pack.h"
+#include "parallelfor.h"
+#include "str.h"
+#include "stringutils.h"
 #include "backends/valuestats.h"
 
 #include "../byte_length_strings.h"
@@ -80,20 +84,34 @@ is_doclenchunk_key(const string & key)
 class PostlistCursor : private GlassCursor {
     Xapian::docid offset;
 
+    /// Stop at the first key >= this (unless it's empty).
+    string range_end;
+
   public:
     string key, tag;
     Xapian::docid firstdid;
     Xapian::termcount tf, cf;
 
-    PostlistCursor(const GlassTable *in, Xapian::docid offset_)
-	: GlassCursor(in), offset(offset_), firstdid(0)
+    /** Construct a cursor over the keys in [range_start, range_end).
+     *
+     *  The cursor isn't positioned on an entry until next() is called.
+     *
+     *  An empty @a range_end means the end of the table.
+     */
+    PostlistCursor(const GlassTable *in, Xapian::docid offset_,
+		   const string& range_start, const string& range_end_)
+	: GlassCursor(in), offset(offset_), range_end(range_end_), firstdid(0)
     {
-	rewind();
-	next();
+	if (range_start.empty()) {
+	    rewind();
+	} else {
+	    find_entry_lt(range_start);
+	}
     }
 
     bool next() {
 	if (!GlassCursor::next()) return false;
+	if (!range_end.empty() && current_key >= range_end) return false;
 	// We put all chunks into the non-initial chunk form here, then fix up
 	// the first chunk for each term in the merged database as we merge.
 	read_tag();
@@ -185,11 +203,20 @@ encode_valuestats(Xapian::doccount freq,
     return value;
 }
 
+/** Merge postlist tables.
+ *
+ *  If @a range_start or @a range_end are specified, only keys in the range
+ *  [range_start, range_end) are merged.  These must be the keys of the first
+ *  chunks of terms, which ensures all the chunks for a term are in the same
+ *  range.
+ */
 static void
 merge_postlists(Xapian::Compactor * compactor,
 		GlassTable * out, vector<Xapian::docid>::const_iterator offset,
 		vector<const GlassTable*>::const_iterator b,
-		vector<const GlassTable*>::const_iterator e)
+		vector<const GlassTable*>::const_iterator e,
+		const string& range_start = string(),
+		const string& range_end = string())
 {
     priority_queue<PostlistCursor *, vector<PostlistCursor *>, PostlistCursorGt> pq;
     for ( ; b != e; ++b, ++offset) {
@@ -199,7 +226,12 @@ merge_postlists(Xapian::Compactor * compactor,
 	    continue;
 	}
 
-	pq.push(new PostlistCursor(in, *offset));
+	auto cur = new PostlistCursor(in, *offset, range_start, range_end);
+	if (cur->next()) {
+	    pq.push(cur);
+	} else {
+	    delete cur;
+	}
     }
 
     string last_key;
@@ -597,16 +629,19 @@ static void
 multimerge_postlists(Xapian::Compactor * compactor,
 		     GlassTable * out, const char * tmpdir,
 		     vector<const GlassTable *> tmp,
-		     vector<Xapian::docid> off)
+		     vector<Xapian::docid> off,
+		     unsigned n_threads)
 {
     unsigned int c = 0;
     while (tmp.size() > 3) {
-	vector<const GlassTable *> tmpout;
-	tmpout.reserve(tmp.size() / 2);
+	vector<const GlassTable *> tmpout(tmp.size() / 2);
 	vector<Xapian::docid> newoff;
 	newoff.resize(tmp.size() / 2);
-	for (unsigned int i = 0, j; i < tmp.size(); i = j) {
-	    j = i + 2;
+	// The merges in each pass use disjoint sets of tables, so they can
+	// be run in parallel.
+	parallel_for(tmpout.size(), n_threads, [&](size_t n) {
+	    unsigned int i = n * 2;
+	    unsigned int j = i + 2;
 	    if (j == tmp.size() - 1) ++j;
 
 	    string dest = tmpdir;
@@ -634,11 +669,11 @@ multimerge_postlists(Xapian::Compactor * compactor,
 		    tmp[k] = NULL;
 		}
 	    }
-	    tmpout.push_back(tmptab);
+	    tmpout[n] = tmptab;
 	    tmptab->flush_db();
 	    tmptab->commit(1, &root_info);
 	    AssertRel(root_info.get_blocksize(),==,65536);
-	}
+	});
 	swap(tmp, tmpout);
 	swap(off, newoff);
 	++c;
@@ -653,6 +688,133 @@ multimerge_postlists(Xapian::Compactor * compactor,
     }
 }
 
+/// What's needed to open another instance of an input postlist table.
+struct PostlistSource {
+    /// The path to pass to the GlassTable constructor.
+    string path;
+
+    /// The root info for the table.
+    RootInfo root_info;
+
+    /// The revision to open.
+    glass_revision_number_t rev;
+};
+
+/** Merge postlist tables using several threads.
+ *
+ *  The term space is split into ranges at keys sampled from the branch
+ *  blocks of the inputs, and each range is merged on its own thread into a
+ *  temporary table.  A GlassTable object can't be used by more than one
+ *  thread at once, so each thread opens its own instances of the input
+ *  tables.  The ranges are in key order, so the temporary tables are then
+ *  simply copied to the output in turn.
+ *
+ *  @return false (having done nothing) if the inputs are too small to split.
+ */
+static bool
+merge_postlists_by_range(Xapian::Compactor * compactor,
+			 GlassTable * out, const char * tmpdir,
+			 const vector<const GlassTable*> & inputs,
+			 const vector<PostlistSource> & sources,
+			 const vector<Xapian::docid> & offset,
+			 unsigned n_threads)
+{
+    // Sample enough keys that the ranges come out roughly the same size.
+    const size_t SAMPLES_PER_RANGE = 64;
+    vector<string> samples;
+    for (auto in : inputs) {
+	in->sample_keys(n_threads * SAMPLES_PER_RANGE, samples);
+    }
+
+    // A range has to start at the first chunk of a term so that all the
+    // chunks for each term are merged together.  Sampled keys may be
+    // truncated or for a later chunk, but the term they start with will do.
+    vector<string> bounds;
+    bounds.reserve(samples.size());
+    for (const string & key : samples) {
+	// Skip keys for user metadata, value and document length chunks.
+	if (key[0] == '\0' && (key.size() == 1 || key[1] != '\xff'))
+	    continue;
+	const char * p = key.data();
+	string term;
+	(void)unpack_string_preserving_sort(&p, p + key.size(), term);
+	if (!term.empty())
+	    bounds.push_back(pack_glass_postlist_key(term));
+    }
+    if (bounds.empty())
+	return false;
+    sort(bounds.begin(), bounds.end());
+
+    // The first range starts at the start of the table, and so also gets the
+    // user metadata, value and document length chunks.
+    vector<string> range_starts(1);
+    for (unsigned r = 1; r < n_threads; ++r) {
+	const string & bound = bounds[r * bounds.size() / n_threads];
+	if (bound != range_starts.back())
+	    range_starts.push_back(bound);
+    }
+    size_t n_ranges = range_starts.size();
+    if (n_ranges < 2)
+	return false;
+
+    vector<unique_ptr<GlassTable>> runs(n_ranges);
+    auto remove_runs = [&]() {
+	for (auto& run : runs) {
+	    if (!run) continue;
+	    string path = run->get_path();
+	    run.reset();
+	    unlink(path.c_str());
+	}
+    };
+    try {
+	parallel_for(n_ranges, n_threads, [&](size_t r) {
+	    vector<unique_ptr<GlassTable>> tables;
+	    vector<const GlassTable*> range_inputs;
+	    for (auto& source : sources) {
+		tables.emplace_back(new GlassTable("postlist", source.path,
+						   true));
+		tables.back()->open(0, source.root_info, source.rev);
+		range_inputs.push_back(tables.back().get());
+	    }
+
+	    string dest = tmpdir;
+	    dest += "/tmprange";
+	    dest += str(r);
+	    dest += '.';
+	    runs[r].reset(new GlassTable("postlist", dest, false));
+
+	    // As in multimerge_postlists(), use maximum blocksize for the
+	    // temporary tables, and don't compress entries in them.
+	    RootInfo root_info;
+	    root_info.init(65536, 0);
+	    const int flags = Xapian::DB_DANGEROUS|Xapian::DB_NO_SYNC;
+	    runs[r]->create_and_open(flags, root_info);
+
+	    string range_end;
+	    if (r + 1 != n_ranges) range_end = range_starts[r + 1];
+	    merge_postlists(compactor, runs[r].get(), offset.begin(),
+			    range_inputs.begin(), range_inputs.end(),
+			    range_starts[r], range_end);
+	    runs[r]->flush_db();
+	    runs[r]->commit(1, &root_info);
+	});
+
+	for (auto& run : runs) {
+	    GlassCursor cur(run.get());
+	    cur.rewind();
+	    while (cur.next()) {
+		bool compressed = cur.read_tag(true);
+		out->add(cur.current_key, cur.current_tag, compressed);
+	    }
+	}
+    } catch (...) {
+	remove_runs();
+	throw;
+    }
+    remove_runs();
+    return true;
+}
+
 class PositionCursor : private GlassCursor {
     Xapian::docid offset;
 
@@ -870,7 +1032,14 @@ GlassDatabase::compact(Xapian::Compactor * compactor,
     vector<GlassTable *> tabs;
     tabs.reserve(tables_end - tables);
     off_t prev_size = block_size;
-    for (const table_list * t = tables; t < tables_end; ++t) {
+    // Each table is compacted independently, so we can compact them in
+    // parallel, except for single file output where they're written one
+    // after another.
+    unsigned n_threads = compactor ? compactor->get_threads() : 1;
+    if (single_file) n_threads = 1;
+    mutex tabs_mutex;
+    parallel_for(tables_end - tables, n_threads, [&](size_t i) {
+	const table_list * t = tables + i;
 	// The postlist table requires an N-way merge, adjusting the
 	// headers of various blocks.  The spelling and synonym tables also
 	// need special handling.  The other tables have keys sorted in
@@ -965,7 +1134,7 @@ GlassDatabase::compact(Xapian::Compactor * compactor,
 		    m += " inputs present, so suppressing output";
 		    compactor->set_status(t->name, m);
 		}
-		continue;
+		return;
 	    }
 	    output_will_exist = false;
 	}
@@ -973,7 +1142,7 @@ GlassDatabase::compact(Xapian::Compactor * compactor,
 	if (!output_will_exist) {
 	    if (compactor)
 		compactor->set_status(t->name, "doesn't exist");
-	    continue;
+	    return;
 	}
 
 	GlassTable * out;
@@ -983,7 +1152,10 @@ GlassDatabase::compact(Xapian::Compactor * compactor,
 	} else {
 	    out = new GlassTable(t->name, dest, false, t->lazy);
 	}
-	tabs.push_back(out);
+	{
+	    lock_guard<mutex> tabs_lock(tabs_mutex);
+	    tabs.push_back(out);
+	}
 	RootInfo * root_info = version_file_out->root_to_set(t->type);
 	if (single_file) {
 	    root_info->set_free_list(fl_serialised);
@@ -997,10 +1169,29 @@ GlassDatabase::compact(Xapian::Compactor * compactor,
 
 	switch (t->type) {
 	    case Glass::POSTLIST: {
+		bool merged = false;
 		if (multipass && inputs.size() > 3) {
 		    multimerge_postlists(compactor, out, destdir,
-					 inputs, offset);
-		} else {
+					 inputs, offset, n_threads);
+		    merged = true;
+		} else if (n_threads > 1 && !single_file_in) {
+		    vector<PostlistSource> postlist_sources;
+		    postlist_sources.reserve(sources.size());
+		    for (auto src : sources) {
+			auto db = static_cast<const GlassDatabase*>(src);
+			string path = db->postlist_table.get_path();
+			path.resize(path.size() -
+				    CONST_STRLEN(GLASS_TABLE_EXTENSION));
+			const GlassVersion & v = db->version_file;
+			postlist_sources.push_back({path,
+						    v.get_root(Glass::POSTLIST),
+						    v.get_revision()});
+		    }
+		    merged = merge_postlists_by_range(compactor, out, destdir,
+						      inputs, postlist_sources,
+						      offset, n_threads);
+		}
+		if (!merged) {
 		    merge_postlists(compactor, out, offset.begin(),
 				    inputs.begin(), inputs.end());
 		}
@@ -1079,7 +1270,7 @@ GlassDatabase::compact(Xapian::Compactor * compactor,
 	    if (compactor)
 		compactor->set_status(t->name, status);
 	}
-    }
+    });
 
     // If compacting to a single file output and all the tables are empty, pad
     // the output so that it isn't mistaken for a stub database when we try to
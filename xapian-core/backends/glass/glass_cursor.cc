@@ -57,7 +57,8 @@ GlassCursor::GlassCursor(const GlassTable *B_, const Glass::Cursor * C_)
 	  tag_status(UNREAD),
 	  B(B_),
 	  version(B_->cursor_version),
-	  level(B_->level)
+	  level(B_->level),
+	  readahead_leaf(BLK_UNUSED)
 {
     B->cursor_created_since_last_modification = true;
     C = new Glass::Cursor[level + 1];
@@ -140,6 +141,19 @@ GlassCursor::next()
     RETURN(true);
 }
 
+void
+GlassCursor::readahead_next_leaf()
+{
+    LOGCALL_VOID(DB, "GlassCursor::readahead_next_leaf", NO_ARGS);
+    if (!is_positioned || level == 0 || B->cursor_version != version)
+	return;
+    uint4 n = C[0].get_n();
+    if (n == readahead_leaf)
+	return;
+    readahead_leaf = n;
+    B->readahead_next_leaf(C);
+}
+
 bool
 GlassCursor::find_entry(const string &key)
 {
@@ -186,6 +186,9 @@ class GlassCursor {
     /** The value of level in the Btree structure. */
     int level;
 
+    /// The leaf block readahead_next_leaf() was last called in.
+    uint4 readahead_leaf;
+
     /** Get the key.
      *
      *  The key of the item at the cursor is copied into key.
@@ -335,6 +338,14 @@ class GlassCursor {
      */
     bool after_end() const { return is_after_end; }
 
+    /** Hint that the entries after the current one will soon be read.
+     *
+     *  The first time this is called in each leaf block, readahead is
+     *  requested for the next leaf block, so reading it can overlap with
+     *  processing the entries in this one.
+     */
+    void readahead_next_leaf();
+
     /// Return a pointer to the GlassTable we're a cursor for.
     const GlassTable * get_table() const { return B; }
 };
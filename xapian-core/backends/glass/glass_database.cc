@@ -54,6 +54,7 @@
 #include "filetests.h"
 #include "io_utils.h"
 #include "pack.h"
+#include "parallelfor.h"
 #include "parseint.h"
 #include "net/remoteconnection.h"
 #include "api/replication.h"
@@ -71,6 +72,9 @@
 #include <cstdlib>
 #include <memory>
 #include <string>
+#include <tuple>
+#include <unordered_set>
+#include <vector>
 
 using namespace std;
 using namespace Xapian;
@@ -189,6 +193,47 @@ GlassDatabase::~GlassDatabase()
     LOGCALL_DTOR(DB, "GlassDatabase");
 }
 
+void
+GlassDatabase::enable_mmap()
+{
+    LOGCALL_VOID(DB, "GlassDatabase::enable_mmap", NO_ARGS);
+    if (!readonly) return;
+    mmapped = true;
+    postlist_table.enable_mmap();
+    position_table.enable_mmap();
+    termlist_table.enable_mmap();
+    synonym_table.enable_mmap();
+    spelling_table.enable_mmap();
+    docdata_table.enable_mmap();
+}
+
+Xapian::Database::Internal*
+GlassDatabase::open_copy() const
+{
+    LOGCALL(DB, Xapian::Database::Internal*, "GlassDatabase::open_copy", NO_ARGS);
+    // A single file database opened from a file descriptor has no path.
+    if (!readonly || db_dir.empty())
+	RETURN(NULL);
+    unique_ptr<GlassDatabase> copy(new GlassDatabase(db_dir));
+    if (mmapped)
+	copy->enable_mmap();
+    copy->value_column_widths = value_column_widths;
+    if (copy->get_revision() == get_revision()) {
+	// Share the document statistics cache, and any value columns and
+	// dictionaries we've already loaded.
+	copy->doc_stats = doc_stats;
+	copy->value_columns = value_columns;
+	copy->value_dictionaries = value_dictionaries;
+    } else {
+	if (doc_stats)
+	    copy->enable_doc_stats_cache();
+	for (auto&& dict : value_dictionaries) {
+	    (void)copy->value_dictionaries[dict.first];
+	}
+    }
+    RETURN(copy.release());
+}
+
 bool
 GlassDatabase::database_exists() {
     LOGCALL(DB, bool, "GlassDatabase::database_exists", NO_ARGS);
@@ -215,6 +260,7 @@ GlassDatabase::create_and_open_tables(int flags, unsigned int block_size)
     docdata_table.create_and_open(flags, v.get_root(Glass::DOCDATA));
     termlist_table.create_and_open(flags, v.get_root(Glass::TERMLIST));
     postlist_table.create_and_open(flags, v.get_root(Glass::POSTLIST));
+    value_manager.set_chunk_bounds(v.get_value_chunk_bounds());
 
     if (!v.sync(tmpfile, rev, flags)) {
 	throw Xapian::DatabaseCreateError("Failed to create iamglass file");
@@ -248,6 +294,20 @@ GlassDatabase::open_tables(int flags)
 	RETURN(false);
     }
 
+    drop_doc_stats();
+    drop_value_columns();
+
+    if (readonly) {
+	// The UUID identifies the database in the process-wide block cache.
+	const char * uuid = version_file.get_uuid();
+	docdata_table.set_block_cache_uuid(uuid);
+	spelling_table.set_block_cache_uuid(uuid);
+	synonym_table.set_block_cache_uuid(uuid);
+	termlist_table.set_block_cache_uuid(uuid);
+	position_table.set_block_cache_uuid(uuid);
+	postlist_table.set_block_cache_uuid(uuid);
+    }
+
     docdata_table.open(flags, version_file.get_root(Glass::DOCDATA), rev);
     spelling_table.open(flags, version_file.get_root(Glass::SPELLING), rev);
     synonym_table.open(flags, version_file.get_root(Glass::SYNONYM), rev);
@@ -259,6 +319,7 @@ GlassDatabase::open_tables(int flags)
     spelling_table.set_wordfreq_upper_bound(swfub);
 
     value_manager.reset();
+    value_manager.set_chunk_bounds(version_file.get_value_chunk_bounds());
 
     if (!readonly) {
 	changes.set_oldest_changeset(version_file.get_oldest_changeset());
@@ -357,6 +418,34 @@ GlassDatabase::set_revision_number(int flags, glass_revision_number_t new_revisi
     spelling_table.commit(new_revision, version_file.root_to_set(Glass::SPELLING));
     docdata_table.commit(new_revision, version_file.root_to_set(Glass::DOCDATA));
 
+    if ((flags & Xapian::DB_ASYNC_COMMIT) &&
+	!(flags & (Xapian::DB_NO_SYNC | Xapian::DB_DANGEROUS)) &&
+	!db_dir.empty() &&
+	!version_file.writing_changeset()) {
+	// The blocks of the new revision have all been written, so leave the
+	// background thread to sync them and then write the version file.
+	if (!syncer) {
+	    syncer.reset(new GlassSyncer(db_dir, version_file.get_revision()));
+	    set_tables_syncer();
+	}
+	vector<int> fds;
+	auto add_fd = [&fds](const GlassTable& table) {
+	    int fd = table.get_fd();
+	    if (fd >= 0) fds.push_back(fd);
+	};
+	add_fd(postlist_table);
+	add_fd(position_table);
+	add_fd(termlist_table);
+	add_fd(synonym_table);
+	add_fd(spelling_table);
+	add_fd(docdata_table);
+	syncer->request(new_revision,
+			version_file.serialise_version(new_revision),
+			std::move(fds), flags);
+	version_file.set_committed(new_revision);
+	return;
+    }
+
     const string & tmpfile = version_file.write(new_revision, flags);
     if (!postlist_table.sync() ||
 	!position_table.sync() ||
@@ -372,6 +461,18 @@ GlassDatabase::set_revision_number(int flags, glass_revision_number_t new_revisi
     changes.commit(new_revision, flags);
 }
 
+void
+GlassDatabase::set_tables_syncer()
+{
+    GlassSyncer* s = syncer.get();
+    postlist_table.set_syncer(s);
+    position_table.set_syncer(s);
+    termlist_table.set_syncer(s);
+    synonym_table.set_syncer(s);
+    spelling_table.set_syncer(s);
+    docdata_table.set_syncer(s);
+}
+
 void
 GlassDatabase::request_document(Xapian::docid did) const
 {
@@ -381,12 +482,12 @@ GlassDatabase::request_document(Xapian::docid did) const
 void
 GlassDatabase::readahead_for_query(const Xapian::Query &query) const
 {
+    vector<string> keys;
     Xapian::TermIterator t;
     for (t = query.get_unique_terms_begin(); t != Xapian::TermIterator(); ++t) {
-	const string & term = *t;
-	if (!postlist_table.readahead_key(GlassPostListTable::make_key(term)))
-	    break;
+	keys.push_back(GlassPostListTable::make_key(*t));
     }
+    postlist_table.readahead_keys(keys);
 }
 
 bool
@@ -401,12 +502,21 @@ void
 GlassDatabase::close()
 {
     LOGCALL_VOID(DB, "GlassDatabase::close", NO_ARGS);
+    if (syncer) {
+	// Finish syncing before closing the files being synced.
+	syncer->wait_all();
+	syncer.reset();
+	set_tables_syncer();
+    }
     postlist_table.close(true);
     position_table.close(true);
     termlist_table.close(true);
     synonym_table.close(true);
     spelling_table.close(true);
     docdata_table.close(true);
+    drop_doc_stats();
+    drop_value_columns();
+    drop_copies();
     lock.release();
 }
 
@@ -703,6 +813,8 @@ GlassDatabase::cancel()
     synonym_table.cancel(version_file.get_root(Glass::SYNONYM), rev);
     spelling_table.cancel(version_file.get_root(Glass::SPELLING), rev);
     docdata_table.cancel(version_file.get_root(Glass::DOCDATA), rev);
+    drop_doc_stats();
+    drop_value_columns();
 
     Xapian::termcount ub = version_file.get_spelling_wordfreq_upper_bound();
     spelling_table.set_wordfreq_upper_bound(ub);
@@ -734,17 +846,69 @@ GlassDatabase::get_doclength(Xapian::docid did) const
 {
     LOGCALL(DB, Xapian::termcount, "GlassDatabase::get_doclength", did);
     Assert(did != 0);
+    if (doc_stats) {
+	if (!doc_stats->have_doclengths())
+	    load_doclengths();
+	Xapian::termcount doclen = doc_stats->get_doclength(did);
+	if (doclen != GlassDocStatsCache::UNKNOWN)
+	    RETURN(doclen);
+	// Fall through so we throw DocNotFoundError.
+    }
     intrusive_ptr<const GlassDatabase> ptrtothis(this);
     RETURN(postlist_table.get_doclength(did, ptrtothis));
 }
 
+bool
+GlassDatabase::get_cached_doclengths(Xapian::doccount n,
+				     const Xapian::docid* dids,
+				     Xapian::termcount* doclens) const
+{
+    // This is called for every batch of postings weighted, so don't use
+    // LOGCALL.
+    if (!doc_stats)
+	return false;
+    if (!doc_stats->have_doclengths())
+	load_doclengths();
+    for (Xapian::doccount i = 0; i != n; ++i) {
+	Xapian::termcount doclen = doc_stats->get_doclength(dids[i]);
+	if (doclen == GlassDocStatsCache::UNKNOWN)
+	    return false;
+	doclens[i] = doclen;
+    }
+    return true;
+}
+
+void
+GlassDatabase::load_doclengths() const
+{
+    LOGCALL_VOID(DB, "GlassDatabase::load_doclengths", NO_ARGS);
+    // Copies sharing doc_stats may try to load it at the same time, but only
+    // one will actually do so.
+    doc_stats->load_doclengths([&]() {
+	intrusive_ptr<const GlassDatabase> ptrtothis(this);
+	GlassPostList pl(ptrtothis, string(), false);
+	while (true) {
+	    pl.next(0.0);
+	    if (pl.at_end()) break;
+	    doc_stats->set_doclength(pl.get_docid(), pl.get_wdf());
+	}
+    });
+}
+
 Xapian::termcount
 GlassDatabase::get_unique_terms(Xapian::docid did) const
 {
     LOGCALL(DB, Xapian::termcount, "GlassDatabase::get_unique_terms", did);
     Assert(did != 0);
+    if (doc_stats) {
+	Xapian::termcount count = doc_stats->get_unique_terms(did);
+	if (count != GlassDocStatsCache::UNKNOWN)
+	    RETURN(count);
+    }
     intrusive_ptr<const GlassDatabase> ptrtothis(this);
-    RETURN(GlassTermList(ptrtothis, did).get_unique_terms());
+    Xapian::termcount count = GlassTermList(ptrtothis, did).get_unique_terms();
+    if (doc_stats) doc_stats->set_unique_terms(did, count);
+    RETURN(count);
 }
 
 void
@@ -852,7 +1016,62 @@ GlassDatabase::open_value_list(Xapian::valueno slot) const
 {
     LOGCALL(DB, ValueList *, "GlassDatabase::open_value_list", slot);
     intrusive_ptr<const GlassDatabase> ptrtothis(this);
-    RETURN(new GlassValueList(slot, ptrtothis));
+    auto w = value_column_widths.find(slot);
+    if (w == value_column_widths.end())
+	RETURN(new GlassValueList(slot, ptrtothis));
+
+    auto& column = value_columns[slot];
+    if (!column) {
+	auto new_column = make_shared<ValueColumn>(w->second);
+	GlassValueList vl(slot, ptrtothis);
+	new_column->load(vl);
+	column = std::move(new_column);
+    }
+    RETURN(new ValueColumnList(column, slot));
+}
+
+void
+GlassDatabase::add_value_column(Xapian::valueno slot, unsigned width)
+{
+    LOGCALL_VOID(DB, "GlassDatabase::add_value_column", slot | width);
+    auto& w = value_column_widths[slot];
+    if (w != width) {
+	w = width;
+	value_columns.erase(slot);
+	// Any copies would need to be told about the column.
+	drop_copies();
+    }
+}
+
+void
+GlassDatabase::add_value_dictionary(Xapian::valueno slot)
+{
+    LOGCALL_VOID(DB, "GlassDatabase::add_value_dictionary", slot);
+    // An empty pointer means the dictionary is loaded when first needed.
+    if (value_dictionaries.emplace(slot, nullptr).second) {
+	// Any copies would need to be told about the dictionary.
+	drop_copies();
+    }
+}
+
+const shared_ptr<const ValueDictionary>&
+GlassDatabase::get_value_dictionary(Xapian::valueno slot) const
+{
+    // This is called for every document a ValueCountMatchSpy counts, so
+    // don't use LOGCALL.
+    auto i = value_dictionaries.find(slot);
+    if (i == value_dictionaries.end())
+	return Database::Internal::get_value_dictionary(slot);
+
+    auto& dict = i->second;
+    if (!dict) {
+	auto new_dict = make_shared<ValueDictionary>();
+	// Use the virtual method so a writable database merges any changes.
+	unique_ptr<ValueList> vl(open_value_list(slot));
+	new_dict->load(*vl);
+	dict = std::move(new_dict);
+    }
+    return dict;
 }
 
 TermList *
@@ -987,6 +1206,18 @@ GlassDatabase::get_uuid() const
     RETURN(version_file.get_uuid_string());
 }
 
+bool
+GlassDatabase::append_revision_key(string& key) const
+{
+    LOGCALL(DB, bool, "GlassDatabase::append_revision_key", key);
+    // A writable database can be modified without the revision changing.
+    if (!is_read_only())
+	RETURN(false);
+    pack_string(key, version_file.get_uuid_string());
+    pack_uint(key, version_file.get_revision());
+    RETURN(true);
+}
+
 void
 GlassDatabase::throw_termlist_table_close_exception() const
 {
@@ -1055,6 +1286,7 @@ GlassWritableDatabase::GlassWritableDatabase(const string &dir, int flags,
 	: GlassDatabase(dir, flags, block_size),
 	  change_count(0),
 	  flush_threshold(0),
+	  flush_threshold_bytes(0),
 	  modify_shortcut_document(NULL),
 	  modify_shortcut_docid(0)
 {
@@ -1067,8 +1299,30 @@ GlassWritableDatabase::GlassWritableDatabase(const string &dir, int flags,
 					       "be a non-negative integer");
 	}
     }
-    if (flush_threshold == 0)
-	flush_threshold = 10000;
+    p = getenv("XAPIAN_FLUSH_THRESHOLD_BYTES");
+    if (p && *p) {
+	if (!parse_unsigned(p, flush_threshold_bytes)) {
+	    throw Xapian::InvalidArgumentError("XAPIAN_FLUSH_THRESHOLD_BYTES "
+					       "must be a non-negative integer");
+	}
+    }
+    p = getenv("XAPIAN_FLUSH_THREADS");
+    if (p && *p) {
+	unsigned flush_threads;
+	if (!parse_unsigned(p, flush_threads)) {
+	    throw Xapian::InvalidArgumentError("XAPIAN_FLUSH_THREADS must be a "
+					       "non-negative integer");
+	}
+	postlist_table.set_merge_threads(flush_threads);
+    }
+    if (flush_threshold == 0) {
+	// If only a memory limit is set, don't also limit the number of
+	// documents.
+	flush_threshold = flush_threshold_bytes ? Xapian::doccount(-1) : 10000;
+    }
+
+    if (flags & Xapian::DB_CACHE_DOC_STATS)
+	enable_doc_stats_cache();
 }
 
 GlassWritableDatabase::~GlassWritableDatabase()
@@ -1086,13 +1340,22 @@ GlassWritableDatabase::commit()
     apply();
 }
 
+void
+GlassWritableDatabase::wait_for_durable(Xapian::rev revision)
+{
+    LOGCALL_VOID(DB, "GlassWritableDatabase::wait_for_durable", revision);
+    if (syncer)
+	syncer->wait(revision ? revision : version_file.get_revision());
+}
+
 void
 GlassWritableDatabase::check_flush_threshold()
 {
-    // FIXME: this should be done by checking memory usage, not the number of
-    // changes.  We could also look at the amount of data the inverter object
-    // currently holds.
-    if (++change_count >= flush_threshold) {
+    // The memory used by the inverter is an estimate, and doesn't include
+    // changes buffered elsewhere (e.g. to values).
+    if (++change_count >= flush_threshold ||
+	(flush_threshold_bytes &&
+	 inverter.get_memory_used() >= flush_threshold_bytes)) {
 	flush_postlist_changes();
 	if (!transaction_active()) apply();
     }
@@ -1102,6 +1365,7 @@ void
 GlassWritableDatabase::flush_postlist_changes() const
 {
     version_file.set_oldest_changeset(changes.get_oldest_changeset());
+    if (doc_stats) doc_stats->apply_doclen_changes(inverter.doclen_changes);
     inverter.flush(postlist_table);
     inverter.flush_pos_lists(position_table);
 
@@ -1149,6 +1413,7 @@ GlassWritableDatabase::add_document_(Xapian::docid did,
 
 	// Set the values.
 	value_manager.add_document(did, document, value_stats);
+	drop_value_columns();
 
 	Xapian::termcount new_doclen = 0;
 	{
@@ -1172,6 +1437,7 @@ GlassWritableDatabase::add_document_(Xapian::docid did,
 	// Set the termlist.
 	if (termlist_table.is_open())
 	    termlist_table.set_termlist(did, document, new_doclen);
+	if (doc_stats) doc_stats->invalidate_unique_terms(did);
 
 	// Set the new document length
 	inverter.set_doclength(did, new_doclen, true);
@@ -1190,6 +1456,136 @@ GlassWritableDatabase::add_document_(Xapian::docid did,
     RETURN(did);
 }
 
+namespace {
+
+/// A document inverted and encoded ready to add to a glass database.
+struct EncodedDocument {
+    /// The document length.
+    Xapian::termcount doclen = 0;
+
+    /// The highest wdf of any term.
+    Xapian::termcount max_wdf = 0;
+
+    /// The terms, in order, with their wdf and encoded positions (if any).
+    vector<tuple<string, Xapian::termcount, string>> terms;
+
+    /// The encoded termlist.
+    string termlist_tag;
+
+    /** Invert and encode @a document.
+     *
+     *  This only reads @a document and static data, so different documents
+     *  can be encoded in parallel.
+     */
+    void encode(const Xapian::Document& document,
+		const GlassPositionListTable& position_table,
+		bool encode_termlist);
+};
+
+void
+EncodedDocument::encode(const Xapian::Document& document,
+			const GlassPositionListTable& position_table,
+			bool encode_termlist)
+{
+    terms.reserve(document.termlist_count());
+    Xapian::TermIterator term = document.termlist_begin();
+    for ( ; term != document.termlist_end(); ++term) {
+	termcount wdf = term.get_wdf();
+	doclen += wdf;
+	max_wdf = max(max_wdf, wdf);
+
+	string tname = *term;
+	if (tname.size() > MAX_SAFE_TERM_LENGTH)
+	    throw Xapian::InvalidArgumentError("Term too long (> " STRINGIZE(MAX_SAFE_TERM_LENGTH) "): " + tname);
+
+	string positions;
+	(void)Inverter::encode_positions(position_table, term, positions);
+	terms.emplace_back(std::move(tname), wdf, std::move(positions));
+    }
+    if (encode_termlist)
+	GlassTermListTable::encode_termlist(termlist_tag, document, doclen);
+}
+
+}
+
+Xapian::docid
+GlassWritableDatabase::add_documents(const vector<Xapian::Document>& docs,
+				     unsigned n_threads)
+{
+    LOGCALL(DB, Xapian::docid, "GlassWritableDatabase::add_documents", docs.size() | n_threads);
+    if (GLASS_MAX_DOCID - version_file.get_last_docid() < docs.size())
+	throw Xapian::DatabaseError("Run out of docids - you'll have to use copydatabase to eliminate any gaps before you can add more documents");
+
+    bool encode_termlist = termlist_table.is_open();
+    vector<EncodedDocument> encoded(docs.size());
+    try {
+	// Documents read from a database may fetch their terms lazily, and
+	// a Document object which appears more than once in the batch would
+	// have its reference count updated by more than one thread, so we
+	// encode such documents on this thread.
+	vector<size_t> parallel;
+	if (n_threads > 1) {
+	    unordered_set<const Xapian::Document::Internal*> seen, repeated;
+	    for (auto& doc : docs) {
+		if (!seen.insert(doc.internal.get()).second)
+		    repeated.insert(doc.internal.get());
+	    }
+	    parallel.reserve(docs.size());
+	    for (size_t i = 0; i != docs.size(); ++i) {
+		const Xapian::Document::Internal* doc = docs[i].internal.get();
+		if (doc->get_docid() == 0 && repeated.count(doc) == 0)
+		    parallel.push_back(i);
+	    }
+	}
+	for (size_t i = 0, j = 0; i != docs.size(); ++i) {
+	    if (j != parallel.size() && parallel[j] == i) {
+		++j;
+		continue;
+	    }
+	    encoded[i].encode(docs[i], position_table, encode_termlist);
+	}
+	parallel_for(parallel.size(), n_threads, [&](size_t j) {
+	    size_t i = parallel[j];
+	    encoded[i].encode(docs[i], position_table, encode_termlist);
+	});
+    } catch (...) {
+	// As for add_document(), discard any pending modifications.
+	cancel();
+	throw;
+    }
+
+    // Apply the encoded documents in docid order.
+    Xapian::docid first_did = version_file.get_last_docid() + 1;
+    for (size_t i = 0; i != docs.size(); ++i) {
+	Xapian::docid did = version_file.get_next_docid();
+	const EncodedDocument& enc = encoded[i];
+	try {
+	    docdata_table.replace_document_data(did, docs[i].get_data());
+	    value_manager.add_document(did, docs[i], value_stats);
+	    drop_value_columns();
+	    version_file.check_wdf(enc.max_wdf);
+	    for (auto& t : enc.terms) {
+		const string& tname = get<0>(t);
+		inverter.add_posting(did, tname, get<1>(t));
+		if (!get<2>(t).empty())
+		    inverter.set_positionlist(did, tname, get<2>(t));
+	    }
+	    if (encode_termlist) {
+		termlist_table.set_encoded_termlist(did, enc.termlist_tag);
+	    }
+	    if (doc_stats) doc_stats->invalidate_unique_terms(did);
+	    inverter.set_doclength(did, enc.doclen, true);
+	    version_file.add_document(enc.doclen);
+	} catch (...) {
+	    cancel();
+	    throw;
+	}
+	check_flush_threshold();
+    }
+
+    RETURN(first_did);
+}
+
 void
 GlassWritableDatabase::delete_document(Xapian::docid did)
 {
@@ -1219,6 +1615,7 @@ GlassWritableDatabase::delete_document(Xapian::docid did)
     try {
 	// Remove the values.
 	value_manager.delete_document(did, value_stats);
+	drop_value_columns();
 
 	// OK, now add entries to remove the postings in the underlying record.
 	intrusive_ptr<const GlassWritableDatabase> ptrtothis(this);
@@ -1239,6 +1636,7 @@ GlassWritableDatabase::delete_document(Xapian::docid did)
 	// Remove the termlist.
 	if (termlist_table.is_open())
 	    termlist_table.delete_termlist(did);
+	if (doc_stats) doc_stats->invalidate_unique_terms(did);
 
 	// Mark this document as removed.
 	inverter.delete_doclength(did);
@@ -1386,6 +1784,7 @@ GlassWritableDatabase::replace_document(Xapian::docid did,
 	    // Set the termlist.
 	    if (termlist_table.is_open())
 		termlist_table.set_termlist(did, document, new_doclen);
+	    if (doc_stats) doc_stats->invalidate_unique_terms(did);
 
 	    // Set the new document length
 	    if (new_doclen != old_doclen)
@@ -1401,6 +1800,7 @@ GlassWritableDatabase::replace_document(Xapian::docid did,
 	if (!modifying || document.internal->values_modified()) {
 	    // Replace the values.
 	    value_manager.replace_document(did, document, value_stats);
+	    drop_value_columns();
 	}
     } catch (...) {
 	// If an error occurs while replacing a document, or doing any other
@@ -1435,6 +1835,22 @@ GlassWritableDatabase::get_doclength(Xapian::docid did) const
     RETURN(GlassDatabase::get_doclength(did));
 }
 
+bool
+GlassWritableDatabase::get_cached_doclengths(Xapian::doccount n,
+					     const Xapian::docid* dids,
+					     Xapian::termcount* doclens) const
+{
+    if (!GlassDatabase::get_cached_doclengths(n, dids, doclens))
+	return false;
+    // The cache only reflects changes which have been flushed.
+    if (!inverter.doclen_changes.empty()) {
+	for (Xapian::doccount i = 0; i != n; ++i) {
+	    (void)inverter.get_doclength(dids[i], doclens[i]);
+	}
+    }
+    return true;
+}
+
 Xapian::termcount
 GlassWritableDatabase::get_unique_terms(Xapian::docid did) const
 {
@@ -1540,6 +1956,8 @@ GlassWritableDatabase::open_leaf_post_list(const string& term,
 	if (version_file.get_last_docid() == doccount) {
 	    RETURN(new ContiguousAllDocsPostList(doccount));
 	}
+	if (doc_stats)
+	    doc_stats->apply_doclen_changes(inverter.doclen_changes);
 	inverter.flush_doclengths(postlist_table);
 	RETURN(new GlassAllDocsPostList(ptrtothis, doccount));
     }
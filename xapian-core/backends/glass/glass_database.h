@@ -27,12 +27,16 @@
 
 #include "backends/backends.h"
 #include "backends/databaseinternal.h"
+#include "backends/valuecolumn.h"
+#include "backends/valuedictionary.h"
 #include "glass_changes.h"
 #include "glass_docdata.h"
+#include "glass_docstats.h"
 #include "glass_inverter.h"
 #include "glass_positionlist.h"
 #include "glass_postlist.h"
 #include "glass_spelling.h"
+#include "glass_syncer.h"
 #include "glass_synonym.h"
 #include "glass_termlisttable.h"
 #include "glass_values.h"
@@ -45,6 +49,7 @@
 #include "xapian/constants.h"
 
 #include <map>
+#include <memory>
 
 class GlassTermList;
 class GlassAllDocsPostList;
@@ -116,6 +121,57 @@ class GlassDatabase : public Xapian::Database::Internal {
     /// Replication changesets.
     GlassChanges changes;
 
+    /** Cached document lengths and numbers of unique terms.
+     *
+     *  NULL unless Xapian::DB_CACHE_DOC_STATS was specified.  Shared with
+     *  copies made by open_copy() at the same revision.
+     */
+    mutable std::shared_ptr<GlassDocStatsCache> doc_stats;
+
+    /** Makes commits durable in a background thread.
+     *
+     *  NULL unless Xapian::DB_ASYNC_COMMIT was specified and a revision has
+     *  been committed.  This is declared after the tables so that it's
+     *  destroyed (which waits for any pending sync) before they close their
+     *  files.
+     */
+    std::unique_ptr<GlassSyncer> syncer;
+
+    /// The cell width for each slot with a value column.
+    std::map<Xapian::valueno, unsigned> value_column_widths;
+
+    /** The value columns which have been loaded.
+     *
+     *  Shared with any ValueColumnList objects reading them, which keep the
+     *  column they started with if it's dropped.
+     */
+    mutable std::map<Xapian::valueno, std::shared_ptr<const ValueColumn>>
+	value_columns;
+
+    /** The value dictionaries for each slot which has one.
+     *
+     *  The pointer is empty if the dictionary hasn't been loaded.
+     */
+    mutable std::map<Xapian::valueno, std::shared_ptr<const ValueDictionary>>
+	value_dictionaries;
+
+    /// Has enable_mmap() been called?
+    bool mmapped = false;
+
+    /// Tell the tables about syncer.
+    void set_tables_syncer();
+
+    /// Load all the document lengths into doc_stats.
+    void load_doclengths() const;
+
+    /** Discard the cached document statistics.
+     *
+     *  Any copies sharing the cache keep the old one.
+     */
+    void drop_doc_stats() const {
+	if (doc_stats) doc_stats.reset(new GlassDocStatsCache);
+    }
+
     /** Return true if a database exists at the path specified for this
      *  database.
      */
@@ -240,13 +296,42 @@ class GlassDatabase : public Xapian::Database::Internal {
 	return postlist_table.cursor_get();
     }
 
+    /** Keep document lengths and numbers of unique terms in memory.
+     *
+     *  This is done if Xapian::DB_CACHE_DOC_STATS is specified.
+     */
+    void enable_doc_stats_cache() {
+	doc_stats.reset(new GlassDocStatsCache);
+    }
+
+    /** Drop any loaded value columns and dictionaries.
+     *
+     *  They're reloaded when next needed.
+     */
+    void drop_value_columns() const {
+	value_columns.clear();
+	for (auto&& dict : value_dictionaries) {
+	    dict.second.reset();
+	}
+    }
+
+    /** Read the tables via memory mappings.
+     *
+     *  This is done if Xapian::DB_MMAP is specified.
+     */
+    void enable_mmap();
+
     /** Virtual methods of Database::Internal. */
     //@{
+    Xapian::Database::Internal* open_copy() const;
     Xapian::doccount get_doccount() const;
     Xapian::docid get_lastdocid() const;
     Xapian::totallength get_total_length() const;
     Xapian::termcount get_doclength(Xapian::docid did) const;
     Xapian::termcount get_unique_terms(Xapian::docid did) const;
+    bool get_cached_doclengths(Xapian::doccount n,
+			       const Xapian::docid* dids,
+			       Xapian::termcount* doclens) const;
     void get_freqs(const string & term,
 		   Xapian::doccount * termfreq_ptr,
 		   Xapian::termcount * collfreq_ptr) const;
@@ -264,6 +349,10 @@ class GlassDatabase : public Xapian::Database::Internal {
     LeafPostList* open_leaf_post_list(const string& term,
 				      bool need_read_pos) const;
     ValueList * open_value_list(Xapian::valueno slot) const;
+    void add_value_column(Xapian::valueno slot, unsigned width);
+    void add_value_dictionary(Xapian::valueno slot);
+    const std::shared_ptr<const ValueDictionary>&
+	get_value_dictionary(Xapian::valueno slot) const;
     Xapian::Document::Internal* open_document(Xapian::docid did,
 					      bool lazy) const;
 
@@ -297,6 +386,7 @@ class GlassDatabase : public Xapian::Database::Internal {
      */
     Xapian::rev get_revision() const;
     string get_uuid() const;
+    bool append_revision_key(string& key) const;
 
     void request_document(Xapian::docid /*did*/) const;
     void readahead_for_query(const Xapian::Query &query) const;
@@ -350,6 +440,12 @@ class GlassWritableDatabase : public GlassDatabase {
     /// If change_count reaches this threshold we automatically flush.
     Xapian::doccount flush_threshold;
 
+    /** If the buffered changes use this many bytes we automatically flush.
+     *
+     *  0 means no limit.
+     */
+    size_t flush_threshold_bytes;
+
     /** A pointer to the last document which was returned by
      *  open_document(), or NULL if there is no such valid document.  This
      *  is used purely for comparing with a supplied document to help with
@@ -386,9 +482,13 @@ class GlassWritableDatabase : public GlassDatabase {
     /** Cancel pending modifications to the database. */
     void cancel();
 
+    void wait_for_durable(Xapian::rev revision);
+
     Xapian::docid add_document(const Xapian::Document& document);
     Xapian::docid add_document_(Xapian::docid did,
 				const Xapian::Document& document);
+    Xapian::docid add_documents(const std::vector<Xapian::Document>& docs,
+				unsigned n_threads);
     // Stop the default implementation of delete_document(term) and
     // replace_document(term) from being hidden.  This isn't really
     // a problem as we only try to call them through the base class
@@ -424,6 +524,9 @@ class GlassWritableDatabase : public GlassDatabase {
     //@{
     Xapian::termcount get_doclength(Xapian::docid did) const;
     Xapian::termcount get_unique_terms(Xapian::docid did) const;
+    bool get_cached_doclengths(Xapian::doccount n,
+			       const Xapian::docid* dids,
+			       Xapian::termcount* doclens) const;
     void get_freqs(const string & term,
 		   Xapian::doccount * termfreq_ptr,
 		   Xapian::termcount * collfreq_ptr) const;
@@ -32,6 +32,7 @@
 #include "glass_cursor.h"
 #include "glass_defs.h"
 #include "glass_table.h"
+#include "glass_values.h"
 #include "glass_version.h"
 #include "pack.h"
 #include "backends/valuestats.h"
@@ -339,6 +340,22 @@ check_glass_table(const char * tablename, const string &db_dir, int fd,
 		p = cursor->current_tag.data();
 		end = p + cursor->current_tag.size();
 
+		// The bounds given by the chunk's header, if it has one.
+		string header_lower, header_upper;
+		bool has_header;
+		try {
+		    has_header = Glass::decode_valuechunk_header(&p, end,
+								 header_lower,
+								 header_upper);
+		} catch (const Xapian::DatabaseCorruptError&) {
+		    if (out)
+			*out << "Bad value chunk header" << endl;
+		    ++errors;
+		    continue;
+		}
+		Xapian::docid first_did = did;
+		string lower, upper;
+
 		while (true) {
 		    string value;
 		    if (!unpack_string(&p, end, value)) {
@@ -350,6 +367,11 @@ check_glass_table(const char * tablename, const string &db_dir, int fd,
 
 		    ++v.freq_real;
 
+		    if (lower.empty() || value < lower)
+			lower = value;
+		    if (value > upper)
+			upper = value;
+
 		    // FIXME: Cross-check that docid did has value slot (and
 		    // vice versa - that there's a value here if the slot entry
 		    // says so).
@@ -396,6 +418,14 @@ check_glass_table(const char * tablename, const string &db_dir, int fd,
 			++errors;
 		    }
 		}
+		if (has_header &&
+		    (lower != header_lower || upper != header_upper)) {
+		    if (out)
+			*out << "Value slot " << slot << " chunk starting at "
+				"docid " << first_did << " has wrong bounds"
+			     << endl;
+		    ++errors;
+		}
 		continue;
 	    }
 
@@ -0,0 +1,137 @@
+/** @file glass_docstats.h
+ * @brief In-memory cache of document lengths and unique term counts.
+ */
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef XAPIAN_INCLUDED_GLASS_DOCSTATS_H
+#define XAPIAN_INCLUDED_GLASS_DOCSTATS_H
+
+#include "glass_inverter.h"
+
+#include "xapian/types.h"
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <vector>
+
+/** Dense arrays of per-document statistics, indexed by docid.
+ *
+ *  The document lengths are all loaded the first time one is needed, while
+ *  the number of unique terms in each document is stored the first time it
+ *  is read from the termlist.
+ *
+ *  Copies of a read-only database at the same revision share a cache, and
+ *  may use it from several threads at once.  Once loaded, the document
+ *  lengths are only changed by a WritableDatabase, which doesn't share its
+ *  cache, so they can be read without locking.
+ */
+class GlassDocStatsCache {
+    /// Protects loading doclens, and unique_terms.
+    mutable std::mutex mutex;
+
+    /// Document lengths, or UNKNOWN for unused docids.
+    std::vector<Xapian::termcount> doclens;
+
+    /// Have the document lengths been loaded?
+    std::atomic<bool> doclens_loaded{false};
+
+    /// Numbers of unique terms, or UNKNOWN if not read yet.
+    std::vector<Xapian::termcount> unique_terms;
+
+    static void set(std::vector<Xapian::termcount>& v,
+		    Xapian::docid did,
+		    Xapian::termcount value) {
+	if (did > v.size()) {
+	    if (value == UNKNOWN) return;
+	    v.resize(did, UNKNOWN);
+	}
+	v[did - 1] = value;
+    }
+
+    static Xapian::termcount get(const std::vector<Xapian::termcount>& v,
+				 Xapian::docid did) {
+	return did <= v.size() ? v[did - 1] : UNKNOWN;
+    }
+
+  public:
+    /// Value returned for entries which aren't known.
+    static constexpr Xapian::termcount UNKNOWN = Xapian::termcount(-1);
+
+    /// Have the document lengths been loaded?
+    bool have_doclengths() const {
+	return doclens_loaded.load(std::memory_order_acquire);
+    }
+
+    /** Load the document lengths unless another thread already has.
+     *
+     *  @param load	Called to load the document lengths using
+     *			set_doclength().
+     */
+    template<typename F>
+    void load_doclengths(F load) {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (doclens_loaded.load(std::memory_order_relaxed)) return;
+	load();
+	doclens_loaded.store(true, std::memory_order_release);
+    }
+
+    /// Return the length of document @a did, or UNKNOWN.
+    Xapian::termcount get_doclength(Xapian::docid did) const {
+	return get(doclens, did);
+    }
+
+    void set_doclength(Xapian::docid did, Xapian::termcount doclen) {
+	set(doclens, did, doclen);
+    }
+
+    /// Return the number of unique terms in document @a did, or UNKNOWN.
+    Xapian::termcount get_unique_terms(Xapian::docid did) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return get(unique_terms, did);
+    }
+
+    void set_unique_terms(Xapian::docid did, Xapian::termcount count) {
+	std::lock_guard<std::mutex> lock(mutex);
+	set(unique_terms, did, count);
+    }
+
+    /// Forget the number of unique terms for document @a did.
+    void invalidate_unique_terms(Xapian::docid did) {
+	std::lock_guard<std::mutex> lock(mutex);
+	set(unique_terms, did, UNKNOWN);
+    }
+
+    /** Apply buffered document length changes.
+     *
+     *  This should be called with the changes when they are flushed to the
+     *  postlist table.
+     */
+    void apply_doclen_changes(
+	    const std::map<Xapian::docid, Xapian::termcount>& changes) {
+	if (!have_doclengths()) {
+	    // The changes will be picked up when we load from the table.
+	    return;
+	}
+	for (auto&& i : changes) {
+	    Xapian::termcount doclen = i.second;
+	    if (doclen == DELETED_POSTING) doclen = UNKNOWN;
+	    set(doclens, i.first, doclen);
+	}
+    }
+};
+
+#endif // XAPIAN_INCLUDED_GLASS_DOCSTATS_H
@@ -89,6 +89,14 @@ GlassFreeList::get_block(const GlassTable *B, uint4 block_size,
 	return first_unused_block++;
     }
 
+    // Blocks freed by a revision which is still being synced in the
+    // background may belong to the last durable revision, so we need to wait
+    // for the sync to finish before reusing them.
+    while (!unsynced.empty() && fl == unsynced.front().first) {
+	B->wait_for_sync(unsynced.front().second);
+	unsynced.pop_front();
+    }
+
     if (p == 0) {
 	if (fl.n == UNUSED) {
 	    throw Xapian::DatabaseCorruptError("Freelist pointer invalid");
@@ -255,6 +263,13 @@ GlassFreeList::commit(const GlassTable * B, uint4 block_size)
 	    Assert(fl.n == fl_end.n || aligned_read4(p + FREELIST_END - 4) != UNUSED);
 	}
 	flw_appending = true;
+	if (fl_end != flw) {
+	    // Note where the blocks freed by this revision start.
+	    while (!unsynced.empty() && B->is_synced(unsynced.front().second)) {
+		unsynced.pop_front();
+	    }
+	    unsynced.emplace_back(fl_end, revision);
+	}
 	fl_end = flw;
     }
 }
@@ -25,6 +25,9 @@
 #include "glass_defs.h"
 #include "pack.h"
 
+#include <deque>
+#include <utility>
+
 class GlassTable;
 
 class GlassFLCursor {
@@ -88,6 +91,13 @@ class GlassFreeList {
     /// Current freelist block we're writing.
     uint8_t * pw;
 
+    /** Where the entries freed by each recent revision start.
+     *
+     *  With Xapian::DB_ASYNC_COMMIT, the blocks freed by a revision which
+     *  isn't durable yet may still be used by the last durable revision.
+     */
+    std::deque<std::pair<GlassFLCursor, uint4>> unsynced;
+
   public:
     GlassFreeList() {
 	revision = 0;
@@ -100,6 +110,7 @@ class GlassFreeList {
 	revision = 0;
 	first_unused_block = 0;
 	flw_appending = false;
+	unsynced.clear();
     }
 
     ~GlassFreeList() { delete [] p; delete [] pw; }
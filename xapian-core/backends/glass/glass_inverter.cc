@@ -26,9 +26,11 @@
 #include "glass_positionlist.h"
 
 #include "api/termlist.h"
+#include "stringutils.h"
 
-#include <map>
+#include <algorithm>
 #include <string>
+#include <vector>
 
 using namespace std;
 
@@ -36,22 +38,10 @@ void
 Inverter::store_positions(const GlassPositionListTable & position_table,
 			  Xapian::docid did,
 			  const string & tname,
-			  const Xapian::VecCOW<Xapian::termpos> & posvec,
+			  const string & s,
 			  bool modifying)
 {
-    string s;
-    position_table.pack(s, posvec);
-    if (modifying) {
-	auto i = pos_changes.find(tname);
-	if (i != pos_changes.end()) {
-	    map<Xapian::docid, string> & m = i->second;
-	    auto j = m.find(did);
-	    if (j != m.end()) {
-		// Update existing entry.
-		swap(j->second, s);
-		return;
-	    }
-	}
+    if (modifying && pos_changes.find(tname) == pos_changes.end()) {
 	const string & key = position_table.make_key(did, tname);
 	string old_tag;
 	if (position_table.get_exact_entry(key, old_tag) && s == old_tag) {
@@ -59,6 +49,9 @@ Inverter::store_positions(const GlassPositionListTable & position_table,
 	    return;
 	}
     }
+    // If there are buffered changes for this term, there may be one for this
+    // document which we need to override, so we just record the new entry
+    // (if it's identical to the entry on disk, the flush rewrites it).
     set_positionlist(did, tname, s);
 }
 
@@ -69,37 +62,50 @@ Inverter::set_positionlist(const GlassPositionListTable & position_table,
 			   const Xapian::TermIterator & term,
 			   bool modifying)
 {
-    auto ptr = term.internal->get_vec_termpos();
-    if (ptr) {
-	if (!ptr->empty()) {
-	    store_positions(position_table, did, tname, *ptr, modifying);
-	    return;
-	}
-    } else {
-	Xapian::PositionIterator pos = term.positionlist_begin();
-	if (pos != term.positionlist_end()) {
-	    Xapian::VecCOW<Xapian::termpos> posvec;
-	    posvec.reserve(term.positionlist_count());
-	    while (pos != term.positionlist_end()) {
-		posvec.push_back(*pos);
-		++pos;
-	    }
-	    store_positions(position_table, did, tname, posvec, modifying);
-	    return;
-	}
+    string s;
+    if (encode_positions(position_table, term, s)) {
+	store_positions(position_table, did, tname, s, modifying);
+	return;
     }
     // If we get here, the new position list was empty.
     if (modifying)
 	delete_positionlist(did, tname);
 }
 
+bool
+Inverter::encode_positions(const GlassPositionListTable & position_table,
+			   const Xapian::TermIterator & term,
+			   string & s)
+{
+    auto ptr = term.internal->get_vec_termpos();
+    if (ptr) {
+	if (ptr->empty())
+	    return false;
+	position_table.pack(s, *ptr);
+	return true;
+    }
+    Xapian::PositionIterator pos = term.positionlist_begin();
+    if (pos == term.positionlist_end())
+	return false;
+    Xapian::VecCOW<Xapian::termpos> posvec;
+    posvec.reserve(term.positionlist_count());
+    while (pos != term.positionlist_end()) {
+	posvec.push_back(*pos);
+	++pos;
+    }
+    position_table.pack(s, posvec);
+    return true;
+}
+
 void
 Inverter::set_positionlist(Xapian::docid did,
 			   const string & term,
 			   const string & s)
 {
-    pos_changes.insert(make_pair(term, map<Xapian::docid, string>()))
-	.first->second[did] = s;
+    auto r = pos_changes.emplace(term, DocidChanges<string>());
+    if (r.second) pos_bytes += TERM_OVERHEAD + term.size();
+    pos_bytes += sizeof(pair<Xapian::docid, string>) + s.size();
+    r.first->second.set(did, s);
 }
 
 void
@@ -112,21 +118,20 @@ Inverter::delete_positionlist(Xapian::docid did,
 bool
 Inverter::get_positionlist(Xapian::docid did,
 			   const string & term,
-			   string & s) const
+			   string & s)
 {
     auto i = pos_changes.find(term);
     if (i == pos_changes.end())
 	return false;
-    const map<Xapian::docid, string> & m = i->second;
-    auto j = m.find(did);
-    if (j == m.end())
+    const string * p = i->second.find(did);
+    if (!p)
 	return false;
-    s = j->second;
+    s = *p;
     return true;
 }
 
 bool
-Inverter::has_positions(const GlassPositionListTable & position_table) const
+Inverter::has_positions(const GlassPositionListTable & position_table)
 {
     if (pos_changes.empty())
 	return !position_table.empty();
@@ -134,9 +139,11 @@ Inverter::has_positions(const GlassPositionListTable & position_table) const
     // FIXME: Can we cheaply keep track of some things to make this more
     // efficient?  E.g. how many sets and deletes we had in total perhaps.
     glass_tablesize_t changes = 0;
-    for (auto i : pos_changes) {
-	const map<Xapian::docid, string>& m = i.second;
-	for (auto j : m) {
+    for (auto& i : pos_changes) {
+	DocidChanges<string>& m = i.second;
+	// Only the last change for each document counts.
+	m.sort();
+	for (auto& j : m) {
 	    const string & s = j.second;
 	    if (!s.empty())
 		return true;
@@ -155,14 +162,28 @@ Inverter::flush_doclengths(GlassPostListTable & table)
     doclen_changes.clear();
 }
 
+vector<string>
+Inverter::sorted_terms(const string & pfx) const
+{
+    vector<string> terms;
+    for (auto& i : postlist_changes) {
+	if (startswith(i.first, pfx))
+	    terms.push_back(i.first);
+    }
+    // Merging the changes in key order gives better locality in the table.
+    sort(terms.begin(), terms.end());
+    return terms;
+}
+
 void
 Inverter::flush_post_list(GlassPostListTable & table, const string & term)
 {
-    map<string, PostingChanges>::iterator i;
-    i = postlist_changes.find(term);
+    auto i = postlist_changes.find(term);
     if (i == postlist_changes.end()) return;
 
     // Flush buffered changes for just this term's postlist.
+    postlist_bytes -= term_bytes(term, i->second);
+    i->second.sort();
     table.merge_changes(term, i->second);
     postlist_changes.erase(i);
 }
@@ -170,11 +191,17 @@ Inverter::flush_post_list(GlassPostListTable & table, const string & term)
 void
 Inverter::flush_all_post_lists(GlassPostListTable & table)
 {
-    map<string, PostingChanges>::const_iterator i;
-    for (i = postlist_changes.begin(); i != postlist_changes.end(); ++i) {
-	table.merge_changes(i->first, i->second);
+    vector<string> terms = sorted_terms(string());
+    vector<pair<const string*, const PostingChanges*>> changes;
+    changes.reserve(terms.size());
+    for (const string & term : terms) {
+	PostingChanges & term_changes = postlist_changes.find(term)->second;
+	term_changes.sort();
+	changes.emplace_back(&term, &term_changes);
     }
+    table.merge_changes(changes);
     postlist_changes.clear();
+    postlist_bytes = 0;
 }
 
 void
@@ -183,29 +210,19 @@ Inverter::flush_post_lists(GlassPostListTable & table, const string & pfx)
     if (pfx.empty())
 	return flush_all_post_lists(table);
 
-    map<string, PostingChanges>::iterator i, begin, end;
-    begin = postlist_changes.lower_bound(pfx);
-    string pfxinc = pfx;
-    while (true) {
-	if (pfxinc.back() != '\xff') {
-	    ++pfxinc.back();
-	    end = postlist_changes.lower_bound(pfxinc);
-	    break;
-	}
-	pfxinc.resize(pfxinc.size() - 1);
-	if (pfxinc.empty()) {
-	    end = postlist_changes.end();
-	    break;
-	}
+    vector<string> terms = sorted_terms(pfx);
+    vector<pair<const string*, const PostingChanges*>> changes;
+    changes.reserve(terms.size());
+    for (const string & term : terms) {
+	PostingChanges & term_changes = postlist_changes.find(term)->second;
+	postlist_bytes -= term_bytes(term, term_changes);
+	term_changes.sort();
+	changes.emplace_back(&term, &term_changes);
     }
-
-    for (i = begin; i != end; ++i) {
-	table.merge_changes(i->first, i->second);
+    table.merge_changes(changes);
+    for (const string & term : terms) {
+	postlist_changes.erase(term);
     }
-
-    // Erase all the entries in one go, as that's:
-    //  O(log(postlist_changes.size()) + O(number of elements removed)
-    postlist_changes.erase(begin, end);
 }
 
 void
@@ -218,10 +235,16 @@ Inverter::flush(GlassPostListTable & table)
 void
 Inverter::flush_pos_lists(GlassPositionListTable & table)
 {
-    for (auto i : pos_changes) {
-	const string & term = i.first;
-	const map<Xapian::docid, string> & m = i.second;
-	for (auto j : m) {
+    vector<string> terms;
+    terms.reserve(pos_changes.size());
+    for (auto& i : pos_changes) {
+	terms.push_back(i.first);
+    }
+    sort(terms.begin(), terms.end());
+    for (const string & term : terms) {
+	DocidChanges<string> & m = pos_changes.find(term)->second;
+	m.sort();
+	for (auto& j : m) {
 	    Xapian::docid did = j.first;
 	    const string & s = j.second;
 	    if (!s.empty())
@@ -231,4 +254,5 @@ Inverter::flush_pos_lists(GlassPositionListTable & table)
 	}
     }
     pos_changes.clear();
+    pos_bytes = 0;
 }
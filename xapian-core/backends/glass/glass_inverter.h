@@ -25,8 +25,12 @@
 
 #include "api/smallvector.h"
 
+#include <algorithm>
 #include <map>
 #include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "omassert.h"
@@ -36,6 +40,10 @@
 class GlassPostListTable;
 class GlassPositionListTable;
 
+namespace Glass {
+    struct PostlistMerge;
+}
+
 namespace Xapian {
 class TermIterator;
 }
@@ -43,9 +51,83 @@ class TermIterator;
 /** Magic wdf value used for a deleted posting. */
 const Xapian::termcount DELETED_POSTING = Xapian::termcount(-1);
 
+/** Buffered changes for a term, keyed by docid.
+ *
+ *  Changes are appended in the order they are made, which is usually in
+ *  ascending docid order, so this avoids allocating a node per change.
+ *  They're sorted, keeping only the last change for each docid, when they're
+ *  needed in docid order.
+ */
+template<typename T>
+class DocidChanges {
+    typedef std::vector<std::pair<Xapian::docid, T>> changes_type;
+
+    changes_type changes;
+
+    /// True if changes is in strictly ascending docid order.
+    bool sorted = true;
+
+  public:
+    typedef typename changes_type::const_iterator const_iterator;
+
+    /// Set the change for @a did, overriding any existing change.
+    void set(Xapian::docid did, T value) {
+	if (!changes.empty() && did <= changes.back().first) {
+	    if (did == changes.back().first) {
+		changes.back().second = std::move(value);
+		return;
+	    }
+	    sorted = false;
+	}
+	changes.emplace_back(did, std::move(value));
+    }
+
+    /// Sort into ascending docid order, dropping overridden changes.
+    void sort() {
+	if (sorted) return;
+	std::stable_sort(changes.begin(), changes.end(),
+			 [](const std::pair<Xapian::docid, T>& a,
+			    const std::pair<Xapian::docid, T>& b) {
+			     return a.first < b.first;
+			 });
+	// Keep the last change for each docid.
+	auto out = changes.begin();
+	for (auto i = changes.begin(); i != changes.end(); ++i) {
+	    auto next = i + 1;
+	    if (next != changes.end() && next->first == i->first) continue;
+	    if (out != i) *out = std::move(*i);
+	    ++out;
+	}
+	changes.erase(out, changes.end());
+	sorted = true;
+    }
+
+    /// Find the change for @a did, or return NULL if there isn't one.
+    const T* find(Xapian::docid did) {
+	sort();
+	auto i = std::lower_bound(changes.begin(), changes.end(), did,
+				  [](const std::pair<Xapian::docid, T>& a,
+				     Xapian::docid b) {
+				      return a.first < b;
+				  });
+	if (i == changes.end() || i->first != did) return NULL;
+	return &i->second;
+    }
+
+    bool empty() const { return changes.empty(); }
+
+    size_t size() const { return changes.size(); }
+
+    /// Iterate the changes - only in docid order after calling sort().
+    const_iterator begin() const { return changes.begin(); }
+
+    const_iterator end() const { return changes.end(); }
+};
+
 /** Class which "inverts the file". */
 class Inverter {
     friend class GlassPostListTable;
+    friend struct Glass::PostlistMerge;
 
     /// Class for storing the changes in frequencies for a term.
     class PostingChanges {
@@ -58,21 +140,21 @@ class Inverter {
 	Xapian::termcount_diff cf_delta;
 
 	/// Changes to this term's postlist.
-	std::map<Xapian::docid, Xapian::termcount> pl_changes;
+	DocidChanges<Xapian::termcount> pl_changes;
 
       public:
 	/// Constructor for an added posting.
 	PostingChanges(Xapian::docid did, Xapian::termcount wdf)
 	    : tf_delta(1), cf_delta(Xapian::termcount_diff(wdf))
 	{
-	    pl_changes.insert(std::make_pair(did, wdf));
+	    pl_changes.set(did, wdf);
 	}
 
 	/// Constructor for a removed posting.
 	PostingChanges(Xapian::docid did, Xapian::termcount wdf, bool)
 	    : tf_delta(-1), cf_delta(-Xapian::termcount_diff(wdf))
 	{
-	    pl_changes.insert(std::make_pair(did, DELETED_POSTING));
+	    pl_changes.set(did, DELETED_POSTING);
 	}
 
 	/// Constructor for an updated posting.
@@ -80,7 +162,7 @@ class Inverter {
 		       Xapian::termcount new_wdf)
 	    : tf_delta(0), cf_delta(Xapian::termcount_diff(new_wdf - old_wdf))
 	{
-	    pl_changes.insert(std::make_pair(did, new_wdf));
+	    pl_changes.set(did, new_wdf);
 	}
 
 	/// Add a posting.
@@ -88,7 +170,7 @@ class Inverter {
 	    ++tf_delta;
 	    cf_delta += wdf;
 	    // Add did to term's postlist
-	    pl_changes[did] = wdf;
+	    pl_changes.set(did, wdf);
 	}
 
 	/// Remove a posting.
@@ -96,16 +178,22 @@ class Inverter {
 	    --tf_delta;
 	    cf_delta -= wdf;
 	    // Remove did from term's postlist.
-	    pl_changes[did] = DELETED_POSTING;
+	    pl_changes.set(did, DELETED_POSTING);
 	}
 
 	/// Update a posting.
 	void update_posting(Xapian::docid did, Xapian::termcount old_wdf,
 			    Xapian::termcount new_wdf) {
 	    cf_delta += new_wdf - old_wdf;
-	    pl_changes[did] = new_wdf;
+	    pl_changes.set(did, new_wdf);
 	}
 
+	/// Sort the postlist changes into docid order.
+	void sort() { pl_changes.sort(); }
+
+	/// Get the number of buffered postlist changes.
+	size_t size() const { return pl_changes.size(); }
+
 	/// Get the term frequency delta.
 	Xapian::termcount_diff get_tfdelta() const { return tf_delta; }
 
@@ -113,21 +201,72 @@ class Inverter {
 	Xapian::termcount_diff get_cfdelta() const { return cf_delta; }
     };
 
+    /** Approximate overhead in bytes for each buffered term.
+     *
+     *  This covers the hash table node and the changes object - the term
+     *  itself and the individual changes are counted separately.
+     */
+    static constexpr size_t TERM_OVERHEAD = 96;
+
+    /// Approximate overhead in bytes for each buffered document length.
+    static constexpr size_t DOCLEN_OVERHEAD = 48;
+
     /// Buffered changes to postlists.
-    std::map<std::string, PostingChanges> postlist_changes;
+    std::unordered_map<std::string, PostingChanges> postlist_changes;
 
     /// Buffered changes to positional data.
-    std::map<std::string, std::map<Xapian::docid, std::string>> pos_changes;
+    std::unordered_map<std::string, DocidChanges<std::string>> pos_changes;
+
+    /** Approximate memory used by postlist_changes in bytes.
+     *
+     *  This is approximate, but we count memory in a consistent way so that
+     *  we can subtract the contribution of a term when we flush just that
+     *  term.
+     */
+    size_t postlist_bytes = 0;
+
+    /// Approximate memory used by pos_changes in bytes.
+    size_t pos_bytes = 0;
+
+    /// The approximate memory used by the changes for a term.
+    static size_t term_bytes(const std::string& term,
+			     const PostingChanges& changes) {
+	return TERM_OVERHEAD + term.size() +
+	       changes.size() *
+	       sizeof(std::pair<Xapian::docid, Xapian::termcount>);
+    }
+
+    /// Return the terms with buffered postlist changes in sorted order.
+    std::vector<std::string> sorted_terms(const std::string& pfx) const;
 
     void store_positions(const GlassPositionListTable & position_table,
 			 Xapian::docid did,
 			 const std::string & tname,
-			 const Xapian::VecCOW<Xapian::termpos> & posvec,
+			 const std::string & s,
 			 bool modifying);
 
-    void set_positionlist(Xapian::docid did,
-			  const std::string & term,
-			  const std::string & s);
+    /** Record a posting change for @a term.
+     *
+     *  If there aren't yet any changes for @a term, @a args are passed to the
+     *  PostingChanges constructor, otherwise @a f is called on the existing
+     *  changes.
+     */
+    template<typename F, typename... Args>
+    void posting_change(const std::string & term, F f, Args... args) {
+	auto i = postlist_changes.find(term);
+	if (i == postlist_changes.end()) {
+	    auto r = postlist_changes.emplace(std::piecewise_construct,
+					      std::forward_as_tuple(term),
+					      std::forward_as_tuple(args...));
+	    postlist_bytes += term_bytes(term, r.first->second);
+	} else {
+	    size_t old_size = i->second.size();
+	    f(i->second);
+	    postlist_bytes += (i->second.size() - old_size) *
+			      sizeof(std::pair<Xapian::docid,
+					       Xapian::termcount>);
+	}
+    }
 
   public:
     /// Buffered changes to document lengths.
@@ -136,39 +275,26 @@ class Inverter {
   public:
     void add_posting(Xapian::docid did, const std::string & term,
 		     Xapian::doccount wdf) {
-	std::map<std::string, PostingChanges>::iterator i;
-	i = postlist_changes.find(term);
-	if (i == postlist_changes.end()) {
-	    postlist_changes.insert(
-		std::make_pair(term, PostingChanges(did, wdf)));
-	} else {
-	    i->second.add_posting(did, wdf);
-	}
+	posting_change(term,
+		       [&](PostingChanges& c) { c.add_posting(did, wdf); },
+		       did, wdf);
     }
 
     void remove_posting(Xapian::docid did, const std::string & term,
 			Xapian::doccount wdf) {
-	std::map<std::string, PostingChanges>::iterator i;
-	i = postlist_changes.find(term);
-	if (i == postlist_changes.end()) {
-	    postlist_changes.insert(
-		std::make_pair(term, PostingChanges(did, wdf, false)));
-	} else {
-	    i->second.remove_posting(did, wdf);
-	}
+	posting_change(term,
+		       [&](PostingChanges& c) { c.remove_posting(did, wdf); },
+		       did, wdf, false);
     }
 
     void update_posting(Xapian::docid did, const std::string & term,
 			Xapian::termcount old_wdf,
 			Xapian::termcount new_wdf) {
-	std::map<std::string, PostingChanges>::iterator i;
-	i = postlist_changes.find(term);
-	if (i == postlist_changes.end()) {
-	    postlist_changes.insert(
-		std::make_pair(term, PostingChanges(did, old_wdf, new_wdf)));
-	} else {
-	    i->second.update_posting(did, old_wdf, new_wdf);
-	}
+	posting_change(term,
+		       [&](PostingChanges& c) {
+			   c.update_posting(did, old_wdf, new_wdf);
+		       },
+		       did, old_wdf, new_wdf);
     }
 
     void set_positionlist(const GlassPositionListTable & position_table,
@@ -177,19 +303,54 @@ class Inverter {
 			  const Xapian::TermIterator & term,
 			  bool modifying = false);
 
+    /** Set the position list for a new document to data already encoded.
+     *
+     *  @param s	The data from encode_positions() (which must not be
+     *			empty).
+     */
+    void set_positionlist(Xapian::docid did,
+			  const std::string & term,
+			  const std::string & s);
+
+    /** Encode the positions of the term @a term points to.
+     *
+     *  This doesn't touch the Inverter or the table, so can be called from
+     *  any thread.
+     *
+     *  @param s	The string to append the encoded positions to.
+     *
+     *  @return false if the term has no positions (in which case @a s isn't
+     *		changed).
+     */
+    static bool encode_positions(const GlassPositionListTable & position_table,
+				 const Xapian::TermIterator & term,
+				 std::string & s);
+
     void delete_positionlist(Xapian::docid did,
 			     const std::string & term);
 
     bool get_positionlist(Xapian::docid did,
 			  const std::string & term,
-			  std::string & s) const;
+			  std::string & s);
 
-    bool has_positions(const GlassPositionListTable & position_table) const;
+    bool has_positions(const GlassPositionListTable & position_table);
 
     void clear() {
 	doclen_changes.clear();
 	postlist_changes.clear();
 	pos_changes.clear();
+	postlist_bytes = 0;
+	pos_bytes = 0;
+    }
+
+    /** Return the approximate memory used by the buffered changes in bytes.
+     *
+     *  Used to decide when to flush based on memory use rather than the
+     *  number of documents changed.
+     */
+    size_t get_memory_used() const {
+	return postlist_bytes + pos_bytes +
+	       doclen_changes.size() * DOCLEN_OVERHEAD;
     }
 
     void set_doclength(Xapian::docid did, Xapian::termcount doclen, bool add) {
@@ -236,8 +397,7 @@ class Inverter {
     bool get_deltas(const std::string & term,
 		    Xapian::termcount_diff & tf_delta,
 		    Xapian::termcount_diff & cf_delta) const {
-	std::map<std::string, PostingChanges>::const_iterator i;
-	i = postlist_changes.find(term);
+	auto i = postlist_changes.find(term);
 	if (i == postlist_changes.end()) {
 	    return false;
 	}
@@ -29,9 +29,12 @@
 #include "glass_database.h"
 #include "debuglog.h"
 #include "pack.h"
+#include "parallelfor.h"
 #include "str.h"
 #include "unicode/description_append.h"
 
+#include <algorithm>
+
 using Xapian::Internal::intrusive_ptr;
 
 // Static functions
@@ -744,6 +747,8 @@ GlassPostList::init()
 					    &is_last_chunk);
     read_wdf(&pos, end, &wdf);
     LOGLINE(DB, "Initial docid " << did);
+
+    if (!is_last_chunk) cursor->readahead_next_leaf();
 }
 
 GlassPostList::~GlassPostList()
@@ -826,6 +831,9 @@ GlassPostList::next_chunk()
     last_did_in_chunk = read_start_of_chunk(&pos, end, first_did_in_chunk,
 					    &is_last_chunk);
     read_wdf(&pos, end, &wdf);
+
+    // Let the following chunks load while we process this one.
+    if (!is_last_chunk) cursor->readahead_next_leaf();
 }
 
 PositionList *
@@ -871,6 +879,28 @@ GlassPostList::next(double w_min)
     RETURN(NULL);
 }
 
+Xapian::doccount
+GlassPostList::next_batch(Xapian::docid* dids,
+			  Xapian::termcount* wdfs,
+			  Xapian::doccount n)
+{
+    LOGCALL(DB, Xapian::doccount, "GlassPostList::next_batch", dids | wdfs | n);
+    if (!have_started)
+	RETURN(LeafPostList::next_batch(dids, wdfs, n));
+
+    Xapian::doccount i = 0;
+    while (i != n) {
+	if (!next_in_chunk()) {
+	    next_chunk();
+	    if (is_at_end) break;
+	}
+	dids[i] = did;
+	wdfs[i] = wdf;
+	++i;
+    }
+    RETURN(i);
+}
+
 bool
 GlassPostList::current_chunk_contains(Xapian::docid desired_did)
 {
@@ -1184,117 +1214,440 @@ next_doclen_chunk:
     delete to;
 }
 
+/** The changes to a posting list and the existing chunks which they touch.
+ *
+ *  Merging the changes is split into three steps: read_chunks() reads the
+ *  existing chunks involved, encode_chunks() works out the updated chunks
+ *  without accessing the table, and apply_updates() writes them to the
+ *  table.
+ */
+struct Glass::PostlistMerge {
+    /// The term.
+    const string* term;
+
+    /// The changes to merge, in docid order.
+    const Inverter::PostingChanges* changes;
+
+    /** The existing chunks involved as (key, tag) pairs, in key order.
+     *
+     *  If the posting list exists, the first entry is always its first
+     *  chunk.  This is empty for a new posting list.
+     */
+    vector<pair<string, string>> chunks;
+
+    /// Index in chunks of the first chunk to merge the changes into.
+    size_t range_start = 0;
+
+    /** True if all the postings are being removed.
+     *
+     *  In this case chunks lists the keys of all the chunks, but doesn't
+     *  hold their tags.
+     */
+    bool zap = false;
+
+    /** The updates to make as (key, tag) pairs, in key order.
+     *
+     *  An empty tag means to delete the key.
+     */
+    vector<pair<string, string>> updates;
+
+    PostlistMerge(const string* term_,
+		  const Inverter::PostingChanges* changes_)
+	: term(term_), changes(changes_) { }
+
+    /// Return an approximate size in bytes for the chunks read.
+    size_t size() const {
+	size_t result = 0;
+	for (auto& chunk : chunks)
+	    result += chunk.first.size() + chunk.second.size();
+	return result;
+    }
+};
+
+/** Encodes postings into chunks in memory.
+ *
+ *  The chunks are split at the same points PostlistChunkWriter would split
+ *  them.
+ */
+class ChunkEncoder {
+  public:
+    struct Chunk {
+	Xapian::docid first_did;
+
+	Xapian::docid last_did;
+
+	/// The encoded entries, without the chunk header.
+	string data;
+
+	Chunk(Xapian::docid first_did_, Xapian::docid last_did_,
+	      const string& data_)
+	    : first_did(first_did_), last_did(last_did_), data(data_) { }
+    };
+
+    /// The encoded chunks.
+    vector<Chunk> chunks;
+
+  private:
+    /// Can entries be appended to the last chunk?
+    bool started = false;
+
+  public:
+    /// Start a new chunk for the next entry appended.
+    void start_chunk() { started = false; }
+
+    /// Append a block of raw entries as a new chunk.
+    void raw_append(Xapian::docid first_did, Xapian::docid last_did,
+		    const char* p, const char* end) {
+	Assert(!started);
+	if (p != end) {
+	    chunks.emplace_back(first_did, last_did, string(p, end));
+	    started = true;
+	}
+    }
+
+    /// Append an entry.
+    void append(Xapian::docid did, Xapian::termcount wdf) {
+	if (started && chunks.back().data.size() < CHUNKSIZE) {
+	    Chunk& chunk = chunks.back();
+	    Assert(did > chunk.last_did);
+	    pack_uint(chunk.data, did - chunk.last_did - 1);
+	    chunk.last_did = did;
+	} else {
+	    // Start a new chunk if this one has grown to the threshold.
+	    chunks.emplace_back(did, did, string());
+	    started = true;
+	}
+	pack_uint(chunks.back().data, wdf);
+    }
+};
+
+/// Read the first docid in a chunk from the key of a chunk other than the first.
+static Xapian::docid
+read_first_did_from_key(const string& key, const string& tname)
+{
+    const char* kpos = key.data();
+    const char* kend = kpos + key.size();
+    if (!check_tname_in_key(&kpos, kend, tname)) {
+	throw Xapian::DatabaseCorruptError("Expected another key with the same term name but found a different one");
+    }
+    Xapian::docid first_did;
+    if (!unpack_uint_preserving_sort(&kpos, kend, &first_did)) {
+	report_read_error(kpos);
+    }
+    return first_did;
+}
+
 void
-GlassPostListTable::merge_changes(const string &term,
-				  const Inverter::PostingChanges & changes)
+GlassPostListTable::read_chunks(Glass::PostlistMerge& merge,
+				GlassCursor& cursor) const
 {
+    LOGCALL_VOID(DB, "GlassPostListTable::read_chunks", *merge.term);
+    const string& term = *merge.term;
+    const auto& pl_changes = merge.changes->pl_changes;
+    Assert(!pl_changes.empty());
+
+    string first_key = make_key(term);
+    if (!cursor.find_entry(first_key)) {
+	// A new posting list.
+	return;
+    }
+
+    cursor.read_tag();
+    merge.chunks.emplace_back(first_key, cursor.current_tag);
+    bool is_last;
+    Xapian::doccount termfreq;
     {
-	// Rewrite the first chunk of this posting list with the updated
-	// termfreq and collfreq.
-	string current_key = make_key(term);
-	string tag;
-	(void)get_exact_entry(current_key, tag);
-
-	// Read start of first chunk to get termfreq and collfreq.
-	const char *pos = tag.data();
-	const char *end = pos + tag.size();
-	Xapian::doccount termfreq;
-	Xapian::termcount collfreq;
-	Xapian::docid firstdid, lastdid;
-	bool islast;
-	if (pos == end) {
-	    termfreq = 0;
-	    collfreq = 0;
-	    firstdid = 0;
-	    lastdid = 0;
-	    islast = true;
-	} else {
-	    firstdid = read_start_of_first_chunk(&pos, end,
-						 &termfreq, &collfreq);
-	    // Handle the generic start of chunk header.
-	    lastdid = read_start_of_chunk(&pos, end, firstdid, &islast);
+	const char* pos = cursor.current_tag.data();
+	const char* end = pos + cursor.current_tag.size();
+	Xapian::docid first_did =
+	    read_start_of_first_chunk(&pos, end, &termfreq, NULL);
+	(void)read_start_of_chunk(&pos, end, first_did, &is_last);
+    }
+
+    if (termfreq + merge.changes->get_tfdelta() == 0) {
+	// All postings deleted!  So we just need the keys of all the chunks
+	// so we can zap the posting list.
+	merge.zap = true;
+	merge.chunks.back().second.resize(0);
+	if (is_last) return;
+	while (cursor.next()) {
+	    const char* kpos = cursor.current_key.data();
+	    const char* kend = kpos + cursor.current_key.size();
+	    if (!check_tname_in_key_lite(&kpos, kend, term)) break;
+	    merge.chunks.emplace_back(cursor.current_key, string());
 	}
+	return;
+    }
 
-	termfreq += changes.get_tfdelta();
-	if (termfreq == 0) {
-	    // All postings deleted!  So we can shortcut by zapping the
-	    // posting list.
-	    if (islast) {
-		// Only one entry for this posting list.
-		del(current_key);
-		return;
-	    }
-	    MutableGlassCursor cursor(this);
-	    bool found = cursor.find_entry(current_key);
-	    Assert(found);
-	    if (!found) return; // Reduce damage!
-	    while (cursor.del()) {
-		const char *kpos = cursor.current_key.data();
-		const char *kend = kpos + cursor.current_key.size();
-		if (!check_tname_in_key_lite(&kpos, kend, term)) break;
-	    }
-	    return;
+    if (is_last) return;
+
+    // If the changes remove postings, a chunk we merge into could end up
+    // empty and then the chunk before or after it needs updating too, so
+    // we include those neighbouring chunks in the merge.
+    bool removing = false;
+    for (auto& change : pl_changes) {
+	if (change.second == DELETED_POSTING) {
+	    removing = true;
+	    break;
 	}
-	collfreq += changes.get_cfdelta();
+    }
 
-	// Rewrite start of first chunk to update termfreq and collfreq.
-	string newhdr = make_start_of_first_chunk(termfreq, collfreq, firstdid);
-	newhdr += make_start_of_chunk(islast, firstdid, lastdid);
-	if (pos == end) {
-	    add(current_key, newhdr);
+    Xapian::docid max_did = (pl_changes.end() - 1)->first;
+    (void)cursor.find_entry(make_key(term, pl_changes.begin()->first));
+    if (cursor.current_key != first_key) {
+	if (removing) {
+	    string key = cursor.current_key;
+	    cursor.find_entry_lt(key);
+	    if (cursor.current_key != first_key) {
+		cursor.read_tag();
+		merge.chunks.emplace_back(cursor.current_key,
+					  cursor.current_tag);
+	    }
+	    merge.range_start = merge.chunks.size() - 1;
+	    (void)cursor.find_entry(key);
 	} else {
-	    Assert(size_t(pos - tag.data()) <= tag.size());
-	    tag.replace(0, pos - tag.data(), newhdr);
-	    add(current_key, tag);
+	    merge.range_start = merge.chunks.size();
 	}
+	cursor.read_tag();
+	merge.chunks.emplace_back(cursor.current_key, cursor.current_tag);
+	const char* pos = cursor.current_tag.data();
+	const char* end = pos + cursor.current_tag.size();
+	Xapian::docid first_did = read_first_did_from_key(cursor.current_key,
+							  term);
+	(void)read_start_of_chunk(&pos, end, first_did, &is_last);
     }
-    map<Xapian::docid, Xapian::termcount>::const_iterator j;
-    j = changes.pl_changes.begin();
-    Assert(j != changes.pl_changes.end()); // This case is caught above.
 
-    Xapian::docid max_did;
-    PostlistChunkReader *from;
-    PostlistChunkWriter *to;
-    max_did = get_chunk(term, j->first, false, &from, &to);
-    for ( ; j != changes.pl_changes.end(); ++j) {
-	Xapian::docid did = j->first;
+    while (!is_last) {
+	if (!cursor.next()) {
+	    throw Xapian::DatabaseCorruptError("Expected another key but found none");
+	}
+	Xapian::docid first_did = read_first_did_from_key(cursor.current_key,
+							  term);
+	if (first_did > max_did && !removing) break;
+	cursor.read_tag();
+	merge.chunks.emplace_back(cursor.current_key, cursor.current_tag);
+	if (first_did > max_did) break;
+	const char* pos = cursor.current_tag.data();
+	const char* end = pos + cursor.current_tag.size();
+	(void)read_start_of_chunk(&pos, end, first_did, &is_last);
+    }
+}
 
-next_chunk:
-	LOGLINE(DB, "Updating term=" << term << ", did=" << did);
-	if (from) while (!from->is_at_end()) {
-	    Xapian::docid copy_did = from->get_docid();
-	    if (copy_did >= did) {
-		if (copy_did == did) {
-		    from->next();
+void
+GlassPostListTable::encode_chunks(Glass::PostlistMerge& merge)
+{
+    const string& term = *merge.term;
+    const auto& pl_changes = merge.changes->pl_changes;
+    auto& chunks = merge.chunks;
+    auto& updates = merge.updates;
+
+    if (merge.zap) {
+	for (auto& chunk : chunks) {
+	    updates.emplace_back(chunk.first, string());
+	}
+	return;
+    }
+
+    Xapian::doccount termfreq = 0;
+    Xapian::termcount collfreq = 0;
+    if (!chunks.empty()) {
+	const char* pos = chunks[0].second.data();
+	const char* end = pos + chunks[0].second.size();
+	(void)read_start_of_first_chunk(&pos, end, &termfreq, &collfreq);
+    }
+    termfreq += merge.changes->get_tfdelta();
+    if (termfreq == 0) {
+	// A new posting list for a term whose postings were all removed again
+	// before being flushed.
+	Assert(chunks.empty());
+	return;
+    }
+    collfreq += merge.changes->get_cfdelta();
+
+    ChunkEncoder encoder;
+    bool is_last = true;
+    auto j = pl_changes.begin();
+    for (size_t i = merge.range_start; i < chunks.size(); ++i) {
+	const string& tag = chunks[i].second;
+	const char* pos = tag.data();
+	const char* end = pos + tag.size();
+	Xapian::docid first_did;
+	if (i == 0) {
+	    first_did = read_start_of_first_chunk(&pos, end, NULL, NULL);
+	} else {
+	    first_did = read_first_did_from_key(chunks[i].first, term);
+	}
+	Xapian::docid last_did = read_start_of_chunk(&pos, end, first_did,
+						     &is_last);
+
+	// Find the changes which belong in this chunk.
+	auto j_end = pl_changes.end();
+	if (i + 1 < chunks.size()) {
+	    Xapian::docid next_first_did =
+		read_first_did_from_key(chunks[i + 1].first, term);
+	    j_end = lower_bound(j, j_end, next_first_did,
+				[](const pair<Xapian::docid,
+					      Xapian::termcount>& change,
+				   Xapian::docid did) {
+				    return change.first < did;
+				});
+	}
+
+	encoder.start_chunk();
+	if (j == j_end || j->first > last_did) {
+	    // We're just appending to this chunk (if anything).
+	    encoder.raw_append(first_did, last_did, pos, end);
+	} else {
+	    PostlistChunkReader from(first_did, string(pos, end));
+	    for ( ; j != j_end; ++j) {
+		Xapian::docid did = j->first;
+		while (!from.is_at_end()) {
+		    Xapian::docid copy_did = from.get_docid();
+		    if (copy_did >= did) {
+			if (copy_did == did) from.next();
+			break;
+		    }
+		    encoder.append(copy_did, from.get_wdf());
+		    from.next();
+		}
+		if (j->second != DELETED_POSTING) {
+		    encoder.append(did, j->second);
 		}
-		break;
 	    }
-	    to->append(this, copy_did, from->get_wdf());
-	    from->next();
+	    while (!from.is_at_end()) {
+		encoder.append(from.get_docid(), from.get_wdf());
+		from.next();
+	    }
 	}
-	if ((!from || from->is_at_end()) && did > max_did) {
-	    delete from;
-	    to->flush(this);
-	    delete to;
-	    max_did = get_chunk(term, did, false, &from, &to);
-	    goto next_chunk;
+	for ( ; j != j_end; ++j) {
+	    if (j->second != DELETED_POSTING) {
+		encoder.append(j->first, j->second);
+	    }
+	}
+    }
+    if (chunks.empty()) {
+	// A new posting list.
+	for ( ; j != pl_changes.end(); ++j) {
+	    if (j->second != DELETED_POSTING) {
+		encoder.append(j->first, j->second);
+	    }
+	}
+    }
+    if (encoder.chunks.empty()) {
+	throw Xapian::DatabaseCorruptError("Posting list for " + term + " has entries but no chunks left after merging");
+    }
+
+    bool range_has_first_chunk = (merge.range_start == 0);
+    if (!range_has_first_chunk) {
+	// Rewrite start of first chunk to update termfreq and collfreq.
+	const string& tag = chunks[0].second;
+	const char* pos = tag.data();
+	const char* end = pos + tag.size();
+	bool first_is_last;
+	Xapian::docid first_did = read_start_of_first_chunk(&pos, end,
+							    NULL, NULL);
+	Xapian::docid last_did = read_start_of_chunk(&pos, end, first_did,
+						     &first_is_last);
+	string newtag = make_start_of_first_chunk(termfreq, collfreq,
+						  first_did);
+	newtag += make_start_of_chunk(first_is_last, first_did, last_did);
+	newtag.append(pos, end);
+	updates.emplace_back(chunks[0].first, std::move(newtag));
+    }
+
+    // Work out which chunks in the range need adding, replacing or
+    // deleting.  The new chunks are in key order, as are the old ones.
+    size_t old_i = merge.range_start;
+    for (size_t k = 0; k != encoder.chunks.size(); ++k) {
+	const ChunkEncoder::Chunk& chunk = encoder.chunks[k];
+	string key, tag;
+	if (k == 0 && range_has_first_chunk) {
+	    key = make_key(term);
+	    tag = make_start_of_first_chunk(termfreq, collfreq,
+					    chunk.first_did);
+	} else {
+	    key = make_key(term, chunk.first_did);
 	}
+	bool chunk_is_last = (k + 1 == encoder.chunks.size() && is_last);
+	tag += make_start_of_chunk(chunk_is_last, chunk.first_did,
+				   chunk.last_did);
+	tag += chunk.data;
 
-	Xapian::termcount new_wdf = j->second;
-	if (new_wdf != Xapian::termcount(-1)) {
-	    to->append(this, did, new_wdf);
+	while (old_i < chunks.size() && chunks[old_i].first < key) {
+	    updates.emplace_back(chunks[old_i++].first, string());
 	}
+	if (old_i < chunks.size() && chunks[old_i].first == key) {
+	    // No need to rewrite a chunk which is unchanged.
+	    bool unchanged = (chunks[old_i++].second == tag);
+	    if (unchanged) continue;
+	}
+	updates.emplace_back(std::move(key), std::move(tag));
+    }
+    while (old_i < chunks.size()) {
+	updates.emplace_back(chunks[old_i++].first, string());
     }
+}
 
-    if (from) {
-	while (!from->is_at_end()) {
-	    to->append(this, from->get_docid(), from->get_wdf());
-	    from->next();
+void
+GlassPostListTable::apply_updates(const Glass::PostlistMerge& merge)
+{
+    for (auto& update : merge.updates) {
+	if (update.second.empty()) {
+	    del(update.first);
+	} else {
+	    add(update.first, update.second);
+	}
+    }
+}
+
+void
+GlassPostListTable::merge_changes(const string &term,
+				  const Inverter::PostingChanges & changes)
+{
+    merge_changes({make_pair(&term, &changes)});
+}
+
+void
+GlassPostListTable::merge_changes(const vector<pair<const string*,
+					      const Inverter::PostingChanges*>>& changes)
+{
+    LOGCALL_VOID(DB, "GlassPostListTable::merge_changes", changes.size());
+
+    // Limit on the total size of the chunks read for a batch of merges, so
+    // that we don't need to hold the chunks for every term in memory at once.
+    const size_t MERGE_BATCH_SIZE = 16 * 1024 * 1024;
+
+    // Don't start extra threads to encode a batch with fewer merges than
+    // this.
+    const size_t MIN_PARALLEL_MERGES = 64;
+
+    vector<Glass::PostlistMerge> merges;
+    auto i = changes.begin();
+    while (i != changes.end()) {
+	merges.clear();
+	{
+	    unique_ptr<GlassCursor> cursor(cursor_get());
+	    size_t batch_size = 0;
+	    do {
+		merges.emplace_back(i->first, i->second);
+		read_chunks(merges.back(), *cursor);
+		batch_size += merges.back().size();
+	    } while (++i != changes.end() && batch_size < MERGE_BATCH_SIZE);
+	}
+
+	unsigned n_threads = merge_threads;
+	if (merges.size() < MIN_PARALLEL_MERGES)
+	    n_threads = 1;
+	parallel_for(merges.size(), n_threads, [&](size_t j) {
+	    encode_chunks(merges[j]);
+	});
+
+	// Terms are in ascending order, so this updates the table in key
+	// order.
+	for (auto& merge : merges) {
+	    apply_updates(merge);
 	}
-	delete from;
     }
-    to->flush(this);
-    delete to;
 }
 
 void
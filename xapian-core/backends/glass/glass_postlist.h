@@ -36,6 +36,8 @@
 #include <memory>
 #include <map>
 #include <string>
+#include <utility>
+#include <vector>
 
 using namespace std;
 
@@ -45,6 +47,7 @@ class GlassDatabase;
 namespace Glass {
     class PostlistChunkReader;
     class PostlistChunkWriter;
+    struct PostlistMerge;
     class RootInfo;
 }
 
@@ -56,6 +59,27 @@ class GlassPostListTable : public GlassTable {
     /// PostList for looking up document lengths.
     mutable unique_ptr<GlassPostList> doclen_pl;
 
+    /// The maximum number of threads to use to encode merged postlists.
+    unsigned merge_threads = 1;
+
+    /** Read the existing chunks which a merge needs.
+     *
+     *  @param merge	The merge to read the chunks for.
+     *  @param cursor	Cursor to use for reading (reused between calls to
+     *			make use of the terms being in ascending order).
+     */
+    void read_chunks(Glass::PostlistMerge& merge, GlassCursor& cursor) const;
+
+    /** Encode the updated chunks for a merge.
+     *
+     *  This doesn't access the table so can be called for different merges
+     *  in parallel.
+     */
+    static void encode_chunks(Glass::PostlistMerge& merge);
+
+    /// Apply the updates for a merge to the table.
+    void apply_updates(const Glass::PostlistMerge& merge);
+
   public:
     /** Create a new table object.
      *
@@ -85,10 +109,30 @@ class GlassPostListTable : public GlassTable {
 	GlassTable::open(flags_, root_info, rev);
     }
 
+    /** Set the maximum number of threads to use when merging changes.
+     *
+     *  @param n_threads  The maximum number of threads (0 and 1 both mean
+     *			  to merge in the calling thread only).
+     */
+    void set_merge_threads(unsigned n_threads) {
+	merge_threads = n_threads;
+    }
+
     /// Merge changes for a term.
     void merge_changes(const string& term,
 		       const Inverter::PostingChanges& changes);
 
+    /** Merge changes for several terms.
+     *
+     *  The updated chunks for different terms are encoded in parallel if
+     *  set_merge_threads() has been called, while the table is read and
+     *  updated from the calling thread in key order.
+     *
+     *  @param changes	The terms and their changes, in ascending term order.
+     */
+    void merge_changes(const vector<pair<const string*,
+				  const Inverter::PostingChanges*>>& changes);
+
     /// Merge document length changes.
     void merge_doclen_changes(const map<Xapian::docid,
 					Xapian::termcount>& doclens);
@@ -288,6 +332,11 @@ class GlassPostList : public LeafPostList {
     /// Skip to next document with docid >= docid.
     PostList * skip_to(Xapian::docid desired_did, double w_min);
 
+    /// Read up to @a n of the following postings.
+    Xapian::doccount next_batch(Xapian::docid* dids,
+				Xapian::termcount* wdfs,
+				Xapian::doccount n);
+
     /// Return true if and only if we're off the end of the list.
     bool at_end() const { return is_at_end; }
 
@@ -0,0 +1,189 @@
+/** @file
+ * @brief Make glass commits durable in a background thread
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include <config.h>
+
+#include "glass_syncer.h"
+
+#include "xapian/constants.h"
+#include "xapian/error.h"
+
+#include "io_utils.h"
+#include "posixy_wrapper.h"
+#include "safeunistd.h"
+
+#include <cerrno>
+#include <system_error>
+#include <utility>
+
+using namespace std;
+
+GlassSyncer::~GlassSyncer()
+{
+    {
+	lock_guard<std::mutex> guard(sync_mutex);
+	stopping = true;
+    }
+    request_cond.notify_all();
+    if (worker.joinable())
+	worker.join();
+}
+
+void
+GlassSyncer::run()
+{
+    unique_lock<std::mutex> guard(sync_mutex);
+    while (true) {
+	request_cond.wait(guard, [this]() {
+	    return stopping || pending_rev != 0;
+	});
+	// Finish any pending request before stopping.
+	if (pending_rev == 0)
+	    return;
+	glass_revision_number_t rev = pending_rev;
+	pending_rev = 0;
+	string version = std::move(pending_version);
+	vector<int> fds = std::move(pending_fds);
+	int flags = pending_flags;
+
+	guard.unlock();
+	bool ok = make_durable(version, fds, flags);
+	int saved_errno = errno;
+	guard.lock();
+
+	if (ok) {
+	    durable_rev = rev;
+	} else if (!failed) {
+	    failed = true;
+	    failed_errno = saved_errno;
+	}
+	done_cond.notify_all();
+    }
+}
+
+bool
+GlassSyncer::make_durable(const string& version,
+			  const vector<int>& fds,
+			  int flags)
+{
+    // The blocks of the new revision must be on disk before the version file
+    // which refers to them.
+    for (int fd : fds) {
+	if (!io_sync(fd))
+	    return false;
+    }
+
+    string tmpfile = db_dir + "/v.tmp";
+    int fd = posixy_open(tmpfile.c_str(),
+			 O_CREAT|O_TRUNC|O_WRONLY|O_BINARY|O_CLOEXEC,
+			 0666);
+    if (fd < 0)
+	return false;
+
+    try {
+	io_write(fd, version.data(), version.size());
+    } catch (const Xapian::DatabaseError&) {
+	int saved_errno = errno;
+	(void)close(fd);
+	(void)unlink(tmpfile.c_str());
+	errno = saved_errno ? saved_errno : EIO;
+	return false;
+    }
+
+    if (!((flags & Xapian::DB_FULL_SYNC) ? io_full_sync(fd) : io_sync(fd))) {
+	int saved_errno = errno;
+	(void)close(fd);
+	(void)unlink(tmpfile.c_str());
+	errno = saved_errno;
+	return false;
+    }
+
+    if (close(fd) != 0) {
+	int saved_errno = errno;
+	(void)unlink(tmpfile.c_str());
+	errno = saved_errno;
+	return false;
+    }
+
+    return io_tmp_rename(tmpfile, db_dir + "/iamglass");
+}
+
+void
+GlassSyncer::check_failed() const
+{
+    if (failed) {
+	throw Xapian::DatabaseError("Background commit of '" + db_dir +
+				    "' failed", failed_errno);
+    }
+}
+
+void
+GlassSyncer::request(glass_revision_number_t rev,
+		     string&& version,
+		     vector<int>&& fds,
+		     int flags)
+{
+    unique_lock<std::mutex> guard(sync_mutex);
+    check_failed();
+    pending_rev = rev;
+    pending_version = std::move(version);
+    pending_fds = std::move(fds);
+    pending_flags = flags;
+    requested_rev = rev;
+    if (!worker.joinable()) {
+	try {
+	    worker = thread(&GlassSyncer::run, this);
+	} catch (const system_error&) {
+	    // Make the revision durable on this thread instead.
+	    pending_rev = 0;
+	    if (!make_durable(pending_version, pending_fds, flags)) {
+		failed = true;
+		failed_errno = errno;
+		check_failed();
+	    }
+	    durable_rev = rev;
+	    return;
+	}
+    }
+    guard.unlock();
+    request_cond.notify_one();
+}
+
+void
+GlassSyncer::wait(glass_revision_number_t rev)
+{
+    unique_lock<std::mutex> guard(sync_mutex);
+    done_cond.wait(guard, [&]() {
+	return failed || durable_rev >= rev || durable_rev == requested_rev;
+    });
+    check_failed();
+}
+
+bool
+GlassSyncer::is_durable(glass_revision_number_t rev)
+{
+    lock_guard<std::mutex> guard(sync_mutex);
+    return durable_rev >= rev;
+}
+
+void
+GlassSyncer::wait_all()
+{
+    wait(glass_revision_number_t(-1));
+}
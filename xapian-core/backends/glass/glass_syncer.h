@@ -0,0 +1,141 @@
+/** @file
+ * @brief Make glass commits durable in a background thread
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_GLASS_SYNCER_H
+#define XAPIAN_INCLUDED_GLASS_SYNCER_H
+
+#include "glass_defs.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/** Make glass commits durable in a background thread.
+ *
+ *  Used for Xapian::DB_ASYNC_COMMIT.  The writer writes out the blocks for a
+ *  new revision and then calls request(), and the background thread syncs the
+ *  table files and then writes, syncs and renames the version file.  Until
+ *  that has happened, the previous durable revision is what's on disk.
+ *
+ *  If several revisions are requested while the background thread is busy,
+ *  only the latest is made durable (so the tables are synced once for all of
+ *  them).
+ */
+class GlassSyncer {
+    /// The database directory.
+    std::string db_dir;
+
+    /// Protects the members below.
+    std::mutex sync_mutex;
+
+    /// Signalled when a request is made or the thread should stop.
+    std::condition_variable request_cond;
+
+    /// Signalled when a revision is made durable or syncing fails.
+    std::condition_variable done_cond;
+
+    /// The latest revision requested but not yet started on.
+    glass_revision_number_t pending_rev = 0;
+
+    /// The serialised version file for pending_rev.
+    std::string pending_version;
+
+    /// The table file descriptors to sync for pending_rev.
+    std::vector<int> pending_fds;
+
+    /// The flags for pending_rev.
+    int pending_flags = 0;
+
+    /// The latest revision requested.
+    glass_revision_number_t requested_rev;
+
+    /// The latest revision which is durable.
+    glass_revision_number_t durable_rev;
+
+    /// errno from a failed sync, or 0 if none has failed.
+    int failed_errno = 0;
+
+    /// Has a sync failed?
+    bool failed = false;
+
+    /// Should the background thread stop?
+    bool stopping = false;
+
+    /// The background thread (started by the first request).
+    std::thread worker;
+
+    /// The background thread's main loop.
+    void run();
+
+    /** Sync the table files, then durably replace the version file.
+     *
+     *  @return true on success, or false on failure, with errno set.
+     */
+    bool make_durable(const std::string& version,
+		      const std::vector<int>& fds,
+		      int flags);
+
+    /// Throw DatabaseError if a sync has failed.
+    void check_failed() const;
+
+  public:
+    /** Constructor.
+     *
+     *  @param db_dir_	The database directory.
+     *  @param rev	The current (durable) revision.
+     */
+    GlassSyncer(const std::string& db_dir_, glass_revision_number_t rev)
+	: db_dir(db_dir_), requested_rev(rev), durable_rev(rev) { }
+
+    /// Destructor: waits for requested revisions to be made durable.
+    ~GlassSyncer();
+
+    /** Request that a revision be made durable.
+     *
+     *  The blocks of revision @a rev must already have been written.
+     *
+     *  @param rev	The new revision.
+     *  @param version	The serialised version file for @a rev.
+     *  @param fds	The file descriptors of the table files to sync.
+     *  @param flags	The database flags.
+     */
+    void request(glass_revision_number_t rev,
+		 std::string&& version,
+		 std::vector<int>&& fds,
+		 int flags);
+
+    /** Wait until revision @a rev is durable.
+     *
+     *  @exception Xapian::DatabaseError if syncing has failed.
+     */
+    void wait(glass_revision_number_t rev);
+
+    /// Is revision @a rev durable?
+    bool is_durable(glass_revision_number_t rev);
+
+    /** Wait until all requested revisions are durable.
+     *
+     *  @exception Xapian::DatabaseError if syncing has failed.
+     */
+    void wait_all();
+};
+
+#endif // XAPIAN_INCLUDED_GLASS_SYNCER_H
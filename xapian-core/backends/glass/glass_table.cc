@@ -30,6 +30,7 @@
 
 #include "omassert.h"
 #include "posixy_wrapper.h"
+#include "safesysstat.h"
 #include "str.h"
 #include "stringutils.h" // For STRINGIZE().
 
@@ -43,6 +44,7 @@
 #include "glass_changes.h"
 #include "glass_cursor.h"
 #include "glass_defs.h"
+#include "glass_syncer.h"
 #include "glass_version.h"
 
 #include "debuglog.h"
@@ -52,7 +54,10 @@
 #include "wordaccess.h"
 
 #include <algorithm>  // for std::min()
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "xapian/constants.h"
 
@@ -165,8 +170,41 @@ GlassTable::read_block(uint4 n, uint8_t * p) const
 	GlassTable::throw_database_closed();
     AssertRel(n,<,free_list.get_first_unused_block());
 
-    io_read_block(handle, reinterpret_cast<char *>(p), block_size, n, offset);
+    BlockCache * cache = NULL;
+    if (use_block_cache) {
+	BlockCache & c = BlockCache::get_instance();
+	if (c.enabled()) {
+	    if (c.find(BlockCache::Key(block_cache_id, n, revision_number),
+		       p, block_size)) {
+		return;
+	    }
+	    cache = &c;
+	}
+    }
+
+    if (!read_block_from_mapping(n, p)) {
+	io_read_block(handle, reinterpret_cast<char *>(p), block_size, n,
+		      offset);
+    }
+    check_block(n, p, cache);
+}
 
+bool
+GlassTable::read_block_from_mapping(uint4 n, uint8_t * p) const
+{
+    off_t block_pos = offset + off_t(n) * block_size;
+    if (!mapping || size_t(block_pos) + block_size > mapping_size)
+	return false;
+    // We still copy the block as glass reuses free blocks in place, and we
+    // check for that after reading the block, so the contents mustn't change
+    // after that.
+    memcpy(p, mapping + block_pos, block_size);
+    return true;
+}
+
+void
+GlassTable::check_block(uint4 n, const uint8_t * p, BlockCache * cache) const
+{
     if (GET_LEVEL(p) != LEVEL_FREELIST) {
 	int dir_end = DIR_END(p);
 	if (rare(dir_end < DIR_START || unsigned(dir_end) > block_size)) {
@@ -174,6 +212,58 @@ GlassTable::read_block(uint4 n, uint8_t * p) const
 	    msg += str(n);
 	    throw Xapian::DatabaseCorruptError(msg);
 	}
+	// Blocks are never modified in place once committed, so any reader
+	// of this revision will see the same contents - unless the block has
+	// been reused by a later revision, in which case the caller will
+	// notice that and throw DatabaseModifiedError.
+	if (cache && REVISION(p) <= revision_number) {
+	    cache->add(BlockCache::Key(block_cache_id, n, revision_number),
+		       p, block_size);
+	}
+    }
+}
+
+/// read_blocks(count, ns, ps) reads block ns[i] to address ps[i] for i < count.
+void
+GlassTable::read_blocks(size_t count, const uint4 * ns,
+			uint8_t * const * ps) const
+{
+    LOGCALL_VOID(DB, "GlassTable::read_blocks",
+		 count | (const void*)ns | (const void*)ps);
+    if (rare(handle == -2))
+	GlassTable::throw_database_closed();
+
+    BlockCache * cache = NULL;
+    if (use_block_cache) {
+	BlockCache & c = BlockCache::get_instance();
+	if (c.enabled()) cache = &c;
+    }
+
+    // The indices of the blocks which weren't in the block cache, and the
+    // block numbers and buffers for those which need reading from the file.
+    vector<size_t> to_check;
+    vector<off_t> blocks;
+    vector<char *> bufs;
+    for (size_t i = 0; i != count; ++i) {
+	uint4 n = ns[i];
+	AssertRel(n,<,free_list.get_first_unused_block());
+	if (cache &&
+	    cache->find(BlockCache::Key(block_cache_id, n, revision_number),
+			ps[i], block_size)) {
+	    continue;
+	}
+	to_check.push_back(i);
+	if (!read_block_from_mapping(n, ps[i])) {
+	    blocks.push_back(n);
+	    bufs.push_back(reinterpret_cast<char *>(ps[i]));
+	}
+    }
+
+    io_read_blocks(handle, bufs.data(), block_size, blocks.data(),
+		   blocks.size(), offset);
+
+    for (size_t i : to_check) {
+	check_block(ns[i], ps[i], cache);
     }
 }
 
@@ -1463,6 +1553,156 @@ GlassTable::readahead_key(const string &key) const
     RETURN(true);
 }
 
+bool
+GlassTable::readahead_keys(const vector<string> &keys) const
+{
+    LOGCALL(DB, bool, "GlassTable::readahead_keys", keys.size());
+
+    // See readahead_key() for the cases where handle < 0.
+    if (handle < 0)
+	RETURN(false);
+
+    // If the table only has one level, there are no branch blocks to preread.
+    if (level == 0 || keys.empty())
+	RETURN(false);
+
+    // The block each key needs at the level being processed, and the index
+    // of the key.
+    vector<pair<uint4, size_t>> blocks;
+    blocks.reserve(keys.size());
+    const uint8_t * p = C[level].get_p();
+    for (size_t i = 0; i != keys.size(); ++i) {
+	form_key(keys[i]);
+	int c = find_in_branch(p, kt, -1);
+	blocks.emplace_back(BItem(p, c).block_given_by(), i);
+    }
+
+    // The blocks needed at the level being processed which aren't already in
+    // our cursor.
+    vector<uint4> to_read;
+    vector<uint8_t *> bufs;
+    unique_ptr<uint8_t[]> buf;
+    size_t buf_blocks = 0;
+    for (int j = level - 1; ; --j) {
+	// Sort so each block is only handled once, and in block order.
+	sort(blocks.begin(), blocks.end());
+	to_read.clear();
+	for (auto& b : blocks) {
+	    uint4 n = b.first;
+	    if (n != C[j].get_n() && (to_read.empty() || n != to_read.back()))
+		to_read.push_back(n);
+	}
+
+	// Once we know the leaf blocks we just request readahead for them and
+	// we're done.  In a writable table the blocks on disk below the root
+	// may not be current, so we don't descend further.
+	if (j == 0 || writable) {
+	    for (uint4 n : to_read) {
+		if (!io_readahead_block(handle, block_size, n, offset))
+		    RETURN(false);
+	    }
+	    break;
+	}
+
+	// Read all the branch blocks needed at this level in one batch, then
+	// find the child block each key needs at the next level down.
+	if (to_read.size() > buf_blocks) {
+	    buf_blocks = to_read.size();
+	    buf.reset(new uint8_t[buf_blocks * block_size]);
+	}
+	bufs.clear();
+	for (size_t i = 0; i != to_read.size(); ++i) {
+	    bufs.push_back(buf.get() + i * block_size);
+	}
+	read_blocks(to_read.size(), to_read.data(), bufs.data());
+
+	size_t r = 0;
+	uint4 prev = BLK_UNUSED;
+	for (auto& b : blocks) {
+	    if (b.first != prev) {
+		prev = b.first;
+		if (prev == C[j].get_n()) {
+		    p = C[j].get_p();
+		} else {
+		    p = bufs[r++];
+		    // If the block has been reused by a later revision, the
+		    // match will report that so just stop the readahead.
+		    if (REVISION(p) > revision_number || GET_LEVEL(p) != j)
+			RETURN(false);
+		}
+	    }
+	    form_key(keys[b.second]);
+	    int c = find_in_branch(p, kt, -1);
+	    b.first = BItem(p, c).block_given_by();
+	}
+    }
+    RETURN(true);
+}
+
+void
+GlassTable::readahead_next_leaf(const Glass::Cursor * C_) const
+{
+    LOGCALL_VOID(DB, "GlassTable::readahead_next_leaf", (const void*)C_);
+    if (handle < 0 || level == 0)
+	return;
+    const uint8_t * p = C_[1].get_p();
+    int c = C_[1].c + D2;
+    if (c >= DIR_END(p))
+	return;
+    (void)io_readahead_block(handle, block_size, BItem(p, c).block_given_by(),
+			     offset);
+}
+
+void
+GlassTable::sample_keys(size_t n, vector<string> & keys) const
+{
+    LOGCALL_VOID(DB, "GlassTable::sample_keys", n | keys.size());
+    if (handle < 0 || level == 0)
+	return;
+
+    // Read the blocks at each level in batches so we don't need a buffer
+    // for a whole level at once.
+    const size_t BATCH_SIZE = 64;
+    unique_ptr<uint8_t[]> buf;
+    vector<uint4> blocks(1, C[level].get_n());
+    vector<uint4> children;
+    vector<string> level_keys;
+    for (int j = level; j > 0; --j) {
+	children.clear();
+	level_keys.clear();
+	for (size_t b = 0; b < blocks.size(); b += BATCH_SIZE) {
+	    size_t count = min(BATCH_SIZE, blocks.size() - b);
+	    uint8_t * ps[BATCH_SIZE];
+	    if (j == level) {
+		ps[0] = const_cast<uint8_t *>(C[level].get_p());
+	    } else {
+		if (!buf) buf.reset(new uint8_t[BATCH_SIZE * block_size]);
+		for (size_t i = 0; i != count; ++i) {
+		    ps[i] = buf.get() + i * block_size;
+		}
+		read_blocks(count, &blocks[b], ps);
+	    }
+	    for (size_t i = 0; i != count; ++i) {
+		const uint8_t * p = ps[i];
+		int dir_end = DIR_END(p);
+		for (int c = DIR_START; c < dir_end; c += D2) {
+		    BItem item(p, c);
+		    children.push_back(item.block_given_by());
+		    // The first item in the leftmost block at each level has a
+		    // null key.
+		    if (item.key().length() == 0) continue;
+		    level_keys.emplace_back();
+		    item.key().read(&level_keys.back());
+		}
+	    }
+	}
+	if (level_keys.size() >= n || j == 1)
+	    break;
+	swap(blocks, children);
+    }
+    keys.insert(keys.end(), level_keys.begin(), level_keys.end());
+}
+
 bool
 GlassTable::get_exact_entry(const string &key, string & tag) const
 {
@@ -1543,6 +1783,19 @@ GlassTable::read_tag(Glass::Cursor * C_, string *tag, bool keep_compressed) cons
     RETURN(compressed && keep_compressed);
 }
 
+void
+GlassTable::wait_for_sync(glass_revision_number_t rev) const
+{
+    if (syncer)
+	syncer->wait(rev);
+}
+
+bool
+GlassTable::is_synced(glass_revision_number_t rev) const
+{
+    return !syncer || syncer->is_durable(rev);
+}
+
 void
 GlassTable::set_full_compaction(bool parity)
 {
@@ -1719,7 +1972,12 @@ GlassTable::GlassTable(const char * tablename_, const string & path_,
 	  comp_stream(Z_DEFAULT_STRATEGY),
 	  lazy(lazy_),
 	  last_readahead(BLK_UNUSED),
-	  offset(0)
+	  offset(0),
+	  block_cache_uuid_set(false),
+	  use_block_cache(false),
+	  use_mmap(false),
+	  mapping(NULL),
+	  mapping_size(0)
 {
     LOGCALL_CTOR(DB, "GlassTable", tablename_ | path_ | readonly_ | lazy_);
 }
@@ -1754,7 +2012,12 @@ GlassTable::GlassTable(const char * tablename_, int fd, off_t offset_,
 	  comp_stream(Z_DEFAULT_STRATEGY),
 	  lazy(lazy_),
 	  last_readahead(BLK_UNUSED),
-	  offset(offset_)
+	  offset(offset_),
+	  block_cache_uuid_set(false),
+	  use_block_cache(false),
+	  use_mmap(false),
+	  mapping(NULL),
+	  mapping_size(0)
 {
     LOGCALL_CTOR(DB, "GlassTable", tablename_ | fd | offset_ | readonly_ | lazy_);
 }
@@ -1816,6 +2079,8 @@ void GlassTable::close(bool permanent) {
 	    handle = -1;
 	}
     }
+    use_block_cache = false;
+    unmap_file();
 
     if (permanent) {
 	handle = -2;
@@ -1995,6 +2260,18 @@ GlassTable::do_open_to_read(const RootInfo * root_info,
 	}
     }
 
+    map_file();
+
+    if (block_cache_uuid_set) {
+	struct stat statbuf;
+	if (fstat(handle, &statbuf) == 0) {
+	    block_cache_id.dev = statbuf.st_dev;
+	    block_cache_id.ino = statbuf.st_ino;
+	    block_cache_id.offset = offset;
+	    use_block_cache = true;
+	}
+    }
+
     basic_open(root_info, rev);
 
     read_root();
@@ -2019,6 +2296,49 @@ GlassTable::open(int flags_, const RootInfo & root_info,
     do_open_to_write(&root_info, rev);
 }
 
+void
+GlassTable::set_block_cache_uuid(const char * uuid)
+{
+    if (writable) return;
+    memcpy(block_cache_id.uuid, uuid, sizeof(block_cache_id.uuid));
+    block_cache_uuid_set = true;
+}
+
+void
+GlassTable::enable_mmap()
+{
+    if (writable) return;
+    use_mmap = true;
+    if (handle >= 0)
+	map_file();
+}
+
+void
+GlassTable::map_file()
+{
+    if (!use_mmap) return;
+    if (mapping) {
+	// Keep the existing mapping unless the file has changed size since it
+	// was made, as blocks past the end of it would be read with pread().
+	struct stat statbuf;
+	if (fstat(handle, &statbuf) == 0 &&
+	    size_t(statbuf.st_size) == mapping_size)
+	    return;
+	unmap_file();
+    }
+    mapping = io_map_file(handle, mapping_size);
+}
+
+void
+GlassTable::unmap_file()
+{
+    if (mapping) {
+	io_unmap_file(mapping, mapping_size);
+	mapping = NULL;
+	mapping_size = 0;
+    }
+}
+
 bool
 GlassTable::prev_for_sequential(Glass::Cursor * C_, int /*dummy*/) const
 {
@@ -31,6 +31,7 @@
 #include "glass_cursor.h"
 #include "glass_defs.h"
 
+#include "backends/blockcache.h"
 #include "io_utils.h"
 #include "omassert.h"
 #include "str.h"
@@ -41,6 +42,7 @@
 
 #include <algorithm>
 #include <string>
+#include <vector>
 
 namespace Glass {
 
@@ -405,6 +407,7 @@ const int BTREE_CURSOR_LEVELS = 10;
 using Glass::RootInfo;
 
 class GlassChanges;
+class GlassSyncer;
 
 /** Class managing a Btree table in a Glass database.
  *
@@ -485,6 +488,37 @@ class GlassTable {
 
     bool readahead_key(const string &key) const;
 
+    /** Readahead the leaf blocks for a batch of keys.
+     *
+     *  Unlike readahead_key(), this descends through all the levels of the
+     *  B-tree.  At each level, readahead is requested for all the blocks
+     *  needed by the keys before any of them are read, so the reads for
+     *  different keys can proceed in parallel rather than one after another.
+     *
+     *  Returns false if we can't readahead on this table.
+     */
+    bool readahead_keys(const std::vector<string> &keys) const;
+
+    /** Readahead the leaf block after the one cursor C_ is in.
+     *
+     *  Only done if the next leaf block is a child of the same branch block,
+     *  since otherwise we'd need to read another branch block to find it.
+     */
+    void readahead_next_leaf(const Glass::Cursor * C_) const;
+
+    /** Sample the keys in the table from its branch blocks.
+     *
+     *  Appends the keys of the items in the highest level of branch blocks
+     *  with at least @a n items (or the lowest level of branch blocks if
+     *  none has that many).  Each key sampled marks the start of a subtree,
+     *  so the keys returned divide the table into roughly equal sized parts.
+     *
+     *  Keys in branch blocks may be truncated, so they may not actually be
+     *  present in the table.  If the table only has one level, no keys are
+     *  sampled.
+     */
+    void sample_keys(size_t n, std::vector<string> & keys) const;
+
     /** Determine whether the btree exists on disk.
      */
     bool exists() const;
@@ -512,6 +546,23 @@ class GlassTable {
     /** Return true if this table is writable. */
     bool is_writable() const { return writable; }
 
+    /** Allow blocks of this table to be shared via the process-wide cache.
+     *
+     *  Only has an effect for a read-only table, and must be called before
+     *  open().
+     *
+     *  @param uuid	The UUID of the database (used to tell apart databases
+     *			which reuse the same inode).
+     */
+    void set_block_cache_uuid(const char * uuid);
+
+    /** Read blocks via a memory mapping of the table file.
+     *
+     *  Only has an effect for a read-only table.  If the table is already
+     *  open, it is mapped now; otherwise it is mapped when opened.
+     */
+    void enable_mmap();
+
     /** Flush any outstanding changes to the DB file of the table.
      *
      *  This must be called before commit, to ensure that the DB file is
@@ -728,6 +779,29 @@ class GlassTable {
 	changes_obj = changes;
     }
 
+    /** Set the GlassSyncer object making commits durable.
+     *
+     *  Blocks freed by a revision which isn't durable yet can't be reused
+     *  until it is.  The GlassSyncer object is not owned by the table.
+     */
+    void set_syncer(GlassSyncer * syncer_) {
+	syncer = syncer_;
+    }
+
+    /// Wait until revision @a rev is durable (called by GlassFreeList).
+    void wait_for_sync(glass_revision_number_t rev) const;
+
+    /// Check if revision @a rev is durable (called by GlassFreeList).
+    bool is_synced(glass_revision_number_t rev) const;
+
+    /** Return the file descriptor of the table, or -1 if it isn't open.
+     *
+     *  Used to sync the table from another thread.
+     */
+    int get_fd() const {
+	return handle >= 0 ? handle : -1;
+    }
+
     /// Throw an exception indicating that the database is closed.
     [[noreturn]]
     static void throw_database_closed();
@@ -740,6 +814,9 @@ class GlassTable {
     bool find(Glass::Cursor *) const;
     int delete_kt();
     void read_block(uint4 n, uint8_t *p) const;
+    void read_blocks(size_t count, const uint4 *ns, uint8_t * const *ps) const;
+    bool read_block_from_mapping(uint4 n, uint8_t *p) const;
+    void check_block(uint4 n, const uint8_t *p, BlockCache *cache) const;
     void write_block(uint4 n, const uint8_t *p,
 		     bool appending = false) const;
     [[noreturn]]
@@ -854,6 +931,12 @@ class GlassTable {
      */
     GlassChanges * changes_obj;
 
+    /** The GlassSyncer object making commits durable.
+     *
+     *  If NULL, commits are synced by the writer.
+     */
+    GlassSyncer * syncer = NULL;
+
     bool single_file() const {
 	return name.empty();
     }
@@ -912,6 +995,37 @@ class GlassTable {
     /// offset to start of table in file.
     off_t offset;
 
+    /// True if the UUID for the block cache has been set.
+    bool block_cache_uuid_set;
+
+    /// True if blocks can be shared via the process-wide cache.
+    bool use_block_cache;
+
+    /// Identity of this table in the process-wide cache.
+    BlockCache::FileId block_cache_id;
+
+    /// True if the table file should be memory mapped.
+    bool use_mmap;
+
+    /** The memory mapping of the table file, or NULL.
+     *
+     *  For a single-file database, this maps the whole file.
+     */
+    const char * mapping;
+
+    /// The size of mapping in bytes.
+    size_t mapping_size;
+
+    /** Map the table file, if use_mmap is true.
+     *
+     *  If the file is already mapped but its size has changed, it is mapped
+     *  again.
+     */
+    void map_file();
+
+    /// Remove any mapping of the table file.
+    void unmap_file();
+
     /* Debugging methods */
 //    void report_block_full(int m, int n, const uint8_t * p);
 };
@@ -36,22 +36,20 @@
 using namespace std;
 
 void
-GlassTermListTable::set_termlist(Xapian::docid did,
-				 const Xapian::Document & doc,
-				 Xapian::termcount doclen)
+GlassTermListTable::encode_termlist(string & tag,
+				    const Xapian::Document & doc,
+				    Xapian::termcount doclen)
 {
-    LOGCALL_VOID(DB, "GlassTermListTable::set_termlist", did | doc | doclen);
+    LOGCALL_STATIC_VOID(DB, "GlassTermListTable::encode_termlist", tag | doc | doclen);
 
     Xapian::doccount termlist_size = doc.termlist_count();
     if (termlist_size == 0) {
 	// doclen is sum(wdf) so should be zero if there are no terms.
 	Assert(doclen == 0);
 	Assert(doc.termlist_begin() == doc.termlist_end());
-	add(make_key(did), string());
 	return;
     }
 
-    string tag;
     pack_uint(tag, doclen);
 
     Xapian::TermIterator t = doc.termlist_begin();
@@ -105,5 +103,4 @@ GlassTermListTable::set_termlist(Xapian::docid did,
 	}
     }
     AssertEq(termlist_size, 0);
-    add(make_key(did), tag);
 }
@@ -65,7 +65,32 @@ class GlassTermListTable : public GlassTable {
      *  @param doclen	The document length.
      */
     void set_termlist(Xapian::docid did, const Xapian::Document & doc,
-		      Xapian::termcount doclen);
+		      Xapian::termcount doclen) {
+	std::string tag;
+	encode_termlist(tag, doc, doclen);
+	set_encoded_termlist(did, tag);
+    }
+
+    /** Encode the termlist data for a document.
+     *
+     *  This doesn't access the table, so can be called from any thread.
+     *
+     *  @param tag	The string to append the encoded data to.
+     *  @param doc	The Xapian::Document object to read term data from.
+     *  @param doclen	The document length.
+     */
+    static void encode_termlist(std::string & tag,
+				const Xapian::Document & doc,
+				Xapian::termcount doclen);
+
+    /** Set the termlist data for document @a did to data already encoded.
+     *
+     *  @param did	The docid to set the termlist data for.
+     *  @param tag	The data from encode_termlist().
+     */
+    void set_encoded_termlist(Xapian::docid did, const std::string & tag) {
+	add(make_key(did), tag);
+    }
 
     /** Delete the termlist data for document @a did.
      *
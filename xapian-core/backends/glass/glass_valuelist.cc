@@ -42,6 +42,41 @@ GlassValueList::update_reader()
     return true;
 }
 
+/** Check if a value stream chunk might have a value in [@a lo, @a hi].
+ *
+ *  Returns true if the chunk has no header giving its bounds.
+ */
+static bool
+chunk_in_range(const string& tag, const string& lo, const string& hi)
+{
+    const char * p = tag.data();
+    const char * end = p + tag.size();
+    string lower, upper;
+    if (!decode_valuechunk_header(&p, end, lower, upper))
+	return true;
+    return upper >= lo && (hi.empty() || lower <= hi);
+}
+
+void
+GlassValueList::find_chunk_in_range(const string& lo, const string& hi)
+{
+    while (!cursor->after_end()) {
+	Xapian::docid first_did = docid_from_key(slot, cursor->current_key);
+	if (!first_did) break;
+	cursor->read_tag();
+	const string & tag = cursor->current_tag;
+	if (chunk_in_range(tag, lo, hi)) {
+	    reader.assign(tag.data(), tag.size(), first_did);
+	    return;
+	}
+	cursor->next();
+    }
+
+    // We've reached the end.
+    delete cursor;
+    cursor = NULL;
+}
+
 GlassValueList::~GlassValueList()
 {
     delete cursor;
@@ -162,6 +197,55 @@ GlassValueList::check(Xapian::docid did)
     return true;
 }
 
+void
+GlassValueList::next_in_range(const string& lo, const string& hi)
+{
+    if (!cursor) {
+	cursor = db->get_postlist_cursor();
+	if (!cursor) return;
+	cursor->find_entry_ge(make_valuechunk_key(slot, 1));
+    } else {
+	if (!reader.at_end()) {
+	    reader.next();
+	    if (!reader.at_end()) return;
+	}
+	cursor->next();
+    }
+    find_chunk_in_range(lo, hi);
+}
+
+void
+GlassValueList::skip_to_in_range(Xapian::docid did,
+				 const string& lo, const string& hi)
+{
+    if (!cursor) {
+	cursor = db->get_postlist_cursor();
+	if (!cursor) return;
+    } else if (!reader.at_end()) {
+	reader.skip_to(did);
+	if (!reader.at_end()) return;
+    }
+
+    if (!cursor->find_entry(make_valuechunk_key(slot, did))) {
+	// We're on the chunk which would contain did (or an entry before the
+	// first chunk).
+	Xapian::docid first_did = docid_from_key(slot, cursor->current_key);
+	if (first_did) {
+	    cursor->read_tag();
+	    const string & tag = cursor->current_tag;
+	    if (chunk_in_range(tag, lo, hi)) {
+		reader.assign(tag.data(), tag.size(), first_did);
+		reader.skip_to(did);
+		if (!reader.at_end()) return;
+	    }
+	}
+	cursor->next();
+    }
+
+    // Either an exact match, or in a gap before the start of a chunk.
+    find_chunk_in_range(lo, hi);
+}
+
 string
 GlassValueList::get_description() const
 {
@@ -46,6 +46,12 @@ class GlassValueList : public Xapian::ValueIterator::Internal {
     /// Update @a reader to use the chunk currently pointed to by @a cursor.
     bool update_reader();
 
+    /** Move @a cursor forward to the first chunk which might have a value in
+     *  [@a lo, @a hi], starting with the current entry, and update @a reader
+     *  to use it.
+     */
+    void find_chunk_in_range(const std::string& lo, const std::string& hi);
+
   public:
     GlassValueList(Xapian::valueno slot_,
 		   Xapian::Internal::intrusive_ptr<const GlassDatabase> db_)
@@ -67,6 +73,11 @@ class GlassValueList : public Xapian::ValueIterator::Internal {
 
     bool check(Xapian::docid did);
 
+    void next_in_range(const std::string& lo, const std::string& hi);
+
+    void skip_to_in_range(Xapian::docid did,
+			  const std::string& lo, const std::string& hi);
+
     std::string get_description() const;
 };
 
@@ -74,6 +74,18 @@ ValueChunkReader::assign(const char * p_, size_t len, Xapian::docid did_)
     p = p_;
     end = p_ + len;
     did = did_;
+    if (p != end && *p == '\0') {
+	// Skip the header giving the bounds of the values in the chunk.
+	++p;
+	for (int i = 0; i != 2; ++i) {
+	    size_t bound_len;
+	    if (!unpack_uint(&p, end, &bound_len) ||
+		bound_len > size_t(end - p)) {
+		throw Xapian::DatabaseCorruptError("Bad value chunk header");
+	    }
+	    p += bound_len;
+	}
+    }
     if (!unpack_string(&p, end, value))
 	throw Xapian::DatabaseCorruptError("Failed to unpack first value");
 }
@@ -212,13 +224,30 @@ class ValueUpdater {
 
     Xapian::docid last_allowed_did;
 
+    /// Should chunks have a header giving the bounds of their values?
+    bool chunk_bounds;
+
+    /// The bounds of the values in tag (if chunk_bounds is true).
+    string lower, upper;
+
     void append_to_stream(Xapian::docid did, const string & value) {
 	Assert(did);
 	if (tag.empty()) {
 	    new_first_did = did;
+	    if (chunk_bounds) {
+		lower = value;
+		upper = value;
+	    }
 	} else {
 	    AssertRel(did,>,prev_did);
 	    pack_uint(tag, did - prev_did - 1);
+	    if (chunk_bounds) {
+		if (value < lower) {
+		    lower = value;
+		} else if (value > upper) {
+		    upper = value;
+		}
+	    }
 	}
 	prev_did = did;
 	pack_string(tag, value);
@@ -231,6 +260,8 @@ class ValueUpdater {
 	    table->del(make_valuechunk_key(slot, first_did));
 	}
 	if (!tag.empty()) {
+	    if (chunk_bounds)
+		tag.insert(0, encode_valuechunk_header(lower, upper));
 	    table->add(make_valuechunk_key(slot, new_first_did), tag);
 	}
 	first_did = 0;
@@ -238,8 +269,10 @@ class ValueUpdater {
     }
 
   public:
-    ValueUpdater(GlassPostListTable * table_, Xapian::valueno slot_)
-	: table(table_), slot(slot_), first_did(0), last_allowed_did(0) { }
+    ValueUpdater(GlassPostListTable * table_, Xapian::valueno slot_,
+		 bool chunk_bounds_)
+	: table(table_), slot(slot_), first_did(0), last_allowed_did(0),
+	  chunk_bounds(chunk_bounds_) { }
 
     ~ValueUpdater() {
 	while (!reader.at_end()) {
@@ -338,7 +371,7 @@ GlassValueManager::merge_changes()
 
     for (auto i : changes) {
 	Xapian::valueno slot = i.first;
-	Glass::ValueUpdater updater(postlist_table, slot);
+	Glass::ValueUpdater updater(postlist_table, slot, chunk_bounds);
 	const map<Xapian::docid, string>& slot_changes = i.second;
 	for (auto j : slot_changes) {
 	    updater.update(j.first, j.second);
@@ -64,6 +64,39 @@ docid_from_key(Xapian::valueno required_slot, const std::string & key)
     return did;
 }
 
+/** Encode the header giving the bounds of the values in a value stream chunk.
+ *
+ *  A chunk without a header starts with its first value, which can't be
+ *  empty, so a header starts with a zero byte to distinguish it.
+ */
+inline std::string
+encode_valuechunk_header(const std::string& lower, const std::string& upper)
+{
+    std::string header(1, '\0');
+    pack_string(header, lower);
+    pack_string(header, upper);
+    return header;
+}
+
+/** Decode the header of a value stream chunk, if it has one.
+ *
+ *  On success, @a *p is left pointing to the first value in the chunk.
+ *
+ *  @return false if the chunk doesn't have a header (it was written to a
+ *	    database in the previous format, or copied from one by compaction).
+ */
+inline bool
+decode_valuechunk_header(const char** p, const char* end,
+			 std::string& lower, std::string& upper)
+{
+    if (*p == end || **p != '\0')
+	return false;
+    ++*p;
+    if (!unpack_string(p, end, lower) || !unpack_string(p, end, upper))
+	throw Xapian::DatabaseCorruptError("Bad value chunk header");
+    return true;
+}
+
 }
 
 namespace Xapian {
@@ -93,6 +126,9 @@ class GlassValueManager {
 
     std::map<Xapian::valueno, std::map<Xapian::docid, std::string>> changes;
 
+    /// Should value stream chunks have a header giving their bounds?
+    bool chunk_bounds = false;
+
     mutable std::unique_ptr<GlassCursor> cursor;
 
     void add_value(Xapian::docid did, Xapian::valueno slot,
@@ -117,6 +153,9 @@ class GlassValueManager {
 	  postlist_table(postlist_table_),
 	  termlist_table(termlist_table_) { }
 
+    /// Set whether value stream chunks should have a bounds header.
+    void set_chunk_bounds(bool chunk_bounds_) { chunk_bounds = chunk_bounds_; }
+
     // Merge in batched-up changes.
     void merge_changes();
 
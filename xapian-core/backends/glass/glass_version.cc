@@ -50,7 +50,8 @@
 using namespace std;
 
 /// Glass format version (date of change):
-#define GLASS_FORMAT_VERSION DATE_TO_VERSION(2016,03,14)
+#define GLASS_FORMAT_VERSION DATE_TO_VERSION(2026,10,17)
+// 2026,10,17 1.5.0 value stream chunks can have a header giving their bounds
 // 2016,03,14 1.3.5 compress_min in version file; partly eliminate component_of
 // 2015,12,24 1.3.4 2 bytes "components_of" per item eliminated, and much more
 // 2014,11,21 1.3.2 Brass renamed to Glass
@@ -65,6 +66,13 @@ using namespace std;
 #define GLASS_VERSION_MAGIC_LEN 14
 #define GLASS_VERSION_MAGIC_AND_VERSION_LEN 16
 
+/** The previous glass format version, which we can still read and update.
+ *
+ *  Databases in this format don't have value stream chunk headers, and we
+ *  don't add any, so they can still be used by older versions.
+ */
+#define GLASS_FORMAT_VERSION_NO_CHUNK_BOUNDS DATE_TO_VERSION(2016,03,14)
+
 static const char GLASS_VERSION_MAGIC[GLASS_VERSION_MAGIC_AND_VERSION_LEN] = {
     '\x0f', '\x0d', 'X', 'a', 'p', 'i', 'a', 'n', ' ', 'G', 'l', 'a', 's', 's',
     char((GLASS_FORMAT_VERSION >> 8) & 0xff), char(GLASS_FORMAT_VERSION & 0xff)
@@ -75,7 +83,7 @@ GlassVersion::GlassVersion(int fd_)
       doccount(0), total_doclen(0), last_docid(0),
       doclen_lbound(0), doclen_ubound(0),
       wdf_ubound(0), spelling_wordfreq_ubound(0),
-      oldest_changeset(0)
+      oldest_changeset(0), value_chunk_bounds(true)
 {
     offset = lseek(fd, 0, SEEK_CUR);
     if (rare(offset < 0)) {
@@ -133,7 +141,11 @@ GlassVersion::read()
     version = static_cast<unsigned char>(buf[GLASS_VERSION_MAGIC_LEN]);
     version <<= 8;
     version |= static_cast<unsigned char>(buf[GLASS_VERSION_MAGIC_LEN + 1]);
-    if (version != GLASS_FORMAT_VERSION) {
+    if (version == GLASS_FORMAT_VERSION_NO_CHUNK_BOUNDS) {
+	value_chunk_bounds = false;
+    } else if (version == GLASS_FORMAT_VERSION) {
+	value_chunk_bounds = true;
+    } else {
 	string msg;
 	if (!single_file()) {
 	    msg = db_dir;
@@ -268,12 +280,17 @@ GlassVersion::cancel()
     unserialise_stats();
 }
 
-const string
-GlassVersion::write(glass_revision_number_t new_rev, int flags)
+string
+GlassVersion::serialise_version(glass_revision_number_t new_rev)
 {
-    LOGCALL(DB, const string, "GlassVersion::write", new_rev|flags);
-
     string s(GLASS_VERSION_MAGIC, GLASS_VERSION_MAGIC_AND_VERSION_LEN);
+    if (!value_chunk_bounds) {
+	// Leave the database in the previous format.
+	s[GLASS_VERSION_MAGIC_LEN] =
+	    char((GLASS_FORMAT_VERSION_NO_CHUNK_BOUNDS >> 8) & 0xff);
+	s[GLASS_VERSION_MAGIC_LEN + 1] =
+	    char(GLASS_FORMAT_VERSION_NO_CHUNK_BOUNDS & 0xff);
+    }
     s.append(uuid.data(), uuid.BINARY_SIZE);
 
     pack_uint(s, new_rev);
@@ -285,6 +302,15 @@ GlassVersion::write(glass_revision_number_t new_rev, int flags)
     // Serialise database statistics.
     serialise_stats();
     s += serialised_stats;
+    return s;
+}
+
+const string
+GlassVersion::write(glass_revision_number_t new_rev, int flags)
+{
+    LOGCALL(DB, const string, "GlassVersion::write", new_rev|flags);
+
+    string s = serialise_version(new_rev);
 
     string tmpfile;
     if (!single_file()) {
@@ -387,12 +413,19 @@ GlassVersion::sync(const string & tmpfile,
 	}
     }
 
+    set_committed(new_rev);
+    return true;
+}
+
+void
+GlassVersion::set_committed(glass_revision_number_t new_rev)
+{
+    Assert(new_rev > rev || rev == 0);
     for (unsigned table_no = 0; table_no < Glass::MAX_; ++table_no) {
 	old_root[table_no] = root[table_no];
     }
 
     rev = new_rev;
-    return true;
 }
 
 /* Only try to compress tags strictly longer than this many bytes.
@@ -418,6 +451,7 @@ GlassVersion::create(unsigned blocksize)
 {
     AssertRel(blocksize,>=,GLASS_MIN_BLOCKSIZE);
     uuid.generate();
+    value_chunk_bounds = true;
     for (unsigned table_no = 0; table_no < Glass::MAX_; ++table_no) {
 	root[table_no].init(blocksize, compress_min_tab[table_no]);
     }
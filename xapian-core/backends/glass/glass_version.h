@@ -147,6 +147,13 @@ class GlassVersion {
     /// Oldest changeset removed when max_changesets is set
     mutable glass_revision_number_t oldest_changeset;
 
+    /** Can value stream chunks have a header giving their bounds?
+     *
+     *  False for a database in the previous format, which we leave in that
+     *  format so older versions can still use it.
+     */
+    bool value_chunk_bounds;
+
     /// The serialised database stats.
     std::string serialised_stats;
 
@@ -162,7 +169,7 @@ class GlassVersion {
 	  doccount(0), total_doclen(0), last_docid(0),
 	  doclen_lbound(0), doclen_ubound(0),
 	  wdf_ubound(0), spelling_wordfreq_ubound(0),
-	  oldest_changeset(0) { }
+	  oldest_changeset(0), value_chunk_bounds(true) { }
 
     explicit GlassVersion(int fd_);
 
@@ -186,8 +193,28 @@ class GlassVersion {
     bool sync(const std::string & tmpfile,
 	      glass_revision_number_t new_rev, int flags);
 
+    /** Return the contents of the version file for revision @a new_rev.
+     *
+     *  Used instead of write() when the version file is written by
+     *  GlassSyncer.
+     */
+    std::string serialise_version(glass_revision_number_t new_rev);
+
+    /** Record that revision @a new_rev has been committed.
+     *
+     *  sync() does this, so this is only needed when the version file is
+     *  written by GlassSyncer.
+     */
+    void set_committed(glass_revision_number_t new_rev);
+
+    /// Is a changeset being written for the next revision?
+    bool writing_changeset() const { return changes != NULL; }
+
     glass_revision_number_t get_revision() const { return rev; }
 
+    /// Should value stream chunks we write have a header giving their bounds?
+    bool get_value_chunk_bounds() const { return value_chunk_bounds; }
+
     const RootInfo & get_root(Glass::table_type tbl) const {
 	return root[tbl];
     }
@@ -28,6 +28,7 @@
 
 #include <algorithm>
 #include <memory>
+#include <mutex>
 #include <queue>
 #include <type_traits>
 
@@ -46,6 +47,7 @@
 #include "filetests.h"
 #include "internaltypes.h"
 #include "pack.h"
+#include "parallelfor.h"
 #include "backends/valuestats.h"
 #include "wordaccess.h"
 
@@ -96,6 +98,12 @@ is_valuechunk_key(const string& key)
     return key.size() > 1 && key[0] == '\0' && key[1] == '\xd8';
 }
 
+static inline bool
+is_valuebounds_key(const string& key)
+{
+    return key.size() > 1 && key[0] == '\0' && key[1] == '\xd9';
+}
+
 static inline bool
 is_doclenchunk_key(const string& key)
 {
@@ -162,6 +170,7 @@ class PostlistCursor<const GlassTable&> : private GlassCursor {
     Xapian::termcount tf, cf;
     Xapian::termcount first_wdf;
     Xapian::termcount wdf_max;
+    Xapian::termcount chunk_wdf_max;
     bool have_wdfs;
 
     PostlistCursor(const GlassTable* in, Xapian::docid offset_)
@@ -171,7 +180,10 @@ class PostlistCursor<const GlassTable&> : private GlassCursor {
     }
 
     bool next() {
-	if (!GlassCursor::next()) return false;
+	do {
+	    if (!GlassCursor::next()) return false;
+	    // Honey stores the bounds of a value chunk in the chunk itself.
+	} while (GlassCompact::is_valuebounds_key(current_key));
 	// We put all chunks into the non-initial chunk form here, then fix up
 	// the first chunk for each term in the merged database as we merge.
 	read_tag();
@@ -221,18 +233,34 @@ class PostlistCursor<const GlassTable&> : private GlassCursor {
 		throw Xapian::DatabaseCorruptError("bad value key");
 	    first_did += offset;
 
+	    // Drop any glass chunk header, as we add a honey one below.
+	    const char* t = tag.data();
+	    string lower, upper;
+	    if (Glass::decode_valuechunk_header(&t, t + tag.size(),
+						lower, upper)) {
+		tag.erase(0, t - tag.data());
+	    }
+
 	    Glass::ValueChunkReader reader(tag.data(), tag.size(), first_did);
 	    Xapian::docid last_did = first_did;
+	    lower = reader.get_value();
+	    upper = lower;
 	    while (reader.next(), !reader.at_end()) {
 		last_did = reader.get_docid();
+		const string& value = reader.get_value();
+		if (value < lower) {
+		    lower = value;
+		} else if (value > upper) {
+		    upper = value;
+		}
 	    }
 
 	    key = Honey::make_valuechunk_key(slot, last_did);
 
-	    // Add the docid delta across the chunk to the start of the tag.
-	    string newtag;
-	    pack_uint(newtag, last_did - first_did);
-	    tag.insert(0, newtag);
+	    // Add the docid delta across the chunk and the bounds of its values
+	    // to the start of the tag.
+	    tag.insert(0, Honey::encode_valuechunk_header(last_did - first_did,
+							  lower, upper));
 
 	    return true;
 	}
@@ -404,7 +432,7 @@ class PostlistCursor<const GlassTable&> : private GlassCursor {
 	    throw Xapian::DatabaseError("Honey does not support a term having "
 					"both zero and non-zero wdf");
 	}
-	wdf_max = max(wdf_max, first_wdf);
+	chunk_wdf_max = first_wdf;
 
 	while (d != e) {
 	    Xapian::docid delta;
@@ -429,9 +457,10 @@ class PostlistCursor<const GlassTable&> : private GlassCursor {
 	    }
 	    if (have_wdfs) {
 		pack_uint(newtag, wdf);
-		wdf_max = max(wdf_max, wdf);
+		chunk_wdf_max = max(chunk_wdf_max, wdf);
 	    }
 	}
+	wdf_max = max(wdf_max, chunk_wdf_max);
 
 	swap(tag, newtag);
 
@@ -444,6 +473,27 @@ template<>
 class PostlistCursor<const HoneyTable&> : private HoneyCursor {
     Xapian::docid offset;
 
+    /// Are the postings for the current term encoded using Stream VByte?
+    bool stream_vbyte = false;
+
+    /// Convert Stream VByte encoded postings in tag to the default encoding.
+    void convert_from_stream_vbyte() {
+	vector<uint32_t> deltas, wdfs;
+	const char* d = tag.data();
+	const char* e = d + tag.size();
+	if (!decode_postings_stream_vbyte(&d, e, have_wdfs, deltas, wdfs)) {
+	    throw Xapian::DatabaseCorruptError("Bad postlist Stream VByte "
+					       "data");
+	}
+	string newtag;
+	for (size_t i = 0; i != deltas.size(); ++i) {
+	    pack_uint(newtag, deltas[i]);
+	    if (have_wdfs)
+		pack_uint(newtag, wdfs[i]);
+	}
+	swap(tag, newtag);
+    }
+
   public:
     string key, tag;
     Xapian::docid firstdid;
@@ -451,6 +501,7 @@ class PostlistCursor<const HoneyTable&> : private HoneyCursor {
     Xapian::termcount tf, cf;
     Xapian::termcount first_wdf;
     Xapian::termcount wdf_max;
+    Xapian::termcount chunk_wdf_max;
     bool have_wdfs;
 
     PostlistCursor(const HoneyTable* in, Xapian::docid offset_)
@@ -521,13 +572,11 @@ class PostlistCursor<const HoneyTable&> : private HoneyCursor {
 	    Xapian::docid lastdid;
 	    if (!decode_initial_chunk_header(&d, e, tf, cf,
 					     firstdid, lastdid, chunk_lastdid,
-					     first_wdf, wdf_max)) {
+					     first_wdf, wdf_max,
+					     chunk_wdf_max, stream_vbyte)) {
 		throw Xapian::DatabaseCorruptError("Bad postlist initial "
 						   "chunk header");
 	    }
-	    // Ignore lastdid - we'll need to recalculate it (at least when
-	    // merging, and for simplicity we always do).
-	    (void)lastdid;
 	    tag.erase(0, d - tag.data());
 
 	    have_wdfs = (cf != 0) && (cf != tf - 1 + first_wdf);
@@ -542,6 +591,16 @@ class PostlistCursor<const HoneyTable&> : private HoneyCursor {
 		    have_wdfs = false;
 		}
 	    }
+	    if (tf == 2) {
+		// The second posting is only implied by the header, so add
+		// it to the postings as the merge may append more after it.
+		pack_uint(tag, lastdid - firstdid - 1);
+		if (have_wdfs)
+		    pack_uint(tag, cf - first_wdf);
+	    }
+	    // Otherwise ignore lastdid - we'll need to recalculate it (at
+	    // least when merging, and for simplicity we always do).
+	    if (stream_vbyte) convert_from_stream_vbyte();
 	} else {
 	    if (cf > 0) {
 		// The cf we report should only be non-zero for initial chunks
@@ -572,7 +631,7 @@ class PostlistCursor<const HoneyTable&> : private HoneyCursor {
 
 	    if (have_wdfs) {
 		if (!decode_delta_chunk_header(&d, e, chunk_lastdid, firstdid,
-					       first_wdf)) {
+					       first_wdf, chunk_wdf_max)) {
 		    throw Xapian::DatabaseCorruptError("Bad postlist delta "
 						       "chunk header");
 		}
@@ -582,8 +641,11 @@ class PostlistCursor<const HoneyTable&> : private HoneyCursor {
 		    throw Xapian::DatabaseCorruptError("Bad postlist delta "
 						       "chunk header");
 		}
+		// The wdf is the same for every entry in this chunk.
+		chunk_wdf_max = first_wdf;
 	    }
 	    tag.erase(0, d - tag.data());
+	    if (stream_vbyte) convert_from_stream_vbyte();
 	}
 	firstdid += offset;
 	chunk_lastdid += offset;
@@ -614,7 +676,7 @@ class PostlistCursorGt {
 template<typename T, typename U> void
 merge_postlists(Xapian::Compactor* compactor,
 		T* out, vector<Xapian::docid>::const_iterator offset,
-		U b, U e)
+		U b, U e, bool stream_vbyte)
 {
     typedef decltype(**b) table_type; // E.g. HoneyTable
     typedef PostlistCursor<table_type> cursor_type;
@@ -844,6 +906,7 @@ merge_postlists(Xapian::Compactor* compactor,
 	Xapian::docid first, last;
 	Xapian::termcount first_wdf;
 	Xapian::termcount wdf_max;
+	Xapian::termcount chunk_wdf_max;
 	Xapian::doccount tf;
 	Xapian::termcount cf;
 	bool have_wdfs;
@@ -853,6 +916,7 @@ merge_postlists(Xapian::Compactor* compactor,
 			   Xapian::docid last_,
 			   Xapian::termcount first_wdf_,
 			   Xapian::termcount wdf_max_,
+			   Xapian::termcount chunk_wdf_max_,
 			   Xapian::doccount tf_,
 			   Xapian::termcount cf_,
 			   bool have_wdfs_,
@@ -861,6 +925,7 @@ merge_postlists(Xapian::Compactor* compactor,
 	      last(last_),
 	      first_wdf(first_wdf_),
 	      wdf_max(wdf_max_),
+	      chunk_wdf_max(chunk_wdf_max_),
 	      tf(tf_),
 	      cf(cf_),
 	      have_wdfs(have_wdfs_),
@@ -872,8 +937,9 @@ merge_postlists(Xapian::Compactor* compactor,
 		// We can just copy the encoded data.
 		tag += data;
 	    } else if (want_wdfs) {
-		// Need to add wdfs which were implicit.
-		auto wdf = (cf - first_wdf) / (tf - 1);
+		// Need to add wdfs which were implicit.  For a non-initial
+		// chunk the cursor sets first_wdf to the flat wdf.
+		auto wdf = tf ? (cf - first_wdf) / (tf - 1) : first_wdf;
 		const char* pos = data.data();
 		const char* pos_end = pos + data.size();
 		while (pos != pos_end) {
@@ -947,6 +1013,7 @@ merge_postlists(Xapian::Compactor* compactor,
 		    }
 		}
 
+		Xapian::termcount chunk_wdf_max = tags[0].chunk_wdf_max;
 		Xapian::docid splice_last = 0;
 		if (!have_wdfs && tags[0].have_wdfs && tf > 2 &&
 		    tags.size() > 1) {
@@ -954,20 +1021,38 @@ merge_postlists(Xapian::Compactor* compactor,
 		    // double up the chunks.
 		    splice_last = chunk_lastdid;
 		    chunk_lastdid = tags[1].last;
+		    chunk_wdf_max = max(chunk_wdf_max, tags[1].chunk_wdf_max);
 		}
 
+		// Stream VByte stores values in at most 32 bits, which docid
+		// deltas and wdfs can only exceed with 64-bit types.
+		bool use_stream_vbyte =
+		    stream_vbyte && tf > 2 &&
+		    (uint64_t(last_did - tags[0].first) >> 32) == 0 &&
+		    (uint64_t(wdf_max) >> 32) == 0;
+
 		string first_tag;
 		encode_initial_chunk_header(tf, cf, tags[0].first, last_did,
 					    chunk_lastdid,
-					    first_wdf, wdf_max, first_tag);
-
+					    first_wdf, wdf_max, chunk_wdf_max,
+					    use_stream_vbyte,
+					    first_tag);
+
+		// Postings get built in the default encoding, and converted
+		// afterwards if we're using Stream VByte.
+		string postings;
+		string& postings_out = use_stream_vbyte ? postings : first_tag;
 		if (tf > 2) {
-		    tags[0].append_postings_to(first_tag, have_wdfs);
+		    tags[0].append_postings_to(postings_out, have_wdfs);
 		    if (!have_wdfs && splice_last) {
-			pack_uint(first_tag, tags[1].first - splice_last);
-			tags[1].append_postings_to(first_tag, have_wdfs);
+			pack_uint(postings_out,
+				  tags[1].first - splice_last - 1);
+			tags[1].append_postings_to(postings_out, have_wdfs);
 		    }
 		}
+		if (use_stream_vbyte)
+		    encode_postings_stream_vbyte(postings, have_wdfs,
+						 first_tag);
 		out->add(last_key, first_tag);
 
 		// If tf == 2, the data could be split over two tags when
@@ -990,12 +1075,16 @@ merge_postlists(Xapian::Compactor* compactor,
 		    while (++i != tags.end()) {
 			last_did = i->last;
 			string tag;
+			postings.resize(0);
+			string& chunk_out =
+			    use_stream_vbyte ? postings : tag;
 			if (have_wdfs) {
 			    encode_delta_chunk_header(i->first,
 						      last_did,
 						      i->first_wdf,
+						      i->chunk_wdf_max,
 						      tag);
-			    tag += i->data;
+			    i->append_postings_to(chunk_out, have_wdfs);
 			} else {
 			    if (i->have_wdfs && i + 1 != tags.end()) {
 				splice_last = last_did;
@@ -1005,14 +1094,18 @@ merge_postlists(Xapian::Compactor* compactor,
 			    encode_delta_chunk_header_no_wdf(i->first,
 							     last_did,
 							     tag);
-			    tag += i->data;
+			    i->append_postings_to(chunk_out, have_wdfs);
 			    if (splice_last) {
 				++i;
-				pack_uint(tag, i->first - splice_last);
+				pack_uint(chunk_out,
+					  i->first - splice_last - 1);
 				splice_last = 0;
-				tag += i->data;
+				i->append_postings_to(chunk_out, have_wdfs);
 			    }
 			}
+			if (use_stream_vbyte)
+			    encode_postings_stream_vbyte(postings, have_wdfs,
+							 tag);
 
 			out->add(pack_honey_postlist_key(term, last_did), tag);
 		    }
@@ -1038,6 +1131,7 @@ merge_postlists(Xapian::Compactor* compactor,
 					  cur->chunk_lastdid,
 					  cur->first_wdf,
 					  cur->wdf_max,
+					  cur->chunk_wdf_max,
 					  cur->tf,
 					  cur->cf,
 					  cur->have_wdfs,
@@ -1487,10 +1581,12 @@ template<typename T, typename U> void
 multimerge_postlists(Xapian::Compactor* compactor,
 		     T* out, const char* tmpdir,
 		     const vector<U*>& in,
-		     vector<Xapian::docid> off)
+		     vector<Xapian::docid> off,
+		     bool stream_vbyte)
 {
     if (in.size() <= 3) {
-	merge_postlists(compactor, out, off.begin(), in.begin(), in.end());
+	merge_postlists(compactor, out, off.begin(), in.begin(), in.end(),
+			stream_vbyte);
 	return;
     }
     unsigned int c = 0;
@@ -1519,7 +1615,7 @@ multimerge_postlists(Xapian::Compactor* compactor,
 	    tmptab->create_and_open(flags, root_info);
 
 	    merge_postlists(compactor, tmptab, off.begin() + i,
-			    in.begin() + i, in.begin() + j);
+			    in.begin() + i, in.begin() + j, false);
 	    tmp.push_back(tmptab);
 	    tmptab->flush_db();
 	    tmptab->commit(1, &root_info);
@@ -1553,7 +1649,7 @@ multimerge_postlists(Xapian::Compactor* compactor,
 	    tmptab->create_and_open(flags, root_info);
 
 	    merge_postlists(compactor, tmptab, off.begin() + i,
-			    tmp.begin() + i, tmp.begin() + j);
+			    tmp.begin() + i, tmp.begin() + j, false);
 	    if (c > 0) {
 		for (unsigned int k = i; k < j; ++k) {
 		    // FIXME: unlink(tmp[k]->get_path().c_str());
@@ -1569,7 +1665,8 @@ multimerge_postlists(Xapian::Compactor* compactor,
 	swap(off, newoff);
 	++c;
     }
-    merge_postlists(compactor, out, off.begin(), tmp.begin(), tmp.end());
+    merge_postlists(compactor, out, off.begin(), tmp.begin(), tmp.end(),
+		    stream_vbyte);
     if (c > 0) {
 	for (size_t k = 0; k < tmp.size(); ++k) {
 	    // FIXME: unlink(tmp[k]->get_path().c_str());
@@ -1979,6 +2076,7 @@ HoneyDatabase::compact(Xapian::Compactor* compactor,
 
     bool single_file = (flags & Xapian::DBCOMPACT_SINGLE_FILE);
     bool multipass = (flags & Xapian::DBCOMPACT_MULTIPASS);
+    bool stream_vbyte = (flags & Xapian::DBCOMPACT_STREAM_VBYTE);
     if (single_file) {
 	// FIXME: Support this combination - we need to put temporary files
 	// somewhere.
@@ -2037,6 +2135,15 @@ HoneyDatabase::compact(Xapian::Compactor* compactor,
     bool bad_totals = false;
     off_t in_total = 0, out_total = 0;
 
+    // Each table is compacted independently, so we can compact them in
+    // parallel, except for single file output where they're written one
+    // after another.
+    unsigned n_threads = compactor ? compactor->get_threads() : 1;
+    if (single_file) n_threads = 1;
+    // Protects tabs, the totals and the unique term bounds when compacting
+    // tables in parallel.
+    mutex totals_mutex;
+
     version_file_out->create();
     for (size_t i = 0; i != sources.size(); ++i) {
 	bool source_single_file = false;
@@ -2098,7 +2205,8 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
     vector<HoneyTable*> tabs;
     tabs.reserve(tables_end - tables);
     off_t prev_size = 0;
-    for (const table_list* t = tables; t < tables_end; ++t) {
+    parallel_for(tables_end - tables, n_threads, [&](size_t i) {
+	const table_list* t = tables + i;
 	// The postlist table requires an N-way merge, adjusting the
 	// headers of various blocks.  The spelling and synonym tables also
 	// need special handling.  The other tables have keys sorted in
@@ -2172,12 +2280,14 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
 		off_t db_size = file_size(table->get_path());
 		if (errno == 0) {
 		    // FIXME: check overflow and set bad_totals
+		    lock_guard<mutex> totals_lock(totals_mutex);
 		    in_total += db_size;
 		    in_size += db_size / 1024;
 		    output_will_exist = true;
 		    ++inputs_present;
 		} else if (errno != ENOENT) {
 		    // We get ENOENT for an optional table.
+		    lock_guard<mutex> totals_lock(totals_mutex);
 		    bad_totals = bad_stat = true;
 		    output_will_exist = true;
 		    ++inputs_present;
@@ -2196,7 +2306,7 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
 		    m += " inputs present, so suppressing output";
 		    compactor->set_status(t->name, m);
 		}
-		continue;
+		return;
 	    }
 	    output_will_exist = false;
 	}
@@ -2204,7 +2314,7 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
 	if (!output_will_exist) {
 	    if (compactor)
 		compactor->set_status(t->name, "doesn't exist");
-	    continue;
+	    return;
 	}
 
 	HoneyTable* out;
@@ -2225,7 +2335,10 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
 	} else {
 	    out = new HoneyTable(t->name, dest, false, t->lazy);
 	}
-	tabs.push_back(out);
+	{
+	    lock_guard<mutex> totals_lock(totals_mutex);
+	    tabs.push_back(out);
+	}
 	Honey::RootInfo* root_info = version_file_out->root_to_set(t->type);
 	if (single_file) {
 	    root_info->set_free_list(fl_serialised);
@@ -2241,10 +2354,11 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
 	    case Honey::POSTLIST: {
 		if (multipass && inputs.size() > 3) {
 		    multimerge_postlists(compactor, out, destdir,
-					 inputs, offset);
+					 inputs, offset, stream_vbyte);
 		} else {
 		    merge_postlists(compactor, out, offset.begin(),
-				    inputs.begin(), inputs.end());
+				    inputs.begin(), inputs.end(),
+				    stream_vbyte);
 		}
 		break;
 	    }
@@ -2260,11 +2374,19 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
 	    default: {
 		// DocData, Termlist
 		auto& v_out = version_file_out;
-		auto ut_lb = v_out->get_unique_terms_lower_bound();
-		auto ut_ub = v_out->get_unique_terms_upper_bound();
+		Xapian::termcount ut_lb, ut_ub;
+		{
+		    lock_guard<mutex> totals_lock(totals_mutex);
+		    ut_lb = v_out->get_unique_terms_lower_bound();
+		    ut_ub = v_out->get_unique_terms_upper_bound();
+		}
 		merge_docid_keyed(out, inputs, offset, ut_lb, ut_ub, t->type);
-		version_file_out->set_unique_terms_lower_bound(ut_lb);
-		version_file_out->set_unique_terms_upper_bound(ut_ub);
+		// Only the termlist table has the unique term counts in.
+		if (t->type == Honey::TERMLIST) {
+		    lock_guard<mutex> totals_lock(totals_mutex);
+		    v_out->set_unique_terms_lower_bound(ut_lb);
+		    v_out->set_unique_terms_upper_bound(ut_ub);
+		}
 		break;
 	    }
 	}
@@ -2290,9 +2412,11 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
 		    db_size -= old_prev_size;
 		}
 		// FIXME: check overflow and set bad_totals
+		lock_guard<mutex> totals_lock(totals_mutex);
 		out_total += db_size;
 		out_size = db_size / 1024;
 	    } else if (errno != ENOENT) {
+		lock_guard<mutex> totals_lock(totals_mutex);
 		bad_totals = bad_stat = true;
 	    }
 	}
@@ -2332,7 +2456,7 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
 	    if (compactor)
 		compactor->set_status(t->name, status);
 	}
-    }
+    });
 
     // If compacting to a single file output and all the tables are empty, pad
     // the output so that it isn't mistaken for a stub database when we try to
@@ -2383,7 +2507,8 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
     vector<HoneyTable*> tabs;
     tabs.reserve(tables_end - tables);
     off_t prev_size = HONEY_MIN_DB_SIZE;
-    for (const table_list* t = tables; t < tables_end; ++t) {
+    parallel_for(tables_end - tables, n_threads, [&](size_t i) {
+	const table_list* t = tables + i;
 	// The postlist table requires an N-way merge, adjusting the
 	// headers of various blocks.  The spelling and synonym tables also
 	// need special handling.  The other tables have keys sorted in
@@ -2457,12 +2582,14 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
 		off_t db_size = file_size(table->get_path());
 		if (errno == 0) {
 		    // FIXME: check overflow and set bad_totals
+		    lock_guard<mutex> totals_lock(totals_mutex);
 		    in_total += db_size;
 		    in_size += db_size / 1024;
 		    output_will_exist = true;
 		    ++inputs_present;
 		} else if (errno != ENOENT) {
 		    // We get ENOENT for an optional table.
+		    lock_guard<mutex> totals_lock(totals_mutex);
 		    bad_totals = bad_stat = true;
 		    output_will_exist = true;
 		    ++inputs_present;
@@ -2481,7 +2608,7 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
 		    m += " inputs present, so suppressing output";
 		    compactor->set_status(t->name, m);
 		}
-		continue;
+		return;
 	    }
 	    output_will_exist = false;
 	}
@@ -2489,7 +2616,7 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
 	if (!output_will_exist) {
 	    if (compactor)
 		compactor->set_status(t->name, "doesn't exist");
-	    continue;
+	    return;
 	}
 
 	HoneyTable* out;
@@ -2510,7 +2637,10 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
 	} else {
 	    out = new HoneyTable(t->name, dest, false, t->lazy);
 	}
-	tabs.push_back(out);
+	{
+	    lock_guard<mutex> totals_lock(totals_mutex);
+	    tabs.push_back(out);
+	}
 	Honey::RootInfo* root_info = version_file_out->root_to_set(t->type);
 	if (single_file) {
 	    root_info->set_free_list(fl_serialised);
@@ -2526,10 +2656,11 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
 	    case Honey::POSTLIST: {
 		if (multipass && inputs.size() > 3) {
 		    multimerge_postlists(compactor, out, destdir,
-					 inputs, offset);
+					 inputs, offset, stream_vbyte);
 		} else {
 		    merge_postlists(compactor, out, offset.begin(),
-				    inputs.begin(), inputs.end());
+				    inputs.begin(), inputs.end(),
+				    stream_vbyte);
 		}
 		break;
 	    }
@@ -2569,9 +2700,11 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
 		    db_size -= old_prev_size;
 		}
 		// FIXME: check overflow and set bad_totals
+		lock_guard<mutex> totals_lock(totals_mutex);
 		out_total += db_size;
 		out_size = db_size / 1024;
 	    } else if (errno != ENOENT) {
+		lock_guard<mutex> totals_lock(totals_mutex);
 		bad_totals = bad_stat = true;
 	    }
 	}
@@ -2611,7 +2744,7 @@ if (source_backend == Xapian::DB_BACKEND_GLASS) {
 	    if (compactor)
 		compactor->set_status(t->name, status);
 	}
-    }
+    });
 
     // If compacting to a single file output and all the tables are empty, pad
     // the output so that it isn't mistaken for a stub database when we try to
@@ -113,6 +113,7 @@ HoneyCursor::next_from_index()
     if (p != end) abort();
     current_compressed = val_size & 1;
     val_size >>= 1;
+    direct_tag = NULL;
 
     // FIXME: Always resize to 0?  Not doing so avoids always having to clear
     // all the data before reading it.
@@ -126,6 +127,11 @@ HoneyCursor::next_from_index()
 bool
 HoneyCursor::read_tag(bool keep_compressed)
 {
+    if (direct_tag) {
+	// read_tag_data() read the tag without copying it.
+	current_tag.assign(direct_tag, direct_tag_len);
+	direct_tag = NULL;
+    }
     if (val_size) {
 	if (store.was_forced_closed()) {
 	    HoneyTable::throw_database_closed();
@@ -166,6 +172,29 @@ HoneyCursor::read_tag(bool keep_compressed)
     return current_compressed;
 }
 
+void
+HoneyCursor::read_tag_data(const char*& p, size_t& len)
+{
+    if (!direct_tag && val_size && !current_compressed) {
+	if (store.was_forced_closed()) {
+	    HoneyTable::throw_database_closed();
+	}
+	direct_tag = store.read_direct(val_size);
+	if (direct_tag) {
+	    direct_tag_len = val_size;
+	    val_size = 0;
+	}
+    }
+    if (direct_tag) {
+	p = direct_tag;
+	len = direct_tag_len;
+	return;
+    }
+    (void)read_tag();
+    p = current_tag.data();
+    len = current_tag.size();
+}
+
 bool
 HoneyCursor::do_find(const string& key, bool greater_than)
 {
@@ -207,154 +236,38 @@ HoneyCursor::do_find(const string& key, bool greater_than)
 	switch (index_type) {
 	    case EOF:
 		return false;
-	    case 0x00: {
-		unsigned char first = key[0] - store.read();
-		unsigned char range = store.read();
-		if (first > range) {
-		    is_at_end = true;
-		    return false;
-		}
-		store.skip(first * 4); // FIXME: pointer width
-		off_t jump = store.read_uint4_be();
-		store.rewind(jump);
-		// The jump point will be an entirely new key (because it is
-		// the first key with that initial character), and we drop in
-		// as if this was the first key so set last_key to be empty.
-		last_key = string();
-		break;
-	    }
+	    case 0x00:
 	    case 0x01: {
-		size_t j = store.read_uint4_be();
-		if (j == 0) {
+		off_t jump, next_jump;
+		if (!SSTIndex::find(store, index_type, key, jump, last_key,
+				    next_jump)) {
 		    is_at_end = true;
 		    return false;
 		}
-		off_t base = store.get_pos();
-		char kkey[SSTINDEX_BINARY_CHOP_KEY_SIZE];
-		size_t kkey_len = 0;
-		size_t i = 0;
-		while (j - i > 1) {
-		    size_t k = i + (j - i) / 2;
-		    store.set_pos(base + k * SSTINDEX_BINARY_CHOP_ENTRY_SIZE);
-		    store.read(kkey, SSTINDEX_BINARY_CHOP_KEY_SIZE);
-		    kkey_len = 4;
-		    while (kkey_len > 0 && kkey[kkey_len - 1] == '\0')
-			--kkey_len;
-		    int r = key.compare(0, SSTINDEX_BINARY_CHOP_KEY_SIZE,
-					kkey, kkey_len);
-		    if (r < 0) {
-			j = k;
-		    } else {
-			i = k;
-			if (r == 0) {
-			    break;
-			}
-		    }
-		}
-		store.set_pos(base + i * SSTINDEX_BINARY_CHOP_ENTRY_SIZE);
-		store.read(kkey, SSTINDEX_BINARY_CHOP_KEY_SIZE);
-		kkey_len = 4;
-		while (kkey_len > 0 && kkey[kkey_len - 1] == '\0') --kkey_len;
-		off_t jump = store.read_uint4_be();
 		store.rewind(jump);
-		// The jump point is to the first key with prefix kkey, so will
-		// work if we set last key to kkey.  Unless we're jumping to the
-		// start of the table, in which case last_key needs to be empty.
-		last_key.assign(kkey, jump == 0 ? 0 : kkey_len);
 		break;
 	    }
 	    case 0x02: {
-		// FIXME: If "close" just seek forwards?  Or consider seeking
-		// from current index pos?
-		// off_t pos = store.get_pos();
-		string index_key, prev_index_key;
-		make_unsigned<off_t>::type ptr = 0;
-		int cmp0 = 1;
-#ifdef DEBUGGING
-		{
-		    cerr << "Using skiplist index\n";
-		}
-#endif
-		while (true) {
-		    int reuse = store.read();
-		    if (reuse == EOF) break;
-		    int len = store.read();
-		    if (len == EOF) abort(); // FIXME
-#ifdef DEBUGGING
-		    {
-			cerr << "reuse = " << reuse << " len = " << len << endl;
-		    }
-#endif
-		    index_key.resize(reuse + len);
-		    store.read(&index_key[reuse], len);
-
-#ifdef DEBUGGING
-		    {
-			string desc;
-			description_append(desc, index_key);
-			cerr << "Index key: " << desc << endl;
-		    }
-#endif
-
-		    cmp0 = index_key.compare(key);
-		    if (cmp0 > 0) {
-			index_key = prev_index_key;
-			break;
-		    }
-		    char buf[8];
-		    char* e = buf;
-		    while (true) {
-			int b = store.read();
-			*e++ = b;
-			if ((b & 0x80) == 0) break;
-		    }
-		    const char* p = buf;
-		    if (!unpack_uint(&p, e, &ptr) || p != e) abort(); // FIXME
-#ifdef DEBUGGING
-		    {
-			cerr << " -> " << ptr << endl;
-		    }
-#endif
-		    if (cmp0 == 0)
-			break;
-		    prev_index_key = index_key;
-#ifdef DEBUGGING
-		    {
-			string desc;
-			description_append(desc, prev_index_key);
-			cerr << "prev_index_key -> " << desc << endl;
-		    }
-#endif
-		}
-#ifdef DEBUGGING
-		{
-		    string desc;
-		    description_append(desc, index_key);
-		    cerr << " index_key = " << desc << ", cmp0 = " << cmp0
-			 << ", going to " << ptr << endl;
-		}
-#endif
+		off_t ptr, next_ptr;
+		bool exact = SSTIndex::find_in_skiplist(store, key, ptr,
+							 last_key, next_ptr);
 		store.set_pos(ptr);
+		current_key = last_key;
 
 		if (ptr != 0) {
-		    last_key = current_key = index_key;
 		    bool res = next_from_index();
 		    (void)res;
 		    Assert(res);
-		    if (cmp0 == 0) {
-			Assert(ptr != 0);
+		    if (exact)
 			return true;
-		    }
 		    store.skip(val_size);
-		} else {
-		    last_key = current_key = string();
 		}
 
 #ifdef DEBUGGING
 		{
 		    string desc;
 		    description_append(desc, current_key);
-		    cerr << "cmp0 was " << cmp0
+		    cerr << "exact was " << exact
 			 << ", Dropped to data layer on key: " << desc << endl;
 		}
 #endif
@@ -369,6 +282,7 @@ HoneyCursor::do_find(const string& key, bool greater_than)
 	}
 	is_at_end = false;
 	val_size = 0;
+	direct_tag = NULL;
     }
 
     while (do_next()) {
@@ -421,6 +335,7 @@ HoneyCursor::prev()
     last_key = current_key = k;
     val_size = vs;
     current_compressed = compressed;
+    direct_tag = NULL;
     store.set_pos(pos);
 
     return true;
@@ -43,6 +43,15 @@ class HoneyCursor {
     std::string current_key, current_tag;
     mutable size_t val_size = 0;
     bool current_compressed = false;
+
+    /** The current tag if read_tag_data() read it from a memory mapping.
+     *
+     *  NULL if the tag hasn't been read like that.
+     */
+    const char* direct_tag = NULL;
+
+    /// The length of direct_tag.
+    size_t direct_tag_len = 0;
     mutable CompressionStream comp_stream;
     bool is_at_end = false;
     mutable std::string last_key;
@@ -69,6 +78,8 @@ class HoneyCursor {
 	  current_tag(o.current_tag), // FIXME really copy?
 	  val_size(o.val_size),
 	  current_compressed(o.current_compressed),
+	  direct_tag(o.direct_tag),
+	  direct_tag_len(o.direct_tag_len),
 	  comp_stream(Z_DEFAULT_STRATEGY),
 	  is_at_end(o.is_at_end),
 	  last_key(o.last_key),
@@ -87,6 +98,7 @@ class HoneyCursor {
 	current_key = last_key = std::string();
 	is_at_end = false;
 	val_size = 0;
+	direct_tag = NULL;
     }
 
     void to_end() { is_at_end = true; }
@@ -103,6 +115,18 @@ class HoneyCursor {
 
     bool read_tag(bool keep_compressed = false);
 
+    /** Read the tag, avoiding copying it if possible.
+     *
+     *  If the table is memory mapped and the tag isn't compressed, @a p is
+     *  set to point to the tag in the mapping.  Otherwise the tag is read
+     *  into current_tag as read_tag() would and @a p points to that.  Either
+     *  way, the data remains valid until the cursor is moved or destroyed.
+     *
+     *  @param p	Set to point to the tag data.
+     *  @param len	Set to the length of the tag data.
+     */
+    void read_tag_data(const char*& p, size_t& len);
+
     bool find_exact(const std::string& key) {
 	return do_find(key, false);
     }
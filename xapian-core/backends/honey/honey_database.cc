@@ -31,8 +31,11 @@
 
 #include "api/leafpostlist.h"
 #include "backends/backends.h"
+#include "pack.h"
 #include "xapian/error.h"
 
+#include <memory>
+
 using namespace std;
 
 void
@@ -102,11 +105,39 @@ HoneyDatabase::~HoneyDatabase()
     delete doclen_cursor;
 }
 
+void
+HoneyDatabase::enable_mmap()
+{
+    mmapped = true;
+    docdata_table.enable_mmap();
+    postlist_table.enable_mmap();
+    position_table.enable_mmap();
+    spelling_table.enable_mmap();
+    synonym_table.enable_mmap();
+    termlist_table.enable_mmap();
+}
+
+Xapian::Database::Internal*
+HoneyDatabase::open_copy() const
+{
+    // A single file database opened from a file descriptor has no path.
+    if (path.empty())
+	return NULL;
+    unique_ptr<HoneyDatabase> copy(new HoneyDatabase(path));
+    if (mmapped)
+	copy->enable_mmap();
+    return copy.release();
+}
+
 void
 HoneyDatabase::readahead_for_query(const Xapian::Query& query) const
 {
-    (void)query;
-    // FIXME: Implement - pre-read the start of the postlist table?
+    Xapian::TermIterator t;
+    for (t = query.get_unique_terms_begin(); t != Xapian::TermIterator(); ++t) {
+	const string& term = *t;
+	if (!postlist_table.readahead_key(Honey::make_postingchunk_key(term)))
+	    break;
+    }
 }
 
 Xapian::doccount
@@ -441,6 +472,7 @@ HoneyDatabase::close()
     spelling_table.close(true);
     synonym_table.close(true);
     termlist_table.close(true);
+    drop_copies();
 }
 
 void
@@ -462,6 +494,14 @@ HoneyDatabase::get_uuid() const
     return version_file.get_uuid_string();
 }
 
+bool
+HoneyDatabase::append_revision_key(string& key) const
+{
+    pack_string(key, version_file.get_uuid_string());
+    pack_uint(key, version_file.get_revision());
+    return true;
+}
+
 int
 HoneyDatabase::get_backend_info(string* path_ptr) const
 {
@@ -81,6 +81,9 @@ class HoneyDatabase : public Xapian::Database::Internal {
 
     mutable HoneyCursor* doclen_cursor = NULL;
 
+    /// Has enable_mmap() been called?
+    bool mmapped = false;
+
     [[noreturn]]
     void throw_termlist_table_close_exception() const;
 
@@ -93,6 +96,14 @@ class HoneyDatabase : public Xapian::Database::Internal {
 
     ~HoneyDatabase();
 
+    /** Read the tables via memory mappings.
+     *
+     *  This is done if Xapian::DB_MMAP is specified.
+     */
+    void enable_mmap();
+
+    Xapian::Database::Internal* open_copy() const;
+
     void readahead_for_query(const Xapian::Query& query) const;
 
     Xapian::doccount get_doccount() const;
@@ -358,6 +369,8 @@ class HoneyDatabase : public Xapian::Database::Internal {
      */
     std::string get_uuid() const;
 
+    bool append_revision_key(std::string& key) const;
+
     /** Get backend information about this database.
      *
      *  @param path	If non-NULL, and set the pointed to string to the file
@@ -28,6 +28,7 @@
 #include "honey_postlist_encodings.h"
 #include "pack.h"
 
+#include <algorithm>
 #include <string>
 
 using namespace Honey;
@@ -39,9 +40,31 @@ HoneyPostList::update_reader()
     Xapian::docid chunk_last = docid_from_key(term, cursor->current_key);
     if (!chunk_last) return false;
 
-    cursor->read_tag();
-    const string& tag = cursor->current_tag;
-    reader.assign(tag.data(), tag.size(), chunk_last);
+    const char* tag;
+    size_t tag_len;
+    cursor->read_tag_data(tag, tag_len);
+    reader.assign(tag, tag_len, chunk_last);
+    chunk_maxweight = -1.0;
+    return true;
+}
+
+bool
+HoneyPostList::next_chunk()
+{
+    if (reader.get_chunk_last_docid() >= last_did) {
+	// We've reached the end.
+	delete cursor;
+	cursor = NULL;
+	return false;
+    }
+
+    if (rare(!cursor->next()))
+	throw Xapian::DatabaseCorruptError("Hit end of table looking for "
+					   "postlist chunk");
+
+    if (rare(!update_reader()))
+	throw Xapian::DatabaseCorruptError("Missing postlist chunk");
+
     return true;
 }
 
@@ -60,11 +83,10 @@ HoneyPostList::HoneyPostList(const HoneyDatabase* db_,
 	return;
     }
 
-    cursor->read_tag();
-    const string& chunk = cursor->current_tag;
-
-    const char* p = chunk.data();
-    const char* pend = p + chunk.size();
+    const char* p;
+    size_t chunk_len;
+    cursor->read_tag_data(p, chunk_len);
+    const char* pend = p + chunk_len;
     // FIXME: Make use of [first,last] ranges to calculate better estimates and
     // potentially to spot subqueries that can't match anything.
     Xapian::doccount tf;
@@ -73,9 +95,12 @@ HoneyPostList::HoneyPostList(const HoneyDatabase* db_,
     Xapian::termcount first_wdf;
     Xapian::docid chunk_last;
     Xapian::termcount wdf_max;
+    Xapian::termcount chunk_wdf_max;
+    bool stream_vbyte;
     if (!decode_initial_chunk_header(&p, pend, tf, cf,
 				     first_did, last_did,
-				     chunk_last, first_wdf, wdf_max))
+				     chunk_last, first_wdf, wdf_max,
+				     chunk_wdf_max, stream_vbyte))
 	throw Xapian::DatabaseCorruptError("Postlist initial chunk header");
 
     Xapian::termcount cf_info = cf;
@@ -106,8 +131,9 @@ HoneyPostList::HoneyPostList(const HoneyDatabase* db_,
 	}
     }
 
-    reader.init(tf, cf_info);
-    reader.assign(p, pend - p, first_did, last_did, first_wdf);
+    reader.init(tf, cf_info, stream_vbyte);
+    reader.assign(p, pend - p, first_did, chunk_last, first_wdf,
+		  chunk_wdf_max);
 }
 
 HoneyPostList::~HoneyPostList()
@@ -159,6 +185,12 @@ HoneyPostList::get_wdf() const
     return reader.get_wdf();
 }
 
+Xapian::termcount
+HoneyPostList::get_block_wdf_max() const
+{
+    return reader.get_chunk_wdf_max();
+}
+
 bool
 HoneyPostList::at_end() const
 {
@@ -172,37 +204,65 @@ HoneyPostList::open_position_list() const
 }
 
 PostList*
-HoneyPostList::next(double)
+HoneyPostList::next(double w_min)
 {
     if (!started) {
 	started = true;
-	return NULL;
-    }
+	if (rare(!cursor)) {
+	    // Term not present in db.
+	    return NULL;
+	}
+    } else {
+	Assert(!reader.at_end());
 
-    Assert(!reader.at_end());
+	if (chunk_can_match(w_min) && reader.next())
+	    return NULL;
 
-    if (reader.next())
-	return NULL;
+	if (!next_chunk())
+	    return NULL;
+    }
 
-    if (reader.get_docid() >= last_did) {
-	// We've reached the end.
-	delete cursor;
-	cursor = NULL;
-	return NULL;
+    // Skip over any chunks which can't contain an entry with enough weight
+    // without decoding their postings.
+    while (!chunk_can_match(w_min)) {
+	if (!next_chunk())
+	    return NULL;
     }
 
-    if (rare(!cursor->next()))
-	throw Xapian::DatabaseCorruptError("Hit end of table looking for "
-					   "postlist chunk");
+    return NULL;
+}
 
-    if (rare(!update_reader()))
-	throw Xapian::DatabaseCorruptError("Missing postlist chunk");
+Xapian::doccount
+HoneyPostList::next_batch(Xapian::docid* dids,
+			  Xapian::termcount* wdfs,
+			  Xapian::doccount n)
+{
+    if (!started)
+	return LeafPostList::next_batch(dids, wdfs, n);
 
-    return NULL;
+    Assert(!at_end());
+    Assert(!reader.at_end());
+
+    Xapian::doccount i = 0;
+    while (reader.next()) {
+	dids[i] = reader.get_docid();
+	wdfs[i] = reader.get_wdf();
+	if (++i == n)
+	    return i;
+    }
+
+    // We've used up the current chunk.  Move to the next one, but stop after
+    // its first entry so that next() gets a chance to skip the rest of it.
+    if (next_chunk()) {
+	dids[i] = reader.get_docid();
+	wdfs[i] = reader.get_wdf();
+	++i;
+    }
+    return i;
 }
 
 PostList*
-HoneyPostList::skip_to(Xapian::docid did, double)
+HoneyPostList::skip_to(Xapian::docid did, double w_min)
 {
     if (!started) {
 	started = true;
@@ -215,8 +275,12 @@ HoneyPostList::skip_to(Xapian::docid did, double)
 
     Assert(!reader.at_end());
 
-    if (reader.skip_to(did))
+    if (chunk_can_match(w_min)) {
+	if (reader.skip_to(did))
+	    return NULL;
+    } else if (did <= reader.get_docid()) {
 	return NULL;
+    }
 
     if (did > last_did) {
 	// We've reached the end.
@@ -225,23 +289,35 @@ HoneyPostList::skip_to(Xapian::docid did, double)
 	return NULL;
     }
 
-    // At this point we know that skip_to() must succeed since last_did
-    // satisfies the requirements.
+    if (did <= reader.get_chunk_last_docid()) {
+	// The rest of the current chunk can't match, so move to the start of
+	// the next chunk, which must be after did.
+	if (!next_chunk())
+	    return NULL;
+    } else {
+	// At this point we know that skip_to() must succeed since last_did
+	// satisfies the requirements.
 
-    // find_entry_ge() returns true for an exact match, which isn't interesting
-    // here.
-    (void)cursor->find_entry_ge(make_postingchunk_key(term, did));
+	// find_entry_ge() returns true for an exact match, which isn't
+	// interesting here.
+	(void)cursor->find_entry_ge(make_postingchunk_key(term, did));
 
-    if (rare(cursor->after_end()))
-	throw Xapian::DatabaseCorruptError("Hit end of table looking for "
-					   "postlist chunk");
+	if (rare(cursor->after_end()))
+	    throw Xapian::DatabaseCorruptError("Hit end of table looking for "
+					       "postlist chunk");
 
-    if (rare(!update_reader()))
-	throw Xapian::DatabaseCorruptError("Missing postlist chunk");
+	if (rare(!update_reader()))
+	    throw Xapian::DatabaseCorruptError("Missing postlist chunk");
 
-    if (rare(!reader.skip_to(did)))
-	throw Xapian::DatabaseCorruptError("Postlist chunk doesn't contain "
-					   "its last entry");
+	if (rare(!reader.skip_to(did)))
+	    throw Xapian::DatabaseCorruptError("Postlist chunk doesn't contain "
+					       "its last entry");
+    }
+
+    while (!chunk_can_match(w_min)) {
+	if (!next_chunk())
+	    return NULL;
+    }
 
     return NULL;
 }
@@ -286,32 +362,88 @@ void
 PostingChunkReader::assign(const char* p_, size_t len,
 			   Xapian::docid chunk_last)
 {
+    // We may have skipped the rest of the first chunk without moving past
+    // its first entry.
+    if (collfreq_info & TOP_BIT_SET(decltype(collfreq_info))) {
+	wdf = collfreq_info &~ TOP_BIT_SET(decltype(collfreq_info));
+	collfreq_info = 0;
+    }
+
     const char* pend = p_ + len;
-    if (collfreq_info ?
-	!decode_delta_chunk_header(&p_, pend, chunk_last, did, wdf) :
-	!decode_delta_chunk_header_no_wdf(&p_, pend, chunk_last, did)) {
-	throw Xapian::DatabaseCorruptError("Postlist delta chunk header");
+    if (collfreq_info) {
+	if (!decode_delta_chunk_header(&p_, pend, chunk_last, did, wdf,
+				       chunk_wdf_max)) {
+	    throw Xapian::DatabaseCorruptError("Postlist delta chunk header");
+	}
+    } else {
+	if (!decode_delta_chunk_header_no_wdf(&p_, pend, chunk_last, did)) {
+	    throw Xapian::DatabaseCorruptError("Postlist delta chunk header");
+	}
+	// The wdf is the same for every entry in this chunk.
+	chunk_wdf_max = wdf;
     }
     p = p_;
     end = pend;
     last_did = chunk_last;
+    if (stream_vbyte) decode_block();
 }
 
 void
 PostingChunkReader::assign(const char* p_, size_t len, Xapian::docid did_,
 			   Xapian::docid last_did_in_chunk,
-			   Xapian::termcount wdf_)
+			   Xapian::termcount wdf_,
+			   Xapian::termcount chunk_wdf_max_)
 {
     p = p_;
     end = p_ + len;
     did = did_;
     last_did = last_did_in_chunk;
     wdf = wdf_;
+    chunk_wdf_max = chunk_wdf_max_;
+    if (stream_vbyte) decode_block();
+}
+
+void
+PostingChunkReader::decode_block()
+{
+    // The wdfs are only stored if collfreq_info is 1 (see its comment).
+    bool have_wdfs = (collfreq_info == 1);
+    if (!decode_postings_stream_vbyte(&p, end, have_wdfs,
+				      block_deltas, block_wdfs)) {
+	throw Xapian::DatabaseCorruptError("Postlist Stream VByte data");
+    }
+    auto n = block_deltas.size();
+    block_dids.resize(n);
+    Xapian::docid d = did;
+    for (size_t i = 0; i != n; ++i) {
+	d += block_deltas[i] + 1;
+	block_dids[i] = d;
+    }
+    block_pos = 0;
 }
 
 bool
 PostingChunkReader::next()
 {
+    if (stream_vbyte) {
+	if (block_pos == block_dids.size()) {
+	    p = NULL;
+	    return false;
+	}
+
+	// The "constant wdf apart from maybe the first entry" case.
+	if (collfreq_info & TOP_BIT_SET(decltype(collfreq_info))) {
+	    wdf = collfreq_info &~ TOP_BIT_SET(decltype(collfreq_info));
+	    collfreq_info = 0;
+	}
+
+	did = block_dids[block_pos];
+	if (collfreq_info)
+	    wdf = block_wdfs[block_pos];
+	++block_pos;
+	return true;
+    }
+
     if (p == end) {
 	if (termfreq == 2 && did != last_did) {
 	    did = last_did;
@@ -356,6 +488,28 @@ PostingChunkReader::skip_to(Xapian::docid target)
 	return false;
     }
 
+    if (stream_vbyte) {
+	// The "constant wdf apart from maybe the first entry" case.
+	if (collfreq_info & TOP_BIT_SET(decltype(collfreq_info))) {
+	    wdf = collfreq_info &~ TOP_BIT_SET(decltype(collfreq_info));
+	    collfreq_info = 0;
+	}
+
+	auto begin = block_dids.begin();
+	auto i = lower_bound(begin + block_pos, block_dids.end(), target);
+	if (rare(i == block_dids.end())) {
+	    // FIXME: Shouldn't happen unless last_did was wrong.
+	    p = NULL;
+	    return false;
+	}
+	block_pos = i - begin;
+	did = *i;
+	if (collfreq_info)
+	    wdf = block_wdfs[block_pos];
+	++block_pos;
+	return true;
+    }
+
     if (p == end) {
 	// Given the checks above, this must be the termfreq == 2 case with the
 	// current position being on the first entry, and so skip_to() must
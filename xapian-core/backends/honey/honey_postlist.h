@@ -26,7 +26,9 @@
 #include "honey_positionlist.h"
 #include "pack.h"
 
+#include <cstdint>
 #include <string>
+#include <vector>
 
 class HoneyCursor;
 class HoneyDatabase;
@@ -85,6 +87,9 @@ class PostingChunkReader {
     /// The last docid in this chunk.
     Xapian::docid last_did;
 
+    /// An upper bound on the wdf of entries in this chunk.
+    Xapian::termcount chunk_wdf_max;
+
     Xapian::doccount termfreq;
 
     /** Value "to do with" collection frequency.
@@ -110,6 +115,28 @@ class PostingChunkReader {
      */
     Xapian::termcount collfreq_info;
 
+    /// Are the postings encoded using Stream VByte?
+    bool stream_vbyte = false;
+
+    /** Index of the next entry in block_dids.
+     *
+     *  Only used if stream_vbyte is true, in which case each chunk is decoded
+     *  in one go when we move to it.
+     */
+    size_t block_pos;
+
+    /// The docids in the current chunk after the first.
+    std::vector<Xapian::docid> block_dids;
+
+    /// The wdfs corresponding to block_dids (if stored).
+    std::vector<std::uint32_t> block_wdfs;
+
+    /// Buffer to decode docid deltas into.
+    std::vector<std::uint32_t> block_deltas;
+
+    /// Decode the Stream VByte encoded postings from p to end.
+    void decode_block();
+
   public:
     /// Create an uninitialised PostingChunkReader.
     PostingChunkReader() : p(NULL) { }
@@ -118,20 +145,24 @@ class PostingChunkReader {
     void init() {
 	p = NULL;
 	termfreq = 0;
+	stream_vbyte = false;
     }
 
     /// Initialise.
-    void init(Xapian::doccount tf, Xapian::termcount cf_info) {
+    void init(Xapian::doccount tf, Xapian::termcount cf_info,
+	      bool stream_vbyte_) {
 	p = NULL;
 	termfreq = tf;
 	collfreq_info = cf_info;
+	stream_vbyte = stream_vbyte_;
     }
 
     void assign(const char* p_, size_t len, Xapian::docid did);
 
     void assign(const char* p_, size_t len, Xapian::docid did_,
 		Xapian::docid last_did_in_chunk,
-		Xapian::termcount wdf_);
+		Xapian::termcount wdf_,
+		Xapian::termcount chunk_wdf_max_);
 
     bool at_end() const { return p == NULL; }
 
@@ -141,6 +172,10 @@ class PostingChunkReader {
 
     Xapian::termcount get_wdf() const { return wdf; }
 
+    Xapian::docid get_chunk_last_docid() const { return last_did; }
+
+    Xapian::termcount get_chunk_wdf_max() const { return chunk_wdf_max; }
+
     /// Advance, returning false if we've run out of data.
     bool next();
 
@@ -175,9 +210,29 @@ class HoneyPostList : public LeafPostList {
      */
     bool started = false;
 
+    /** Upper bound on the weight of entries in the current chunk.
+     *
+     *  This is calculated lazily, and negative if not yet calculated.
+     */
+    double chunk_maxweight = -1.0;
+
     /// Update @a reader to use the chunk currently pointed to by @a cursor.
     bool update_reader();
 
+    /** Move to the start of the next chunk.
+     *
+     *  @return false if there are no more chunks (in which case we're now
+     *		at_end()).
+     */
+    bool next_chunk();
+
+    /// Could any entry in the current chunk have weight >= @a w_min?
+    bool chunk_can_match(double w_min) {
+	if (w_min <= 0.0 || !weight) return true;
+	if (chunk_maxweight < 0.0) chunk_maxweight = get_block_maxweight();
+	return w_min <= chunk_maxweight;
+    }
+
   public:
     /// Create HoneyPostList from already positioned @a cursor_.
     HoneyPostList(const HoneyDatabase* db_,
@@ -195,6 +250,8 @@ class HoneyPostList : public LeafPostList {
 
     Xapian::termcount get_wdf() const;
 
+    Xapian::termcount get_block_wdf_max() const;
+
     bool at_end() const;
 
     PositionList* open_position_list() const;
@@ -203,6 +260,10 @@ class HoneyPostList : public LeafPostList {
 
     PostList* skip_to(Xapian::docid did, double w_min);
 
+    Xapian::doccount next_batch(Xapian::docid* dids,
+				Xapian::termcount* wdfs,
+				Xapian::doccount n);
+
     std::string get_description() const;
 };
 
@@ -22,6 +22,21 @@
 #define XAPIAN_INCLUDED_HONEY_POSTLIST_ENCODINGS_H
 
 #include "pack.h"
+#include "streamvbyte.h"
+#include "xapian/error.h"
+
+#include <cstdint>
+#include <vector>
+
+/** Combine termfreq (which must be > 2) and the postings encoding.
+ *
+ *  The bottom bit is set if the postings are encoded using Stream VByte.
+ */
+inline Xapian::totallength
+encode_termfreq_and_encoding(Xapian::doccount termfreq, bool stream_vbyte)
+{
+    return (Xapian::totallength(termfreq - 3) << 1) | stream_vbyte;
+}
 
 inline void
 encode_initial_chunk_header(Xapian::doccount termfreq,
@@ -31,9 +46,13 @@ encode_initial_chunk_header(Xapian::doccount termfreq,
 			    Xapian::docid chunk_last,
 			    Xapian::termcount first_wdf,
 			    Xapian::termcount wdf_max,
+			    Xapian::termcount chunk_wdf_max,
+			    bool stream_vbyte,
 			    std::string& out)
 {
     Assert(termfreq != 0);
+    // Only postlists with postings after the chunk header have an encoding.
+    Assert(!stream_vbyte || termfreq > 2);
     pack_uint(out, first - 1);
     if (termfreq == 1) {
 	// Special case for a term which only occurs in one document.  By
@@ -91,13 +110,13 @@ encode_initial_chunk_header(Xapian::doccount termfreq,
 	AssertEq(first_wdf, 0);
 	AssertEq(wdf_max, 0);
 	pack_uint(out, 0u);
-	pack_uint(out, termfreq - 3);
+	pack_uint(out, encode_termfreq_and_encoding(termfreq, stream_vbyte));
 	pack_uint(out, last - first - (termfreq - 1));
 	pack_uint(out, chunk_last - first);
     } else {
 	AssertRel(collfreq, >=, termfreq);
 	pack_uint(out, collfreq - termfreq + 1);
-	pack_uint(out, termfreq - 3);
+	pack_uint(out, encode_termfreq_and_encoding(termfreq, stream_vbyte));
 	pack_uint(out, last - first - (termfreq - 1));
 	pack_uint(out, chunk_last - first);
 	pack_uint(out, first_wdf - 1);
@@ -108,6 +127,15 @@ encode_initial_chunk_header(Xapian::doccount termfreq,
 	    AssertRel(wdf_max, >=, first_wdf);
 	    pack_uint(out, wdf_max - first_wdf);
 	}
+
+	if (chunk_last != last) {
+	    // There are further chunks, so store the maximum wdf in this chunk
+	    // to allow the matcher to skip over it if its postings can't
+	    // contribute enough weight.  For the last chunk this is wdf_max
+	    // anyway.
+	    AssertRel(chunk_wdf_max, <=, wdf_max);
+	    pack_uint(out, wdf_max - chunk_wdf_max);
+	}
     }
 }
 
@@ -119,8 +147,11 @@ decode_initial_chunk_header(const char** p, const char* end,
 			    Xapian::docid& last,
 			    Xapian::docid& chunk_last,
 			    Xapian::termcount& first_wdf,
-			    Xapian::termcount& wdf_max)
+			    Xapian::termcount& wdf_max,
+			    Xapian::termcount& chunk_wdf_max,
+			    bool& stream_vbyte)
 {
+    stream_vbyte = false;
     if (!unpack_uint(p, end, &first)) {
 	return false;
     }
@@ -134,19 +165,20 @@ decode_initial_chunk_header(const char** p, const char* end,
 	// Single occurrence term.
 	termfreq = 1;
 	chunk_last = last = first;
-	wdf_max = first_wdf = collfreq;
+	chunk_wdf_max = wdf_max = first_wdf = collfreq;
 	return true;
     }
 
-    if (!unpack_uint(p, end, &termfreq)) {
+    Xapian::totallength tf_info;
+    if (!unpack_uint(p, end, &tf_info)) {
 	return false;
     }
     if (*p == end) {
 	// Double occurrence term with first_wdf = floor(collfreq / 2).
-	chunk_last = last = first + termfreq + 1;
+	chunk_last = last = first + Xapian::docid(tf_info) + 1;
 	termfreq = 2;
 	first_wdf = collfreq / 2;
-	wdf_max = max(first_wdf, collfreq - first_wdf);
+	chunk_wdf_max = wdf_max = max(first_wdf, collfreq - first_wdf);
 	return true;
     }
 
@@ -157,21 +189,22 @@ decode_initial_chunk_header(const char** p, const char* end,
 	// Double occurrence term.
 	Assert(collfreq != 0);
 	first_wdf = last;
-	chunk_last = last = first + termfreq + 1;
+	chunk_last = last = first + Xapian::docid(tf_info) + 1;
 	termfreq = 2;
-	wdf_max = max(first_wdf, collfreq - first_wdf);
+	chunk_wdf_max = wdf_max = max(first_wdf, collfreq - first_wdf);
 	return true;
     }
 
     if (!unpack_uint(p, end, &chunk_last)) {
 	return false;
     }
-    termfreq += 3;
+    stream_vbyte = (tf_info & 1);
+    termfreq = Xapian::doccount(tf_info >> 1) + 3;
     last += first + termfreq - 1;
     chunk_last += first;
 
     if (collfreq == 0) {
-	wdf_max = first_wdf = 0;
+	chunk_wdf_max = wdf_max = first_wdf = 0;
     } else {
 	collfreq += (termfreq - 1);
 	if (!unpack_uint(p, end, &first_wdf)) {
@@ -186,6 +219,15 @@ decode_initial_chunk_header(const char** p, const char* end,
 	    }
 	    wdf_max += first_wdf;
 	}
+
+	if (chunk_last == last) {
+	    chunk_wdf_max = wdf_max;
+	} else {
+	    if (!unpack_uint(p, end, &chunk_wdf_max)) {
+		return false;
+	    }
+	    chunk_wdf_max = wdf_max - chunk_wdf_max;
+	}
     }
 
     return true;
@@ -213,7 +255,8 @@ decode_initial_chunk_header_freqs(const char** p, const char* end,
 	return true;
     }
 
-    if (!unpack_uint(p, end, &termfreq)) {
+    Xapian::totallength tf_info;
+    if (!unpack_uint(p, end, &tf_info)) {
 	return false;
     }
     if (*p == end) {
@@ -235,7 +278,7 @@ decode_initial_chunk_header_freqs(const char** p, const char* end,
 	return true;
     }
 
-    termfreq += 3;
+    termfreq = Xapian::doccount(tf_info >> 1) + 3;
     if (collfreq != 0) {
 	collfreq += (termfreq - 1);
     }
@@ -247,25 +290,31 @@ inline void
 encode_delta_chunk_header(Xapian::docid chunk_first,
 			  Xapian::docid chunk_last,
 			  Xapian::termcount chunk_first_wdf,
+			  Xapian::termcount chunk_wdf_max,
 			  std::string& out)
 {
     Assert(chunk_first_wdf != 0);
+    AssertRel(chunk_wdf_max, >=, chunk_first_wdf);
     pack_uint(out, chunk_last - chunk_first);
     pack_uint(out, chunk_first_wdf - 1);
+    pack_uint(out, chunk_wdf_max - chunk_first_wdf);
 }
 
 inline bool
 decode_delta_chunk_header(const char** p, const char* end,
 			  Xapian::docid chunk_last,
 			  Xapian::docid& chunk_first,
-			  Xapian::termcount& chunk_first_wdf)
+			  Xapian::termcount& chunk_first_wdf,
+			  Xapian::termcount& chunk_wdf_max)
 {
     if (!unpack_uint(p, end, &chunk_first) ||
-	!unpack_uint(p, end, &chunk_first_wdf)) {
+	!unpack_uint(p, end, &chunk_first_wdf) ||
+	!unpack_uint(p, end, &chunk_wdf_max)) {
 	return false;
     }
     chunk_first = chunk_last - chunk_first;
     ++chunk_first_wdf;
+    chunk_wdf_max += chunk_first_wdf;
     return true;
 }
 
@@ -289,4 +338,77 @@ decode_delta_chunk_header_no_wdf(const char** p, const char* end,
     return true;
 }
 
+/** Convert postings to Stream VByte.
+ *
+ *  @param data	     The postings after the chunk header in the default
+ *		     encoding - each entry is pack_uint() of the docid delta
+ *		     minus one, followed by pack_uint() of the wdf if
+ *		     @a have_wdfs is true.  Every value must fit in 32 bits.
+ *  @param out	     String to append the encoded postings to.
+ *
+ *  The encoded form is pack_uint() of the number of entries, then the docid
+ *  deltas as a Stream VByte block, then the wdfs as a second block if
+ *  @a have_wdfs is true.  Empty @a data gives empty output.
+ */
+inline void
+encode_postings_stream_vbyte(const std::string& data,
+			     bool have_wdfs,
+			     std::string& out)
+{
+    if (data.empty()) return;
+    std::vector<std::uint32_t> deltas, wdfs;
+    const char* p = data.data();
+    const char* end = p + data.size();
+    while (p != end) {
+	Xapian::docid delta;
+	if (!unpack_uint(&p, end, &delta))
+	    throw Xapian::DatabaseCorruptError("Decoding docid delta");
+	deltas.push_back(delta);
+	if (have_wdfs) {
+	    Xapian::termcount wdf;
+	    if (!unpack_uint(&p, end, &wdf))
+		throw Xapian::DatabaseCorruptError("Decoding wdf");
+	    wdfs.push_back(wdf);
+	}
+    }
+    pack_uint(out, deltas.size());
+    pack_stream_vbyte(out, deltas.data(), deltas.size());
+    if (have_wdfs)
+	pack_stream_vbyte(out, wdfs.data(), wdfs.size());
+}
+
+/** Decode postings encoded by encode_postings_stream_vbyte().
+ *
+ *  @param deltas    Set to the docid deltas (each one less than the
+ *		     difference between consecutive docids).
+ *  @param wdfs	     Set to the wdfs if @a have_wdfs is true (otherwise left
+ *		     unchanged).
+ */
+inline bool
+decode_postings_stream_vbyte(const char** p, const char* end,
+			     bool have_wdfs,
+			     std::vector<std::uint32_t>& deltas,
+			     std::vector<std::uint32_t>& wdfs)
+{
+    if (*p == end) {
+	deltas.clear();
+	if (have_wdfs) wdfs.clear();
+	return true;
+    }
+    size_t n;
+    if (!unpack_uint(p, end, &n) || n > size_t(end - *p)) {
+	// Every value takes at least one byte.
+	return false;
+    }
+    deltas.resize(n);
+    if (!unpack_stream_vbyte(p, end, deltas.data(), n))
+	return false;
+    if (have_wdfs) {
+	wdfs.resize(n);
+	if (!unpack_stream_vbyte(p, end, wdfs.data(), n))
+	    return false;
+    }
+    return *p == end;
+}
+
 #endif // XAPIAN_INCLUDED_HONEY_POSTLIST_ENCODINGS_H
@@ -146,8 +146,11 @@ HoneyPostListTable::get_wdf_upper_bound(const std::string& term) const
     Xapian::docid chunk_last;
     Xapian::termcount first_wdf;
     Xapian::termcount wdf_max;
+    Xapian::termcount chunk_wdf_max;
+    bool stream_vbyte;
     if (!decode_initial_chunk_header(&p, pend, tf, cf, first, last, chunk_last,
-				     first_wdf, wdf_max))
+				     first_wdf, wdf_max, chunk_wdf_max,
+				     stream_vbyte))
 	throw Xapian::DatabaseCorruptError("Postlist initial chunk header");
     return wdf_max;
 }
@@ -29,6 +29,7 @@
 
 #include "unicode/description_append.h"
 
+#include <algorithm>
 #include <cerrno>
 
 #ifdef DEBUGGING
@@ -154,6 +155,142 @@ HoneyTable::commit(honey_revision_number_t, RootInfo* root_info)
     last_key = string();
 }
 
+bool
+SSTIndex::find(BufferedFile& store,
+	       int index_type,
+	       const string& key,
+	       off_t& start,
+	       string& start_key,
+	       off_t& end)
+{
+    Assert(!key.empty());
+    if (index_type == 0x00) {
+	unsigned char first =
+	    static_cast<unsigned char>(key[0] - store.read());
+	unsigned char range = store.read();
+	if (first > range)
+	    return false;
+	store.skip(first * 4); // FIXME: pointer width
+	start = store.read_uint4_be();
+	if (first < range)
+	    end = store.read_uint4_be();
+	// The jump point will be an entirely new key (because it is the first
+	// key with that initial character), and we drop in as if this was the
+	// first key so start_key is empty.
+	start_key.resize(0);
+	return true;
+    }
+
+    AssertEq(index_type, 0x01);
+    size_t n_index = store.read_uint4_be();
+    if (n_index == 0)
+	return false;
+    off_t base = store.get_pos();
+    char kkey[SSTINDEX_BINARY_CHOP_KEY_SIZE];
+    size_t kkey_len;
+    size_t i = 0, j = n_index;
+    while (j - i > 1) {
+	size_t k = i + (j - i) / 2;
+	store.set_pos(base + k * SSTINDEX_BINARY_CHOP_ENTRY_SIZE);
+	store.read(kkey, SSTINDEX_BINARY_CHOP_KEY_SIZE);
+	kkey_len = SSTINDEX_BINARY_CHOP_KEY_SIZE;
+	while (kkey_len > 0 && kkey[kkey_len - 1] == '\0') --kkey_len;
+	int r = key.compare(0, SSTINDEX_BINARY_CHOP_KEY_SIZE, kkey, kkey_len);
+	if (r < 0) {
+	    j = k;
+	} else {
+	    i = k;
+	    if (r == 0) {
+		break;
+	    }
+	}
+    }
+    store.set_pos(base + i * SSTINDEX_BINARY_CHOP_ENTRY_SIZE);
+    store.read(kkey, SSTINDEX_BINARY_CHOP_KEY_SIZE);
+    kkey_len = SSTINDEX_BINARY_CHOP_KEY_SIZE;
+    while (kkey_len > 0 && kkey[kkey_len - 1] == '\0') --kkey_len;
+    start = store.read_uint4_be();
+    if (i + 1 < n_index) {
+	store.skip(SSTINDEX_BINARY_CHOP_KEY_SIZE);
+	end = store.read_uint4_be();
+    }
+    // The jump point is to the first key with prefix kkey, so will work if
+    // we set start_key to kkey.  Unless we're jumping to the start of the
+    // table, in which case start_key needs to be empty.
+    start_key.assign(kkey, start == 0 ? 0 : kkey_len);
+    return true;
+}
+
+/// Read a pointer from a skiplist index.
+static off_t
+read_skiplist_ptr(BufferedFile& store)
+{
+    char buf[10];
+    char* e = buf;
+    while (true) {
+	int b = store.read();
+	if (b == EOF || e == buf + sizeof(buf))
+	    throw Xapian::DatabaseCorruptError("Bad skiplist index pointer");
+	*e++ = char(b);
+	if ((b & 0x80) == 0) break;
+    }
+    const char* p = buf;
+    make_unsigned<off_t>::type ptr;
+    if (!unpack_uint(&p, e, &ptr) || p != e)
+	throw Xapian::DatabaseCorruptError("Bad skiplist index pointer");
+    return off_t(ptr);
+}
+
+bool
+SSTIndex::find_in_skiplist(BufferedFile& store,
+			   const string& key,
+			   off_t& start,
+			   string& start_key,
+			   off_t& end)
+{
+    Assert(!key.empty());
+    // FIXME: If "close" just seek forwards?  Or consider seeking from
+    // current index pos?
+    string index_key, prev_index_key;
+    off_t ptr = 0;
+    int cmp0 = 1;
+    while (true) {
+	int reuse = store.read();
+	if (reuse == EOF) break;
+	int len = store.read();
+	if (len == EOF || size_t(reuse) > index_key.size())
+	    throw Xapian::DatabaseCorruptError("Bad skiplist index entry");
+	index_key.resize(reuse + len);
+	store.read(&index_key[reuse], len);
+
+	cmp0 = index_key.compare(key);
+	if (cmp0 > 0) {
+	    end = read_skiplist_ptr(store);
+	    index_key = prev_index_key;
+	    break;
+	}
+	ptr = read_skiplist_ptr(store);
+	if (cmp0 == 0)
+	    break;
+	prev_index_key = index_key;
+    }
+#ifdef DEBUGGING
+    {
+	string desc;
+	description_append(desc, index_key);
+	cerr << " index_key = " << desc << ", cmp0 = " << cmp0
+	     << ", going to " << ptr << endl;
+    }
+#endif
+    start = ptr;
+    if (ptr != 0) {
+	start_key = index_key;
+    } else {
+	start_key.resize(0);
+    }
+    return cmp0 == 0;
+}
+
 bool
 HoneyTable::read_key(std::string& key,
 		     size_t& val_size,
@@ -243,6 +380,45 @@ HoneyTable::read_val(std::string& val, size_t val_size) const
 #endif
 }
 
+bool
+HoneyTable::readahead_key(const std::string& key) const
+{
+    Assert(!key.empty());
+    // Readahead is just a hint, so quietly ignore it if the table isn't open
+    // (e.g. a lazy table which doesn't exist, or the database was closed).
+    if (!read_only || !store.is_open())
+	return false;
+
+    // We can't locate the key itself without reading the keys before it, but
+    // the index tells us where the region which must contain it starts and
+    // ends.  We preread the start of that region - limit how much so a
+    // region covering a large part of the table doesn't flood the cache.
+    const size_t READAHEAD_MAX = 128 * 1024;
+
+    store.rewind(root);
+    off_t start, end = root;
+    string start_key;
+    int index_type = store.read();
+    switch (index_type) {
+	case EOF:
+	    return false;
+	case 0x00:
+	case 0x01:
+	    if (!SSTIndex::find(store, index_type, key, start, start_key, end))
+		return true;
+	    break;
+	case 0x02:
+	    (void)SSTIndex::find_in_skiplist(store, key, start, start_key, end);
+	    break;
+	default:
+	    return false;
+    }
+    if (end <= start)
+	return true;
+    size_t len = min(size_t(end - start), READAHEAD_MAX);
+    return store.readahead(start, len);
+}
+
 bool
 HoneyTable::get_exact_entry(const std::string& key, std::string* tag) const
 {
@@ -262,113 +438,22 @@ HoneyTable::get_exact_entry(const std::string& key, std::string* tag) const
     switch (index_type) {
 	case EOF:
 	    return false;
-	case 0x00: {
-	    unsigned char first =
-		static_cast<unsigned char>(key[0] - store.read());
-	    unsigned char range = store.read();
-	    if (first > range)
-		return false;
-	    store.skip(first * 4); // FIXME: pointer width
-	    off_t jump = store.read_uint4_be();
-	    store.rewind(jump);
-	    // The jump point will be an entirely new key (because it is the
-	    // first key with that initial character), and we drop in as if
-	    // this was the first key so set last_key to be empty.
-	    last_key = string();
-	    break;
-	}
+	case 0x00:
 	case 0x01: {
-	    size_t j = store.read_uint4_be();
-	    if (j == 0)
+	    off_t jump, next_jump;
+	    if (!SSTIndex::find(store, index_type, key, jump, last_key,
+				next_jump))
 		return false;
-	    off_t base = store.get_pos();
-	    char kkey[SSTINDEX_BINARY_CHOP_KEY_SIZE];
-	    size_t kkey_len = 0;
-	    size_t i = 0;
-	    while (j - i > 1) {
-		size_t k = i + (j - i) / 2;
-		store.set_pos(base + k * SSTINDEX_BINARY_CHOP_ENTRY_SIZE);
-		store.read(kkey, SSTINDEX_BINARY_CHOP_KEY_SIZE);
-		kkey_len = 4;
-		while (kkey_len > 0 && kkey[kkey_len - 1] == '\0') --kkey_len;
-		int r = key.compare(0, SSTINDEX_BINARY_CHOP_KEY_SIZE,
-				    kkey, kkey_len);
-		if (r < 0) {
-		    j = k;
-		} else {
-		    i = k;
-		    if (r == 0) {
-			break;
-		    }
-		}
-	    }
-	    store.set_pos(base + i * SSTINDEX_BINARY_CHOP_ENTRY_SIZE);
-	    store.read(kkey, SSTINDEX_BINARY_CHOP_KEY_SIZE);
-	    kkey_len = 4;
-	    while (kkey_len > 0 && kkey[kkey_len - 1] == '\0') --kkey_len;
-	    off_t jump = store.read_uint4_be();
 	    store.rewind(jump);
-	    // The jump point is to the first key with prefix kkey, so will
-	    // work if we set last key to kkey.  Unless we're jumping to the
-	    // start of the table, in which case last_key needs to be empty.
-	    last_key.assign(kkey, jump == 0 ? 0 : kkey_len);
 	    break;
 	}
 	case 0x02: {
-	    // FIXME: If "close" just seek forwards?  Or consider seeking from
-	    // current index pos?
-	    // off_t pos = store.get_pos();
-	    string index_key, prev_index_key;
-	    make_unsigned<off_t>::type ptr = 0;
-	    int cmp0 = 1;
-	    while (true) {
-		int reuse = store.read();
-		if (reuse == EOF) break;
-		int len = store.read();
-		if (len == EOF) abort(); // FIXME
-		index_key.resize(reuse + len);
-		store.read(&index_key[reuse], len);
-
-#ifdef DEBUGGING
-		{
-		    string desc;
-		    description_append(desc, index_key);
-		    cerr << "Index key: " << desc << endl;
-		}
-#endif
-
-		cmp0 = index_key.compare(key);
-		if (cmp0 > 0) {
-		    index_key = prev_index_key;
-		    break;
-		}
-		char buf[8];
-		char* e = buf;
-		while (true) {
-		    int b = store.read();
-		    *e++ = b;
-		    if ((b & 0x80) == 0) break;
-		}
-		const char* p = buf;
-		if (!unpack_uint(&p, e, &ptr) || p != e) abort(); // FIXME
-#ifdef DEBUGGING
-		{
-		    cerr << " -> " << ptr << endl;
-		}
-#endif
-		if (cmp0 == 0)
-		    break;
-		prev_index_key = index_key;
-	    }
-#ifdef DEBUGGING
-	    {
-		cerr << " cmp0 = " << cmp0 << ", going to " << ptr << endl;
-	    }
-#endif
+	    off_t ptr, next_ptr;
+	    exact_match = SSTIndex::find_in_skiplist(store, key, ptr, last_key,
+						     next_ptr);
 	    store.set_pos(ptr);
 
 	    if (ptr != 0) {
-		last_key = index_key;
 		char buf[8];
 		int r;
 		{
@@ -392,14 +477,10 @@ HoneyTable::get_exact_entry(const std::string& key, std::string* tag) const
 		compressed = val_size & 1;
 		val_size >>= 1;
 		Assert(p == end);
-	    } else {
-		last_key = string();
 	    }
 
-	    if (cmp0 == 0) {
-		exact_match = true;
+	    if (exact_match)
 		break;
-	    }
 
 #ifdef DEBUGGING
 	    {
@@ -79,9 +79,19 @@ class BufferedFileCommon {
     unsigned _refs = 0;
     off_t offset = 0;
 
+    /// Memory mapping of the whole file, or NULL.
+    const char* mapping = NULL;
+
+    /// The size of mapping in bytes.
+    size_t mapping_size = 0;
+
     BufferedFileCommon(int fd_, off_t offset_)
 	: fd(fd_), _refs(1), offset(offset_) {}
 
+    ~BufferedFileCommon() {
+	if (mapping) io_unmap_file(mapping, mapping_size);
+    }
+
     BufferedFileCommon(const BufferedFileCommon&) = delete;
 
     BufferedFileCommon& operator=(const BufferedFileCommon&) = delete;
@@ -97,6 +107,22 @@ class BufferedFile {
 
     const int FORCED_CLOSE = -2;
 
+    /** Read from the file at offset @a o.
+     *
+     *  If the file is memory mapped, the data is copied from the mapping.
+     *  Otherwise (or if the range isn't all in the mapping) this is the same
+     *  as io_pread().
+     */
+    size_t do_pread(char* p, size_t n, off_t o, size_t min) const {
+	if (common->mapping &&
+	    size_t(o) <= common->mapping_size &&
+	    n <= common->mapping_size - size_t(o)) {
+	    std::memcpy(p, common->mapping + o, n);
+	    return n;
+	}
+	return io_pread(common->fd, p, n, o, min);
+    }
+
   public:
     BufferedFile() { }
 
@@ -138,10 +164,45 @@ class BufferedFile {
 
     bool is_open() const { return common && common->fd >= 0; }
 
+    /** Memory map the file, if possible.
+     *
+     *  The mapping is shared by copies of this object, and remains valid
+     *  until the last copy is destroyed.
+     */
+    void map() {
+	if (!read_only || !is_open() || common->mapping) return;
+	common->mapping = io_map_file(common->fd, common->mapping_size);
+    }
+
+    /** Read @a len bytes without copying them, if the file is mapped.
+     *
+     *  @return A pointer to the data in the mapping (valid until the last
+     *	    copy of this object is destroyed), or NULL if the file isn't
+     *	    mapped (in which case nothing is read).
+     */
+    const char* read_direct(size_t len) const {
+	if (!common->mapping) return NULL;
+	size_t start = size_t(get_pos() + common->offset);
+	if (start > common->mapping_size ||
+	    len > common->mapping_size - start) {
+	    return NULL;
+	}
+	skip(len);
+	return common->mapping + start;
+    }
+
     bool was_forced_closed() const {
 	return common && common->fd == FORCED_CLOSE;
     }
 
+    /** Hint that @a len bytes starting at position @a pos_ will be read.
+     *
+     *  Returns false if we can't readahead on this file.
+     */
+    bool readahead(off_t pos_, size_t len) const {
+	return io_readahead_block(common->fd, len, 0, common->offset + pos_);
+    }
+
     bool open(const std::string& path, bool read_only_) {
 	if (common && --common->_refs == 0)
 	    delete common;
@@ -260,7 +321,7 @@ class BufferedFile {
 	if (buf_end == 0) {
 	    // The buffer is currently empty, so we need to read at least one
 	    // byte.
-	    size_t r = io_pread(common->fd, buf, sizeof(buf), pos, 0);
+	    size_t r = do_pread(buf, sizeof(buf), pos, 0);
 	    if (r < sizeof(buf)) {
 		if (r == 0) {
 		    return EOF;
@@ -294,7 +355,7 @@ class BufferedFile {
 	    buf_end = 0;
 	}
 	// FIXME: refill buffer if len < sizeof(buf)
-	size_t r = io_pread(common->fd, p, len, pos + common->offset, len);
+	size_t r = do_pread(p, len, pos + common->offset, len);
 	// io_pread() should throw an exception if it read < len bytes.
 	AssertEq(r, len);
 	pos += r;
@@ -528,6 +589,52 @@ skip_adding_upper_bound:
 	if (parent_index) s += parent_index->size();
 	return s;
     }
+
+    /** Look up a key in an array or binary chop index.
+     *
+     *  @param store	    The table's file, positioned just after the byte
+     *			    giving the index type.
+     *  @param index_type   The index type - 0x00 (array) or 0x01 (binary
+     *			    chop).
+     *  @param key	    The key to look up (must not be empty).
+     *  @param start	    Set to the offset of the entry to start reading
+     *			    from to find @a key.
+     *  @param start_key    Set to the key to prefix-decompress the key of
+     *			    the entry at @a start against.
+     *  @param end	    Set to the offset of the next index point after
+     *			    @a start (so @a key must be before this if it's
+     *			    present), or left unchanged if there isn't one.
+     *
+     *  @return false if the index shows @a key isn't present.
+     */
+    static bool find(BufferedFile& store,
+		     int index_type,
+		     const std::string& key,
+		     off_t& start,
+		     std::string& start_key,
+		     off_t& end);
+
+    /** Look up a key in a skiplist index.
+     *
+     *  @param store	    The table's file, positioned just after the byte
+     *			    giving the index type.
+     *  @param key	    The key to look up (must not be empty).
+     *  @param start	    Set to the offset just after the key of the last
+     *			    index point with a key <= @a key (so the next
+     *			    thing to read is its value size), or to 0 if
+     *			    there's no such index point.
+     *  @param start_key    Set to the key of that index point (or empty if
+     *			    @a start is 0).
+     *  @param end	    Set to the offset of the next index point, or left
+     *			    unchanged if there isn't one.
+     *
+     *  @return true if @a start_key is @a key.
+     */
+    static bool find_in_skiplist(BufferedFile& store,
+				 const std::string& key,
+				 off_t& start,
+				 std::string& start_key,
+				 off_t& end);
 };
 
 class HoneyCursor;
@@ -602,6 +709,11 @@ class HoneyTable {
     void open(int flags_, const Honey::RootInfo& root_info,
 	      honey_revision_number_t);
 
+    /// Read the table via a memory mapping.
+    void enable_mmap() {
+	if (read_only) store.map();
+    }
+
     void close(bool permanent) {
 	bool fd_owned = !single_file();
 	if (permanent)
@@ -655,8 +767,14 @@ class HoneyTable {
 	std::abort();
     }
 
-    // readahead probably not useful?  (FIXME)
-    bool readahead_key(const std::string&) const { return false; }
+    /** Hint that the entry for @a key will soon be read.
+     *
+     *  The index is used to find the region of the table the key must be
+     *  in, and the start of that region is preread.
+     *
+     *  Returns false if we can't readahead on this table.
+     */
+    bool readahead_key(const std::string& key) const;
 
     bool is_modified() const { return !read_only && !empty(); }
 
@@ -42,6 +42,35 @@ HoneyValueList::update_reader()
     return true;
 }
 
+void
+HoneyValueList::find_chunk_in_range(const string& lo, const string& hi)
+{
+    while (!cursor->after_end()) {
+	Xapian::docid last_did = docid_from_key(slot, cursor->current_key);
+	if (!last_did) break;
+
+	cursor->read_tag();
+	const string& tag = cursor->current_tag;
+	const char* p = tag.data();
+	const char* end = p + tag.size();
+	Xapian::docid delta;
+	string lower, upper;
+	if (!decode_valuechunk_header(&p, end, delta, lower, upper)) {
+	    throw Xapian::DatabaseCorruptError("Failed to unpack value chunk "
+					       "header");
+	}
+	if (upper >= lo && (hi.empty() || lower <= hi)) {
+	    reader.assign(tag.data(), tag.size(), last_did);
+	    return;
+	}
+	cursor->next();
+    }
+
+    // We've reached the end.
+    delete cursor;
+    cursor = NULL;
+}
+
 HoneyValueList::~HoneyValueList()
 {
     delete cursor;
@@ -133,6 +162,42 @@ HoneyValueList::skip_to(Xapian::docid did)
     cursor = NULL;
 }
 
+void
+HoneyValueList::next_in_range(const string& lo, const string& hi)
+{
+    if (!cursor) {
+	cursor = db->get_postlist_cursor();
+	if (!cursor) return;
+	cursor->find_entry_ge(make_valuechunk_key(slot, 1));
+    } else {
+	if (!reader.at_end()) {
+	    reader.next();
+	    if (!reader.at_end()) return;
+	}
+	cursor->next();
+    }
+    find_chunk_in_range(lo, hi);
+}
+
+void
+HoneyValueList::skip_to_in_range(Xapian::docid did,
+				 const string& lo, const string& hi)
+{
+    if (!cursor) {
+	cursor = db->get_postlist_cursor();
+	if (!cursor) return;
+    } else if (!reader.at_end()) {
+	reader.skip_to(did);
+	if (!reader.at_end()) return;
+    }
+
+    // Chunks are keyed by their last docid, so this finds the chunk which
+    // would contain did, or the first chunk after it.
+    (void)cursor->find_entry_ge(make_valuechunk_key(slot, did));
+    find_chunk_in_range(lo, hi);
+    if (cursor) reader.skip_to(did);
+}
+
 string
 HoneyValueList::get_description() const
 {
@@ -46,6 +46,12 @@ class HoneyValueList : public Xapian::ValueIterator::Internal {
     /// Update @a reader to use the chunk currently pointed to by @a cursor.
     bool update_reader();
 
+    /** Move @a cursor forward to the first chunk which might have a value in
+     *  [@a lo, @a hi], starting with the current entry, and update @a reader
+     *  to use it.
+     */
+    void find_chunk_in_range(const std::string& lo, const std::string& hi);
+
   public:
     HoneyValueList(Xapian::valueno slot_, const HoneyDatabase* db_)
 	: cursor(NULL), slot(slot_), db(db_) { }
@@ -64,6 +70,11 @@ class HoneyValueList : public Xapian::ValueIterator::Internal {
 
     void skip_to(Xapian::docid);
 
+    void next_in_range(const std::string& lo, const std::string& hi);
+
+    void skip_to_in_range(Xapian::docid did,
+			  const std::string& lo, const std::string& hi);
+
     std::string get_description() const;
 };
 
@@ -52,8 +52,10 @@ ValueChunkReader::assign(const char* p_, size_t len, Xapian::docid last_did)
 {
     p = p_;
     end = p_ + len;
-    if (!unpack_uint(&p, end, &did))
-	throw Xapian::DatabaseCorruptError("Failed to unpack docid delta");
+    string lower, upper;
+    if (!decode_valuechunk_header(&p, end, did, lower, upper))
+	throw Xapian::DatabaseCorruptError("Failed to unpack value chunk "
+					   "header");
     did = last_did - did;
     if (!unpack_string(&p, end, value))
 	throw Xapian::DatabaseCorruptError("Failed to unpack first value");
@@ -107,6 +107,41 @@ encode_valuestats(Xapian::doccount freq,
     return value;
 }
 
+/** Encode the header of a value stream chunk.
+ *
+ *  @param delta	The last docid in the chunk minus the first.
+ *  @param lower	The lowest value in the chunk.
+ *  @param upper	The highest value in the chunk.
+ */
+inline std::string
+encode_valuechunk_header(Xapian::docid delta,
+			 const std::string& lower,
+			 const std::string& upper)
+{
+    std::string header;
+    pack_uint(header, delta);
+    pack_string(header, lower);
+    pack_string(header, upper);
+    return header;
+}
+
+/** Decode the header of a value stream chunk.
+ *
+ *  On success, @a *p is left pointing to the first value in the chunk.
+ *
+ *  @return false if the header is corrupt.
+ */
+inline bool
+decode_valuechunk_header(const char** p, const char* end,
+			 Xapian::docid& delta,
+			 std::string& lower,
+			 std::string& upper)
+{
+    return unpack_uint(p, end, &delta) &&
+	   unpack_string(p, end, lower) &&
+	   unpack_string(p, end, upper);
+}
+
 }
 
 namespace Xapian {
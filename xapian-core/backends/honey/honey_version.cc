@@ -51,8 +51,11 @@
 using namespace std;
 
 /// Honey format version (date of change):
-#define HONEY_FORMAT_VERSION DATE_TO_VERSION(2018,4,3)
-// 2018,4,3   1.5.0 outlaw mixed-wdf terms
+#define HONEY_FORMAT_VERSION DATE_TO_VERSION(2026,10,19)
+// 2026,10,19 1.5.0 store bounds of values in each value chunk
+// 2026,10,18       optional Stream VByte postings
+// 2026,10,17       store per chunk wdf_max
+// 2018,4,3         outlaw mixed-wdf terms
 // 2018,3,28        don't special case first entry in SSTable
 // 2018,3,27        new key format for value stats, value chunks, doclen chunks
 // 2018,3,26        use known suffix from spelling B and T keys
@@ -321,6 +321,22 @@ MultiDatabase::open_value_list(Xapian::valueno slot) const
     }
 }
 
+void
+MultiDatabase::add_value_column(Xapian::valueno slot, unsigned width)
+{
+    for (auto&& shard : shards) {
+	shard->add_value_column(slot, width);
+    }
+}
+
+void
+MultiDatabase::add_value_dictionary(Xapian::valueno slot)
+{
+    for (auto&& shard : shards) {
+	shard->add_value_dictionary(slot);
+    }
+}
+
 Xapian::termcount
 MultiDatabase::get_doclength(Xapian::docid did) const
 {
@@ -502,6 +518,16 @@ MultiDatabase::get_uuid() const
     return uuid;
 }
 
+bool
+MultiDatabase::append_revision_key(string& key) const
+{
+    for (auto&& shard : shards) {
+	if (!shard->append_revision_key(key))
+	    return false;
+    }
+    return true;
+}
+
 bool
 MultiDatabase::locked() const
 {
@@ -553,6 +579,20 @@ MultiDatabase::commit()
     }
 }
 
+void
+MultiDatabase::wait_for_durable(Xapian::rev revision)
+{
+    if (revision != 0) {
+	throw Xapian::InvalidOperationError("WritableDatabase::"
+					    "wait_for_durable() with a "
+					    "revision and more than one "
+					    "subdatabase");
+    }
+    for (auto&& shard : shards) {
+	shard->wait_for_durable(0);
+    }
+}
+
 void
 MultiDatabase::cancel()
 {
@@ -99,6 +99,10 @@ class MultiDatabase : public Xapian::Database::Internal {
 
     ValueList* open_value_list(Xapian::valueno slot) const;
 
+    void add_value_column(Xapian::valueno slot, unsigned width);
+
+    void add_value_dictionary(Xapian::valueno slot);
+
     Xapian::termcount get_doclength(Xapian::docid did) const;
 
     Xapian::termcount get_unique_terms(Xapian::docid did) const;
@@ -126,6 +130,8 @@ class MultiDatabase : public Xapian::Database::Internal {
 
     std::string get_uuid() const;
 
+    bool append_revision_key(std::string& key) const;
+
     bool locked() const;
 
     void write_changesets_to_fd(int fd,
@@ -141,6 +147,8 @@ class MultiDatabase : public Xapian::Database::Internal {
 
     void commit();
 
+    void wait_for_durable(Xapian::rev revision);
+
     void cancel();
 
     void begin_transaction(bool flushed);
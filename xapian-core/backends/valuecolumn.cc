@@ -0,0 +1,164 @@
+/** @file
+ * @brief Values in a slot held in memory as a fixed-width column
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include <config.h>
+
+#include "valuecolumn.h"
+
+#include "omassert.h"
+#include "str.h"
+#include "unicode/description_append.h"
+
+#include <cstring>
+
+using namespace std;
+
+void
+ValueColumn::load(ValueList& vl)
+{
+    while (vl.next(), !vl.at_end()) {
+	Xapian::docid did = vl.get_docid();
+	AssertRel(did,>,last_docid);
+	cells.resize(size_t(did) * (width + 1));
+	last_docid = did;
+	string value = vl.get_value();
+	auto p = cells.data() + size_t(did - 1) * (width + 1);
+	if (value.size() > width) {
+	    *p = LONG_VALUE;
+	    long_values.emplace(did, std::move(value));
+	} else {
+	    *p = static_cast<unsigned char>(value.size());
+	    memcpy(p + 1, value.data(), value.size());
+	}
+    }
+}
+
+string
+ValueColumn::get_value(Xapian::docid did) const
+{
+    if (did - 1 >= last_docid)
+	return string();
+    auto p = cell(did);
+    if (*p == LONG_VALUE)
+	return long_values.find(did)->second;
+    return string(reinterpret_cast<const char*>(p + 1), *p);
+}
+
+void
+ValueColumn::get_value_view(Xapian::docid did,
+			    const char*& p, size_t& len) const
+{
+    if (did - 1 >= last_docid) {
+	p = "";
+	len = 0;
+	return;
+    }
+    auto c = cell(did);
+    if (*c == LONG_VALUE) {
+	const string& value = long_values.find(did)->second;
+	p = value.data();
+	len = value.size();
+	return;
+    }
+    p = reinterpret_cast<const char*>(c + 1);
+    len = *c;
+}
+
+Xapian::docid
+ValueColumnList::get_docid() const
+{
+    return current_did;
+}
+
+string
+ValueColumnList::get_value() const
+{
+    return column->get_value(current_did);
+}
+
+bool
+ValueColumnList::get_value_view(const char*& p, size_t& len) const
+{
+    column->get_value_view(current_did, p, len);
+    return true;
+}
+
+Xapian::valueno
+ValueColumnList::get_valueno() const
+{
+    return slot;
+}
+
+bool
+ValueColumnList::at_end() const
+{
+    return ended;
+}
+
+void
+ValueColumnList::next()
+{
+    Xapian::docid last = column->get_last_docid();
+    while (current_did < last) {
+	if (column->has_value(++current_did))
+	    return;
+    }
+    ended = true;
+}
+
+void
+ValueColumnList::skip_to(Xapian::docid did)
+{
+    if (did <= current_did) return;
+    current_did = did - 1;
+    next();
+}
+
+bool
+ValueColumnList::check(Xapian::docid did)
+{
+    if (did <= current_did) {
+	return column->has_value(current_did);
+    }
+
+    if (did > column->get_last_docid()) {
+	ended = true;
+	return true;
+    }
+
+    current_did = did;
+    return column->has_value(did);
+}
+
+string
+ValueColumnList::get_description() const
+{
+    string desc = "ValueColumnList(slot=";
+    desc += str(slot);
+    if (!ended) {
+	desc += ", docid=";
+	desc += str(current_did);
+	desc += ", value=\"";
+	description_append(desc, get_value());
+	desc += "\")";
+    } else {
+	desc += ", atend)";
+    }
+    return desc;
+}
@@ -0,0 +1,131 @@
+/** @file
+ * @brief Values in a slot held in memory as a fixed-width column
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_VALUECOLUMN_H
+#define XAPIAN_INCLUDED_VALUECOLUMN_H
+
+#include "valuelist.h"
+
+#include "xapian/types.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/** The values in a slot held in memory as a fixed-width column.
+ *
+ *  There's a cell for each docid up to the last one with a value, holding a
+ *  length byte followed by the value padded to the column width, so finding
+ *  the value for a document doesn't need to decode the value stream.  Values
+ *  too long for a cell are stored separately.
+ */
+class ValueColumn {
+    /// Length byte for a value which is stored in long_values.
+    static constexpr unsigned char LONG_VALUE = 255;
+
+    /// The number of bytes of value in each cell.
+    unsigned width;
+
+    /// The cells, for docids 1 to last_docid.
+    std::vector<unsigned char> cells;
+
+    /// The last docid with a cell.
+    Xapian::docid last_docid = 0;
+
+    /// Values which are too long to fit in a cell.
+    std::map<Xapian::docid, std::string> long_values;
+
+    const unsigned char* cell(Xapian::docid did) const {
+	return cells.data() + size_t(did - 1) * (width + 1);
+    }
+
+  public:
+    /// The largest width supported.
+    static constexpr unsigned MAX_WIDTH = LONG_VALUE - 1;
+
+    explicit ValueColumn(unsigned width_) : width(width_) { }
+
+    /// Read all the values from value stream @a vl.
+    void load(ValueList& vl);
+
+    /// Return the last docid which has a value.
+    Xapian::docid get_last_docid() const { return last_docid; }
+
+    /// Does document @a did have a value?
+    bool has_value(Xapian::docid did) const {
+	return did - 1 < last_docid && cell(did)[0] != 0;
+    }
+
+    /// Return the value for document @a did (empty if it hasn't one).
+    std::string get_value(Xapian::docid did) const;
+
+    /** Point to the value for document @a did without copying it.
+     *
+     *  The pointer remains valid for the lifetime of this object.
+     */
+    void get_value_view(Xapian::docid did,
+			const char*& p, size_t& len) const;
+};
+
+/// A value stream which reads from a ValueColumn.
+class ValueColumnList : public ValueList {
+    /// Don't allow assignment.
+    void operator=(const ValueColumnList&) = delete;
+
+    /// Don't allow copying.
+    ValueColumnList(const ValueColumnList&) = delete;
+
+    /// The column (which stays valid if the database drops it).
+    std::shared_ptr<const ValueColumn> column;
+
+    /// The value slot we're iterating over.
+    Xapian::valueno slot;
+
+    /// The document id at the current position.
+    Xapian::docid current_did = 0;
+
+    /// Have we reached the end?
+    bool ended = false;
+
+  public:
+    ValueColumnList(const std::shared_ptr<const ValueColumn>& column_,
+		    Xapian::valueno slot_)
+	: column(column_), slot(slot_) { }
+
+    Xapian::docid get_docid() const;
+
+    std::string get_value() const;
+
+    bool get_value_view(const char*& p, size_t& len) const;
+
+    Xapian::valueno get_valueno() const;
+
+    bool at_end() const;
+
+    void next();
+
+    void skip_to(Xapian::docid did);
+
+    bool check(Xapian::docid did);
+
+    std::string get_description() const;
+};
+
+#endif // XAPIAN_INCLUDED_VALUECOLUMN_H
@@ -0,0 +1,43 @@
+/** @file
+ * @brief Dictionary of the distinct values in a slot
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include <config.h>
+
+#include "valuedictionary.h"
+
+#include "omassert.h"
+
+#include <unordered_map>
+
+using namespace std;
+
+void
+ValueDictionary::load(ValueList& vl)
+{
+    unordered_map<string, uint32_t> index;
+    while (vl.next(), !vl.at_end()) {
+	Xapian::docid did = vl.get_docid();
+	AssertRel(did,>,ordinals.size());
+	auto r = index.emplace(vl.get_value(), uint32_t(values.size() + 1));
+	if (r.second)
+	    values.push_back(r.first->first);
+	ordinals.resize(did);
+	ordinals[did - 1] = r.first->second;
+    }
+}
@@ -0,0 +1,62 @@
+/** @file
+ * @brief Dictionary of the distinct values in a slot
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_VALUEDICTIONARY_H
+#define XAPIAN_INCLUDED_VALUEDICTIONARY_H
+
+#include "valuelist.h"
+
+#include "xapian/types.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/** Dictionary of the distinct values in a slot.
+ *
+ *  Each distinct value has an ordinal (starting from 1), and there's an array
+ *  indexed by docid giving the ordinal of each document's value, so values
+ *  can be counted in an array indexed by ordinal without fetching them.
+ */
+class ValueDictionary {
+    /// The distinct values, in the order first seen (indexed by ordinal - 1).
+    std::vector<std::string> values;
+
+    /// The ordinal of the value for each docid (0 if it hasn't one).
+    std::vector<uint32_t> ordinals;
+
+  public:
+    /// Read all the values from value stream @a vl.
+    void load(ValueList& vl);
+
+    /// Return the number of distinct values.
+    size_t size() const { return values.size(); }
+
+    /// Return the ordinal of document @a did's value (0 if it hasn't one).
+    uint32_t get_ordinal(Xapian::docid did) const {
+	return did - 1 < ordinals.size() ? ordinals[did - 1] : 0;
+    }
+
+    /// Return the value with ordinal @a ordinal (from 1 to size()).
+    const std::string& get_value(uint32_t ordinal) const {
+	return values[ordinal - 1];
+    }
+};
+
+#endif // XAPIAN_INCLUDED_VALUEDICTIONARY_H
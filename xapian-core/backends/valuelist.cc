@@ -33,4 +33,24 @@ ValueIterator::Internal::check(Xapian::docid did)
     return true;
 }
 
+void
+ValueIterator::Internal::next_in_range(const std::string&, const std::string&)
+{
+    next();
+}
+
+void
+ValueIterator::Internal::skip_to_in_range(Xapian::docid did,
+					  const std::string&,
+					  const std::string&)
+{
+    skip_to(did);
+}
+
+bool
+ValueIterator::Internal::get_value_view(const char*&, size_t&) const
+{
+    return false;
+}
+
 }
@@ -92,6 +92,45 @@ class Xapian::ValueIterator::Internal : public Xapian::Internal::intrusive_base
      */
     virtual bool check(Xapian::docid did);
 
+    /** Advance to the next entry which might have a value in a range.
+     *
+     *  Like next(), but may skip over entries whose values are known to lie
+     *  outside the range [@a lo, @a hi] - for example, a whole chunk of the
+     *  stream whose stored bounds don't overlap the range.  The entry moved
+     *  to may still have a value outside the range, so the caller still
+     *  needs to check.
+     *
+     *  @param lo	The lower end of the range (empty for no lower limit).
+     *  @param hi	The upper end of the range (empty for no upper limit).
+     *
+     *  The default implementation calls next().
+     */
+    virtual void next_in_range(const std::string& lo, const std::string& hi);
+
+    /** Skip forward to the specified docid or a later entry which might have
+     *  a value in a range.
+     *
+     *  Like skip_to(), but may skip over entries as next_in_range() does.
+     *
+     *  The default implementation calls skip_to().
+     */
+    virtual void skip_to_in_range(Xapian::docid did,
+				  const std::string& lo,
+				  const std::string& hi);
+
+    /** Return the value at the current position without copying it.
+     *
+     *  @param[out] p	Set to point to the value's bytes.
+     *  @param[out] len	Set to the length of the value.
+     *
+     *  @return true if @a p and @a len were set, false if this value stream
+     *		can't do this (in which case call get_value() instead).  The
+     *		value remains valid until the value stream is deleted.
+     *
+     *  The default implementation returns false.
+     */
+    virtual bool get_value_view(const char*& p, size_t& len) const;
+
     /// Return a string description of this object.
     virtual std::string get_description() const = 0;
 };
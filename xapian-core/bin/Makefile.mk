@@ -64,9 +64,11 @@ bin_xapian_inspect_CPPFLAGS =\
 bin_xapian_inspect_SOURCES = bin/xapian-inspect.cc\
 	api/constinfo.cc\
 	api/error.cc\
+	backends/blockcache.cc\
 	backends/glass/glass_changes.cc\
 	backends/glass/glass_cursor.cc\
 	backends/glass/glass_freelist.cc\
+	backends/glass/glass_syncer.cc\
 	backends/glass/glass_table.cc\
 	backends/glass/glass_version.cc\
 	backends/uuids.cc\
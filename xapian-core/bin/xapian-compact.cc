@@ -29,6 +29,7 @@
 #include <iostream>
 
 #include "gnu_getopt.h"
+#include "parseint.h"
 
 #include "backends/glass/glass_defs.h"
 
@@ -40,6 +41,7 @@ using namespace std;
 #define OPT_HELP 1
 #define OPT_VERSION 2
 #define OPT_NO_RENUMBER 3
+#define OPT_STREAM_VBYTE 4
 
 static void show_usage() {
     cout << "Usage: " PROG_NAME " [OPTIONS] SOURCE_DATABASE... DESTINATION_DATABASE\n\n"
@@ -62,6 +64,10 @@ static void show_usage() {
 "                     option is only supported when merging databases if they\n"
 "                     have disjoint ranges of used document ids\n"
 "  -s, --single-file  Produce a single file database\n"
+"  -j, --threads=N    Compact up to N tables at once (default 1; ignored for\n"
+"                     single file output)\n"
+"      --stream-vbyte Encode postlists using Stream VByte, which is faster to\n"
+"                     decode but larger (only supported for honey)\n"
 "  --help             display this help and exit\n"
 "  --version          output version information and exit" << endl;
 }
@@ -89,7 +95,7 @@ MyCompactor::set_status(const string & table, const string & status)
 	return;
     if (!status.empty())
 	cout << '\r' << table << ": " << status << endl;
-    else
+    else if (get_threads() == 1)
 	cout << table << " ..." << flush;
 }
 
@@ -111,7 +117,7 @@ MyCompactor::resolve_duplicate_metadata(const string & key,
 int
 main(int argc, char **argv)
 {
-    const char * opts = "b:B:nFmqs";
+    const char * opts = "b:B:nFmqsj:";
     static const struct option long_opts[] = {
 	{"fuller",	no_argument, 0, 'F'},
 	{"no-full",	no_argument, 0, 'n'},
@@ -120,6 +126,8 @@ main(int argc, char **argv)
 	{"backend",	required_argument, 0, 'B'},
 	{"no-renumber", no_argument, 0, OPT_NO_RENUMBER},
 	{"single-file", no_argument, 0, 's'},
+	{"threads",	required_argument, 0, 'j'},
+	{"stream-vbyte", no_argument, 0, OPT_STREAM_VBYTE},
 	{"quiet",	no_argument, 0, 'q'},
 	{"help",	no_argument, 0, OPT_HELP},
 	{"version",	no_argument, 0, OPT_VERSION},
@@ -183,6 +191,19 @@ main(int argc, char **argv)
 	    case 's':
 		flags |= Xapian::DBCOMPACT_SINGLE_FILE;
 		break;
+	    case 'j': {
+		unsigned threads;
+		if (!parse_unsigned(optarg, threads) || threads == 0) {
+		    cerr << PROG_NAME": Bad value '" << optarg << "' passed "
+			    "for threads, must be a positive integer" << endl;
+		    exit(1);
+		}
+		compactor.set_threads(threads);
+		break;
+	    }
+	    case OPT_STREAM_VBYTE:
+		flags |= Xapian::DBCOMPACT_STREAM_VBYTE;
+		break;
 	    case 'q':
 		compactor.set_quiet(true);
 		break;
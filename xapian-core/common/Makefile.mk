@@ -16,6 +16,7 @@ noinst_HEADERS +=\
 	common/io_utils.h\
 	common/keyword.h\
 	common/log2.h\
+	common/lrucache.h\
 	common/min_non_zero.h\
 	common/msvc_dirent.h\
 	common/msvcignoreinvalidparam.h\
@@ -23,6 +24,7 @@ noinst_HEADERS +=\
 	common/output.h\
 	common/overflow.h\
 	common/pack.h\
+	common/parallelfor.h\
 	common/parseint.h\
 	common/posixy_wrapper.h\
 	common/pretty.h\
@@ -44,6 +46,7 @@ noinst_HEADERS +=\
 	common/socket_utils.h\
 	common/stdclamp.h\
 	common/str.h\
+	common/streamvbyte.h\
 	common/stringutils.h\
 	common/wordaccess.h
 
@@ -79,6 +82,11 @@ lib_src +=\
 endif
 endif
 
+if BUILD_BACKEND_HONEY
+lib_src +=\
+	common/streamvbyte.cc
+endif
+
 noinst_LTLIBRARIES += libgetopt.la
 
 libgetopt_la_SOURCES =\
@@ -25,8 +25,20 @@
 #include "posixy_wrapper.h"
 
 #include "safeunistd.h"
+#include "safesysstat.h"
 
+#if defined HAVE_MMAP || defined HAVE_IO_URING
+# include <sys/mman.h>
+#endif
+#ifdef HAVE_IO_URING
+# include <sched.h>
+# include <sys/syscall.h>
+# include <linux/io_uring.h>
+#endif
+
+#include <algorithm>
 #include <cerrno>
+#include <cstdint>
 #include <cstring>
 #include <string>
 
@@ -256,6 +268,30 @@ io_readahead_block(int fd, size_t n, off_t b, off_t o)
 }
 #endif
 
+#ifdef HAVE_MMAP
+const char *
+io_map_file(int fd, size_t & size)
+{
+    size = 0;
+    struct stat statbuf;
+    if (fstat(fd, &statbuf) < 0 || statbuf.st_size <= 0)
+	return NULL;
+    void * p = mmap(NULL, statbuf.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED)
+	return NULL;
+    size = statbuf.st_size;
+    return static_cast<const char *>(p);
+}
+
+void
+io_unmap_file(const char * p, size_t size)
+{
+    // If an error occurs here, we just ignore it, since there's nothing
+    // useful we could do about it.
+    (void)munmap(const_cast<char *>(p), size);
+}
+#endif
+
 void
 io_read_block(int fd, char * p, size_t n, off_t b, off_t o)
 {
@@ -304,6 +340,272 @@ io_read_block(int fd, char * p, size_t n, off_t b, off_t o)
 #endif
 }
 
+#ifdef HAVE_IO_URING
+namespace {
+
+/** A minimal io_uring instance for submitting batches of reads.
+ *
+ *  We talk to the kernel directly rather than requiring liburing, since all
+ *  we need to do is submit some reads and wait for them all to complete.
+ */
+class ReadRing {
+    int ring_fd = -1;
+
+    void * sq_ring = MAP_FAILED;
+
+    size_t sq_ring_size = 0;
+
+    /// MAP_FAILED if the completion queue is in the same mapping as sq_ring.
+    void * cq_ring = MAP_FAILED;
+
+    size_t cq_ring_size = 0;
+
+    void * sqes_mapping = MAP_FAILED;
+
+    size_t sqes_size = 0;
+
+    unsigned * sq_head;
+
+    unsigned * sq_tail;
+
+    unsigned sq_mask;
+
+    unsigned * sq_array;
+
+    io_uring_sqe * sqes;
+
+    unsigned * cq_head;
+
+    unsigned * cq_tail;
+
+    unsigned cq_mask;
+
+    io_uring_cqe * cqes;
+
+    /** How many times to retry io_uring_enter() after a transient error.
+     *
+     *  After this many failures in a row we stop submitting, wait for the
+     *  reads already submitted, and let the caller read the rest itself.
+     */
+    enum { MAX_RETRIES = 16 };
+
+    /// Submit @a to_submit entries and wait for @a wait_for completions.
+    int enter(unsigned to_submit, unsigned wait_for) {
+	return int(syscall(__NR_io_uring_enter, ring_fd, to_submit, wait_for,
+			   IORING_ENTER_GETEVENTS, NULL, 0));
+    }
+
+    /** Store the results of any completed reads.
+     *
+     *  @return The number of completions reaped.
+     */
+    size_t reap(ssize_t * results);
+
+  public:
+    /// The most reads which can be submitted in one batch.
+    enum { ENTRIES = 64 };
+
+    ReadRing();
+
+    ~ReadRing();
+
+    bool ok() const { return ring_fd >= 0; }
+
+    /** Read @a n bytes at offsets[i] into bufs[i], for i < count.
+     *
+     *  @a count must be at most ENTRIES.  Once all the reads have completed,
+     *  results[i] is set to the return value of the read (the number of
+     *  bytes read, or a negated errno value).  If submitting the reads keeps
+     *  failing part way through, results[i] is -ECANCELED for those which
+     *  weren't submitted.
+     *
+     *  @return false if the reads couldn't be submitted (in which case none
+     *		of them have been).
+     */
+    bool read(int fd, char * const * bufs, size_t n, const off_t * offsets,
+	      size_t count, ssize_t * results);
+};
+
+ReadRing::ReadRing()
+{
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = int(syscall(__NR_io_uring_setup, unsigned(ENTRIES), &params));
+    // This will fail if the kernel doesn't support io_uring, or it has been
+    // disabled (e.g. by a seccomp filter), in which case ok() returns false.
+    if (fd < 0) return;
+
+    sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_size = params.cq_off.cqes +
+		     params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP);
+    if (single_mmap) sq_ring_size = std::max(sq_ring_size, cq_size);
+    sq_ring = mmap(NULL, sq_ring_size, PROT_READ|PROT_WRITE,
+		   MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sq_ring == MAP_FAILED) {
+	::close(fd);
+	return;
+    }
+    char * cq_base = static_cast<char *>(sq_ring);
+    if (!single_mmap) {
+	cq_ring_size = cq_size;
+	cq_ring = mmap(NULL, cq_ring_size, PROT_READ|PROT_WRITE,
+		       MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+	if (cq_ring == MAP_FAILED) {
+	    ::close(fd);
+	    return;
+	}
+	cq_base = static_cast<char *>(cq_ring);
+    }
+    sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_mapping = mmap(NULL, sqes_size, PROT_READ|PROT_WRITE,
+			MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes_mapping == MAP_FAILED) {
+	::close(fd);
+	return;
+    }
+
+    char * sq_base = static_cast<char *>(sq_ring);
+    sq_head = reinterpret_cast<unsigned *>(sq_base + params.sq_off.head);
+    sq_tail = reinterpret_cast<unsigned *>(sq_base + params.sq_off.tail);
+    sq_mask = *reinterpret_cast<unsigned *>(sq_base + params.sq_off.ring_mask);
+    sq_array = reinterpret_cast<unsigned *>(sq_base + params.sq_off.array);
+    sqes = static_cast<io_uring_sqe *>(sqes_mapping);
+    cq_head = reinterpret_cast<unsigned *>(cq_base + params.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned *>(cq_base + params.cq_off.tail);
+    cq_mask = *reinterpret_cast<unsigned *>(cq_base + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe *>(cq_base + params.cq_off.cqes);
+    ring_fd = fd;
+}
+
+ReadRing::~ReadRing()
+{
+    if (sqes_mapping != MAP_FAILED) munmap(sqes_mapping, sqes_size);
+    if (cq_ring != MAP_FAILED) munmap(cq_ring, cq_ring_size);
+    if (sq_ring != MAP_FAILED) munmap(sq_ring, sq_ring_size);
+    if (ring_fd >= 0) ::close(ring_fd);
+}
+
+size_t
+ReadRing::reap(ssize_t * results)
+{
+    unsigned head = *cq_head;
+    unsigned cq_end = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+    size_t n = cq_end - head;
+    while (head != cq_end) {
+	const io_uring_cqe * cqe = &cqes[head & cq_mask];
+	results[cqe->user_data] = cqe->res;
+	++head;
+    }
+    __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    return n;
+}
+
+bool
+ReadRing::read(int fd, char * const * bufs, size_t n, const off_t * offsets,
+	       size_t count, ssize_t * results)
+{
+    AssertRel(count,<=,size_t(ENTRIES));
+    // Only we update the tail of the submission queue.
+    unsigned tail = *sq_tail;
+    for (size_t i = 0; i != count; ++i) {
+	unsigned index = (tail + i) & sq_mask;
+	io_uring_sqe * sqe = &sqes[index];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = IORING_OP_READ;
+	sqe->fd = fd;
+	sqe->addr = reinterpret_cast<uintptr_t>(bufs[i]);
+	sqe->len = unsigned(n);
+	sqe->off = offsets[i];
+	sqe->user_data = i;
+	sq_array[index] = index;
+    }
+    __atomic_store_n(sq_tail, tail + unsigned(count), __ATOMIC_RELEASE);
+
+    unsigned to_submit = unsigned(count);
+    size_t done = 0;
+    unsigned retries = 0;
+    while (done != count) {
+	int r = enter(to_submit, unsigned(count - done));
+	if (r >= 0) {
+	    to_submit -= std::min(unsigned(r), to_submit);
+	    retries = 0;
+	} else if ((errno != EINTR && errno != EAGAIN && errno != EBUSY) ||
+		   ++retries > MAX_RETRIES) {
+	    // Give up on the ring, taking back any entries the kernel hasn't
+	    // consumed.
+	    unsigned submitted = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) -
+				 tail;
+	    __atomic_store_n(sq_tail, tail + submitted, __ATOMIC_RELEASE);
+	    if (submitted == 0) {
+		// Let the caller fall back to reading the blocks itself.
+		return false;
+	    }
+	    // Reads are in progress into the caller's buffers so we can't
+	    // return until they've completed, but io_uring_enter() may keep
+	    // failing so poll the completion queue.  Completions are posted
+	    // on return from any system call, so yield between polls.
+	    done += reap(results);
+	    while (done != submitted) {
+		sched_yield();
+		done += reap(results);
+	    }
+	    // The caller reads the blocks we didn't submit itself.
+	    for (size_t i = submitted; i != count; ++i) {
+		results[i] = -ECANCELED;
+	    }
+	    return true;
+	}
+	done += reap(results);
+    }
+    return true;
+}
+
+}
+#endif
+
+void
+io_read_blocks(int fd, char * const * bufs, size_t n, const off_t * blocks,
+	       size_t count, off_t o)
+{
+#ifdef HAVE_IO_URING
+    if (count > 1) {
+	// Each thread has its own ring, created the first time it's needed.
+	static thread_local ReadRing ring;
+	while (ring.ok() && count != 0) {
+	    off_t offsets[ReadRing::ENTRIES];
+	    ssize_t results[ReadRing::ENTRIES];
+	    size_t batch = std::min(count, size_t(ReadRing::ENTRIES));
+	    for (size_t i = 0; i != batch; ++i) {
+		offsets[i] = o + blocks[i] * n;
+	    }
+	    if (!ring.read(fd, bufs, n, offsets, batch, results))
+		break;
+	    for (size_t i = 0; i != batch; ++i) {
+		// On an error or a short read, retry with io_read_block() which
+		// handles those cases.
+		if (rare(results[i] != ssize_t(n)))
+		    io_read_block(fd, bufs[i], n, blocks[i], o);
+	    }
+	    bufs += batch;
+	    blocks += batch;
+	    count -= batch;
+	}
+    }
+#endif
+    // Request readahead for all the blocks before reading any of them, so
+    // the reads can be serviced in parallel.
+    if (count > 1) {
+	for (size_t i = 0; i != count; ++i) {
+	    if (!io_readahead_block(fd, n, blocks[i], o))
+		break;
+	}
+    }
+    for (size_t i = 0; i != count; ++i) {
+	io_read_block(fd, bufs[i], n, blocks[i], o);
+    }
+}
+
 void
 io_write_block(int fd, const char * p, size_t n, off_t b, off_t o)
 {
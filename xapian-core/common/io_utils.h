@@ -159,6 +159,42 @@ inline bool io_readahead_block(int, size_t, off_t, off_t = 0) { return false; }
 /// Read block b size n bytes into buffer p from file descriptor fd, offset o.
 void io_read_block(int fd, char * p, size_t n, off_t b, off_t o = 0);
 
+/** Read a batch of blocks size n bytes from file descriptor fd, offset o.
+ *
+ *  Block blocks[i] is read into buffer bufs[i], for i from 0 to count - 1.
+ *
+ *  The reads are issued together so they can be serviced in parallel.  If
+ *  io_uring is enabled (which configure does by default where it's
+ *  available) and the kernel allows it, they're submitted in a single system
+ *  call; otherwise readahead is requested for all the blocks before they're
+ *  read in turn.
+ */
+void io_read_blocks(int fd, char * const * bufs, size_t n,
+		    const off_t * blocks, size_t count, off_t o = 0);
+
+/** Map the whole of the file open on file descriptor fd for reading.
+ *
+ *  @param	fd	The file descriptor to map.
+ *  @param	size	Set to the size of the mapping.
+ *
+ *  @return	A pointer to the start of the mapping, or NULL if the file
+ *		couldn't be mapped (e.g. it's empty or the platform doesn't
+ *		support mmap()), in which case the caller should read the file
+ *		in the usual way instead.
+ */
+#ifdef HAVE_MMAP
+const char * io_map_file(int fd, size_t & size);
+#else
+inline const char * io_map_file(int, size_t & size) { size = 0; return NULL; }
+#endif
+
+/// Unmap a mapping returned by io_map_file().
+#ifdef HAVE_MMAP
+void io_unmap_file(const char * p, size_t size);
+#else
+inline void io_unmap_file(const char *, size_t) { }
+#endif
+
 /// Write block b size n bytes from buffer p to file descriptor fd, offset o.
 void io_write_block(int fd, const char * p, size_t n, off_t b, off_t o = 0);
 
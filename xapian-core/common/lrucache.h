@@ -0,0 +1,157 @@
+/** @file lrucache.h
+ * @brief Thread-safe LRU cache with a limit on its total size in bytes.
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_LRUCACHE_H
+#define XAPIAN_INCLUDED_LRUCACHE_H
+
+#include <cstddef>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+/** Thread-safe LRU cache mapping strings to values of type @a V.
+ *
+ *  Each entry is accounted as using @a SizeOf()(key, value) bytes, and least
+ *  recently used entries are discarded to keep the total within the limit
+ *  passed to the constructor.
+ */
+template<typename V, typename SizeOf>
+class LRUCache {
+    /// Don't allow assignment.
+    void operator=(const LRUCache&) = delete;
+
+    /// Don't allow copying.
+    LRUCache(const LRUCache&) = delete;
+
+    typedef std::list<std::pair<std::string, V>> lru_list;
+
+    /// Protects all the members below.
+    mutable std::mutex mutex;
+
+    /// The maximum total size of the entries in bytes.
+    size_t max_size;
+
+    /// The total size of the entries in bytes.
+    size_t size = 0;
+
+    /// The number of lookups which found an entry.
+    size_t hits = 0;
+
+    /// The number of lookups which didn't find an entry.
+    size_t misses = 0;
+
+    /// The cached (key, value) pairs, most recently used first.
+    lru_list entries;
+
+    /// Index of entries by key.
+    std::unordered_map<std::string, typename lru_list::iterator> index;
+
+    /// Remove an entry (caller must hold mutex).
+    void remove(typename lru_list::iterator it) {
+	size -= SizeOf()(it->first, it->second);
+	index.erase(it->first);
+	entries.erase(it);
+    }
+
+  public:
+    explicit LRUCache(size_t max_size_) : max_size(max_size_) { }
+
+    size_t get_max_size() const { return max_size; }
+
+    size_t get_size() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return size;
+    }
+
+    size_t get_entry_count() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return entries.size();
+    }
+
+    size_t get_hits() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return hits;
+    }
+
+    size_t get_misses() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return misses;
+    }
+
+    /** Look up an entry.
+     *
+     *  @param key	The key to look up.
+     *  @param value	Set to the cached value if found.
+     *
+     *  @return true if an entry was found.
+     */
+    bool find(const std::string& key, V& value) {
+	std::lock_guard<std::mutex> lock(mutex);
+	auto i = index.find(key);
+	if (i == index.end()) {
+	    ++misses;
+	    return false;
+	}
+	++hits;
+	// Move the entry to the front of the list as it's now the most
+	// recently used.
+	entries.splice(entries.begin(), entries, i->second);
+	value = i->second->second;
+	return true;
+    }
+
+    /** Add an entry.
+     *
+     *  If there's already an entry for @a key, it is replaced.  Least
+     *  recently used entries are discarded to make room.
+     */
+    void add(const std::string& key, const V& value) {
+	size_t new_size = SizeOf()(key, value);
+	// Don't cache an entry which is bigger than the whole cache.
+	if (new_size > max_size)
+	    return;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	auto i = index.find(key);
+	if (i != index.end()) {
+	    // Another thread may have added the same key since we looked it
+	    // up.
+	    remove(i->second);
+	}
+	while (size + new_size > max_size) {
+	    remove(std::prev(entries.end()));
+	}
+	entries.emplace_front(key, value);
+	index.emplace(key, entries.begin());
+	size += new_size;
+    }
+
+    /// Discard all the entries.
+    void clear() {
+	std::lock_guard<std::mutex> lock(mutex);
+	entries.clear();
+	index.clear();
+	size = 0;
+    }
+};
+
+#endif // XAPIAN_INCLUDED_LRUCACHE_H
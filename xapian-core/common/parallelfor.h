@@ -0,0 +1,90 @@
+/** @file parallelfor.h
+ * @brief Run a function for each of a range of indices using threads.
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_PARALLELFOR_H
+#define XAPIAN_INCLUDED_PARALLELFOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+/** Call @a func(i) for each i in [0, @a n) using up to @a n_threads threads.
+ *
+ *  Indices are handed out in ascending order to whichever thread is free, and
+ *  the calling thread does work too.  If we fail to start a thread, we just
+ *  use the ones we've got.
+ *
+ *  If any call throws an exception, the remaining indices are skipped and the
+ *  first exception thrown is rethrown once all the threads have finished.
+ */
+template<typename F>
+void
+parallel_for(size_t n, unsigned n_threads, F func)
+{
+    if (n_threads <= 1 || n <= 1) {
+	for (size_t i = 0; i != n; ++i) {
+	    func(i);
+	}
+	return;
+    }
+
+    std::atomic<size_t> next(0);
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto worker = [&]() {
+	try {
+	    while (true) {
+		size_t i = next++;
+		if (i >= n)
+		    break;
+		func(i);
+	    }
+	} catch (...) {
+	    next = n;
+	    std::lock_guard<std::mutex> lock(error_mutex);
+	    if (!error)
+		error = std::current_exception();
+	}
+    };
+
+    // This thread works too, so start one fewer extra threads.
+    size_t n_extra = std::min(size_t(n_threads), n) - 1;
+    std::vector<std::thread> threads;
+    threads.reserve(n_extra);
+    try {
+	while (threads.size() != n_extra) {
+	    threads.emplace_back(worker);
+	}
+    } catch (const std::system_error&) {
+	// Just use the threads we've got.
+    }
+    worker();
+    for (auto&& t : threads) {
+	t.join();
+    }
+    if (error)
+	std::rethrow_exception(error);
+}
+
+#endif // XAPIAN_INCLUDED_PARALLELFOR_H
@@ -0,0 +1,162 @@
+/** @file streamvbyte.cc
+ * @brief Encode and decode blocks of integers using Stream VByte.
+ */
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "streamvbyte.h"
+
+#if defined __GNUC__ && (defined __x86_64__ || defined __i386__)
+// We build the SSSE3 kernel using the target attribute and pick it at runtime
+// so that the library doesn't need to be compiled with -mssse3.
+# define STREAMVBYTE_SSSE3
+# include <tmmintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+/// Lookup tables indexed by a control byte.
+struct StreamVByteTables {
+    /// The total number of data bytes for the four values.
+    unsigned char length[256];
+
+#ifdef STREAMVBYTE_SSSE3
+    /// Shuffle masks to expand the data bytes to four 32-bit values.
+    unsigned char shuffle[256][16];
+#endif
+
+    StreamVByteTables() {
+	for (unsigned c = 0; c != 256; ++c) {
+	    unsigned offset = 0;
+	    for (unsigned i = 0; i != 4; ++i) {
+		unsigned len = ((c >> (2 * i)) & 3) + 1;
+#ifdef STREAMVBYTE_SSSE3
+		for (unsigned j = 0; j != 4; ++j) {
+		    // A mask byte with the top bit set gives a zero byte.
+		    shuffle[c][i * 4 + j] = j < len ? offset + j : 0x80;
+		}
+#endif
+		offset += len;
+	    }
+	    length[c] = offset;
+	}
+    }
+};
+
+}
+
+static const StreamVByteTables&
+get_tables()
+{
+    static const StreamVByteTables tables;
+    return tables;
+}
+
+#ifdef STREAMVBYTE_SSSE3
+static bool
+have_ssse3()
+{
+# ifdef __SSSE3__
+    return true;
+# else
+    static const bool result = __builtin_cpu_supports("ssse3");
+    return result;
+# endif
+}
+
+/** Decode groups of four values using SSSE3.
+ *
+ *  Each group is decoded by loading 16 bytes, so we stop when fewer than 16
+ *  bytes remain and leave the remaining values to the scalar code.
+ *
+ *  @return The number of values decoded.
+ */
+__attribute__((target("ssse3")))
+static size_t
+unpack_stream_vbyte_ssse3(const unsigned char* control,
+			  const unsigned char** data_ptr,
+			  const unsigned char* end,
+			  uint32_t* values, size_t n)
+{
+    const StreamVByteTables& tables = get_tables();
+    const unsigned char* data = *data_ptr;
+    size_t i = 0;
+    while (n - i >= 4 && end - data >= 16) {
+	unsigned c = control[i / 4];
+	auto in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+	auto mask =
+	    _mm_loadu_si128(reinterpret_cast<const __m128i*>(tables.shuffle[c]));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(values + i),
+			 _mm_shuffle_epi8(in, mask));
+	data += tables.length[c];
+	i += 4;
+    }
+    *data_ptr = data;
+    return i;
+}
+#endif
+
+void
+pack_stream_vbyte(string& s, const uint32_t* values, size_t n)
+{
+    size_t control_pos = s.size();
+    s.append((n + 3) / 4, '\0');
+    for (size_t i = 0; i != n; ++i) {
+	uint32_t value = values[i];
+	unsigned code = (value > 0xff) + (value > 0xffff) + (value > 0xffffff);
+	unsigned char& control =
+	    reinterpret_cast<unsigned char&>(s[control_pos + i / 4]);
+	control |= code << (2 * (i & 3));
+	for (unsigned j = 0; j <= code; ++j) {
+	    s += static_cast<char>(static_cast<unsigned char>(value));
+	    value >>= 8;
+	}
+    }
+}
+
+bool
+unpack_stream_vbyte(const char** p, const char* end,
+		    uint32_t* values, size_t n)
+{
+    auto control = reinterpret_cast<const unsigned char*>(*p);
+    auto uend = reinterpret_cast<const unsigned char*>(end);
+    size_t control_len = (n + 3) / 4;
+    if (size_t(uend - control) < control_len)
+	return false;
+    const unsigned char* data = control + control_len;
+
+    size_t i = 0;
+#ifdef STREAMVBYTE_SSSE3
+    if (have_ssse3())
+	i = unpack_stream_vbyte_ssse3(control, &data, uend, values, n);
+#endif
+    for ( ; i != n; ++i) {
+	unsigned len = ((control[i / 4] >> (2 * (i & 3))) & 3) + 1;
+	if (size_t(uend - data) < len)
+	    return false;
+	uint32_t value = 0;
+	for (unsigned j = len; j-- > 0; ) {
+	    value = (value << 8) | data[j];
+	}
+	values[i] = value;
+	data += len;
+    }
+    *p = reinterpret_cast<const char*>(data);
+    return true;
+}
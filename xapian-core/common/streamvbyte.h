@@ -0,0 +1,55 @@
+/** @file streamvbyte.h
+ * @brief Encode and decode blocks of integers using Stream VByte.
+ */
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef XAPIAN_INCLUDED_STREAMVBYTE_H
+#define XAPIAN_INCLUDED_STREAMVBYTE_H
+
+#include <cstdint>
+#include <string>
+
+/** Append @a n 32-bit values encoded using Stream VByte to a string.
+ *
+ *  The encoding is a block of control bytes (one per four values, holding a
+ *  2-bit length code for each value) followed by the values themselves as
+ *  1-4 byte little-endian integers.  Separating the lengths from the data
+ *  allows decoding four values at a time with a single SIMD shuffle.
+ *
+ *  The number of values isn't stored, so the caller needs to record it.
+ *
+ *  @param s		The string to append to.
+ *  @param values	The values to encode.
+ *  @param n		The number of values.
+ */
+void pack_stream_vbyte(std::string& s, const std::uint32_t* values, size_t n);
+
+/** Decode @a n 32-bit values encoded by pack_stream_vbyte().
+ *
+ *  Uses an SSSE3 kernel where the CPU supports it.
+ *
+ *  @param p	    Pointer to pointer to the current position in the string.
+ *  @param end	    Pointer to the end of the string.
+ *  @param values   Where to store the decoded values.
+ *  @param n	    The number of values to decode.
+ *
+ *  @return false if there wasn't enough data (in which case *p and the
+ *	    contents of values are unspecified).
+ */
+bool unpack_stream_vbyte(const char** p, const char* end,
+			 std::uint32_t* values, size_t n);
+
+#endif // XAPIAN_INCLUDED_STREAMVBYTE_H
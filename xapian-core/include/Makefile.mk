@@ -9,6 +9,7 @@ inc_HEADERS =\
 
 xapianinclude_HEADERS =\
 	include/xapian/attributes.h\
+	include/xapian/bulkloader.h\
 	include/xapian/cluster.h\
 	include/xapian/compactor.h\
 	include/xapian/constants.h\
@@ -22,12 +23,14 @@ xapianinclude_HEADERS =\
 	include/xapian/enquire.h\
 	include/xapian/eset.h\
 	include/xapian/expanddecider.h\
+	include/xapian/filtercache.h\
 	include/xapian/intrusive_ptr.h\
 	include/xapian/iterator.h\
 	include/xapian/keymaker.h\
 	include/xapian/matchdecider.h\
 	include/xapian/matchspy.h\
 	include/xapian/mset.h\
+	include/xapian/msetcache.h\
 	include/xapian/positioniterator.h\
 	include/xapian/postingiterator.h\
 	include/xapian/postingsource.h\
@@ -35,6 +38,7 @@ xapianinclude_HEADERS =\
 	include/xapian/queryparser.h\
 	include/xapian/registry.h\
 	include/xapian/rset.h\
+	include/xapian/segmenteddatabase.h\
 	include/xapian/stem.h\
 	include/xapian/termgenerator.h\
 	include/xapian/termiterator.h\
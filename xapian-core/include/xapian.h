@@ -70,7 +70,9 @@
 // Searching
 #include <xapian/enquire.h>
 #include <xapian/eset.h>
+#include <xapian/filtercache.h>
 #include <xapian/mset.h>
+#include <xapian/msetcache.h>
 #include <xapian/expanddecider.h>
 #include <xapian/keymaker.h>
 #include <xapian/matchdecider.h>
@@ -103,6 +105,12 @@
 // Database compaction and merging
 #include <xapian/compactor.h>
 
+// Bulk loading
+#include <xapian/bulkloader.h>
+
+// Segmented databases
+#include <xapian/segmenteddatabase.h>
+
 // ELF visibility annotations for GCC.
 #include <xapian/visibility.h>
 
@@ -0,0 +1,139 @@
+/** @file  bulkloader.h
+ *  @brief Build a new database from a stream of documents
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_BULKLOADER_H
+#define XAPIAN_INCLUDED_BULKLOADER_H
+
+#if !defined XAPIAN_IN_XAPIAN_H && !defined XAPIAN_LIB_BUILD
+# error Never use <xapian/bulkloader.h> directly; include <xapian.h> instead.
+#endif
+
+#include <memory>
+#include <string>
+
+#include <xapian/types.h>
+#include <xapian/visibility.h>
+
+namespace Xapian {
+
+class Compactor;
+class Document;
+
+/** Build a new database from a stream of documents.
+ *
+ *  This is faster than adding the documents to a WritableDatabase and then
+ *  compacting it.  Documents are indexed in runs, each of which is written
+ *  to a temporary database as a single batch of appends to new posting
+ *  lists.  finish() merges the runs into a compact database using the
+ *  database compaction code.  At most 16 runs are merged at once, so if
+ *  there are more finish() first merges them in passes into intermediate
+ *  runs.
+ *
+ *  Memory use is bounded by the size of a run, and the number of files open
+ *  at once by the number of runs merged at once.
+ *
+ *  The temporary databases are created in a directory named by appending
+ *  ".tmp" to the database path, which is removed by finish() (or by the
+ *  destructor if finish() isn't called).
+ */
+class XAPIAN_VISIBILITY_DEFAULT BulkLoader {
+  public:
+    /// Class representing the BulkLoader internals.
+    class Internal;
+
+  private:
+    /// @private @internal The internals.
+    std::unique_ptr<Internal> internal;
+
+    /// Don't allow copying.
+    BulkLoader(const BulkLoader&) = delete;
+
+    /// Don't allow assignment.
+    BulkLoader& operator=(const BulkLoader&) = delete;
+
+  public:
+    /** Construct a BulkLoader.
+     *
+     *  @param path	Path to create the database at.  There shouldn't
+     *			already be a database there.
+     *  @param flags	Xapian::DB_BACKEND_GLASS (the default) or
+     *			Xapian::DB_BACKEND_HONEY to specify the type of
+     *			database to create, optionally combined with any of
+     *			the flags and compaction levels which can be passed
+     *			to Database::compact() (except
+     *			Xapian::DBCOMPACT_NO_RENUMBER, which is ignored).
+     *  @param run_size	The number of documents to index in each run
+     *			(default: 0, which means 10000).  Larger runs mean
+     *			fewer runs to merge but use more memory.
+     *  @param block_size  The block size to use for a glass database
+     *			(default: 0, which means to use the default block
+     *			size).
+     */
+    explicit BulkLoader(const std::string& path,
+			int flags = 0,
+			Xapian::doccount run_size = 0,
+			int block_size = 0);
+
+    /** Destructor.
+     *
+     *  If finish() hasn't been called, the temporary databases are removed
+     *  and the database isn't created.
+     */
+    ~BulkLoader();
+
+    /** Add a document.
+     *
+     *  @param document	The document to add.
+     *
+     *  @return The document ID the document will have in the database.
+     *		Documents are numbered from 1 in the order they are added.
+     */
+    Xapian::docid add_document(const Xapian::Document& document);
+
+    /** Set user metadata in the database.
+     *
+     *  The metadata is held in memory until finish() is called.  If the same
+     *  key is set more than once, the last value set is used.
+     *
+     *  @param key	The key to set (must be non-empty).
+     *  @param value	The value to set.
+     */
+    void set_metadata(const std::string& key, const std::string& value);
+
+    /// Return the number of documents added so far.
+    Xapian::doccount get_doccount() const;
+
+    /** Merge the documents added into the database.
+     *
+     *  No more documents can be added after this has been called.
+     */
+    void finish();
+
+    /** Merge the documents added into the database.
+     *
+     *  No more documents can be added after this has been called.
+     *
+     *  @param compactor  Functor to report progress of the final merge.
+     */
+    void finish(Xapian::Compactor& compactor);
+};
+
+}
+
+#endif // XAPIAN_INCLUDED_BULKLOADER_H
@@ -38,6 +38,9 @@ class Database;
 /** Compact a database, or merge and compact several.
  */
 class XAPIAN_VISIBILITY_DEFAULT Compactor {
+    /// Number of threads to use.
+    unsigned threads = 1;
+
   public:
     /** Compaction level. */
     typedef enum {
@@ -54,6 +57,29 @@ class XAPIAN_VISIBILITY_DEFAULT Compactor {
 
     virtual ~Compactor();
 
+    /** Set the number of threads to use.
+     *
+     *  Each table is compacted independently, so with more than one thread
+     *  several tables can be compacted at once.  Compacting to a single file
+     *  database currently always uses one thread, since the tables are
+     *  written one after another.
+     *
+     *  When more than one thread is used, calls to set_status() and
+     *  resolve_duplicate_metadata() may come from any of them, but calls are
+     *  serialised so a subclass doesn't need to worry about locking.
+     *
+     *  @param n_threads	The number of threads to use (0 is treated as 1).
+     *			The default is 1.
+     *
+     *  @since Added in Xapian 1.5.0.
+     */
+    void set_threads(unsigned n_threads) {
+	threads = n_threads ? n_threads : 1;
+    }
+
+    /// Return the number of threads to use.
+    unsigned get_threads() const { return threads; }
+
     /** Update progress.
      *
      *  Subclass this method if you want to get progress updates during
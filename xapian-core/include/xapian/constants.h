@@ -144,6 +144,56 @@ const int DB_NO_TERMLIST	 = 0x20;
  */
 const int DB_RETRY_LOCK		 = 0x40;
 
+/** Keep per-document statistics in memory.
+ *
+ *  For backends which support it (currently glass), the document lengths
+ *  are all loaded into an array the first time one is needed, and the number
+ *  of unique terms in each document is remembered once it has been read.
+ *  This speeds up weighting schemes which need these statistics for every
+ *  matching document, at the cost of 4 bytes of memory per document for
+ *  each statistic.
+ */
+const int DB_CACHE_DOC_STATS	 = 0x80;
+
+/** Read database tables via memory mapping.
+ *
+ *  For backends which support it (currently glass and honey), each table
+ *  file of a read-only database is memory mapped, and data is read from the
+ *  mapping instead of with a system call for each read.  For honey, tags
+ *  which aren't compressed are used directly from the mapping without being
+ *  copied.  This is most useful when the database files are already in the
+ *  operating system's file cache.
+ *
+ *  The database files mustn't be truncated while open with this flag (for
+ *  example by overwriting the database with DB_CREATE_OR_OVERWRITE), as the
+ *  process will then get a SIGBUS signal if it tries to read from the
+ *  truncated part of the mapping.
+ *
+ *  This flag is ignored when opening a WritableDatabase, and on platforms
+ *  which don't support mmap().
+ */
+const int DB_MMAP		 = 0x800;
+
+/** Make commits durable in a background thread.
+ *
+ *  For backends which support it (currently glass, except for single-file
+ *  databases and when changesets are being written for replication),
+ *  WritableDatabase::commit() returns once the new revision's blocks have
+ *  been written, and a background thread syncs them to disk and then writes
+ *  the new version file.  If further commits happen while this is going on,
+ *  they're made durable together, so the tables are synced once for all of
+ *  them.
+ *
+ *  Until a revision is durable, other processes opening the database see
+ *  the previous durable revision, and after a crash the database will be at
+ *  that revision.  Use WritableDatabase::wait_for_durable() to wait for a
+ *  revision to be durable.
+ *
+ *  This flag has no effect with DB_NO_SYNC or DB_DANGEROUS, or when opening
+ *  a read-only Database.
+ */
+const int DB_ASYNC_COMMIT	 = 0x1000;
+
 /** Use the glass backend.
  *
  *  When opening a WritableDatabase, this means create a glass database if a
@@ -274,6 +324,14 @@ const int DBCOMPACT_MULTIPASS = 8;
  */
 const int DBCOMPACT_SINGLE_FILE = 16;
 
+/** Encode postlists using Stream VByte.
+ *
+ *  Supported by the honey backend.  Postings are stored in blocks which
+ *  can be decoded using SIMD instructions, which makes reading long
+ *  postlists faster at the cost of a somewhat larger database.
+ */
+const int DBCOMPACT_STREAM_VBYTE = 32;
+
 /** Assume document id is valid.
  *
  *  By default, Database::get_document() checks that the document id passed is
@@ -406,6 +406,53 @@ class XAPIAN_VISIBILITY_DEFAULT Database {
 	return ValueIterator();
     }
 
+    /** Keep the values in a slot in memory as a fixed-width column.
+     *
+     *  The first time the values in @a slot are read as a stream (which
+     *  happens when sorting by value, for a ValueCountMatchSpy, and for value
+     *  range queries) they're all loaded into an array indexed by docid with
+     *  a cell of @a width bytes for each document.  After that, looking up
+     *  the value for a document doesn't need to decode the value stream.
+     *
+     *  Values longer than @a width bytes are stored separately, so all
+     *  values are still returned exactly - the width should be chosen so that
+     *  most values fit.  Numbers encoded with sortable_serialise() are at
+     *  most 9 bytes long.  The column uses @a width + 1 bytes for each docid
+     *  up to the highest one with a value in @a slot.
+     *
+     *  The column is discarded when the database is modified or reopened,
+     *  and loaded again the next time it's needed.
+     *
+     *  Currently only glass databases support value columns - for other
+     *  backends this method has no effect.
+     *
+     *  @param slot	The value slot.
+     *  @param width	The number of bytes in each cell (default: 9).  Must be
+     *			between 1 and 254.
+     */
+    void add_value_column(Xapian::valueno slot, unsigned width = 9);
+
+    /** Keep a dictionary of the distinct values in a slot in memory.
+     *
+     *  The first time a ValueCountMatchSpy counts the values in @a slot, the
+     *  distinct values are loaded into a dictionary, along with an array
+     *  giving the position in the dictionary of each document's value.  The
+     *  match spy then counts matching documents in an array indexed by
+     *  position, and only looks at the value strings when its results are
+     *  read.
+     *
+     *  The dictionary uses 4 bytes for each docid up to the highest one with
+     *  a value in @a slot, plus the distinct values.  It is discarded when
+     *  the database is modified or reopened, and loaded again the next time
+     *  it's needed.
+     *
+     *  Currently only glass databases support value dictionaries - for other
+     *  backends this method has no effect.
+     *
+     *  @param slot	The value slot.
+     */
+    void add_value_dictionary(Xapian::valueno slot);
+
     /** Get the length of a document.
      *
      *  @param did   The document id of the document
@@ -648,6 +695,43 @@ class XAPIAN_VISIBILITY_DEFAULT Database {
 	return check_(NULL, fd, opts, out);
     }
 
+    /** Set the size of the process-wide cache of database blocks.
+     *
+     *  Blocks read by read-only glass databases are cached and shared
+     *  between all the Database objects in the process, which saves a system
+     *  call to read each block which is found in the cache.  This is most
+     *  useful when the same database files are opened by many Database
+     *  objects.  The cache is split into 16 parts, each of which is allowed
+     *  1/16 of the total size.
+     *
+     *  The initial size is taken from environment variable
+     *  XAPIAN_BLOCK_CACHE_SIZE if set, and otherwise is 0, which disables the
+     *  cache.
+     *
+     *  @param max_size	The maximum total size of the cached blocks in
+     *			bytes (0 to disable the cache and discard any cached
+     *			blocks).
+     *
+     *  Experimental - see
+     *  https://xapian.org/docs/deprecation#experimental-features
+     */
+    static void set_block_cache_size(size_t max_size);
+
+    /** Get the maximum size of the process-wide cache of database blocks.
+     *
+     *  @see set_block_cache_size()
+     */
+    static size_t get_block_cache_size();
+
+    /// Return the number of lookups which found a block in the block cache.
+    static size_t get_block_cache_hits();
+
+    /// Return the number of lookups which didn't find a block in the cache.
+    static size_t get_block_cache_misses();
+
+    /// Return the number of blocks discarded from the block cache.
+    static size_t get_block_cache_evictions();
+
     /** Produce a compact version of this database.
      *
      *  New 1.3.4.  Various methods of the Compactor class were deprecated in
@@ -676,6 +760,9 @@ class XAPIAN_VISIBILITY_DEFAULT Database {
      *   - Xapian::DBCOMPACT_SINGLE_FILE
      *		Produce a single-file database (only supported for glass
      *		currently).
+     *   - Xapian::DBCOMPACT_STREAM_VBYTE
+     *		Encode postlists using Stream VByte, which is faster to decode
+     *		(only supported for honey).
      *   - At most one of:
      *     - Xapian::Compactor::STANDARD - Don't split items unnecessarily.
      *     - Xapian::Compactor::FULL     - Split items whenever it saves space
@@ -734,6 +821,9 @@ class XAPIAN_VISIBILITY_DEFAULT Database {
      *   - Xapian::DBCOMPACT_SINGLE_FILE
      *		Produce a single-file database (only supported for glass
      *		currently).
+     *   - Xapian::DBCOMPACT_STREAM_VBYTE
+     *		Encode postlists using Stream VByte, which is faster to decode
+     *		(only supported for honey).
      *   - At most one of:
      *     - Xapian::Compactor::STANDARD - Don't split items unnecessarily.
      *     - Xapian::Compactor::FULL     - Split items whenever it saves space
@@ -787,6 +877,9 @@ class XAPIAN_VISIBILITY_DEFAULT Database {
      *   - Xapian::DBCOMPACT_SINGLE_FILE
      *		Produce a single-file database (only supported for glass
      *		currently).
+     *   - Xapian::DBCOMPACT_STREAM_VBYTE
+     *		Encode postlists using Stream VByte, which is faster to decode
+     *		(only supported for honey).
      *   - At most one of:
      *     - Xapian::Compactor::STANDARD - Don't split items unnecessarily.
      *     - Xapian::Compactor::FULL     - Split items whenever it saves space
@@ -848,6 +941,9 @@ class XAPIAN_VISIBILITY_DEFAULT Database {
      *   - Xapian::DBCOMPACT_SINGLE_FILE
      *		Produce a single-file database (only supported for glass
      *		currently).
+     *   - Xapian::DBCOMPACT_STREAM_VBYTE
+     *		Encode postlists using Stream VByte, which is faster to decode
+     *		(only supported for honey).
      *   - At most one of:
      *     - Xapian::Compactor::STANDARD - Don't split items unnecessarily.
      *     - Xapian::Compactor::FULL     - Split items whenever it saves space
@@ -1065,11 +1161,46 @@ class XAPIAN_VISIBILITY_DEFAULT WritableDatabase : public Database {
      *  you can improve indexing throughput dramatically by setting
      *  XAPIAN_FLUSH_THRESHOLD in the environment to a larger value.
      *
+     *  Since the memory needed per document varies a lot between (say) short
+     *  messages and whole books, with the glass backend you can instead set
+     *  XAPIAN_FLUSH_THRESHOLD_BYTES to commit once the buffered changes use
+     *  about that many bytes of memory.  If only XAPIAN_FLUSH_THRESHOLD_BYTES
+     *  is set, the number of documents isn't limited; if both are set, a
+     *  commit happens when either is reached.
+     *
+     *  For glass databases, you can set environment variable
+     *  XAPIAN_FLUSH_THREADS to the maximum number of threads to use to
+     *  encode the updated posting lists when the changes are flushed
+     *  (default 1, which means to only use the calling thread).
+     *
+     *  If the database was opened with Xapian::DB_ASYNC_COMMIT, this
+     *  returns once the changes have been written, and they're made durable
+     *  and visible to other readers in the background - use
+     *  wait_for_durable() to wait for this.
+     *
      *  @since This method was new in Xapian 1.1.0 - in earlier versions it
      *	       was called flush().
      */
     void commit();
 
+    /** Wait until committed changes are durable.
+     *
+     *  This is only needed if the database was opened with
+     *  Xapian::DB_ASYNC_COMMIT - otherwise commit() doesn't return until the
+     *  changes are durable.
+     *
+     *  @param revision	The revision to wait for (as returned by
+     *			Database::get_revision() after the commit).  The
+     *			default of 0 means the latest committed revision,
+     *			and must be used if there's more than one shard.
+     *
+     *  @exception Xapian::DatabaseError is thrown if making a commit durable
+     *		   in the background failed.  Once this has happened, any
+     *		   further commit will also fail, and the database should be
+     *		   closed and reopened.
+     */
+    void wait_for_durable(Xapian::rev revision = 0);
+
     /** Begin a transaction.
      *
      *  A Xapian transaction is a set of consecutive modifications to be
@@ -1168,6 +1299,29 @@ class XAPIAN_VISIBILITY_DEFAULT WritableDatabase : public Database {
      */
     Xapian::docid add_document(const Xapian::Document& doc);
 
+    /** Add a batch of documents to the database.
+     *
+     *  This has the same effect as calling add_document() on each document
+     *  in turn, so the documents are allocated consecutive document IDs in
+     *  the order given, but backends which support it invert and encode the
+     *  documents using several threads before adding them.  The glass
+     *  backend does this for documents which weren't read from a database.
+     *
+     *  The encoded batch is held in memory until it has been added, so very
+     *  large batches are best split up.
+     *
+     *  @param docs		The Document objects to be added.  The same
+     *				Document object shouldn't be modified by
+     *				another thread during this call.
+     *  @param n_threads	The maximum number of threads to use (default:
+     *				0, which means the number of hardware threads).
+     *
+     *  @return The document ID allocated to the first document, or 0 if
+     *		@a docs is empty.
+     */
+    Xapian::docid add_documents(const std::vector<Xapian::Document>& docs,
+				unsigned n_threads = 0);
+
     /** Delete a document from the database.
      *
      *  This method removes the document with the specified document ID
@@ -42,9 +42,11 @@ namespace Xapian {
 // Forward declarations of classes referenced below.
 class Database;
 class ExpandDecider;
+class FilterCache;
 class KeyMaker;
 class MatchDecider;
 class MatchSpy;
+class MSetCache;
 class Query;
 class RSet;
 class Weight;
@@ -358,6 +360,95 @@ class XAPIAN_VISIBILITY_DEFAULT Enquire {
      */
     void set_time_limit(double time_limit);
 
+    /** Set the number of threads to use for matching.
+     *
+     *  When searching a Database with more than one local shard, each shard
+     *  can be matched in its own thread, and the partial results are then
+     *  merged in the same way as results from remote shards are.  The
+     *  threads share the current minimum weight needed to make the MSet, so
+     *  pruning tightens as soon as any shard has found enough good matches.
+     *
+     *  If there's only one local shard and it is a glass or honey database
+     *  opened read-only, its range of docids is instead split into up to
+     *  @a n_threads ranges, and each is matched in its own thread using
+     *  another Database object opened on the same path.  If the database on
+     *  disk has been modified since the Database object was opened the
+     *  match isn't split.
+     *
+     *  @param n_threads  The maximum number of threads to use (default: 0,
+     *			  which means match in the calling thread; 1 has the
+     *			  same effect).
+     *
+     *  Limitations:
+     *
+     *  Matching is only run in parallel if no MatchSpy objects have been
+     *  added and no MatchDecider is passed to get_mset(), since those are
+     *  not required to be thread-safe.  If a KeyMaker is set with
+     *  set_sort_by_key() or a variant, then it must be safe to call from
+     *  several threads at once.  If a single shard is split into docid ranges
+     *  then any PostingSource objects in the query must implement clone().
+     */
+    void set_match_threads(unsigned n_threads);
+
+    /** Set a cache for search results.
+     *
+     *  If a cache is set, get_mset() first looks for a cached result, and
+     *  stores the result in the cache if it has to run the match.  The cache
+     *  can be shared by several Enquire objects.
+     *
+     *  Cached entries are keyed by the query, the weighting scheme and its
+     *  parameters, the sorting, collapsing and cutoff settings, the
+     *  parameters passed to get_mset(), and the revision and UUID of each
+     *  shard.  So when a Database is reopened at a new revision, results
+     *  cached for the old revision are no longer used.
+     *
+     *  @param cache	The cache to use.  Pass a default-constructed
+     *			MSetCache object to stop using a cache.
+     *
+     *  The cache isn't used (and the match is just run as usual) if:
+     *
+     *   - an RSet or a MatchDecider is passed to get_mset(),
+     *   - any MatchSpy objects have been added,
+     *   - a time limit is set with set_time_limit(),
+     *   - any shard is a WritableDatabase, or doesn't support revisions (for
+     *     example, inmemory and remote shards), or
+     *   - the query, weighting scheme or KeyMaker don't support
+     *     serialisation.
+     *
+     *  The cached result is only correct if running the query is repeatable,
+     *  so don't set a cache if you use a PostingSource which can give
+     *  different results for the same database revision.
+     */
+    void set_mset_cache(const MSetCache& cache);
+
+    /** Set a cache for boolean filters.
+     *
+     *  If a cache is set, the documents matched by the filter subqueries of
+     *  an OP_FILTER query (all the subqueries after the first) are stored in
+     *  the cache as a compressed bitmap for each shard the first time the
+     *  filter is used.  When the same filter is used again, documents are
+     *  checked against the bitmap instead of running the filter subqueries.
+     *  The cache can be shared by several Enquire objects.
+     *
+     *  Cached entries are keyed by the filter subqueries and the revision
+     *  and UUID of the shard, so when a Database is reopened at a new
+     *  revision, filters cached for the old revision are no longer used.
+     *
+     *  @param cache	The cache to use.  Pass a default-constructed
+     *			FilterCache object to stop using a cache.
+     *
+     *  The cache isn't used for a shard which is a WritableDatabase or
+     *  doesn't support revisions (for example, inmemory and remote shards),
+     *  for a filter which doesn't support serialisation, or for a filter
+     *  which is a single term.  Filters inside OP_SYNONYM, OP_PHRASE or
+     *  OP_NEAR don't use the cache either.
+     *
+     *  The cached filter is only correct if running it is repeatable, so
+     *  don't set a cache if you use a PostingSource in a filter which can
+     *  give different results for the same database revision.
+     */
+    void set_filter_cache(const FilterCache& cache);
+
     /** Run the query.
      *
      *  Run the query using the settings in this Enquire object and those
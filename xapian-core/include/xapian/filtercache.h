@@ -0,0 +1,116 @@
+/** @file  filtercache.h
+ *  @brief Cache of boolean filters which can be shared between Enquire objects
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_FILTERCACHE_H
+#define XAPIAN_INCLUDED_FILTERCACHE_H
+
+#if !defined XAPIAN_IN_XAPIAN_H && !defined XAPIAN_LIB_BUILD
+# error Never use <xapian/filtercache.h> directly; include <xapian.h> instead.
+#endif
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include <xapian/visibility.h>
+
+namespace Xapian {
+
+/** Cache of boolean filters which can be shared between Enquire objects.
+ *
+ *  Set a cache on an Enquire object with Enquire::set_filter_cache(), and
+ *  the documents matching the filter part of an OP_FILTER query are stored
+ *  in the cache as a compressed bitmap for each shard.  Later queries with
+ *  the same filter then test documents against the bitmap instead of
+ *  reading the filter's posting lists.  Entries are discarded in least
+ *  recently used order to keep the total size within a limit.
+ *
+ *  The cache may be used from several threads at once.  Unlike most Xapian
+ *  classes, copies of a FilterCache object can safely be used in different
+ *  threads (the reference count is updated atomically) so the same cache can
+ *  be set on Enquire objects used by different threads.
+ */
+class XAPIAN_VISIBILITY_DEFAULT FilterCache {
+  public:
+    /// Class representing the FilterCache internals.
+    class Internal;
+    /// @private @internal Reference counted internals.
+    std::shared_ptr<Internal> internal;
+
+    /** Copying is allowed.
+     *
+     *  The internals are reference counted, so copying is cheap.  The copy
+     *  shares the cached entries with the original.
+     */
+    FilterCache(const FilterCache & o);
+
+    /** Copying is allowed.
+     *
+     *  The internals are reference counted, so assignment is cheap.
+     */
+    FilterCache & operator=(const FilterCache & o);
+
+    /// Move constructor.
+    FilterCache(FilterCache && o);
+
+    /// Move assignment operator.
+    FilterCache & operator=(FilterCache && o);
+
+    /** Construct a cache.
+     *
+     *  @param max_size	The maximum total size of the cached entries in
+     *			bytes (default: 0, which means nothing is cached).
+     */
+    explicit FilterCache(size_t max_size = 0);
+
+    /// Destructor.
+    ~FilterCache();
+
+    /// Return the maximum total size of the cached entries in bytes.
+    size_t get_max_size() const;
+
+    /** Return the total size of the cached entries in bytes.
+     *
+     *  This is an estimate of the memory used, including an allowance for
+     *  the overhead of storing each entry.
+     */
+    size_t get_size() const;
+
+    /// Return the number of cached entries.
+    size_t get_entry_count() const;
+
+    /// Return the number of lookups which found a cached entry.
+    size_t get_hits() const;
+
+    /// Return the number of lookups which didn't find a cached entry.
+    size_t get_misses() const;
+
+    /** Discard all the cached entries.
+     *
+     *  The hit and miss counts are left unchanged.
+     */
+    void clear();
+
+    /// Return a string describing this object.
+    std::string get_description() const;
+};
+
+}
+
+#endif // XAPIAN_INCLUDED_FILTERCACHE_H
@@ -34,6 +34,7 @@
 
 #include <string>
 #include <map>
+#include <memory>
 
 namespace Xapian {
 
@@ -217,9 +218,20 @@ class XAPIAN_VISIBILITY_DEFAULT ValueCountMatchSpy : public MatchSpy {
 	/// Total number of documents seen by the match spy.
 	Xapian::doccount total;
 
-	/// The values seen so far, together with their frequency.
+	/** The values seen so far, together with their frequency.
+	 *
+	 *  Documents from a shard with a dictionary for the slot (see
+	 *  Database::add_value_dictionary()) are counted in ordinal_counts
+	 *  first, and added to this when the results are read.
+	 */
 	std::map<std::string, Xapian::doccount> values;
 
+	/// Counts by position in a shard's value dictionary.
+	struct OrdinalCounts;
+
+	/// Counts for the shard we're currently counting (if it has one).
+	std::shared_ptr<OrdinalCounts> ordinal_counts;
+
 	Internal() : slot(Xapian::BAD_VALUENO), total(0) {}
 	explicit Internal(Xapian::valueno slot_) : slot(slot_), total(0) {}
     };
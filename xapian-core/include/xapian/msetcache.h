@@ -0,0 +1,118 @@
+/** @file  msetcache.h
+ *  @brief Cache of search results which can be shared between Enquire objects
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_MSETCACHE_H
+#define XAPIAN_INCLUDED_MSETCACHE_H
+
+#if !defined XAPIAN_IN_XAPIAN_H && !defined XAPIAN_LIB_BUILD
+# error Never use <xapian/msetcache.h> directly; include <xapian.h> instead.
+#endif
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include <xapian/visibility.h>
+
+namespace Xapian {
+
+/** Cache of search results which can be shared between Enquire objects.
+ *
+ *  Set a cache on an Enquire object with Enquire::set_mset_cache(), and
+ *  Enquire::get_mset() will look there before running the match, and store
+ *  the result there afterwards.  Entries are discarded in least recently used
+ *  order to keep the total size within a limit.
+ *
+ *  The cache may be used from several threads at once.  Unlike most Xapian
+ *  classes, copies of an MSetCache object can safely be used in different
+ *  threads (the reference count is updated atomically) so the same cache can
+ *  be set on Enquire objects used by different threads.
+ */
+class XAPIAN_VISIBILITY_DEFAULT MSetCache {
+  public:
+    /// Class representing the MSetCache internals.
+    class Internal;
+    /// @private @internal Reference counted internals.
+    std::shared_ptr<Internal> internal;
+
+    /** Copying is allowed.
+     *
+     *  The internals are reference counted, so copying is cheap.  The copy
+     *  shares the cached entries with the original.
+     */
+    MSetCache(const MSetCache & o);
+
+    /** Copying is allowed.
+     *
+     *  The internals are reference counted, so assignment is cheap.
+     */
+    MSetCache & operator=(const MSetCache & o);
+
+    /// Move constructor.
+    MSetCache(MSetCache && o);
+
+    /// Move assignment operator.
+    MSetCache & operator=(MSetCache && o);
+
+    /** Construct a cache.
+     *
+     *  @param max_size	The maximum total size of the cached entries in
+     *			bytes (default: 0, which means nothing is cached).
+     */
+    explicit MSetCache(size_t max_size = 0);
+
+    /// Destructor.
+    ~MSetCache();
+
+    /// Return the maximum total size of the cached entries in bytes.
+    size_t get_max_size() const;
+
+    /** Return the total size of the cached entries in bytes.
+     *
+     *  This is an estimate of the memory used, including an allowance for
+     *  the overhead of storing each entry.
+     */
+    size_t get_size() const;
+
+    /// Return the number of cached entries.
+    size_t get_entry_count() const;
+
+    /** Return the number of lookups which found a cached entry.
+     *
+     *  Calls to Enquire::get_mset() which can't use the cache (see
+     *  Enquire::set_mset_cache()) don't count as either hits or misses.
+     */
+    size_t get_hits() const;
+
+    /// Return the number of lookups which didn't find a cached entry.
+    size_t get_misses() const;
+
+    /** Discard all the cached entries.
+     *
+     *  The hit and miss counts are left unchanged.
+     */
+    void clear();
+
+    /// Return a string describing this object.
+    std::string get_description() const;
+};
+
+}
+
+#endif // XAPIAN_INCLUDED_MSETCACHE_H
@@ -0,0 +1,158 @@
+/** @file  segmenteddatabase.h
+ *  @brief Writable database made of segments merged in the background
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_SEGMENTEDDATABASE_H
+#define XAPIAN_INCLUDED_SEGMENTEDDATABASE_H
+
+#if !defined XAPIAN_IN_XAPIAN_H && !defined XAPIAN_LIB_BUILD
+# error Never use <xapian/segmenteddatabase.h> directly; include <xapian.h> instead.
+#endif
+
+#include <memory>
+#include <string>
+
+#include <xapian/types.h>
+#include <xapian/visibility.h>
+
+namespace Xapian {
+
+class Document;
+
+/** A writable database made of segments which are merged in the background.
+ *
+ *  New documents are added to a private glass database, the active segment.
+ *  commit() compacts the active segment into a sealed honey segment (as
+ *  does adding a document when the active segment holds enough documents),
+ *  so commits cost time proportional to the changes, not the size of the
+ *  whole database.  When enough sealed segments of the same tier have built
+ *  up, a background thread compacts them into a single segment of the next
+ *  tier, so the number of segments grows logarithmically with the number of
+ *  documents.
+ *
+ *  The segments are listed in a stub database file in the database
+ *  directory, so the whole database can be searched by opening the
+ *  directory with Xapian::Database, which combines the segments as shards.
+ *  Document ids in a Database opened like this change as segments are
+ *  added and merged, so documents should be identified by a unique term, as
+ *  used by replace_document() and delete_document().
+ *
+ *  Sealed segments are never modified.  Documents deleted from them are
+ *  listed in a deletion list file for each segment, which readers apply
+ *  when they open the database, and which merges leave out of the merged
+ *  segment.  commit() lists new segments and deletion list files in a
+ *  single atomic update of the stub file, so a reader sees either all of
+ *  the changes or none of them.  A reader opening the database just as a
+ *  merge finishes may find a segment or deletion list it lists has been
+ *  removed, in which case it should retry.
+ *
+ *  Only one SegmentedDatabase object can have a database open at once.
+ *  Uncommitted changes are lost if the database isn't closed cleanly.
+ *  The methods of a SegmentedDatabase object shouldn't be called from more
+ *  than one thread at once.
+ */
+class XAPIAN_VISIBILITY_DEFAULT SegmentedDatabase {
+  public:
+    /// Class representing the SegmentedDatabase internals.
+    class Internal;
+
+  private:
+    /// @private @internal The internals.
+    std::unique_ptr<Internal> internal;
+
+    /// Don't allow copying.
+    SegmentedDatabase(const SegmentedDatabase&) = delete;
+
+    /// Don't allow assignment.
+    SegmentedDatabase& operator=(const SegmentedDatabase&) = delete;
+
+  public:
+    /** Open a segmented database, creating it if it doesn't exist.
+     *
+     *  @param path		Directory holding the database.
+     *  @param segment_size	The number of documents after which the active
+     *				segment is sealed, if commit() hasn't been
+     *				called (default: 0, which means 10000).
+     *  @param merge_factor	How many sealed segments of the same tier are
+     *				merged at once (default: 0, which means 10).
+     *				Must be at least 2.
+     */
+    explicit SegmentedDatabase(const std::string& path,
+			       Xapian::doccount segment_size = 0,
+			       unsigned merge_factor = 0);
+
+    /** Destructor.
+     *
+     *  Calls close(), ignoring any exceptions.
+     */
+    ~SegmentedDatabase();
+
+    /** Add a document.
+     *
+     *  @param document	The document to add.
+     */
+    void add_document(const Xapian::Document& document);
+
+    /** Delete any documents indexed by a term.
+     *
+     *  @param unique_term	The term to delete documents by.
+     */
+    void delete_document(const std::string& unique_term);
+
+    /** Replace any documents indexed by a term.
+     *
+     *  Any documents indexed by @a unique_term are deleted, and @a document
+     *  is added.
+     *
+     *  @param unique_term	The term to replace documents by.
+     *  @param document		The new document.
+     */
+    void replace_document(const std::string& unique_term,
+			  const Xapian::Document& document);
+
+    /** Commit pending changes.
+     *
+     *  This seals the active segment, atomically publishes the new segments
+     *  and deletions, and starts a background merge if one is needed and
+     *  none is running.
+     *
+     *  If a background merge has failed since the last call, the exception
+     *  it threw is rethrown here (the segments it was merging are left as
+     *  they were).
+     */
+    void commit();
+
+    /** Wait until no background merge is running.
+     *
+     *  If a background merge has failed, the exception it threw is rethrown.
+     */
+    void wait_for_merges();
+
+    /// Return the number of segments in the database.
+    size_t get_segment_count() const;
+
+    /** Commit, wait for any background merge, and close the database.
+     *
+     *  No more changes can be made after this has been called.
+     */
+    void close();
+};
+
+}
+
+#endif // XAPIAN_INCLUDED_SEGMENTEDDATABASE_H
@@ -242,6 +242,29 @@ class XAPIAN_VISIBILITY_DEFAULT Weight {
 			       Xapian::termcount doclen,
 			       Xapian::termcount uniqterms) const = 0;
 
+    /** Calculate the weight contributions for this object's term to a batch
+     *  of documents.
+     *
+     *  The result must be the same as calling get_sumpart() for each
+     *  document in turn (which is what the default implementation does), but
+     *  subclasses can override this to avoid a virtual method call per
+     *  document and to allow the compiler to vectorise the calculation.
+     *
+     *  @param n	  The number of documents.
+     *  @param wdfs	  The wdf of the term in each document.
+     *  @param doclens	  The length of each document (zero for each document
+     *			  if get_sumpart() doesn't need the document length).
+     *  @param uniqterms  The number of unique terms in each document (zero
+     *			  for each document if get_sumpart() doesn't need
+     *			  this).
+     *  @param sumparts	  Array of @a n entries to store the results in.
+     */
+    virtual void get_sumparts(Xapian::doccount n,
+			      const Xapian::termcount* wdfs,
+			      const Xapian::termcount* doclens,
+			      const Xapian::termcount* uniqterms,
+			      double* sumparts) const;
+
     /** Return an upper bound on what get_sumpart() can return for any document.
      *
      *  This information is used by the matcher to perform various
@@ -249,6 +272,18 @@ class XAPIAN_VISIBILITY_DEFAULT Weight {
      */
     virtual double get_maxpart() const = 0;
 
+    /** Return an upper bound on what get_sumpart() can return for any
+     *  document in which the term's wdf is at most @a wdf_max.
+     *
+     *  This allows the matcher to skip blocks of postings for which the
+     *  backend stores the maximum wdf, so it's worth implementing for
+     *  schemes where the weight increases with wdf.  The default
+     *  implementation ignores @a wdf_max and returns get_maxpart().
+     *
+     *  @param wdf_max	An upper bound on the wdf.
+     */
+    virtual double get_maxpart_for_wdf(Xapian::termcount wdf_max) const;
+
     /** Calculate the term-independent weight component for a document.
      *
      *  The parameter gives information about the document which may be used
@@ -598,7 +633,13 @@ class XAPIAN_VISIBILITY_DEFAULT TfIdfWeight : public Weight {
     double get_sumpart(Xapian::termcount wdf,
 		       Xapian::termcount doclen,
 		       Xapian::termcount uniqterm) const;
+    void get_sumparts(Xapian::doccount n,
+		      const Xapian::termcount* wdfs,
+		      const Xapian::termcount* doclens,
+		      const Xapian::termcount* uniqterms,
+		      double* sumparts) const;
     double get_maxpart() const;
+    double get_maxpart_for_wdf(Xapian::termcount wdf_max) const;
 
     double get_sumextra(Xapian::termcount doclen,
 			Xapian::termcount uniqterms) const;
@@ -709,7 +750,13 @@ class XAPIAN_VISIBILITY_DEFAULT BM25Weight : public Weight {
     double get_sumpart(Xapian::termcount wdf,
 		       Xapian::termcount doclen,
 		       Xapian::termcount uniqterm) const;
+    void get_sumparts(Xapian::doccount n,
+		      const Xapian::termcount* wdfs,
+		      const Xapian::termcount* doclens,
+		      const Xapian::termcount* uniqterms,
+		      double* sumparts) const;
     double get_maxpart() const;
+    double get_maxpart_for_wdf(Xapian::termcount wdf_max) const;
 
     double get_sumextra(Xapian::termcount doclen,
 			Xapian::termcount uniqterms) const;
@@ -831,7 +878,13 @@ class XAPIAN_VISIBILITY_DEFAULT BM25PlusWeight : public Weight {
     double get_sumpart(Xapian::termcount wdf,
 		       Xapian::termcount doclen,
 		       Xapian::termcount uniqterm) const;
+    void get_sumparts(Xapian::doccount n,
+		      const Xapian::termcount* wdfs,
+		      const Xapian::termcount* doclens,
+		      const Xapian::termcount* uniqterms,
+		      double* sumparts) const;
     double get_maxpart() const;
+    double get_maxpart_for_wdf(Xapian::termcount wdf_max) const;
 
     double get_sumextra(Xapian::termcount doclen,
 			Xapian::termcount uniqterms) const;
@@ -896,6 +949,7 @@ class XAPIAN_VISIBILITY_DEFAULT TradWeight : public Weight {
 		       Xapian::termcount doclen,
 		       Xapian::termcount uniqueterms) const;
     double get_maxpart() const;
+    double get_maxpart_for_wdf(Xapian::termcount wdf_max) const;
 
     double get_sumextra(Xapian::termcount doclen,
 			Xapian::termcount uniqterms) const;
@@ -1,9 +1,13 @@
 noinst_HEADERS +=\
 	matcher/andmaybepostlist.h\
 	matcher/andnotpostlist.h\
+	matcher/batchpostlist.h\
+	matcher/bitmappostlist.h\
+	matcher/blockandpostlist.h\
 	matcher/boolorpostlist.h\
 	matcher/collapser.h\
 	matcher/deciderpostlist.h\
+	matcher/docidbitmap.h\
 	matcher/exactphrasepostlist.h\
 	matcher/externalpostlist.h\
 	matcher/extraweightpostlist.h\
@@ -45,9 +49,13 @@ EXTRA_DIST +=\
 lib_src +=\
 	matcher/andmaybepostlist.cc\
 	matcher/andnotpostlist.cc\
+	matcher/batchpostlist.cc\
+	matcher/bitmappostlist.cc\
+	matcher/blockandpostlist.cc\
 	matcher/boolorpostlist.cc\
 	matcher/collapser.cc\
 	matcher/deciderpostlist.cc\
+	matcher/docidbitmap.cc\
 	matcher/exactphrasepostlist.cc\
 	matcher/externalpostlist.cc\
 	matcher/extraweightpostlist.cc\
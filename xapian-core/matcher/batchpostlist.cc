@@ -0,0 +1,201 @@
+/** @file batchpostlist.cc
+ * @brief PostList which reads a LeafPostList in batches
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "batchpostlist.h"
+
+#include "omassert.h"
+
+#include <algorithm>
+
+using namespace std;
+
+bool
+BatchPostList::start_batch()
+{
+    pos = 0;
+    if (pl->at_end()) {
+	pl_at_end = true;
+	count = 0;
+	return false;
+    }
+    dids[0] = pl->get_docid();
+    wdfs[0] = pl->get_wdf();
+    count = 1;
+    return true;
+}
+
+void
+BatchPostList::calc_weights()
+{
+    // We don't calculate weights in batches if the weighting scheme needs
+    // the numbers of unique terms.
+    static const Xapian::termcount zeros[BATCH_SIZE] = {};
+    const Xapian::termcount* lens = zeros;
+    if (need_doclength) {
+	// Reading each document length from the postlist table would mean
+	// moving the doclength cursor backwards for every batch.
+	if (!db.get_cached_doclengths(count, dids, doclens)) {
+	    weights_in_batch = false;
+	    return;
+	}
+	lens = doclens;
+    }
+    pl->get_weights(count, wdfs, lens, zeros, weights);
+}
+
+void
+BatchPostList::read_batch(double w_min)
+{
+    if (pl_at_end) {
+	pos = count = 0;
+	return;
+    }
+    (void)pl->next(w_min);
+    if (!start_batch())
+	return;
+    count += pl->next_batch(dids + 1, wdfs + 1, BATCH_SIZE - 1);
+    pl_at_end = pl->at_end();
+    if (weights_in_batch)
+	calc_weights();
+}
+
+void
+BatchPostList::skip_low_weights(double w_min)
+{
+    if (!weights_in_batch || w_min <= 0.0)
+	return;
+    while (count != 0 && weights[pos] < w_min) {
+	if (++pos == count)
+	    read_batch(w_min);
+    }
+}
+
+Xapian::doccount
+BatchPostList::get_termfreq_min() const
+{
+    return pl->get_termfreq_min();
+}
+
+Xapian::doccount
+BatchPostList::get_termfreq_max() const
+{
+    return pl->get_termfreq_max();
+}
+
+Xapian::doccount
+BatchPostList::get_termfreq_est() const
+{
+    return pl->get_termfreq_est();
+}
+
+TermFreqs
+BatchPostList::get_termfreq_est_using_stats(
+	const Xapian::Weight::Internal& stats) const
+{
+    return pl->get_termfreq_est_using_stats(stats);
+}
+
+Xapian::docid
+BatchPostList::get_docid() const
+{
+    Assert(pos < count);
+    return dids[pos];
+}
+
+Xapian::termcount
+BatchPostList::get_wdf() const
+{
+    Assert(pos < count);
+    return wdfs[pos];
+}
+
+double
+BatchPostList::get_weight(Xapian::termcount doclen,
+			  Xapian::termcount unique_terms) const
+{
+    Assert(pos < count);
+    if (weights_in_batch)
+	return weights[pos];
+    double weight;
+    pl->get_weights(1, wdfs + pos, &doclen, &unique_terms, &weight);
+    return weight;
+}
+
+bool
+BatchPostList::at_end() const
+{
+    return count == 0;
+}
+
+double
+BatchPostList::recalc_maxweight()
+{
+    return pl->recalc_maxweight();
+}
+
+PostList*
+BatchPostList::next(double w_min)
+{
+    if (pos + 1 < count) {
+	++pos;
+    } else {
+	read_batch(w_min);
+    }
+    skip_low_weights(w_min);
+    return NULL;
+}
+
+PostList*
+BatchPostList::skip_to(Xapian::docid did, double w_min)
+{
+    if (count != 0 && did <= dids[count - 1]) {
+	if (did <= dids[pos])
+	    return NULL;
+	pos = lower_bound(dids + pos + 1, dids + count, did) - dids;
+    } else if (pl_at_end) {
+	pos = count = 0;
+	return NULL;
+    } else {
+	// Don't read ahead after skipping, as we may be under an AND which is
+	// about to skip again.
+	(void)pl->skip_to(did, w_min);
+	if (!start_batch())
+	    return NULL;
+	if (weights_in_batch)
+	    calc_weights();
+    }
+    skip_low_weights(w_min);
+    return NULL;
+}
+
+Xapian::termcount
+BatchPostList::count_matching_subqs() const
+{
+    return pl->count_matching_subqs();
+}
+
+string
+BatchPostList::get_description() const
+{
+    string desc = "BatchPostList(";
+    desc += pl->get_description();
+    desc += ')';
+    return desc;
+}
@@ -0,0 +1,147 @@
+/** @file batchpostlist.h
+ * @brief PostList which reads a LeafPostList in batches
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef XAPIAN_INCLUDED_BATCHPOSTLIST_H
+#define XAPIAN_INCLUDED_BATCHPOSTLIST_H
+
+#include "api/leafpostlist.h"
+#include "backends/databaseinternal.h"
+
+/** PostList which reads a LeafPostList in batches.
+ *
+ *  Used for the weighted leaf subqueries of OP_OR, where we expect to look at
+ *  most of the postings.  Reading postings via LeafPostList::next_batch()
+ *  avoids several virtual method calls per posting.  We also calculate the
+ *  weights for the whole batch with one call to Weight::get_sumparts() (if
+ *  the weighting scheme needs document lengths, this requires the shard to
+ *  hold them in memory), and skip entries which can't reach the w_min passed
+ *  to next().
+ *
+ *  The wrapped postlist is read ahead of the current position, so this
+ *  mustn't be used where positional information is needed.
+ */
+class BatchPostList : public PostList {
+    /// Don't allow assignment.
+    void operator=(const BatchPostList&) = delete;
+
+    /// Don't allow copying.
+    BatchPostList(const BatchPostList&) = delete;
+
+    /// The maximum number of postings to read at once.
+    static constexpr Xapian::doccount BATCH_SIZE = 64;
+
+    /// The wrapped postlist.
+    LeafPostList* pl;
+
+    /// The shard @a pl is from.
+    const Xapian::Database::Internal& db;
+
+    /// Are the weights for each batch calculated when it is read?
+    bool weights_in_batch;
+
+    /// Does the weighting scheme need the document lengths?
+    bool need_doclength;
+
+    /// Have we run out of postings in @a pl?
+    bool pl_at_end = false;
+
+    /// Index of the current posting in the batch.
+    Xapian::doccount pos = 0;
+
+    /// The number of postings in the current batch (0 if at_end).
+    Xapian::doccount count = 0;
+
+    /// The docids in the current batch.
+    Xapian::docid dids[BATCH_SIZE];
+
+    /// The wdfs in the current batch.
+    Xapian::termcount wdfs[BATCH_SIZE];
+
+    /// The weights in the current batch (if weights_in_batch is true).
+    double weights[BATCH_SIZE];
+
+    /// The document lengths in the current batch (if need_doclength is true).
+    Xapian::termcount doclens[BATCH_SIZE];
+
+    /** Read the next batch of postings.
+     *
+     *  The first posting in the batch is read with next(w_min), so the
+     *  wrapped postlist can skip blocks which can't reach @a w_min.
+     */
+    void read_batch(double w_min);
+
+    /** Start a new batch with the posting @a pl is currently on.
+     *
+     *  @return false if @a pl is at_end().
+     */
+    bool start_batch();
+
+    /** Calculate weights for the current batch.
+     *
+     *  If the document lengths are needed but the shard doesn't hold them in
+     *  memory, this instead sets weights_in_batch to false, and get_weight()
+     *  then weights each posting using the document length passed to it.
+     */
+    void calc_weights();
+
+    /// Advance pos until its weight is at least @a w_min.
+    void skip_low_weights(double w_min);
+
+  public:
+    /** Construct.
+     *
+     *  @param pl_	The postlist to wrap - this object takes ownership.
+     *  @param db_	The shard @a pl_ is from.
+     */
+    BatchPostList(LeafPostList* pl_, const Xapian::Database::Internal& db_)
+	: pl(pl_), db(db_),
+	  weights_in_batch(!pl_->get_weights_needs_unique_terms()),
+	  need_doclength(pl_->get_weights_needs_doclength()) {}
+
+    ~BatchPostList() { delete pl; }
+
+    Xapian::doccount get_termfreq_min() const;
+
+    Xapian::doccount get_termfreq_max() const;
+
+    Xapian::doccount get_termfreq_est() const;
+
+    TermFreqs get_termfreq_est_using_stats(
+	const Xapian::Weight::Internal& stats) const;
+
+    Xapian::docid get_docid() const;
+
+    Xapian::termcount get_wdf() const;
+
+    double get_weight(Xapian::termcount doclen,
+		      Xapian::termcount unique_terms) const;
+
+    bool at_end() const;
+
+    double recalc_maxweight();
+
+    PostList* next(double w_min);
+
+    PostList* skip_to(Xapian::docid did, double w_min);
+
+    Xapian::termcount count_matching_subqs() const;
+
+    std::string get_description() const;
+};
+
+#endif // XAPIAN_INCLUDED_BATCHPOSTLIST_H
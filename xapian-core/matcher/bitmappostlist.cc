@@ -0,0 +1,123 @@
+/** @file
+ * @brief PostList which iterates the docids in a DocidBitmap
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include <config.h>
+
+#include "bitmappostlist.h"
+
+#include "omassert.h"
+#include "str.h"
+
+using namespace std;
+
+Xapian::doccount
+BitmapPostList::get_termfreq_min() const
+{
+    return bitmap->get_size();
+}
+
+Xapian::doccount
+BitmapPostList::get_termfreq_max() const
+{
+    return bitmap->get_size();
+}
+
+Xapian::doccount
+BitmapPostList::get_termfreq_est() const
+{
+    return bitmap->get_size();
+}
+
+Xapian::docid
+BitmapPostList::get_docid() const
+{
+    return did;
+}
+
+double
+BitmapPostList::get_weight(Xapian::termcount, Xapian::termcount) const
+{
+    return 0.0;
+}
+
+bool
+BitmapPostList::at_end() const
+{
+    return ended;
+}
+
+double
+BitmapPostList::recalc_maxweight()
+{
+    return 0.0;
+}
+
+PostList*
+BitmapPostList::next(double)
+{
+    Assert(!ended);
+    // Check for wrapping if we're on the largest possible docid.
+    if (did + 1 != 0)
+	did = bitmap->find_from(did + 1, hint);
+    else
+	did = 0;
+    ended = (did == 0);
+    return NULL;
+}
+
+PostList*
+BitmapPostList::skip_to(Xapian::docid target, double)
+{
+    Assert(!ended);
+    if (target > did) {
+	did = bitmap->find_from(target, hint);
+	ended = (did == 0);
+    }
+    return NULL;
+}
+
+PostList*
+BitmapPostList::check(Xapian::docid target, double, bool& valid)
+{
+    Assert(!ended);
+    if (target <= did) {
+	// We may be on a docid which a previous check() didn't find.
+	valid = bitmap->contains(did, hint);
+	return NULL;
+    }
+    // If target isn't in the bitmap, next() will advance from it.
+    did = target;
+    valid = bitmap->contains(target, hint);
+    return NULL;
+}
+
+Xapian::termcount
+BitmapPostList::count_matching_subqs() const
+{
+    return matching_subqs;
+}
+
+string
+BitmapPostList::get_description() const
+{
+    string desc = "BitmapPostList(size=";
+    desc += str(bitmap->get_size());
+    desc += ')';
+    return desc;
+}
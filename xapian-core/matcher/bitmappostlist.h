@@ -0,0 +1,85 @@
+/** @file
+ * @brief PostList which iterates the docids in a DocidBitmap
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_BITMAPPOSTLIST_H
+#define XAPIAN_INCLUDED_BITMAPPOSTLIST_H
+
+#include "api/postlist.h"
+#include "docidbitmap.h"
+
+#include <memory>
+
+/** PostList which iterates the docids in a DocidBitmap.
+ *
+ *  This is unweighted, and check() just tests the bitmap.
+ */
+class BitmapPostList : public PostList {
+    /// Don't allow assignment.
+    void operator=(const BitmapPostList&) = delete;
+
+    /// Don't allow copying.
+    BitmapPostList(const BitmapPostList&) = delete;
+
+    /// The bitmap (which may be shared with a cache).
+    std::shared_ptr<const DocidBitmap> bitmap;
+
+    /// The current docid, or zero if we haven't started or are at_end.
+    Xapian::docid did = 0;
+
+    /// Have we reached the end?
+    bool ended = false;
+
+    /// The bitmap block to start searching from.
+    size_t hint = 0;
+
+    /// The value to return from count_matching_subqs().
+    Xapian::termcount matching_subqs;
+
+  public:
+    BitmapPostList(const std::shared_ptr<const DocidBitmap>& bitmap_,
+		   Xapian::termcount matching_subqs_)
+	: bitmap(bitmap_), matching_subqs(matching_subqs_) { }
+
+    Xapian::doccount get_termfreq_min() const;
+
+    Xapian::doccount get_termfreq_max() const;
+
+    Xapian::doccount get_termfreq_est() const;
+
+    Xapian::docid get_docid() const;
+
+    double get_weight(Xapian::termcount doclen,
+		      Xapian::termcount unique_terms) const;
+
+    bool at_end() const;
+
+    double recalc_maxweight();
+
+    PostList* next(double w_min);
+
+    PostList* skip_to(Xapian::docid did, double w_min);
+
+    PostList* check(Xapian::docid did, double w_min, bool& valid);
+
+    Xapian::termcount count_matching_subqs() const;
+
+    std::string get_description() const;
+};
+
+#endif // XAPIAN_INCLUDED_BITMAPPOSTLIST_H
@@ -0,0 +1,247 @@
+/** @file blockandpostlist.cc
+ * @brief N-way AND of leaf postlists which intersects blocks of docids
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "blockandpostlist.h"
+
+#include "omassert.h"
+
+#include <cstdint>
+
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
+using namespace std;
+
+/// Count how many of the 4 docids starting at @a p are less than @a target.
+template<typename T>
+static inline unsigned
+count_less_4(const T* p, T target)
+{
+    return unsigned(p[0] < target) + unsigned(p[1] < target) +
+	   unsigned(p[2] < target) + unsigned(p[3] < target);
+}
+
+#ifdef __SSE2__
+/// Count how many of the 4 docids starting at @a p are less than @a target.
+static inline unsigned
+count_less_4(const uint32_t* p, uint32_t target)
+{
+    // SSE2 only has signed comparisons, so flip the top bit of everything to
+    // get the unsigned ordering.
+    const __m128i bias = _mm_set1_epi32(INT32_MIN);
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    v = _mm_xor_si128(v, bias);
+    __m128i t = _mm_xor_si128(_mm_set1_epi32(int32_t(target)), bias);
+    int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(v, t)));
+    return unsigned(__builtin_popcount(unsigned(mask)));
+}
+#endif
+
+/** Find the first entry in @a dids[lo, hi) which is >= @a target.
+ *
+ *  The caller must ensure that dids[hi - 1] >= target.
+ */
+static Xapian::doccount
+gallop(const Xapian::docid* dids,
+       Xapian::doccount lo, Xapian::doccount hi,
+       Xapian::docid target)
+{
+    AssertRel(lo,<,hi);
+    AssertRel(dids[hi - 1],>=,target);
+    // For dense sub-postlists, the next entry is often the one we want.
+    if (dids[lo] >= target)
+	return lo;
+
+    // Gallop forwards with doubling steps to find a range which contains
+    // the entry we want.  We expect it to usually be close to the start.
+    Xapian::doccount step = 4;
+    while (hi - lo > step) {
+	Xapian::doccount probe = lo + step - 1;
+	if (dids[probe] >= target) {
+	    hi = probe + 1;
+	    break;
+	}
+	lo = probe + 1;
+	step *= 2;
+    }
+
+    // Binary chop down to at most 4 entries.
+    while (hi - lo > 4) {
+	Xapian::doccount mid = lo + (hi - lo) / 2;
+	if (dids[mid - 1] < target) {
+	    lo = mid;
+	} else {
+	    hi = mid;
+	}
+    }
+
+    if (hi >= 4) {
+	// All entries before lo are < target, so we can compare the 4 entries
+	// ending at hi in one go.
+	return hi - 4 + count_less_4(dids + hi - 4, target);
+    }
+    while (dids[lo] < target) ++lo;
+    return lo;
+}
+
+bool
+BlockAndPostList::fill_block(size_t n)
+{
+    Block& block = blocks[n];
+    LeafPostList* pl = leaf(n);
+    block.pos = 0;
+    block.hit = false;
+    if (pl->at_end()) {
+	block.pl_at_end = true;
+	block.count = 0;
+	return false;
+    }
+    block.dids[0] = pl->get_docid();
+    block.wdfs[0] = pl->get_wdf();
+    block.count = 1;
+    if (block.read_ahead) {
+	block.count += pl->next_batch(block.dids + 1, block.wdfs + 1,
+				      block.read_ahead);
+	block.pl_at_end = pl->at_end();
+    }
+    return true;
+}
+
+void
+BlockAndPostList::next_in_block(size_t n, double w_min)
+{
+    Block& block = blocks[n];
+    if (block.pos + 1 < block.count) {
+	++block.pos;
+	return;
+    }
+    if (block.pl_at_end) {
+	block.pos = block.count = 0;
+	return;
+    }
+    (void)leaf(n)->next(new_min(w_min, n));
+    (void)fill_block(n);
+}
+
+bool
+BlockAndPostList::skip_in_block(size_t n, Xapian::docid target, double w_min)
+{
+    Block& block = blocks[n];
+    if (block.count != 0 && target <= block.dids[block.count - 1]) {
+	if (target > block.dids[block.pos]) {
+	    block.pos = gallop(block.dids, block.pos + 1, block.count, target);
+	    block.hit = true;
+	}
+	return true;
+    }
+
+    if (block.pl_at_end) {
+	block.pos = block.count = 0;
+	return false;
+    }
+
+    if (block.count != 0) {
+	// Adjust how far we read ahead based on whether the previous block
+	// got used - if the docids we skip to are sparse compared to this
+	// sub-postlist then reading a block is wasted work.
+	if (block.hit) {
+	    block.read_ahead = min(block.read_ahead * 2 + 1, BLOCK_SIZE - 1);
+	} else {
+	    block.read_ahead /= 2;
+	}
+    }
+    (void)leaf(n)->skip_to(target, new_min(w_min, n));
+    return fill_block(n);
+}
+
+void
+BlockAndPostList::find_next_match(double w_min)
+{
+advanced_plist0:
+    const Block& block0 = blocks[0];
+    if (block0.count == 0) {
+	did = 0;
+	return;
+    }
+    did = block0.dids[block0.pos];
+    for (size_t i = 1; i < n_kids; ++i) {
+	if (!skip_in_block(i, did, w_min)) {
+	    did = 0;
+	    return;
+	}
+	const Block& block = blocks[i];
+	Xapian::docid new_did = block.dids[block.pos];
+	if (new_did != did) {
+	    (void)skip_in_block(0, new_did, w_min);
+	    goto advanced_plist0;
+	}
+    }
+}
+
+Xapian::termcount
+BlockAndPostList::get_wdf() const
+{
+    Xapian::termcount totwdf = 0;
+    for (size_t i = 0; i < n_kids; ++i) {
+	const Block& block = blocks[i];
+	totwdf += block.wdfs[block.pos];
+    }
+    return totwdf;
+}
+
+double
+BlockAndPostList::get_weight(Xapian::termcount doclen,
+			     Xapian::termcount unique_terms) const
+{
+    Assert(did);
+    double result = 0;
+    for (size_t i = 0; i < n_kids; ++i) {
+	// The sub-postlists have read ahead, so we need to supply the wdf.
+	const Block& block = blocks[i];
+	result += leaf(i)->get_weight_for_wdf(block.wdfs[block.pos],
+					      doclen, unique_terms);
+    }
+    return result;
+}
+
+PostList*
+BlockAndPostList::next(double w_min)
+{
+    next_in_block(0, w_min);
+    find_next_match(w_min);
+    return NULL;
+}
+
+PostList*
+BlockAndPostList::skip_to(Xapian::docid did_min, double w_min)
+{
+    (void)skip_in_block(0, did_min, w_min);
+    find_next_match(w_min);
+    return NULL;
+}
+
+string
+BlockAndPostList::get_description() const
+{
+    string desc = "BlockAndPostList";
+    desc += MultiAndPostList::get_description();
+    return desc;
+}
@@ -0,0 +1,119 @@
+/** @file blockandpostlist.h
+ * @brief N-way AND of leaf postlists which intersects blocks of docids
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef XAPIAN_INCLUDED_BLOCKANDPOSTLIST_H
+#define XAPIAN_INCLUDED_BLOCKANDPOSTLIST_H
+
+#include "api/leafpostlist.h"
+#include "multiandpostlist.h"
+
+#include <memory>
+
+/** N-way AND of leaf postlists which intersects blocks of docids.
+ *
+ *  Each sub-postlist is read into an array of docids and wdfs with
+ *  LeafPostList::next_batch(), and we intersect those arrays using galloping
+ *  search, comparing several docids at once with SIMD instructions where
+ *  available.  This avoids virtual method calls for most postings, which
+ *  MultiAndPostList needs for every skip_to() on every sub-postlist.
+ *
+ *  The sub-postlists are read ahead of the current position, so this mustn't
+ *  be used where positional information is needed.
+ */
+class BlockAndPostList : public MultiAndPostList {
+    /// The maximum number of postings to read at once.
+    static constexpr Xapian::doccount BLOCK_SIZE = 64;
+
+    /// A block of postings from one of the sub-postlists.
+    struct Block {
+	/// Index of the current posting in the block.
+	Xapian::doccount pos = 0;
+
+	/// The number of postings in the block (0 if at_end).
+	Xapian::doccount count = 0;
+
+	/** Have we run out of postings in the sub-postlist?
+	 *
+	 *  If count is 0 and this is false, we haven't started yet.
+	 */
+	bool pl_at_end = false;
+
+	/// Has a skip landed inside this block since it was filled?
+	bool hit = false;
+
+	/// How many postings to read after the one a skip lands on.
+	Xapian::doccount read_ahead = BLOCK_SIZE - 1;
+
+	/// The docids in the block.
+	Xapian::docid dids[BLOCK_SIZE];
+
+	/// The wdfs in the block.
+	Xapian::termcount wdfs[BLOCK_SIZE];
+    };
+
+    /// Blocks for each of the sub-postlists (in the same order as plist).
+    std::unique_ptr<Block[]> blocks;
+
+    /// Return sub-postlist @a n.
+    LeafPostList* leaf(size_t n) const {
+	// We only ever put LeafPostList objects in plist.
+	return static_cast<LeafPostList*>(plist[n]);
+    }
+
+    /** Fill block @a n starting with the posting its sub-postlist is on.
+     *
+     *  @return false if the sub-postlist is at_end().
+     */
+    bool fill_block(size_t n);
+
+    /// Advance sub-postlist @a n to the next posting.
+    void next_in_block(size_t n, double w_min);
+
+    /** Advance sub-postlist @a n to the first posting with docid >= @a target.
+     *
+     *  @return false if there's no such posting.
+     */
+    bool skip_in_block(size_t n, Xapian::docid target, double w_min);
+
+    /// Advance the sub-postlists to the next match.
+    void find_next_match(double w_min);
+
+  public:
+    /** Construct from 2 random-access iterators to a container of
+     *  LeafPostList*, a pointer to the matcher, and the document collection
+     *  size.
+     */
+    template<class RandomItor>
+    BlockAndPostList(RandomItor pl_begin, RandomItor pl_end,
+		     PostListTree* matcher_, Xapian::doccount db_size_)
+	: MultiAndPostList(pl_begin, pl_end, matcher_, db_size_),
+	  blocks(new Block[n_kids]) {}
+
+    Xapian::termcount get_wdf() const;
+
+    double get_weight(Xapian::termcount doclen,
+		      Xapian::termcount unique_terms) const;
+
+    PostList* next(double w_min);
+
+    PostList* skip_to(Xapian::docid, double w_min);
+
+    std::string get_description() const;
+};
+
+#endif // XAPIAN_INCLUDED_BLOCKANDPOSTLIST_H
@@ -27,6 +27,7 @@
 
 #include <algorithm>
 #include <functional>
+#include <vector>
 
 using namespace std;
 
@@ -70,9 +71,88 @@ BoolOrPostList::recalc_maxweight()
     return 0;
 }
 
+void
+BoolOrPostList::decode_bitmap(Xapian::docid first)
+{
+    bitmap.reset(new DocidBitmap);
+
+    // The matcher won't look at any docid after last.
+    Xapian::docid last = pltree ? pltree->get_range_last() : Xapian::docid(-1);
+
+    // Position the sub-postlists, and move those which have a docid we need
+    // to the start of plist.
+    size_t n_active = 0;
+    for (size_t i = 0; i < n_kids; ++i) {
+	PostList* res = plist[i].pl->skip_to(first, 0);
+	if (res) {
+	    delete plist[i].pl;
+	    plist[i].pl = res;
+	}
+	if (plist[i].pl->at_end())
+	    continue;
+	plist[i].did = plist[i].pl->get_docid();
+	if (plist[i].did > last)
+	    continue;
+	std::swap(plist[i], plist[n_active++]);
+    }
+
+    // Fill a bitset for each block of docids in turn.  Each sub-postlist
+    // is read up to the end of the block, so we don't need a bitset for
+    // the whole docid range.
+    vector<uint64_t> words(DocidBitmap::BITSET_WORDS);
+    while (n_active) {
+	Xapian::docid key = plist[0].did;
+	for (size_t i = 1; i < n_active; ++i) {
+	    key = min(key, plist[i].did);
+	}
+	key >>= 16;
+	size_t i = 0;
+	while (i < n_active) {
+	    PostListAndDocID& kid = plist[i];
+	    while ((kid.did >> 16) == key) {
+		unsigned low = kid.did & 0xffff;
+		words[low >> 6] |= uint64_t(1) << (low & 63);
+		PostList* res = kid.pl->next(0);
+		if (res) {
+		    delete kid.pl;
+		    kid.pl = res;
+		}
+		if (kid.pl->at_end()) {
+		    kid.did = 0;
+		    break;
+		}
+		kid.did = kid.pl->get_docid();
+		if (kid.did > last) {
+		    kid.did = 0;
+		    break;
+		}
+	    }
+	    if (kid.did == 0) {
+		std::swap(plist[i], plist[--n_active]);
+	    } else {
+		++i;
+	    }
+	}
+	bitmap->add_block(key, words.data());
+	fill(words.begin(), words.end(), 0);
+    }
+    bitmap->done();
+}
+
 PostList*
 BoolOrPostList::next(double)
 {
+    if (use_bitmap) {
+	if (!bitmap)
+	    decode_bitmap(1);
+	// Check for wrapping if we're on the largest possible docid.
+	if (did + 1 != 0)
+	    did = bitmap->find_from(did + 1, bitmap_hint);
+	else
+	    did = 0;
+	return NULL;
+    }
+
     while (plist[0].did == did) {
 	PostList* res = plist[0].pl->next(0);
 	if (res) {
@@ -109,6 +189,12 @@ PostList*
 BoolOrPostList::skip_to(Xapian::docid did_min, double)
 {
     if (rare(did_min <= did)) return NULL;
+    if (use_bitmap) {
+	if (!bitmap)
+	    decode_bitmap(did_min);
+	did = bitmap->find_from(did_min, bitmap_hint);
+	return NULL;
+    }
     did = Xapian::docid(-1);
     size_t j = 0;
     for (size_t i = 0; i < n_kids; ++i) {
@@ -236,6 +322,10 @@ BoolOrPostList::get_termfreq_est_using_stats(
 bool
 BoolOrPostList::at_end() const
 {
+    if (bitmap) {
+	// find_from() returns 0 when there are no more docids.
+	return did == 0;
+    }
     // We never need to return true here - if all but one child reaches
     // at_end(), we prune to leave just that child.  If all children reach
     // at_end() together, we prune to leave one of them which will then
@@ -259,6 +349,7 @@ BoolOrPostList::get_description() const
 Xapian::termcount
 BoolOrPostList::get_wdf() const
 {
+    Assert(!use_bitmap);
     return for_all_matches([](PostList* pl) {
 			       return pl->get_wdf();
 			   });
@@ -267,6 +358,10 @@ BoolOrPostList::get_wdf() const
 Xapian::termcount
 BoolOrPostList::count_matching_subqs() const
 {
+    if (use_bitmap) {
+	// The sub-postlists are all unweighted terms.
+	return 0;
+    }
     return for_all_matches([](PostList* pl) {
 			       return pl->count_matching_subqs();
 			   });
@@ -275,6 +370,7 @@ BoolOrPostList::count_matching_subqs() const
 void
 BoolOrPostList::gather_position_lists(OrPositionList* orposlist)
 {
+    Assert(!use_bitmap);
     for_all_matches([&orposlist](PostList* pl) {
 			pl->gather_position_lists(orposlist);
 			return 0;
@@ -22,6 +22,11 @@
 #define XAPIAN_INCLUDED_BOOLORPOSTLIST_H
 
 #include "api/postlist.h"
+#include "docidbitmap.h"
+
+#include <memory>
+
+class PostListTree;
 
 /// PostList class implementing unweighted Query::OP_OR
 class BoolOrPostList : public PostList {
@@ -57,6 +62,36 @@ class BoolOrPostList : public PostList {
     /** Total number of documents in the database. */
     Xapian::doccount db_size;
 
+    /// Should we evaluate by decoding the sub-postlists into a bitmap?
+    bool use_bitmap;
+
+    /** The matcher (used to find the last docid to decode).
+     *
+     *  May be NULL, in which case the bitmap covers to the end of the
+     *  sub-postlists.
+     */
+    PostListTree* pltree;
+
+    /** The matching docids, if evaluating as a bitmap.
+     *
+     *  This is built from the sub-postlists when we're first positioned.
+     */
+    std::unique_ptr<DocidBitmap> bitmap;
+
+    /// The bitmap block to start searching from.
+    size_t bitmap_hint = 0;
+
+    /** Decode the sub-postlists into bitmap.
+     *
+     *  The sub-postlists are kept (at_end) so they can still supply termfreq
+     *  estimates.  When the matcher is only matching a range of docids we
+     *  stop decoding at the end of that range, so each range only decodes its
+     *  own part of the sub-postlists.
+     *
+     *  @param first	The first docid we need.
+     */
+    void decode_bitmap(Xapian::docid first);
+
     /** Helper to apply operation to all postlists matching current docid.
      *
      *  This function makes use of the heap structure, descending to any
@@ -106,12 +141,21 @@ class BoolOrPostList : public PostList {
   public:
     /** Construct from 2 random-access iterators to a container of PostList*,
      *  a pointer to the matcher, and the document collection size.
+     *
+     *  If @a use_bitmap_ is true, then when first positioned all the
+     *  sub-postlists are decoded into a bitmap, which is then iterated.
+     *  This avoids the cost of maintaining a heap when there are a lot of
+     *  sub-postlists, but the sub-postlists must all be unweighted term
+     *  postlists (so count_matching_subqs() is always 0), and get_wdf() and
+     *  gather_position_lists() aren't supported.
      */
     template<class RandomItor>
     BoolOrPostList(RandomItor pl_begin, RandomItor pl_end,
-		   Xapian::doccount db_size_)
+		   Xapian::doccount db_size_,
+		   bool use_bitmap_ = false,
+		   PostListTree* pltree_ = NULL)
 	: did(0), n_kids(pl_end - pl_begin), plist(NULL),
-	  db_size(db_size_)
+	  db_size(db_size_), use_bitmap(use_bitmap_), pltree(pltree_)
     {
 	plist = new PostListAndDocID[n_kids];
 	// This initialises all entries to have did 0, so all entries are
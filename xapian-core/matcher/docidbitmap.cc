@@ -0,0 +1,175 @@
+/** @file
+ * @brief Compressed bitmap of document ids
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include <config.h>
+
+#include "docidbitmap.h"
+
+#include "omassert.h"
+
+#include <algorithm>
+
+using namespace std;
+
+/// Return the index of the lowest set bit in @a w, which must be non-zero.
+static inline unsigned
+lowest_set_bit(uint64_t w)
+{
+    Assert(w != 0);
+#if HAVE_DECL___BUILTIN_CTZLL
+    return unsigned(__builtin_ctzll(w));
+#else
+    unsigned i = 0;
+    while ((w & 1) == 0) {
+	w >>= 1;
+	++i;
+    }
+    return i;
+#endif
+}
+
+/// Return the number of set bits in @a w.
+static inline unsigned
+count_set_bits(uint64_t w)
+{
+#if HAVE_DECL___BUILTIN_POPCOUNTLL
+    return unsigned(__builtin_popcountll(w));
+#else
+    unsigned c = 0;
+    while (w) {
+	++c;
+	w &= w - 1;
+    }
+    return c;
+#endif
+}
+
+void
+DocidBitmap::flush_pending()
+{
+    AssertRel(pending.size(),<=,65536);
+    AssertRel(blocks.empty() ? 0 : blocks.back().key,<=,pending_key);
+    Xapian::doccount count = Xapian::doccount(pending.size());
+    if (count > MAX_ARRAY) {
+	blocks.emplace_back(pending_key, count, bitsets.size());
+	bitsets.resize(bitsets.size() + BITSET_WORDS);
+	uint64_t* words = &bitsets[blocks.back().offset];
+	for (uint16_t low : pending) {
+	    words[low >> 6] |= uint64_t(1) << (low & 63);
+	}
+    } else {
+	blocks.emplace_back(pending_key, count, arrays.size());
+	arrays.insert(arrays.end(), pending.begin(), pending.end());
+    }
+    size += count;
+    pending.clear();
+}
+
+void
+DocidBitmap::add_block(Xapian::docid key, const uint64_t* words)
+{
+    Assert(pending.empty());
+    AssertRel(blocks.empty() ? 0 : blocks.back().key + 1,<=,key);
+    Xapian::doccount count = 0;
+    for (size_t w = 0; w != BITSET_WORDS; ++w) {
+	count += count_set_bits(words[w]);
+    }
+    if (count == 0)
+	return;
+    if (count > MAX_ARRAY) {
+	blocks.emplace_back(key, count, bitsets.size());
+	bitsets.insert(bitsets.end(), words, words + BITSET_WORDS);
+    } else {
+	blocks.emplace_back(key, count, arrays.size());
+	for (size_t w = 0; w != BITSET_WORDS; ++w) {
+	    for (uint64_t bits = words[w]; bits; bits &= bits - 1) {
+		arrays.push_back(uint16_t(w * 64 + lowest_set_bit(bits)));
+	    }
+	}
+    }
+    size += count;
+}
+
+size_t
+DocidBitmap::find_block(Xapian::docid key, size_t& hint) const
+{
+    if (hint < blocks.size() && blocks[hint].key == key)
+	return hint;
+    // If the hint is before the block we want, only search after it.
+    auto b = blocks.begin();
+    if (hint < blocks.size() && blocks[hint].key < key)
+	b += hint + 1;
+    b = lower_bound(b, blocks.end(), key,
+		    [](const Block& block, Xapian::docid k) {
+			return block.key < k;
+		    });
+    hint = size_t(b - blocks.begin());
+    return hint;
+}
+
+bool
+DocidBitmap::contains(Xapian::docid did, size_t& hint) const
+{
+    Xapian::docid key = did >> 16;
+    size_t i = find_block(key, hint);
+    if (i == blocks.size() || blocks[i].key != key)
+	return false;
+    const Block& block = blocks[i];
+    uint16_t low = uint16_t(did);
+    if (block.is_bitset()) {
+	return (bitsets[block.offset + (low >> 6)] >> (low & 63)) & 1;
+    }
+    auto begin = arrays.begin() + block.offset;
+    return binary_search(begin, begin + block.count, low);
+}
+
+Xapian::docid
+DocidBitmap::find_from(Xapian::docid did, size_t& hint) const
+{
+    Xapian::docid key = did >> 16;
+    for (size_t i = find_block(key, hint); i != blocks.size(); ++i) {
+	const Block& block = blocks[i];
+	// If we've moved on to a later block, start from its first entry.
+	unsigned start = block.key == key ? unsigned(did & 0xffff) : 0;
+	if (block.is_bitset()) {
+	    const uint64_t* words = &bitsets[block.offset];
+	    size_t w = start >> 6;
+	    uint64_t bits = words[w] & (~uint64_t(0) << (start & 63));
+	    while (bits == 0) {
+		if (++w == BITSET_WORDS) break;
+		bits = words[w];
+	    }
+	    if (bits != 0) {
+		hint = i;
+		return (block.key << 16) | Xapian::docid(w * 64 +
+							 lowest_set_bit(bits));
+	    }
+	} else {
+	    auto begin = arrays.begin() + block.offset;
+	    auto end = begin + block.count;
+	    auto p = lower_bound(begin, end, start);
+	    if (p != end) {
+		hint = i;
+		return (block.key << 16) | *p;
+	    }
+	}
+    }
+    hint = blocks.size();
+    return 0;
+}
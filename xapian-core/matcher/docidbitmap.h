@@ -0,0 +1,150 @@
+/** @file
+ * @brief Compressed bitmap of document ids
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#ifndef XAPIAN_INCLUDED_DOCIDBITMAP_H
+#define XAPIAN_INCLUDED_DOCIDBITMAP_H
+
+#include "xapian/types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/** Compressed bitmap of document ids.
+ *
+ *  The docids are split into blocks of 65536 by their high bits, in the style
+ *  of a "roaring" bitmap.  A block with only a few entries stores the low 16
+ *  bits of each in a sorted array, while a fuller block stores a bitset, so
+ *  neither sparse nor dense sets take much space, and testing membership
+ *  doesn't depend on the number of entries.
+ */
+class DocidBitmap {
+  public:
+    /// The number of 64-bit words in the bitset for a block.
+    static constexpr size_t BITSET_WORDS = 65536 / 64;
+
+  private:
+    /// Blocks with more entries than this store a bitset.
+    static constexpr Xapian::doccount MAX_ARRAY = 4096;
+
+    struct Block {
+	/// The high bits of the docids in this block.
+	Xapian::docid key;
+
+	/// The number of docids in this block.
+	Xapian::doccount count;
+
+	/// Offset of this block's entries in arrays or bitsets.
+	size_t offset;
+
+	Block(Xapian::docid key_, Xapian::doccount count_, size_t offset_)
+	    : key(key_), count(count_), offset(offset_) { }
+
+	bool is_bitset() const { return count > MAX_ARRAY; }
+    };
+
+    /// The blocks, in ascending order of key.
+    std::vector<Block> blocks;
+
+    /// The low bits of the docids in array blocks.
+    std::vector<uint16_t> arrays;
+
+    /// The words of bitset blocks.
+    std::vector<uint64_t> bitsets;
+
+    /// The number of docids in the bitmap.
+    Xapian::doccount size = 0;
+
+    /// The low bits of docids for the block being added to.
+    std::vector<uint16_t> pending;
+
+    /// The key of the block being added to.
+    Xapian::docid pending_key = 0;
+
+    /// Store the pending block.
+    void flush_pending();
+
+    /** Find the first block with a key >= @a key.
+     *
+     *  @param hint	A block index to try first, which is updated to the
+     *			index returned.
+     */
+    size_t find_block(Xapian::docid key, size_t& hint) const;
+
+  public:
+    /** Add a docid.
+     *
+     *  Docids must be added in ascending order, and done() called after the
+     *  last has been added.
+     */
+    void add(Xapian::docid did) {
+	Xapian::docid key = did >> 16;
+	if (key != pending_key && !pending.empty())
+	    flush_pending();
+	pending_key = key;
+	pending.push_back(uint16_t(did));
+    }
+
+    /** Add a block of docids from a bitset.
+     *
+     *  This can't be mixed with add().
+     *
+     *  @param key	The high bits of the docids (i.e. did >> 16), which
+     *			must be greater than that of any docids already
+     *			added.
+     *  @param words	BITSET_WORDS words with a bit set for the low 16 bits
+     *			of each docid.
+     */
+    void add_block(Xapian::docid key, const uint64_t* words);
+
+    /// Finish adding docids.
+    void done() {
+	if (!pending.empty())
+	    flush_pending();
+	std::vector<uint16_t>().swap(pending);
+    }
+
+    /// Return the number of docids in the bitmap.
+    Xapian::doccount get_size() const { return size; }
+
+    /// Return an estimate of the memory used in bytes.
+    size_t get_bytes_used() const {
+	return blocks.size() * sizeof(Block) +
+	       arrays.size() * sizeof(uint16_t) +
+	       bitsets.size() * sizeof(uint64_t);
+    }
+
+    /** Test if @a did is in the bitmap.
+     *
+     *  @param hint	A block index to try first (see find_from()).
+     */
+    bool contains(Xapian::docid did, size_t& hint) const;
+
+    /** Find the first docid in the bitmap which is >= @a did.
+     *
+     *  @param hint	A block index to start looking from, which is updated
+     *			so that ascending searches can pass the same variable
+     *			to avoid searching the blocks.  Should start as 0.
+     *
+     *  @return	The docid found, or 0 if there isn't one.
+     */
+    Xapian::docid find_from(Xapian::docid did, size_t& hint) const;
+};
+
+#endif // XAPIAN_INCLUDED_DOCIDBITMAP_H
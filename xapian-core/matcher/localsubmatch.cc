@@ -60,6 +60,8 @@ class LazyWeight : public Xapian::Weight {
 
     double factor;
 
+    bool add_max_part;
+
     LazyWeight * clone() const;
 
     void init(double factor_);
@@ -70,13 +72,15 @@ class LazyWeight : public Xapian::Weight {
 	       Xapian::Weight::Internal * stats_,
 	       Xapian::termcount qlen_,
 	       Xapian::termcount wqf__,
-	       double factor_)
+	       double factor_,
+	       bool add_max_part_)
 	: pl(pl_),
 	  real_wt(real_wt_),
 	  stats(stats_),
 	  qlen(qlen_),
 	  wqf(wqf__),
-	  factor(factor_)
+	  factor(factor_),
+	  add_max_part(add_max_part_)
     { }
 
     std::string name() const;
@@ -152,7 +156,8 @@ double
 LazyWeight::get_maxpart() const
 {
     // This gets called first for the case we care about.
-    return pl->resolve_lazy_termweight(real_wt, stats, qlen, wqf, factor);
+    return pl->resolve_lazy_termweight(real_wt, stats, qlen, wqf, factor,
+				       add_max_part);
 }
 
 double
@@ -229,7 +234,7 @@ LocalSubMatch::make_synonym_postlist(PostListTree* pltree,
     RETURN(res.release());
 }
 
-PostList *
+LeafPostList *
 LocalSubMatch::open_post_list(const string& term,
 			      Xapian::termcount wqf,
 			      double factor,
@@ -238,7 +243,7 @@ LocalSubMatch::open_post_list(const string& term,
 			      QueryOptimiser * qopt,
 			      bool lazy_weight)
 {
-    LOGCALL(MATCH, PostList *, "LocalSubMatch::open_post_list", term | wqf | factor | need_positions | qopt | lazy_weight);
+    LOGCALL(MATCH, LeafPostList *, "LocalSubMatch::open_post_list", term | wqf | factor | need_positions | qopt | lazy_weight);
 
     bool weighted = false;
 
@@ -297,12 +302,14 @@ LocalSubMatch::open_post_list(const string& term,
 	Xapian::Weight * wt = wt_factory.clone();
 	if (!lazy_weight) {
 	    wt->init_(*total_stats, qlen, term, wqf, factor);
-	    total_stats->set_max_part(term, wt->get_maxpart());
+	    if (add_max_parts)
+		total_stats->set_max_part(term, wt->get_maxpart());
 	} else {
 	    // Delay initialising the actual weight object, so that we can
 	    // gather stats for the terms lazily expanded from a wildcard
 	    // (needed for the remote database case).
-	    wt = new LazyWeight(pl, wt, total_stats, qlen, wqf, factor);
+	    wt = new LazyWeight(pl, wt, total_stats, qlen, wqf, factor,
+				add_max_parts);
 	}
 	pl->set_termweight(wt);
     }
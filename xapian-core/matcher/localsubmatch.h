@@ -26,6 +26,7 @@
 #include "api/leafpostlist.h"
 #include "api/queryinternal.h"
 #include "xapian/enquire.h"
+#include "xapian/filtercache.h"
 #include "xapian/weight.h"
 
 #include <map>
@@ -61,6 +62,16 @@ class LocalSubMatch {
     /// Do any of the subdatabases have positional information?
     bool full_db_has_positions;
 
+    /// Cache for the filters of OP_FILTER subqueries (NULL for none).
+    Xapian::FilterCache::Internal* filter_cache = NULL;
+
+    /** Add each term's maximum weight to the statistics?
+     *
+     *  False when matching a range of docids in a shard, since the
+     *  LocalSubMatch for the shard's first range adds them.
+     */
+    bool add_max_parts = true;
+
   public:
     /// Constructor.
     LocalSubMatch(const Xapian::Database::Internal* db_,
@@ -75,6 +86,23 @@ class LocalSubMatch {
 	  full_db_has_positions(full_db_has_positions_)
     {}
 
+    /** Construct a LocalSubMatch for another Database::Internal object.
+     *
+     *  This is used when matching a range of docids in parallel - @a db_
+     *  should be another Database::Internal object for the same shard (at the
+     *  same revision) as @a o, so the statistics can be shared.  Building the
+     *  PostList tree for the new object doesn't add to the statistics.
+     */
+    LocalSubMatch(const LocalSubMatch& o,
+		  const Xapian::Database::Internal* db_)
+	: total_stats(o.total_stats), query(o.query), qlen(o.qlen), db(db_),
+	  wt_factory(o.wt_factory),
+	  shard_index(o.shard_index),
+	  full_db_has_positions(o.full_db_has_positions),
+	  filter_cache(o.filter_cache),
+	  add_max_parts(false)
+    {}
+
     /** Fetch and collate statistics.
      *
      *  Before we can calculate term weights we need to fetch statistics from
@@ -109,17 +137,26 @@ class LocalSubMatch {
 				     double factor,
 				     bool wdf_disjoint);
 
-    PostList * open_post_list(const std::string& term,
-			      Xapian::termcount wqf,
-			      double factor,
-			      bool need_positions,
-			      bool in_synonym,
-			      Xapian::Internal::QueryOptimiser* qopt,
-			      bool lazy_weight);
+    LeafPostList * open_post_list(const std::string& term,
+				  Xapian::termcount wqf,
+				  double factor,
+				  bool need_positions,
+				  bool in_synonym,
+				  Xapian::Internal::QueryOptimiser* qopt,
+				  bool lazy_weight);
 
     bool weight_needs_wdf() const {
 	return wt_factory.get_sumpart_needs_wdf_();
     }
+
+    /// Set a cache for the filters of OP_FILTER subqueries.
+    void set_filter_cache(Xapian::FilterCache::Internal* cache) {
+	filter_cache = cache;
+    }
+
+    Xapian::FilterCache::Internal* get_filter_cache() const {
+	return filter_cache;
+    }
 };
 
 #endif /* XAPIAN_INCLUDED_LOCALSUBMATCH_H */
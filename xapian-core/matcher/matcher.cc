@@ -24,18 +24,22 @@
 
 #include "api/enquireinternal.h"
 #include "api/msetinternal.h"
+#include "api/queryinternal.h"
 #include "api/rsetinternal.h"
+#include "backends/backends.h"
 #include "backends/multi/multi_database.h"
 #include "deciderpostlist.h"
 #include "localsubmatch.h"
 #include "msetcmp.h"
 #include "omassert.h"
+#include "parallelfor.h"
 #include "postlisttree.h"
 #include "protomset.h"
 #include "spymaster.h"
 #include "valuestreamdocument.h"
 #include "weight/weightinternal.h"
 
+#include <xapian/postingsource.h>
 #include <xapian/version.h> // For XAPIAN_HAS_REMOTE_BACKEND
 
 #ifdef XAPIAN_HAS_REMOTE_BACKEND
@@ -44,8 +48,11 @@
 #endif
 
 #include <algorithm>
+#include <atomic>
 #include <cerrno>
 #include <cfloat> // For DBL_EPSILON.
+#include <memory>
+#include <string>
 #include <vector>
 
 #ifdef HAVE_POLL_H
@@ -56,6 +63,7 @@
 
 using namespace std;
 using Xapian::Internal::opt_intrusive_ptr;
+using Xapian::Internal::QueryPostingSource;
 
 static constexpr auto DOCID = Xapian::Enquire::Internal::DOCID;
 static constexpr auto REL = Xapian::Enquire::Internal::REL;
@@ -317,73 +325,62 @@ Matcher::Matcher(const Xapian::Database& db_,
     stats.set_bounds_from_db(db);
 }
 
-Xapian::MSet
-Matcher::get_local_mset(Xapian::doccount first,
-			Xapian::doccount maxitems,
-			Xapian::doccount check_at_least,
-			const Xapian::Weight& wtscheme,
-			const Xapian::MatchDecider* mdecider,
-			const Xapian::KeyMaker* sorter,
-			Xapian::valueno collapse_key,
-			Xapian::doccount collapse_max,
-			int percent_threshold,
-			double percent_threshold_factor,
-			double weight_threshold,
-			Xapian::Enquire::docid_order order,
-			Xapian::valueno sort_key,
-			Xapian::Enquire::Internal::sort_setting sort_by,
-			bool sort_val_reverse,
-			double time_limit,
-			const vector<opt_ptr_spy>& matchspies)
+void
+Matcher::set_filter_cache(Xapian::FilterCache::Internal* cache)
 {
-    Assert(!locals.empty());
+    for (auto&& submatch : locals) {
+	if (submatch)
+	    submatch->set_filter_cache(cache);
+    }
+}
 
-    ValueStreamDocument vsdoc(db);
-    ++vsdoc._refs;
-    Xapian::Document doc(&vsdoc);
+/// Minimum weight shared by threads matching local shards in parallel.
+class SharedMinWeight {
+    atomic<double> min_weight{0.0};
 
-    vector<PostList*> postlists;
-    postlists.reserve(locals.size());
-    PostListTree pltree(vsdoc, db, wtscheme);
-    Xapian::termcount total_subqs = 0;
-    try {
-	bool all_null = true;
-	for (size_t i = 0; i != locals.size(); ++i) {
-	    if (!locals[i].get()) {
-		postlists.push_back(NULL);
-		continue;
-	    }
-	    // Pick the highest total subqueries answer amongst the
-	    // subdatabases, as the query to postlist conversion doesn't
-	    // recurse into positional queries for shards that don't have
-	    // positional data when at least one other shard does.
-	    Xapian::termcount total_subqs_i = 0;
-	    PostList* pl = locals[i]->get_postlist(&pltree, &total_subqs_i);
-	    total_subqs = max(total_subqs, total_subqs_i);
-	    if (pl != NULL) {
-		all_null = false;
-		if (mdecider) {
-		    pl = new DeciderPostList(pl, mdecider, &vsdoc, &pltree);
-		}
-	    }
-	    postlists.push_back(pl);
-	}
-	Assert(!postlists.empty());
+  public:
+    double get() const { return min_weight.load(memory_order_relaxed); }
 
-	if (all_null) {
-	    vector<Result> dummy;
-	    return Xapian::MSet(new Xapian::MSet::Internal(first, 0, 0, 0, 0,
-							   0, 0, 0.0, 0.0,
-							   std::move(dummy),
-							   0));
+    /// Raise the shared minimum weight to @a w if it's currently lower.
+    void raise(double w) {
+	double old = min_weight.load(memory_order_relaxed);
+	while (w > old &&
+	       !min_weight.compare_exchange_weak(old, w, memory_order_relaxed)) {
 	}
-    } catch (...) {
-	for (auto pl : postlists) delete pl;
-	throw;
     }
+};
 
-    Xapian::doccount n_shards = postlists.size();
-    pltree.set_postlists(&postlists[0], n_shards);
+/** Run the match loop over a PostListTree which has had its postlists set.
+ *
+ *  @param shared_min_weight	If non-NULL, a minimum weight shared with other
+ *				threads matching other shards (only valid if
+ *				the primary sort is by relevance and we aren't
+ *				collapsing).
+ */
+static Xapian::MSet
+run_match(PostListTree& pltree,
+	  ValueStreamDocument& vsdoc,
+	  Xapian::doccount n_shards,
+	  Xapian::termcount total_subqs,
+	  Xapian::doccount first,
+	  Xapian::doccount maxitems,
+	  Xapian::doccount check_at_least,
+	  const Xapian::MatchDecider* mdecider,
+	  const Xapian::KeyMaker* sorter,
+	  Xapian::valueno collapse_key,
+	  Xapian::doccount collapse_max,
+	  int percent_threshold,
+	  double percent_threshold_factor,
+	  double weight_threshold,
+	  Xapian::Enquire::docid_order order,
+	  Xapian::valueno sort_key,
+	  Xapian::Enquire::Internal::sort_setting sort_by,
+	  bool sort_val_reverse,
+	  double time_limit,
+	  const vector<opt_intrusive_ptr<Xapian::MatchSpy>>& matchspies,
+	  SharedMinWeight* shared_min_weight)
+{
+    Xapian::Document doc(&vsdoc);
 
     // The highest weight a document could get in this match.
     const double max_possible = pltree.recalc_maxweight();
@@ -401,6 +398,8 @@ Matcher::get_local_mset(Xapian::doccount first,
 	// All percentages will be 100% so turn off any percentage cut-off.
 	percent_threshold = 0;
 	percent_threshold_factor = 0.0;
+	// Sharing a minimum weight is pointless.
+	shared_min_weight = NULL;
     }
 
     Xapian::doccount matches_lower_bound = pltree.get_termfreq_min();
@@ -444,7 +443,7 @@ Matcher::get_local_mset(Xapian::doccount first,
 			   sort_by == DOCID);
 
     ProtoMSet proto_mset(first, maxitems, check_at_least,
-			 mcmp, sort_by, total_subqs,
+			 mcmp, sort_by, sort_val_reverse, total_subqs,
 			 pltree,
 			 collapse_key, collapse_max,
 			 percent_threshold, percent_threshold_factor,
@@ -453,8 +452,18 @@ Matcher::get_local_mset(Xapian::doccount first,
 			 time_limit);
     proto_mset.set_new_min_weight(weight_threshold);
 
+    // Holds the sort key for value streams which can't point to it in place.
+    string key_buf;
+
     while (true) {
 	double min_weight = proto_mset.get_min_weight();
+	if (shared_min_weight) {
+	    double shared = shared_min_weight->get();
+	    if (shared > min_weight) {
+		min_weight = shared;
+		proto_mset.set_pruned_externally();
+	    }
+	}
 	if (!pltree.next(min_weight)) {
 	    break;
 	}
@@ -482,7 +491,16 @@ Matcher::get_local_mset(Xapian::doccount first,
 	    if (sorter) {
 		new_item.set_sort_key((*sorter)(doc));
 	    } else {
-		new_item.set_sort_key(vsdoc.get_value(sort_key));
+		// Most candidates are rejected once the proto-mset is full, so
+		// check the value in place before copying it.
+		const char* key;
+		size_t key_len;
+		vsdoc.get_value_view(sort_key, key, key_len, key_buf);
+		if (proto_mset.early_reject_by_key(key, key_len,
+						   calculated_weight, weight,
+						   spymaster, doc))
+		    continue;
+		new_item.set_sort_key(string(key, key_len));
 	    }
 
 	    if (proto_mset.early_reject(new_item, calculated_weight, spymaster,
@@ -507,6 +525,10 @@ Matcher::get_local_mset(Xapian::doccount first,
 
 	if (!proto_mset.process(std::move(new_item), vsdoc))
 	    break;
+
+	if (shared_min_weight) {
+	    shared_min_weight->raise(proto_mset.get_min_weight());
+	}
     }
 
     return proto_mset.finalise(mdecider,
@@ -515,6 +537,316 @@ Matcher::get_local_mset(Xapian::doccount first,
 			       matches_upper_bound);
 }
 
+Xapian::MSet
+Matcher::get_local_mset(Xapian::doccount first,
+			Xapian::doccount maxitems,
+			Xapian::doccount check_at_least,
+			const Xapian::Weight& wtscheme,
+			const Xapian::MatchDecider* mdecider,
+			const Xapian::KeyMaker* sorter,
+			Xapian::valueno collapse_key,
+			Xapian::doccount collapse_max,
+			int percent_threshold,
+			double percent_threshold_factor,
+			double weight_threshold,
+			Xapian::Enquire::docid_order order,
+			Xapian::valueno sort_key,
+			Xapian::Enquire::Internal::sort_setting sort_by,
+			bool sort_val_reverse,
+			double time_limit,
+			const vector<opt_ptr_spy>& matchspies)
+{
+    Assert(!locals.empty());
+
+    ValueStreamDocument vsdoc(db);
+    ++vsdoc._refs;
+
+    vector<PostList*> postlists;
+    postlists.reserve(locals.size());
+    PostListTree pltree(vsdoc, db, wtscheme);
+    Xapian::termcount total_subqs = 0;
+    try {
+	bool all_null = true;
+	for (size_t i = 0; i != locals.size(); ++i) {
+	    if (!locals[i].get()) {
+		postlists.push_back(NULL);
+		continue;
+	    }
+	    // Pick the highest total subqueries answer amongst the
+	    // subdatabases, as the query to postlist conversion doesn't
+	    // recurse into positional queries for shards that don't have
+	    // positional data when at least one other shard does.
+	    Xapian::termcount total_subqs_i = 0;
+	    PostList* pl = locals[i]->get_postlist(&pltree, &total_subqs_i);
+	    total_subqs = max(total_subqs, total_subqs_i);
+	    if (pl != NULL) {
+		all_null = false;
+		if (mdecider) {
+		    pl = new DeciderPostList(pl, mdecider, &vsdoc, &pltree);
+		}
+	    }
+	    postlists.push_back(pl);
+	}
+	Assert(!postlists.empty());
+
+	if (all_null) {
+	    vector<Result> dummy;
+	    return Xapian::MSet(new Xapian::MSet::Internal(first, 0, 0, 0, 0,
+							   0, 0, 0.0, 0.0,
+							   std::move(dummy),
+							   0));
+	}
+    } catch (...) {
+	for (auto pl : postlists) delete pl;
+	throw;
+    }
+
+    Xapian::doccount n_shards = postlists.size();
+    pltree.set_postlists(&postlists[0], n_shards);
+
+    return run_match(pltree, vsdoc, n_shards, total_subqs,
+		     first, maxitems, check_at_least,
+		     mdecider, sorter, collapse_key, collapse_max,
+		     percent_threshold, percent_threshold_factor,
+		     weight_threshold, order, sort_key, sort_by,
+		     sort_val_reverse, time_limit, matchspies, NULL);
+}
+
+/// Check if @a query uses a PostingSource which doesn't support clone().
+static bool
+uses_unclonable_posting_source(const Xapian::Query& query)
+{
+    if (query.get_type() == Xapian::Query::LEAF_POSTING_SOURCE) {
+	auto q = static_cast<const QueryPostingSource*>(query.internal.get());
+	unique_ptr<Xapian::PostingSource> clone(
+	    q->get_posting_source()->clone());
+	return !clone;
+    }
+    for (size_t i = 0; i != query.get_num_subqueries(); ++i) {
+	if (uses_unclonable_posting_source(query.get_subquery(i)))
+	    return true;
+    }
+    return false;
+}
+
+const Xapian::Database::Internal*
+Matcher::get_shard(Xapian::doccount shard_index) const
+{
+    if (db.internal->size() == 1)
+	return db.internal.get();
+    auto multidb = static_cast<const MultiDatabase*>(db.internal.get());
+    return multidb->shards[shard_index];
+}
+
+bool
+Matcher::can_match_locals_in_parallel(const Xapian::MatchDecider* mdecider,
+				      const vector<opt_ptr_spy>& matchspies,
+				      unsigned n_threads) const
+{
+    if (n_threads <= 1 || mdecider || !matchspies.empty())
+	return false;
+
+    Xapian::doccount n_shards = db.internal->size();
+    vector<const Xapian::Database::Internal*> shards;
+    for (Xapian::doccount i = 0; i != n_shards; ++i) {
+	if (locals[i].get())
+	    shards.push_back(get_shard(i));
+    }
+
+    if (shards.size() == 1) {
+	// We can split a single shard into ranges of docids, but each thread
+	// needs its own Database::Internal object for the shard, so it needs
+	// to be a read-only database which we can open again, and any
+	// PostingSource objects need to be cloned for each thread.
+	string path;
+	int backend = shards[0]->get_backend_info(&path);
+	return (backend == BACKEND_GLASS || backend == BACKEND_HONEY) &&
+	       // Single file databases opened from a file descriptor don't
+	       // have a path.
+	       !path.empty() &&
+	       shards[0]->is_read_only() &&
+	       !uses_unclonable_posting_source(query);
+    }
+
+    // Each thread needs its own Database::Internal object, so check that the
+    // same shard hasn't been added more than once.
+    if (shards.empty())
+	return false;
+    sort(shards.begin(), shards.end());
+    return adjacent_find(shards.begin(), shards.end()) == shards.end();
+}
+
+/// State for matching one local shard (or a range of its docids) in a thread.
+struct ShardMatch {
+    /// Index of this shard in the combined Database.
+    Xapian::doccount shard_index;
+
+    /// Database object for just this shard.
+    Xapian::Database shard_db;
+
+    /** LocalSubMatch for @a shard_db.
+     *
+     *  Only used when matching a range of docids with a Database object
+     *  opened just for this thread.
+     */
+    unique_ptr<LocalSubMatch> submatch;
+
+    ValueStreamDocument vsdoc;
+
+    PostListTree pltree;
+
+    /** PostList for this shard.
+     *
+     *  Owned by @a pltree once set_postlists() has been called.
+     */
+    PostList* pl = NULL;
+
+    Xapian::MSet mset;
+
+    ShardMatch(Xapian::doccount shard_index_,
+	       Xapian::Database::Internal* shard,
+	       const Xapian::Weight& wtscheme)
+	: shard_index(shard_index_),
+	  shard_db(shard),
+	  vsdoc(shard_db),
+	  pltree(vsdoc, shard_db, wtscheme)
+    {
+	++vsdoc._refs;
+    }
+
+    /** Build the PostList tree for this shard.
+     *
+     *  Returns false if the query can't match anything in this shard.
+     */
+    bool build_postlist(LocalSubMatch& local_submatch,
+			Xapian::termcount& total_subqs) {
+	Xapian::termcount total_subqs_i = 0;
+	pl = local_submatch.get_postlist(&pltree, &total_subqs_i);
+	total_subqs = max(total_subqs, total_subqs_i);
+	if (pl == NULL)
+	    return false;
+	pltree.set_postlists(&pl, 1);
+	return true;
+    }
+};
+
+vector<Xapian::MSet>
+Matcher::get_local_msets_parallel(Xapian::doccount first,
+				  Xapian::doccount maxitems,
+				  Xapian::doccount check_at_least,
+				  const Xapian::Weight& wtscheme,
+				  const Xapian::KeyMaker* sorter,
+				  Xapian::valueno collapse_key,
+				  Xapian::doccount collapse_max,
+				  double weight_threshold,
+				  Xapian::Enquire::docid_order order,
+				  Xapian::valueno sort_key,
+				  Xapian::Enquire::Internal::sort_setting sort_by,
+				  bool sort_val_reverse,
+				  double time_limit,
+				  unsigned n_threads)
+{
+    Xapian::doccount n_shards = db.internal->size();
+
+    // Building the PostList trees updates the shared statistics, so we do
+    // that for all shards in this thread before starting any others.
+    vector<unique_ptr<ShardMatch>> shard_matches;
+    Xapian::termcount total_subqs = 0;
+    Xapian::doccount n_locals = 0;
+    for (Xapian::doccount i = 0; i != n_shards; ++i) {
+	if (!locals[i].get())
+	    continue;
+	++n_locals;
+	// Casting away const on the Database::Internal here is OK, as the
+	// matcher only calls const methods on it.
+	auto shard = const_cast<Xapian::Database::Internal*>(get_shard(i));
+	unique_ptr<ShardMatch> sm(new ShardMatch(i, shard, wtscheme));
+	if (!sm->build_postlist(*locals[i], total_subqs))
+	    continue;
+	shard_matches.push_back(std::move(sm));
+    }
+
+    if (n_locals == 1 && shard_matches.size() == 1) {
+	// Split the docids in the only local shard into ranges and match each
+	// in its own thread.
+	ShardMatch& sm0 = *shard_matches[0];
+	auto shard = sm0.shard_db.internal.get();
+	Xapian::docid first_did, last_did;
+	shard->get_used_docid_range(first_did, last_did);
+	Xapian::doccount n_ranges = 0;
+	if (last_did > first_did)
+	    n_ranges = min(Xapian::doccount(n_threads), last_did - first_did + 1);
+
+	// Each range needs its own Database::Internal object (the first range
+	// can use the existing one).
+	vector<Xapian::Database> copies;
+	if (n_ranges > 1) {
+	    shard->get_copies(n_ranges - 1, copies);
+	    n_ranges = copies.size() + 1;
+	}
+
+	if (n_ranges > 1) {
+	    // The ranges are set after building each PostList tree, since
+	    // filters cached while building it must cover the whole shard.  A
+	    // BoolOrPostList reads the range end when it first decodes.
+	    unsigned long long span = last_did - first_did + 1ull;
+	    auto set_range = [&](ShardMatch& sm, Xapian::doccount r) {
+		Xapian::docid lo = first_did + span * r / n_ranges;
+		Xapian::docid hi = first_did + span * (r + 1) / n_ranges - 1;
+		sm.pltree.set_docid_range(lo, hi, double(hi - lo + 1) / span);
+	    };
+	    set_range(sm0, 0);
+
+	    LocalSubMatch& submatch0 = *locals[sm0.shard_index];
+	    for (Xapian::doccount r = 1; r != n_ranges; ++r) {
+		auto copy = copies[r - 1].internal.get();
+		unique_ptr<ShardMatch> sm(new ShardMatch(sm0.shard_index, copy,
+							 wtscheme));
+		sm->submatch.reset(new LocalSubMatch(submatch0, copy));
+		if (!sm->build_postlist(*sm->submatch, total_subqs))
+		    continue;
+		set_range(*sm, r);
+		shard_matches.push_back(std::move(sm));
+	    }
+	}
+    }
+
+    for (auto&& sm : shard_matches) {
+	// Calculating the maximum weight may resolve lazy term weights which
+	// also updates the shared statistics.
+	(void)sm->pltree.recalc_maxweight();
+    }
+
+    if (shard_matches.empty())
+	return vector<Xapian::MSet>();
+
+    // A minimum weight found by one thread only applies to the others if
+    // we're sorting primarily by relevance and not collapsing (since results
+    // from different threads may collapse together).
+    SharedMinWeight shared_min_weight;
+    SharedMinWeight* shared = NULL;
+    if ((sort_by == REL || sort_by == REL_VAL) && collapse_max == 0)
+	shared = &shared_min_weight;
+
+    parallel_for(shard_matches.size(), n_threads, [&](size_t j) {
+	ShardMatch& sm = *shard_matches[j];
+	sm.mset = run_match(sm.pltree, sm.vsdoc, 1, total_subqs,
+			    first, maxitems, check_at_least,
+			    NULL, sorter, collapse_key, collapse_max,
+			    0, 0.0, weight_threshold,
+			    order, sort_key, sort_by, sort_val_reverse,
+			    time_limit, vector<opt_ptr_spy>(), shared);
+    });
+
+    vector<Xapian::MSet> msets;
+    msets.reserve(shard_matches.size());
+    for (auto&& sm : shard_matches) {
+	sm->mset.internal->unshard_docids(sm->shard_index, n_shards);
+	msets.push_back(std::move(sm->mset));
+    }
+    return msets;
+}
+
 Xapian::MSet
 Matcher::get_mset(Xapian::doccount first,
 		  Xapian::doccount maxitems,
@@ -532,12 +864,18 @@ Matcher::get_mset(Xapian::doccount first,
 		  Xapian::Enquire::Internal::sort_setting sort_by,
 		  bool sort_val_reverse,
 		  double time_limit,
-		  const vector<opt_intrusive_ptr<Xapian::MatchSpy>>& matchspies)
+		  const vector<opt_intrusive_ptr<Xapian::MatchSpy>>& matchspies,
+		  unsigned n_threads)
 {
     AssertRel(check_at_least, >=, first + maxitems);
 
     Assert(!query.empty());
 
+    if (collapse_key == Xapian::BAD_VALUENO) {
+	// We aren't actually collapsing, so don't merge counts as if we were.
+	collapse_max = 0;
+    }
+
 #ifdef XAPIAN_HAS_REMOTE_BACKEND
     if (locals.empty() && remotes.size() == 1) {
 	// Short cut for a single remote database.
@@ -555,6 +893,10 @@ Matcher::get_mset(Xapian::doccount first,
     // precision on x86.
     percent_threshold_factor -= DBL_EPSILON;
 
+    bool parallel = !locals.empty() &&
+		    can_match_locals_in_parallel(mdecider, matchspies,
+						 n_threads);
+
 #ifdef XAPIAN_HAS_REMOTE_BACKEND
     for (auto&& submatch : remotes) {
 	Assert(submatch.get());
@@ -571,9 +913,13 @@ Matcher::get_mset(Xapian::doccount first,
 	submatch->start_match(0, remote_maxitems, check_at_least, sorter,
 			      stats);
     }
+
+    bool merging = parallel || !remotes.empty();
+#else
+    bool merging = parallel;
 #endif
 
-    Xapian::MSet local_mset;
+    vector<Xapian::MSet> local_msets;
     if (!locals.empty()) {
 	for (auto&& submatch : locals) {
 	    if (submatch.get())
@@ -583,8 +929,7 @@ Matcher::get_mset(Xapian::doccount first,
 	Xapian::doccount local_first = first;
 	Xapian::doccount local_maxitems = maxitems;
 	double local_percent_threshold_factor = percent_threshold_factor;
-#ifdef XAPIAN_HAS_REMOTE_BACKEND
-	if (!remotes.empty()) {
+	if (merging) {
 	    // We need to fetch the first "first" results too, as merging may
 	    // push those down into the part of the merged MSet we care about.
 	    local_first = 0;
@@ -600,34 +945,46 @@ Matcher::get_mset(Xapian::doccount first,
 	    }
 	    local_percent_threshold_factor = 0.0;
 	}
-#endif
-	local_mset = get_local_mset(local_first, local_maxitems, check_at_least,
-				    wtscheme, mdecider,
-				    sorter, collapse_key, collapse_max,
-				    percent_threshold,
-				    local_percent_threshold_factor,
-				    weight_threshold, order, sort_key, sort_by,
-				    sort_val_reverse, time_limit, matchspies);
+	if (parallel) {
+	    local_msets = get_local_msets_parallel(local_first, local_maxitems,
+						   check_at_least, wtscheme,
+						   sorter, collapse_key,
+						   collapse_max,
+						   weight_threshold,
+						   order, sort_key, sort_by,
+						   sort_val_reverse,
+						   time_limit, n_threads);
+	} else {
+	    local_msets.push_back(
+		get_local_mset(local_first, local_maxitems, check_at_least,
+			       wtscheme, mdecider,
+			       sorter, collapse_key, collapse_max,
+			       percent_threshold,
+			       local_percent_threshold_factor,
+			       weight_threshold, order, sort_key, sort_by,
+			       sort_val_reverse, time_limit, matchspies));
+	}
     }
 
-#ifdef XAPIAN_HAS_REMOTE_BACKEND
-    if (remotes.empty()) {
-	// Another easy case - only local databases.
-	return local_mset;
+    if (!merging) {
+	// Another easy case - only local databases matched in this thread.
+	Assert(local_msets.size() == 1);
+	return local_msets[0];
     }
 
     // We need to merge MSet objects.  We only need the number of remote shards
-    // + 1 if there are any local shards, so reserving n_shards may be more
+    // + the number of local MSet objects, so reserving n_shards may be more
     // than we need.
     vector<pair<Xapian::MSet, Xapian::doccount>> msets;
     Xapian::MSet merged_mset;
-    if (!locals.empty()) {
+    for (auto&& local_mset : local_msets) {
 	if (!local_mset.empty())
 	    msets.push_back({local_mset, 0});
 	merged_mset.internal->merge_stats(local_mset.internal.get(),
 					  collapse_max != 0);
     }
 
+#ifdef XAPIAN_HAS_REMOTE_BACKEND
     for_all_remotes(
 	[&](RemoteSubMatch* submatch) {
 	    Xapian::MSet remote_mset = submatch->get_mset(matchspies);
@@ -640,6 +997,7 @@ Matcher::get_mset(Xapian::doccount first,
 						 db.internal->size());
 	    msets.push_back({remote_mset, 0});
 	});
+#endif
 
     if (merged_mset.internal->max_possible == 0.0) {
 	// All the weights are zero.
@@ -706,6 +1064,30 @@ Matcher::get_mset(Xapian::doccount first,
 	}
     }
 
+    if (percent_threshold && !collapser) {
+	// The MSet objects we've merged were produced without applying the
+	// percentage threshold, so adjust the counts in the same way the
+	// ProtoMSet does when not merging.
+	auto mseti = merged_mset.internal;
+	Xapian::doccount n_passed = mseti->first - first + mseti->items.size();
+	if (mseti->items.size() != maxitems) {
+	    // We've merged all the documents which reach the threshold.
+	    mseti->matches_estimated = n_passed;
+	    mseti->matches_upper_bound = n_passed;
+	} else {
+	    // Scale the estimate assuming that document weights are evenly
+	    // distributed from 0 to the maximum weight seen.
+	    double scale = 1.0 - percent_threshold_factor;
+	    auto e = Xapian::doccount(mseti->matches_estimated * scale + 0.5);
+	    mseti->matches_estimated = STD_CLAMP(e, n_passed,
+						 mseti->matches_upper_bound);
+	}
+	mseti->matches_lower_bound = n_passed;
+	mseti->uncollapsed_lower_bound = mseti->matches_lower_bound;
+	mseti->uncollapsed_estimated = mseti->matches_estimated;
+	mseti->uncollapsed_upper_bound = mseti->matches_upper_bound;
+    }
+
     if (collapser) {
 	auto todo = check_at_least - maxitems;
 	if (merged_mset.size() != maxitems) {
@@ -786,7 +1168,4 @@ Matcher::get_mset(Xapian::doccount first,
     }
 
     return merged_mset;
-#else
-    return local_mset;
-#endif
 }
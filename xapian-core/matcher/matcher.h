@@ -104,6 +104,46 @@ class Matcher {
 				double time_limit,
 				const std::vector<opt_ptr_spy>& matchspies);
 
+    /** Match each local shard in its own thread.
+     *
+     *  If there's only one local shard, its docids are instead split into
+     *  ranges which are each matched in their own thread.
+     *
+     *  Returns an MSet object for each local shard (or docid range) which has
+     *  a non-NULL PostList, with docids already mapped back to those of the
+     *  combined Database.  These need to be merged to produce the final
+     *  result.
+     */
+    std::vector<Xapian::MSet>
+    get_local_msets_parallel(Xapian::doccount first,
+			     Xapian::doccount maxitems,
+			     Xapian::doccount check_at_least,
+			     const Xapian::Weight& wtscheme,
+			     const Xapian::KeyMaker* sorter,
+			     Xapian::valueno collapse_key,
+			     Xapian::doccount collapse_max,
+			     double weight_threshold,
+			     Xapian::Enquire::docid_order order,
+			     Xapian::valueno sort_key,
+			     Xapian::Enquire::Internal::sort_setting sort_by,
+			     bool sort_val_reverse,
+			     double time_limit,
+			     unsigned n_threads);
+
+    /// Get the Database::Internal for shard @a shard_index.
+    const Xapian::Database::Internal*
+    get_shard(Xapian::doccount shard_index) const;
+
+    /** Can we match local shards in parallel?
+     *
+     *  Requires more than one distinct local shard (or a single local shard
+     *  which we can open again for each thread), and no user objects which
+     *  aren't required to be thread-safe.
+     */
+    bool can_match_locals_in_parallel(const Xapian::MatchDecider* mdecider,
+				      const std::vector<opt_ptr_spy>& matchspies,
+				      unsigned n_threads) const;
+
     /// Perform action on remotes as they become ready using poll() or select().
     template<typename Action> void for_all_remotes(Action action);
 
@@ -151,6 +191,14 @@ class Matcher {
 	    double time_limit,
 	    const std::vector<opt_ptr_spy>& matchspies);
 
+    /** Set a cache for the filters of OP_FILTER subqueries.
+     *
+     *  This is used by local shards, and must be called before get_mset().
+     *
+     *  @param cache	The cache to use (NULL for none).
+     */
+    void set_filter_cache(Xapian::FilterCache::Internal* cache);
+
     /** Run the match and produce an MSet object.
      *
      *  @param first		Zero-based index of the first result to return
@@ -186,6 +234,8 @@ class Matcher {
      *  @param time_limit	time in seconds after which to disable
      *				check_at_least (0.0 means don't).
      *  @param matchspies	MatchSpy objects to use
+     *  @param n_threads	Maximum number of threads to match local shards
+     *				with (0 or 1 means don't use threads).
      */
     Xapian::MSet get_mset(Xapian::doccount first,
 			  Xapian::doccount maxitems,
@@ -203,7 +253,8 @@ class Matcher {
 			  Xapian::Enquire::Internal::sort_setting sort_by,
 			  bool sort_val_reverse,
 			  double time_limit,
-			  const std::vector<opt_ptr_spy>& matchspies);
+			  const std::vector<opt_ptr_spy>& matchspies,
+			  unsigned n_threads = 0);
 };
 
 #endif // XAPIAN_INCLUDED_MATCHER_H
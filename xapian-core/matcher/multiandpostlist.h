@@ -45,6 +45,7 @@ class MultiAndPostList : public PostList {
     /// Don't allow copying.
     MultiAndPostList(const MultiAndPostList &);
 
+  protected:
     /// The current docid, or zero if we haven't started or are at_end.
     Xapian::docid did;
 
@@ -71,6 +72,7 @@ class MultiAndPostList : public PostList {
 	return w_min - (max_total - max_wt[n]);
     }
 
+  private:
     /// Call next on a sub-postlist n, and handle any pruning.
     void next_helper(size_t n, double w_min) {
 	PostList * res = plist[n]->next(new_min(w_min, n));
@@ -59,6 +59,27 @@ class PostListTree {
 
     Xapian::Database& db;
 
+    /** First docid to match.
+     *
+     *  The range is set when matching part of a single shard.
+     */
+    Xapian::docid range_first = 1;
+
+    /// Last docid to match.
+    Xapian::docid range_last = Xapian::docid(-1);
+
+    /// Fraction of the shard's used docids which the range covers.
+    double range_fraction = 1.0;
+
+    /// Do we still need to skip to @a range_first?
+    bool need_skip_to_range = false;
+
+    /// Is the current docid within the docid range?
+    bool in_range() const {
+	return range_last == Xapian::docid(-1) ||
+	       pl->get_docid() <= range_last;
+    }
+
   public:
     PostListTree(ValueStreamDocument& vsdoc_,
 		 Xapian::Database& db_,
@@ -91,6 +112,33 @@ class PostListTree {
 	    vsdoc.new_shard(current_shard);
     }
 
+    /** Only match documents with docids in a range.
+     *
+     *  Only valid with a single shard, and must be called before next() is.
+     *
+     *  @param first	    First docid in the range
+     *  @param last	    Last docid in the range
+     *  @param fraction    Fraction of the used docids which the range covers
+     *			   (used to estimate the number of matches).
+     */
+    void set_docid_range(Xapian::docid first,
+			 Xapian::docid last,
+			 double fraction) {
+	Assert(n_shards == 1);
+	range_first = first;
+	range_last = last;
+	range_fraction = fraction;
+	need_skip_to_range = (first > 1);
+    }
+
+    /** Last docid to match.
+     *
+     *  Xapian::docid(-1) unless set_docid_range() has been called.  A
+     *  PostList which decodes ahead (e.g. a BoolOrPostList using a bitmap)
+     *  can stop here as the matcher won't consider any later docid.
+     */
+    Xapian::docid get_range_last() const { return range_last; }
+
     double recalc_maxweight() {
 	if (!use_cached_max_weight) {
 	    use_cached_max_weight = true;
@@ -114,6 +162,10 @@ class PostListTree {
 	for (Xapian::doccount i = 0; i != n_shards; ++i)
 	    if (shard_pls[i])
 		result += shard_pls[i]->get_termfreq_min();
+	if (range_fraction != 1.0) {
+	    // We don't know how many of the matches fall within the range.
+	    result = 0;
+	}
 	return result;
     }
 
@@ -122,6 +174,9 @@ class PostListTree {
 	for (Xapian::doccount i = 0; i != n_shards; ++i)
 	    if (shard_pls[i])
 		result += shard_pls[i]->get_termfreq_max();
+	if (range_last != Xapian::docid(-1)) {
+	    result = min(result, range_last - range_first + 1);
+	}
 	return result;
     }
 
@@ -130,6 +185,9 @@ class PostListTree {
 	for (Xapian::doccount i = 0; i != n_shards; ++i)
 	    if (shard_pls[i])
 		result += shard_pls[i]->get_termfreq_est();
+	if (range_fraction != 1.0) {
+	    result = Xapian::doccount(result * range_fraction + 0.5);
+	}
 	return result;
     }
 
@@ -151,7 +209,14 @@ class PostListTree {
 	}
 
 	while (true) {
-	    PostList* result = pl->next(w_min);
+	    PostList* result;
+	    if (rare(need_skip_to_range)) {
+		// Move to the start of the docid range.
+		result = pl->skip_to(range_first, w_min);
+		need_skip_to_range = false;
+	    } else {
+		result = pl->next(w_min);
+	    }
 	    if (rare(result)) {
 		delete pl;
 		shard_pls[current_shard] = pl = result;
@@ -163,11 +228,11 @@ class PostListTree {
 			    return false;
 			}
 		    }
-		    return true;
+		    return in_range();
 		}
 	    } else {
 		if (usual(!pl->at_end())) {
-		    return true;
+		    return in_range();
 		}
 	    }
 
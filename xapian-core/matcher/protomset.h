@@ -32,6 +32,7 @@
 #include "stdclamp.h"
 
 #include <algorithm>
+#include <cstring>
 
 using Xapian::Internal::intrusive_ptr;
 
@@ -61,6 +62,9 @@ class ProtoMSet {
 
     Xapian::Enquire::Internal::sort_setting sort_by;
 
+    /// Do greater sort keys rank higher?
+    bool sort_val_reverse;
+
     MSetCmp mcmp;
 
     /** Minimum threshold on the weight.
@@ -85,6 +89,15 @@ class ProtoMSet {
 
     bool min_weight_pending = false;
 
+    /** Have we skipped documents due to a threshold from elsewhere?
+     *
+     *  When local shards are matched in parallel, the threads share the
+     *  highest min_weight any of them has reached, so a shard can skip
+     *  matching documents without the ProtoMSet being full.  If this happens
+     *  the number of documents we've seen isn't an exact count of the matches.
+     */
+    bool pruned_externally = false;
+
     /** Count of how many known matching documents have been processed so far.
      *
      *  Used to implement "check_at_least".
@@ -135,6 +148,7 @@ class ProtoMSet {
 	      Xapian::doccount check_at_least_,
 	      MSetCmp mcmp_,
 	      Xapian::Enquire::Internal::sort_setting sort_by_,
+	      bool sort_val_reverse_,
 	      Xapian::termcount total_subqs_,
 	      PostListTree& pltree_,
 	      Xapian::valueno collapse_key,
@@ -147,6 +161,7 @@ class ProtoMSet {
 	: max_size(first_ + max_items),
 	  check_at_least(check_at_least_),
 	  sort_by(sort_by_),
+	  sort_val_reverse(sort_val_reverse_),
 	  mcmp(mcmp_),
 	  first(first_),
 	  total_subqs(total_subqs_),
@@ -171,6 +186,8 @@ class ProtoMSet {
 
     double get_min_weight() const { return min_weight; }
 
+    void set_pruned_externally() { pruned_externally = true; }
+
     void update_max_weight(double weight) {
 	if (weight <= max_weight)
 	    return;
@@ -227,7 +244,9 @@ class ProtoMSet {
 		if (known_matching_docs >= check_at_least)
 		    min_weight = new_min_weight;
 	    } else {
-		if (checked_enough())
+		// If any results were removed then we're no longer full, so
+		// the lowest weight remaining isn't a valid minimum.
+		if (j == results.size() && checked_enough())
 		    min_weight = new_min_weight;
 	    }
 	}
@@ -245,6 +264,59 @@ class ProtoMSet {
 	return true;
     }
 
+    /// Count a candidate which can't make the proto-mset.
+    void reject(bool calculated_weight,
+		double weight,
+		SpyMaster& spymaster,
+		const Xapian::Document& doc) {
+	++known_matching_docs;
+	if (!calculated_weight)
+	    weight = pltree.get_weight();
+	spymaster(doc, weight);
+	update_max_weight(weight);
+    }
+
+    /** Try to reject a candidate using just its sort key.
+     *
+     *  This compares the key in place, so when most candidates are rejected
+     *  we don't need to copy each one's key into a Result.  It only rejects
+     *  when we're sorting primarily by value, aren't collapsing, and the key
+     *  alone ranks the candidate below the lowest in the proto-mset.
+     *  Otherwise it returns false and the caller should build a Result and
+     *  call early_reject().
+     *
+     *  @param key		The candidate's sort key.
+     *  @param key_len		The length of @a key.
+     *  @param calculated_weight	Has @a weight been calculated?
+     *  @param weight		The candidate's weight, if calculated.
+     */
+    bool early_reject_by_key(const char* key, size_t key_len,
+			     bool calculated_weight,
+			     double weight,
+			     SpyMaster& spymaster,
+			     const Xapian::Document& doc) {
+	if (min_heap.empty() || collapser)
+	    return false;
+	if (sort_by != Xapian::Enquire::Internal::VAL &&
+	    sort_by != Xapian::Enquire::Internal::VAL_REL)
+	    return false;
+
+	// Compare in the same way as std::string::compare().
+	const std::string& worst = results[min_heap.front()].get_sort_key();
+	size_t n = std::min(key_len, worst.size());
+	int cmp = n ? std::memcmp(key, worst.data(), n) : 0;
+	if (cmp == 0) {
+	    if (key_len == worst.size())
+		return false;
+	    cmp = key_len < worst.size() ? -1 : 1;
+	}
+	if ((cmp > 0) == sort_val_reverse)
+	    return false;
+
+	reject(calculated_weight, weight, spymaster, doc);
+	return true;
+    }
+
     bool early_reject(Result& new_item,
 		      bool calculated_weight,
 		      SpyMaster& spymaster,
@@ -266,11 +338,7 @@ class ProtoMSet {
 	// If we're collapsing, we need to check if this would have been
 	// collapsed before incrementing known_matching_docs.
 	if (!collapser) {
-	    ++known_matching_docs;
-	    double weight =
-		calculated_weight ? new_item.get_weight() : pltree.get_weight();
-	    spymaster(doc, weight);
-	    update_max_weight(weight);
+	    reject(calculated_weight, new_item.get_weight(), spymaster, doc);
 	    return true;
 	}
 
@@ -494,7 +562,7 @@ class ProtoMSet {
 	Xapian::doccount uncollapsed_estimated = matches_estimated;
 	Xapian::doccount uncollapsed_upper_bound = matches_upper_bound;
 
-	if (!full()) {
+	if (!full() && !pruned_externally) {
 	    // We didn't get all the results requested, so we know that we've
 	    // got all there are, and the bounds and estimate are all equal to
 	    // that number.
@@ -509,7 +577,8 @@ class ProtoMSet {
 	    } else {
 		AssertRel(matches_estimated, <=, known_matching_docs);
 	    }
-	} else if (!collapser && known_matching_docs < check_at_least) {
+	} else if (!collapser && !pruned_externally &&
+		   known_matching_docs < check_at_least) {
 	    // Similar to the above, but based on known_matching_docs.
 	    matches_lower_bound = known_matching_docs;
 	    matches_estimated = matches_lower_bound;
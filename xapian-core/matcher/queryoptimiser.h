@@ -90,16 +90,16 @@ class QueryOptimiser {
 
     void set_total_subqs(Xapian::termcount n) { total_subqs = n; }
 
-    PostList * open_post_list(const std::string& term,
-			      Xapian::termcount wqf,
-			      double factor) {
+    LeafPostList * open_post_list(const std::string& term,
+				  Xapian::termcount wqf,
+				  double factor) {
 	return localsubmatch.open_post_list(term, wqf, factor, need_positions,
 					    in_synonym, this, false);
     }
 
-    PostList * open_lazy_post_list(const std::string& term,
-				   Xapian::termcount wqf,
-				   double factor) {
+    LeafPostList * open_lazy_post_list(const std::string& term,
+				       Xapian::termcount wqf,
+				       double factor) {
 	return localsubmatch.open_post_list(term, wqf, factor, need_positions,
 					    in_synonym, this, true);
     }
@@ -126,6 +126,10 @@ class QueryOptimiser {
     bool need_wdf_for_synonym() const {
 	return in_synonym && !localsubmatch.weight_needs_wdf();
     }
+
+    Xapian::FilterCache::Internal* get_filter_cache() const {
+	return localsubmatch.get_filter_cache();
+    }
 };
 
 }
@@ -35,11 +35,11 @@ ValueGePostList::next(double)
 {
     Assert(db);
     if (!valuelist) valuelist = db->open_value_list(slot);
-    valuelist->next();
+    valuelist->next_in_range(begin, string());
     while (!valuelist->at_end()) {
 	const string & v = valuelist->get_value();
 	if (v >= begin) return NULL;
-	valuelist->next();
+	valuelist->next_in_range(begin, string());
     }
     db = NULL;
     return NULL;
@@ -50,11 +50,11 @@ ValueGePostList::skip_to(Xapian::docid did, double)
 {
     Assert(db);
     if (!valuelist) valuelist = db->open_value_list(slot);
-    valuelist->skip_to(did);
+    valuelist->skip_to_in_range(did, begin, string());
     while (!valuelist->at_end()) {
 	const string & v = valuelist->get_value();
 	if (v >= begin) return NULL;
-	valuelist->next();
+	valuelist->next_in_range(begin, string());
     }
     db = NULL;
     return NULL;
@@ -70,6 +70,11 @@ ValueGePostList::check(Xapian::docid did, double, bool &valid)
     if (!valid) {
 	return NULL;
     }
+    if (valuelist->at_end()) {
+	// check() acted like skip_to() and ran off the end.
+	db = NULL;
+	return NULL;
+    }
     const string & v = valuelist->get_value();
     valid = (v >= begin);
     return NULL;
@@ -182,13 +182,13 @@ ValueRangePostList::next(double)
 {
     Assert(db);
     if (!valuelist) valuelist = db->open_value_list(slot);
-    valuelist->next();
+    valuelist->next_in_range(begin, end);
     while (!valuelist->at_end()) {
 	const string & v = valuelist->get_value();
 	if (v >= begin && v <= end) {
 	    return NULL;
 	}
-	valuelist->next();
+	valuelist->next_in_range(begin, end);
     }
     db = NULL;
     return NULL;
@@ -199,13 +199,13 @@ ValueRangePostList::skip_to(Xapian::docid did, double)
 {
     Assert(db);
     if (!valuelist) valuelist = db->open_value_list(slot);
-    valuelist->skip_to(did);
+    valuelist->skip_to_in_range(did, begin, end);
     while (!valuelist->at_end()) {
 	const string & v = valuelist->get_value();
 	if (v >= begin && v <= end) {
 	    return NULL;
 	}
-	valuelist->next();
+	valuelist->next_in_range(begin, end);
     }
     db = NULL;
     return NULL;
@@ -221,6 +221,11 @@ ValueRangePostList::check(Xapian::docid did, double, bool &valid)
     if (!valid) {
 	return NULL;
     }
+    if (valuelist->at_end()) {
+	// check() acted like skip_to() and ran off the end.
+	db = NULL;
+	return NULL;
+    }
     const string & v = valuelist->get_value();
     valid = (v >= begin && v <= end);
     return NULL;
@@ -57,8 +57,8 @@ ValueStreamDocument::new_shard(size_t n)
     clear_valuelists(valuelists);
 }
 
-string
-ValueStreamDocument::fetch_value(Xapian::valueno slot) const
+ValueList*
+ValueStreamDocument::position_value_list(Xapian::valueno slot) const
 {
     pair<map<Xapian::valueno, ValueList *>::iterator, bool> ret;
     ret = valuelists.insert(make_pair(slot, static_cast<ValueList*>(NULL)));
@@ -70,7 +70,7 @@ ValueStreamDocument::fetch_value(Xapian::valueno slot) const
     } else {
 	vl = ret.first->second;
 	if (!vl) {
-	    return string();
+	    return NULL;
 	}
     }
 
@@ -79,11 +79,34 @@ ValueStreamDocument::fetch_value(Xapian::valueno slot) const
 	    delete vl;
 	    ret.first->second = NULL;
 	} else if (vl->get_docid() == did) {
-	    return vl->get_value();
+	    return vl;
 	}
     }
 
-    return string();
+    return NULL;
+}
+
+string
+ValueStreamDocument::fetch_value(Xapian::valueno slot) const
+{
+    ValueList* vl = position_value_list(slot);
+    return vl ? vl->get_value() : string();
+}
+
+void
+ValueStreamDocument::get_value_view(Xapian::valueno slot,
+				    const char*& p, size_t& len,
+				    string& buf) const
+{
+    ValueList* vl = position_value_list(slot);
+    if (!vl) {
+	p = "";
+	len = 0;
+    } else if (!vl->get_value_view(p, len)) {
+	buf = vl->get_value();
+	p = buf.data();
+	len = buf.size();
+    }
 }
 
 void
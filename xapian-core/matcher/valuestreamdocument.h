@@ -49,6 +49,12 @@ class ValueStreamDocument : public Xapian::Document::Internal {
 
     mutable Xapian::Document::Internal * doc = NULL;
 
+    /** Find the value stream for @a slot positioned on the current document.
+     *
+     *  Returns NULL if the current document has no value in @a slot.
+     */
+    ValueList* position_value_list(Xapian::valueno slot) const;
+
     /** Private constructor.
      *
      *  This is an implementation detail - the public constructor forwards to
@@ -88,6 +94,16 @@ class ValueStreamDocument : public Xapian::Document::Internal {
 	return ValueStreamDocument::fetch_value(slot);
     }
 
+    /** Point to a value of the current document without copying it.
+     *
+     *  If the value stream for @a slot can't do this, the value is copied
+     *  into @a buf and @a p points there.  The pointer is only valid until
+     *  the next call to set_document() or until @a buf is modified.
+     */
+    void get_value_view(Xapian::valueno slot,
+			const char*& p, size_t& len,
+			std::string& buf) const;
+
   protected:
     /** Implementation of virtual methods @{ */
     std::string fetch_value(Xapian::valueno slot) const;
@@ -40,15 +40,21 @@
 #include "safefcntl.h"
 #include "safesysstat.h"
 #include "safeunistd.h"
+#include "setenv.h"
 #ifdef HAVE_SOCKETPAIR
 # include "safesyssocket.h"
 # include <signal.h>
 # include "safesyswait.h"
 #endif
 
+#include <atomic>
 #include <cerrno>
+#include <chrono>
 #include <fstream>
+#include <future>
 #include <iterator>
+#include <map>
+#include <thread>
 
 using namespace std;
 
@@ -1217,6 +1223,187 @@ DEFINE_TESTCASE(notermlist1, glass) {
     return true;
 }
 
+/// Check doc stats from @a db match those from @a ref.
+static void
+check_doc_stats(const Xapian::Database& db, const Xapian::Database& ref)
+{
+    TEST_EQUAL(db.get_lastdocid(), ref.get_lastdocid());
+    for (Xapian::docid did = 1; did <= ref.get_lastdocid() + 1; ++did) {
+	try {
+	    Xapian::termcount doclen = ref.get_doclength(did);
+	    TEST_EQUAL(db.get_doclength(did), doclen);
+	    TEST_EQUAL(db.get_unique_terms(did), ref.get_unique_terms(did));
+	} catch (const Xapian::DocNotFoundError&) {
+	    TEST_EXCEPTION(Xapian::DocNotFoundError, db.get_doclength(did));
+	    TEST_EXCEPTION(Xapian::DocNotFoundError, db.get_unique_terms(did));
+	}
+    }
+}
+
+/// Feature test for Xapian::DB_CACHE_DOC_STATS.
+DEFINE_TESTCASE(cachedocstats1, glass) {
+    Xapian::WritableDatabase wdb = get_named_writable_database("cachedocstats1");
+    for (Xapian::docid did = 1; did <= 50; ++did) {
+	Xapian::Document doc;
+	for (Xapian::termcount i = 0; i < did % 7; ++i) {
+	    doc.add_term("t" + str(i), did % 3 + 1);
+	}
+	wdb.add_document(doc);
+    }
+    wdb.commit();
+
+    string path = get_named_writable_database_path("cachedocstats1");
+    Xapian::Database ref(path);
+    Xapian::Database db(path, Xapian::DB_CACHE_DOC_STATS);
+    check_doc_stats(db, ref);
+
+    // Check a writer with the cache sees its own changes.
+    wdb.close();
+    wdb = Xapian::WritableDatabase(path,
+				   Xapian::DB_OPEN|Xapian::DB_CACHE_DOC_STATS);
+    check_doc_stats(wdb, ref);
+    wdb.delete_document(3);
+    Xapian::Document doc;
+    doc.add_term("new", 10);
+    wdb.replace_document(5, doc);
+    doc.add_term("newer");
+    wdb.add_document(doc);
+    // Flush the document length changes so they update the cache.
+    TEST_EQUAL(*wdb.postlist_begin(string()), 1);
+    TEST_EQUAL(wdb.get_doclength(5), 10);
+    TEST_EQUAL(wdb.get_unique_terms(5), 1);
+    TEST_EQUAL(wdb.get_doclength(51), 11);
+    TEST_EQUAL(wdb.get_unique_terms(51), 2);
+    TEST_EXCEPTION(Xapian::DocNotFoundError, wdb.get_doclength(3));
+    wdb.commit();
+
+    // The reader should pick up the changes after reopen().
+    TEST_EQUAL(db.get_doclength(5), 5 % 7 * (5 % 3 + 1));
+    TEST(db.reopen());
+    ref.reopen();
+    check_doc_stats(db, ref);
+    check_doc_stats(wdb, ref);
+    return true;
+}
+
+/// Check DB_ASYNC_COMMIT.
+DEFINE_TESTCASE(asynccommit1, glass) {
+    Xapian::WritableDatabase wdb = get_named_writable_database("asynccommit1");
+    string path = get_named_writable_database_path("asynccommit1");
+    // Nothing to wait for without DB_ASYNC_COMMIT.
+    wdb.wait_for_durable();
+    wdb.close();
+
+    wdb = Xapian::WritableDatabase(path,
+				   Xapian::DB_OPEN|Xapian::DB_ASYNC_COMMIT);
+    for (Xapian::docid did = 1; did <= 200; ++did) {
+	Xapian::Document doc;
+	doc.set_data("doc " + str(did));
+	doc.add_term("all");
+	doc.add_term("t" + str(did % 10));
+	wdb.add_document(doc);
+	// Replace and delete documents too, so freed blocks get reused while
+	// commits are still being synced.
+	if (did > 10) wdb.replace_document(did - 10, doc);
+	if (did % 7 == 0) wdb.delete_document(did / 7);
+	wdb.commit();
+    }
+    Xapian::rev rev = wdb.get_revision();
+    wdb.wait_for_durable(rev);
+
+    Xapian::Database db(path);
+    TEST_EQUAL(db.get_revision(), rev);
+    TEST_EQUAL(db.get_doccount(), wdb.get_doccount());
+    TEST_EQUAL(db.get_termfreq("all"), db.get_doccount());
+    TEST_EQUAL(db.get_document(200).get_data(), "doc 200");
+    TEST_EQUAL(db.get_document(150).get_data(), "doc 160");
+
+    // close() waits for the last commit to be durable.
+    Xapian::doccount doccount = db.get_doccount();
+    wdb.add_document(Xapian::Document());
+    wdb.commit();
+    wdb.close();
+    TEST(db.reopen());
+    TEST_EQUAL(db.get_revision(), rev + 1);
+    TEST_EQUAL(db.get_doccount(), doccount + 1);
+    TEST_EQUAL(Xapian::Database::check(path), 0);
+    return true;
+}
+
+/// Check DB_ASYNC_COMMIT commits don't wait for earlier commits to be synced.
+DEFINE_TESTCASE(asynccommit2, glass) {
+#if !defined __WIN32__ && !defined __OS2__
+    Xapian::WritableDatabase wdb = get_named_writable_database("asynccommit2");
+    string path = get_named_writable_database_path("asynccommit2");
+    // Put plenty of blocks freed by durable revisions on the freelists.
+    for (Xapian::docid did = 1; did <= 1000; ++did) {
+	Xapian::Document doc;
+	doc.set_data(string(100, 'x'));
+	for (int i = 0; i < 20; ++i) {
+	    doc.add_term("t" + str(did * i % 1009));
+	}
+	wdb.add_document(doc);
+    }
+    wdb.commit();
+    for (Xapian::docid did = 1; did <= 1000; ++did) {
+	wdb.delete_document(did);
+    }
+    wdb.commit();
+    Xapian::rev durable_rev = wdb.get_revision();
+    wdb.close();
+
+    // Opening the temporary version file blocks until we read from it, so
+    // the background sync of the first commit below stalls there.
+    string fifo = path + "/v.tmp";
+    TEST(mkfifo(fifo.c_str(), 0600) == 0);
+
+    wdb = Xapian::WritableDatabase(path,
+				   Xapian::DB_OPEN|Xapian::DB_ASYNC_COMMIT);
+    promise<void> go;
+    atomic<bool> drained(false);
+    thread drainer([&]() {
+	// Unstall the sync when we're told to, or after a while in case the
+	// commits are waiting for it.
+	(void)go.get_future().wait_for(chrono::seconds(10));
+	int fd = open(fifo.c_str(), O_RDONLY);
+	if (fd >= 0) {
+	    char buf[4096];
+	    while (read(fd, buf, sizeof(buf)) > 0) { }
+	    close(fd);
+	}
+	drained = true;
+    });
+    bool commits_waited = true;
+    try {
+	for (int i = 0; i < 5; ++i) {
+	    Xapian::Document doc;
+	    doc.add_term("new" + str(i));
+	    wdb.add_document(doc);
+	    wdb.commit();
+	}
+	commits_waited = drained;
+    } catch (const Xapian::DatabaseError&) {
+	// A commit waited for the stalled sync, which then failed.
+    }
+    go.set_value();
+    drainer.join();
+    TEST(!commits_waited);
+    TEST_EQUAL(wdb.get_revision(), durable_rev + 5);
+
+    // A FIFO can't be synced, so the stalled sync fails.
+    TEST_EXCEPTION(Xapian::DatabaseError, wdb.wait_for_durable());
+
+    // None of the commits may have overwritten blocks of the last durable
+    // revision.
+    Xapian::Database db(path);
+    TEST_REL(db.get_revision(), >=, durable_rev);
+    TEST_EQUAL(Xapian::Database::check(path), 0);
+    return true;
+#else
+    SKIP_TEST("Test uses mkfifo()");
+#endif
+}
+
 /// Regression test for bug starting a new glass freelist block.
 DEFINE_TESTCASE(newfreelistblock1, writable) {
     Xapian::Document doc;
@@ -1878,3 +2065,355 @@ DEFINE_TESTCASE(reconstruct1, backend) {
     TEST_STRINGS_EQUAL(db.reconstruct_text(6, 0, "", 1, 3), "and yet anoth");
     return true;
 }
+
+/// Restore the block cache size when a testcase exits.
+class BlockCacheSizeRestorer {
+    size_t old_size;
+
+  public:
+    explicit BlockCacheSizeRestorer(size_t new_size)
+	: old_size(Xapian::Database::get_block_cache_size()) {
+	Xapian::Database::set_block_cache_size(new_size);
+    }
+
+    ~BlockCacheSizeRestorer() {
+	Xapian::Database::set_block_cache_size(old_size);
+    }
+};
+
+/// Read every posting and document data, to read most blocks of the database.
+static string
+read_everything(const Xapian::Database& db)
+{
+    string result;
+    for (auto t = db.allterms_begin(); t != db.allterms_end(); ++t) {
+	result += *t;
+	for (auto p = db.postlist_begin(*t); p != db.postlist_end(*t); ++p) {
+	    result += ' ';
+	    result += str(*p);
+	    result += ':';
+	    result += str(p.get_wdf());
+	}
+	result += '\n';
+    }
+    for (Xapian::docid did = 1; did <= db.get_lastdocid(); ++did) {
+	result += db.get_document(did).get_data();
+    }
+    return result;
+}
+
+/// Add documents which need a good number of blocks.
+static void
+add_blockcache_docs(Xapian::WritableDatabase& wdb, const string& prefix,
+		    int n)
+{
+    for (int i = 1; i <= n; ++i) {
+	Xapian::Document doc;
+	doc.add_term(prefix);
+	doc.add_term(prefix + str(i % 7), i % 3 + 1);
+	doc.add_term(prefix + str(i));
+	doc.set_data(prefix + string(100, char('a' + i % 26)));
+	wdb.add_document(doc);
+    }
+    wdb.commit();
+}
+
+/// Test the process-wide block cache.
+DEFINE_TESTCASE(blockcache1, glass) {
+    BlockCacheSizeRestorer restorer(1024 * 1024);
+    TEST_EQUAL(Xapian::Database::get_block_cache_size(), 1024 * 1024);
+
+    Xapian::WritableDatabase wdb = get_named_writable_database("blockcache1");
+    add_blockcache_docs(wdb, "x", 2000);
+    const string path = get_named_writable_database_path("blockcache1");
+
+    // The writable database doesn't use the cache.
+    size_t hits = Xapian::Database::get_block_cache_hits();
+    size_t misses = Xapian::Database::get_block_cache_misses();
+    string expected = read_everything(wdb);
+    TEST_EQUAL(Xapian::Database::get_block_cache_hits(), hits);
+    TEST_EQUAL(Xapian::Database::get_block_cache_misses(), misses);
+
+    Xapian::Database db1(path);
+    TEST_EQUAL(read_everything(db1), expected);
+    TEST_REL(Xapian::Database::get_block_cache_misses(), >, misses);
+    misses = Xapian::Database::get_block_cache_misses();
+
+    // A second Database object should find the blocks in the cache.
+    Xapian::Database db2(path);
+    hits = Xapian::Database::get_block_cache_hits();
+    TEST_EQUAL(read_everything(db2), expected);
+    TEST_REL(Xapian::Database::get_block_cache_hits(), >, hits);
+
+    // After a commit, a reopened reader must see the new revision.
+    add_blockcache_docs(wdb, "y", 500);
+    expected = read_everything(wdb);
+    TEST(db1.reopen());
+    TEST_EQUAL(read_everything(db1), expected);
+
+    // Overwriting the database will probably reuse the same files and
+    // revision numbers, but gives a new UUID.
+    wdb.close();
+    db1.close();
+    db2.close();
+    wdb = Xapian::WritableDatabase(path, Xapian::DB_CREATE_OR_OVERWRITE);
+    add_blockcache_docs(wdb, "z", 2000);
+    expected = read_everything(wdb);
+    TEST_EQUAL(read_everything(Xapian::Database(path)), expected);
+
+    // A small cache has to discard blocks.
+    size_t evictions = Xapian::Database::get_block_cache_evictions();
+    Xapian::Database::set_block_cache_size(16 * 2 * 8192);
+    TEST_EQUAL(read_everything(Xapian::Database(path)), expected);
+    TEST_REL(Xapian::Database::get_block_cache_evictions(), >, evictions);
+
+    // Check disabling the cache.
+    Xapian::Database::set_block_cache_size(0);
+    hits = Xapian::Database::get_block_cache_hits();
+    misses = Xapian::Database::get_block_cache_misses();
+    TEST_EQUAL(read_everything(Xapian::Database(path)), expected);
+    TEST_EQUAL(Xapian::Database::get_block_cache_hits(), hits);
+    TEST_EQUAL(Xapian::Database::get_block_cache_misses(), misses);
+
+    return true;
+}
+
+/// Feature test for Xapian::DB_MMAP.
+DEFINE_TESTCASE(mmap1, glass || honey) {
+    const string path = get_database_path("etext");
+    Xapian::Database ref(path);
+    Xapian::Database db(path, Xapian::DB_MMAP);
+    TEST_EQUAL(read_everything(db), read_everything(ref));
+
+    Xapian::Enquire ref_enq(ref);
+    Xapian::Enquire enq(db);
+    Xapian::Query query(Xapian::Query::OP_OR,
+			Xapian::Query("the"), Xapian::Query("cherri"));
+    ref_enq.set_query(query);
+    enq.set_query(query);
+    Xapian::MSet ref_mset = ref_enq.get_mset(0, 20);
+    Xapian::MSet mset = enq.get_mset(0, 20);
+    TEST_EQUAL(mset.size(), ref_mset.size());
+    TEST(mset_range_is_same(mset, 0, ref_mset, 0, mset.size()));
+    TEST(mset_range_is_same_weights(mset, 0, ref_mset, 0, mset.size()));
+
+    // Check the positional data via a phrase search.
+    query = Xapian::Query(Xapian::Query::OP_PHRASE,
+			  Xapian::Query("of"), Xapian::Query("the"));
+    ref_enq.set_query(query);
+    enq.set_query(query);
+    ref_mset = ref_enq.get_mset(0, 20);
+    mset = enq.get_mset(0, 20);
+    TEST_EQUAL(mset.size(), ref_mset.size());
+    TEST(mset_range_is_same(mset, 0, ref_mset, 0, mset.size()));
+    return true;
+}
+
+/// Test DB_MMAP with a glass database which is modified while open.
+DEFINE_TESTCASE(mmap2, glass) {
+    Xapian::WritableDatabase wdb = get_named_writable_database("mmap2");
+    add_blockcache_docs(wdb, "x", 500);
+    const string path = get_named_writable_database_path("mmap2");
+
+    Xapian::Database db(path, Xapian::DB_MMAP);
+    TEST_EQUAL(read_everything(db), read_everything(wdb));
+
+    // The table files will grow, so the reader needs to map them again after
+    // reopen() to see the new blocks.
+    add_blockcache_docs(wdb, "y", 2000);
+    TEST(db.reopen());
+    TEST_EQUAL(read_everything(db), read_everything(wdb));
+    return true;
+}
+
+/// Check queries work with readahead through a multi-level B-tree.
+DEFINE_TESTCASE(readahead1, glass) {
+    string db_dir = "." + get_dbtype();
+    mkdir(db_dir.c_str(), 0755);
+    db_dir += "/db__readahead1";
+    rm_rf(db_dir);
+    // Use the smallest block size and long terms so the postlist table has
+    // several levels.
+    Xapian::WritableDatabase wdb(db_dir,
+				 Xapian::DB_CREATE|Xapian::DB_BACKEND_GLASS,
+				 2048);
+    const string prefix = "x" + string(100, 'p');
+    for (int i = 1; i <= 5000; ++i) {
+	Xapian::Document doc;
+	doc.add_term(prefix + str(i));
+	wdb.add_document(doc);
+    }
+    wdb.commit();
+
+    vector<Xapian::Query> subqs;
+    for (int i = 1; i <= 5000; i += 97) {
+	subqs.push_back(Xapian::Query(prefix + str(i)));
+    }
+    // Terms which aren't in the database (before, between and after the
+    // terms which are).
+    subqs.push_back(Xapian::Query("a"));
+    subqs.push_back(Xapian::Query(prefix + "0"));
+    subqs.push_back(Xapian::Query("zzz"));
+    Xapian::Query query(Xapian::Query::OP_OR, subqs.begin(), subqs.end());
+
+    Xapian::Database db(db_dir);
+    Xapian::Enquire enquire(db);
+    enquire.set_query(query);
+    Xapian::MSet mset = enquire.get_mset(0, 100);
+    TEST_EQUAL(mset.size(), 52);
+
+    Xapian::Enquire wenquire(wdb);
+    wenquire.set_query(query);
+    TEST(mset_range_is_same(mset, 0, wenquire.get_mset(0, 100), 0, 52));
+
+    // Blocks read ahead may come from the block cache or a mapping.  The
+    // second pass should find the blocks from the first in the cache.
+    BlockCacheSizeRestorer restorer(1024 * 1024);
+    for (int pass = 0; pass != 2; ++pass) {
+	Xapian::Database mdb(db_dir, Xapian::DB_MMAP);
+	Xapian::Enquire menquire(mdb);
+	menquire.set_query(query);
+	TEST(mset_range_is_same(mset, 0, menquire.get_mset(0, 100), 0, 52));
+    }
+    return true;
+}
+
+/// Test XAPIAN_FLUSH_THRESHOLD_BYTES.
+DEFINE_TESTCASE(flushthresholdbytes1, glass) {
+    Xapian::WritableDatabase wdb;
+    setenv("XAPIAN_FLUSH_THRESHOLD_BYTES", "65536", 1);
+    try {
+	wdb = get_named_writable_database("flushthresholdbytes1");
+    } catch (...) {
+	setenv("XAPIAN_FLUSH_THRESHOLD_BYTES", "", 1);
+	throw;
+    }
+    setenv("XAPIAN_FLUSH_THRESHOLD_BYTES", "", 1);
+
+    for (Xapian::docid did = 1; did <= 100; ++did) {
+	Xapian::Document doc;
+	for (Xapian::termpos i = 1; i <= 200; ++i) {
+	    doc.add_posting("t" + str(i), i);
+	}
+	wdb.add_document(doc);
+    }
+
+    // Far fewer than the default of 10000 documents have been added, but
+    // the buffered changes should have exceeded the memory limit.
+    const string path =
+	get_named_writable_database_path("flushthresholdbytes1");
+    Xapian::Database db(path);
+    TEST_REL(db.get_doccount(), >, 0);
+    TEST_REL(db.get_doccount(), <, 100);
+
+    // Replace the documents in descending docid order, so the buffered
+    // changes aren't in docid order.
+    for (Xapian::docid did = 100; did >= 1; --did) {
+	Xapian::Document doc;
+	for (Xapian::termpos i = 1; i <= 200; i += (did % 2) + 1) {
+	    doc.add_posting("t" + str(i), i + 1);
+	}
+	wdb.replace_document(did, doc);
+    }
+    Xapian::Document doc;
+    doc.add_posting("t1", 7);
+    wdb.replace_document(2, doc);
+    wdb.commit();
+
+    TEST(db.reopen());
+    TEST_EQUAL(db.get_doccount(), 100);
+    TEST_EQUAL(db.get_termfreq("t1"), 100);
+    TEST_EQUAL(db.get_termfreq("t2"), 49);
+    TEST_EQUAL(db.get_termfreq("t200"), 49);
+    TEST_EQUAL(db.get_doclength(2), 1);
+    TEST_EQUAL(db.get_doclength(3), 100);
+    TEST_EQUAL(db.get_doclength(4), 200);
+    TEST_EQUAL(*db.postlist_begin("t2"), 4);
+    TEST_EQUAL(*db.positionlist_begin(2, "t1"), 7);
+    TEST_EQUAL(*db.positionlist_begin(3, "t3"), 4);
+    TEST(db.positionlist_begin(2, "t3") == db.positionlist_end(2, "t3"));
+    return true;
+}
+
+/// Check flushing with changes merged into posting lists in parallel.
+DEFINE_TESTCASE(flushthreads1, glass) {
+    Xapian::WritableDatabase wdb;
+    setenv("XAPIAN_FLUSH_THREADS", "4", 1);
+    try {
+	wdb = get_named_writable_database("flushthreads1");
+    } catch (...) {
+	setenv("XAPIAN_FLUSH_THREADS", "", 1);
+	throw;
+    }
+    setenv("XAPIAN_FLUSH_THREADS", "", 1);
+
+    // The expected postings for the terms which aren't unique to a
+    // document.
+    map<string, map<Xapian::docid, Xapian::termcount>> expected;
+    auto add_doc = [&](Xapian::docid did, Xapian::termcount wdf) {
+	Xapian::Document doc;
+	doc.add_term("a", wdf);
+	expected["a"][did] = wdf;
+	string m = "m" + str(did % 7);
+	doc.add_term(m);
+	expected[m][did] = 1;
+	doc.add_term("u" + str(did));
+	wdb.replace_document(did, doc);
+    };
+    auto delete_doc = [&](Xapian::docid did) {
+	wdb.delete_document(did);
+	expected["a"].erase(did);
+	auto& m = expected["m" + str(did % 7)];
+	m.erase(did);
+	if (m.empty()) expected.erase("m" + str(did % 7));
+    };
+
+    // Enough documents that "a" and the "m" terms need several chunks, and
+    // enough unique terms that the merges are split between threads.
+    for (Xapian::docid did = 1; did <= 3000; ++did) {
+	add_doc(did, did % 5 + 1);
+    }
+    wdb.commit();
+
+    // Remove whole chunks from the middle of "a", the first entry of each
+    // posting list and the whole of "m3", change some wdfs and append.
+    for (Xapian::docid did = 1001; did <= 2000; ++did) {
+	delete_doc(did);
+    }
+    delete_doc(1);
+    for (Xapian::docid did = 3; did <= 3000; did += 7) {
+	if (did <= 1000 || did > 2000) delete_doc(did);
+    }
+    for (Xapian::docid did = 2500; did <= 2600; ++did) {
+	if (did % 7 != 3) add_doc(did, 7);
+    }
+    for (Xapian::docid did = 3001; did <= 3500; ++did) {
+	if (did % 7 != 3) add_doc(did, 2);
+    }
+    wdb.commit();
+
+    const string path = get_named_writable_database_path("flushthreads1");
+    TEST_EQUAL(Xapian::Database::check(path, 0, &tout), 0);
+
+    Xapian::Database db(path);
+    TEST_EQUAL(db.get_termfreq("m3"), 0);
+    TEST(!db.term_exists("u1"));
+    TEST(db.term_exists("u3500"));
+    for (auto& i : expected) {
+	const string& term = i.first;
+	tout << term << '\n';
+	TEST_EQUAL(db.get_termfreq(term), i.second.size());
+	Xapian::termcount collfreq = 0;
+	auto p = db.postlist_begin(term);
+	for (auto& posting : i.second) {
+	    TEST(p != db.postlist_end(term));
+	    TEST_EQUAL(*p, posting.first);
+	    TEST_EQUAL(p.get_wdf(), posting.second);
+	    collfreq += posting.second;
+	    ++p;
+	}
+	TEST(p == db.postlist_end(term));
+	TEST_EQUAL(db.get_collection_freq(term), collfreq);
+    }
+    return true;
+}
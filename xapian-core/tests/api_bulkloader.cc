@@ -0,0 +1,229 @@
+/** @file
+ * @brief Tests of Xapian::BulkLoader.
+ */
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "api_bulkloader.h"
+
+#include <xapian.h>
+
+#include "apitest.h"
+#include "filetests.h"
+#include "str.h"
+#include "testutils.h"
+
+#ifdef HAVE_GETRLIMIT
+# include <sys/resource.h>
+#endif
+
+using namespace std;
+
+/// Make the document to add with a given index.
+static Xapian::Document
+make_doc(unsigned i)
+{
+    Xapian::Document doc;
+    doc.set_data("doc " + str(i));
+    doc.add_posting("all", 1);
+    doc.add_posting("all", i % 5 + 2);
+    doc.add_posting("mod" + str(i % 13), 3);
+    doc.add_term("id" + str(i));
+    doc.add_boolean_term("Qb" + str(i % 3));
+    doc.add_value(0, str(i));
+    if (i % 4 == 0) doc.add_value(1, "four");
+    return doc;
+}
+
+/// Check two databases have the same contents.
+static void
+check_same_db(const Xapian::Database& db1, const Xapian::Database& db2)
+{
+    TEST_EQUAL(db1.get_doccount(), db2.get_doccount());
+    TEST_EQUAL(db1.get_lastdocid(), db2.get_lastdocid());
+    TEST_EQUAL(db1.get_total_length(), db2.get_total_length());
+
+    auto t1 = db1.allterms_begin();
+    auto t2 = db2.allterms_begin();
+    while (t1 != db1.allterms_end()) {
+	TEST(t2 != db2.allterms_end());
+	const string& term = *t1;
+	TEST_EQUAL(term, *t2);
+	TEST_EQUAL(db1.get_termfreq(term), db2.get_termfreq(term));
+	TEST_EQUAL(db1.get_collection_freq(term),
+		   db2.get_collection_freq(term));
+	auto p1 = db1.postlist_begin(term);
+	auto p2 = db2.postlist_begin(term);
+	while (p1 != db1.postlist_end(term)) {
+	    TEST(p2 != db2.postlist_end(term));
+	    TEST_EQUAL(*p1, *p2);
+	    TEST_EQUAL(p1.get_wdf(), p2.get_wdf());
+	    TEST_EQUAL(p1.get_doclength(), p2.get_doclength());
+	    TEST(equal(p1.positionlist_begin(), p1.positionlist_end(),
+		       p2.positionlist_begin()));
+	    ++p1;
+	    ++p2;
+	}
+	TEST(p2 == db2.postlist_end(term));
+	++t1;
+	++t2;
+    }
+    TEST(t2 == db2.allterms_end());
+
+    for (Xapian::valueno slot = 0; slot != 2; ++slot) {
+	TEST_EQUAL(db1.get_value_freq(slot), db2.get_value_freq(slot));
+	TEST_EQUAL(db1.get_value_lower_bound(slot),
+		   db2.get_value_lower_bound(slot));
+	TEST_EQUAL(db1.get_value_upper_bound(slot),
+		   db2.get_value_upper_bound(slot));
+	auto v1 = db1.valuestream_begin(slot);
+	auto v2 = db2.valuestream_begin(slot);
+	while (v1 != db1.valuestream_end(slot)) {
+	    TEST(v2 != db2.valuestream_end(slot));
+	    TEST_EQUAL(v1.get_docid(), v2.get_docid());
+	    TEST_EQUAL(*v1, *v2);
+	    ++v1;
+	    ++v2;
+	}
+	TEST(v2 == db2.valuestream_end(slot));
+    }
+
+    for (Xapian::docid did = 1; did <= db1.get_lastdocid(); ++did) {
+	TEST_EQUAL(db1.get_document(did).get_data(),
+		   db2.get_document(did).get_data());
+	TEST_EQUAL(db1.get_doclength(did), db2.get_doclength(did));
+	TEST_EQUAL(db1.get_unique_terms(did), db2.get_unique_terms(did));
+	TEST(equal(db1.termlist_begin(did), db1.termlist_end(did),
+		   db2.termlist_begin(did)));
+    }
+
+    TEST(equal(db1.metadata_keys_begin(), db1.metadata_keys_end(),
+	       db2.metadata_keys_begin()));
+    for (auto k = db1.metadata_keys_begin(); k != db1.metadata_keys_end(); ++k) {
+	TEST_EQUAL(db1.get_metadata(*k), db2.get_metadata(*k));
+    }
+}
+
+/// Build a database with BulkLoader and check it matches one indexed normally.
+static void
+test_bulkload(const string& name, int flags)
+{
+    const unsigned N = 1000;
+    Xapian::WritableDatabase wdb = get_named_writable_database(name);
+    string out = get_compaction_output_path(name + "out");
+    {
+	// Use small runs so they get merged in more than one pass.
+	Xapian::BulkLoader loader(out, flags, 37);
+	for (unsigned i = 1; i <= N; ++i) {
+	    Xapian::Document doc = make_doc(i);
+	    TEST_EQUAL(loader.add_document(doc), i);
+	    TEST_EQUAL(wdb.add_document(doc), i);
+	}
+	loader.set_metadata("key", "old");
+	loader.set_metadata("key", "value");
+	loader.set_metadata("other", "data");
+	wdb.set_metadata("key", "value");
+	wdb.set_metadata("other", "data");
+	TEST_EQUAL(loader.get_doccount(), N);
+	TEST(dir_exists(out + ".tmp"));
+	loader.finish();
+	TEST_EXCEPTION(Xapian::InvalidOperationError,
+		       loader.add_document(make_doc(0)));
+	TEST(!dir_exists(out + ".tmp"));
+    }
+    wdb.commit();
+
+    TEST_EQUAL(Xapian::Database::check(out, 0, &tout), 0);
+    Xapian::Database db(out);
+    check_same_db(wdb, db);
+}
+
+/// Check building a glass database with BulkLoader.
+DEFINE_TESTCASE(bulkload1, glass) {
+    test_bulkload("bulkload1", Xapian::DB_BACKEND_GLASS);
+    return true;
+}
+
+/// Check building a honey database with BulkLoader.
+DEFINE_TESTCASE(bulkload2, glass) {
+    test_bulkload("bulkload2", Xapian::DB_BACKEND_HONEY);
+    return true;
+}
+
+/// Check BulkLoader with no documents, and without calling finish().
+DEFINE_TESTCASE(bulkload3, glass) {
+    string out = get_compaction_output_path("bulkload3out");
+    {
+	Xapian::BulkLoader loader(out);
+	loader.finish();
+    }
+    TEST(!dir_exists(out + ".tmp"));
+    Xapian::Database db(out);
+    TEST_EQUAL(db.get_doccount(), 0);
+
+    string out2 = get_compaction_output_path("bulkload3out2");
+    {
+	Xapian::BulkLoader loader(out2);
+	loader.add_document(make_doc(1));
+	TEST(dir_exists(out2 + ".tmp"));
+    }
+    TEST(!dir_exists(out2 + ".tmp"));
+    TEST(!path_exists(out2));
+    return true;
+}
+
+/// Check finish() works with more runs than could be open at once.
+DEFINE_TESTCASE(bulkload4, glass) {
+#ifndef HAVE_GETRLIMIT
+    SKIP_TEST("Can't limit the number of open files");
+#else
+    struct rlimit old_limit;
+    TEST(getrlimit(RLIMIT_NOFILE, &old_limit) == 0);
+    if (old_limit.rlim_cur != RLIM_INFINITY && old_limit.rlim_cur < 128)
+	SKIP_TEST("Open file limit is already below 128");
+
+    // Each run has several files, so 300 runs can't all be open at once
+    // with this limit.
+    const unsigned N = 300;
+    string out = get_compaction_output_path("bulkload4out");
+    {
+	Xapian::BulkLoader loader(out, 0, 1);
+	for (unsigned i = 1; i <= N; ++i) {
+	    loader.add_document(make_doc(i));
+	}
+	struct rlimit new_limit = old_limit;
+	new_limit.rlim_cur = 128;
+	TEST(setrlimit(RLIMIT_NOFILE, &new_limit) == 0);
+	try {
+	    loader.finish();
+	} catch (...) {
+	    setrlimit(RLIMIT_NOFILE, &old_limit);
+	    throw;
+	}
+	TEST(setrlimit(RLIMIT_NOFILE, &old_limit) == 0);
+    }
+
+    TEST_EQUAL(Xapian::Database::check(out, 0, &tout), 0);
+    Xapian::Database db(out);
+    TEST_EQUAL(db.get_doccount(), N);
+    TEST_EQUAL(db.get_termfreq("all"), N);
+    for (Xapian::docid did : { 1u, 17u, 256u, N }) {
+	TEST_EQUAL(db.get_document(did).get_data(), "doc " + str(did));
+    }
+    return true;
+#endif
+}
@@ -34,9 +34,12 @@
 #include "testsuite.h"
 #include "testutils.h"
 
+#include <algorithm>
 #include <cerrno>
 #include <cstdlib>
 #include <fstream>
+#include <set>
+#include <vector>
 
 #include <sys/types.h>
 #include "safesysstat.h"
@@ -240,8 +243,6 @@ DEFINE_TESTCASE(compactnorenumber1, compact && generated && !multi) {
 
 // Test use of compact to merge two databases.
 DEFINE_TESTCASE(compactmerge1, compact) {
-    XFAIL_FOR_BACKEND("honey", "Honey->honey compaction is currently buggy");
-
     string indbpath = get_database_path("apitest_simpledata");
     string outdbpath = get_compaction_output_path("compactmerge1out");
     rm_rf(outdbpath);
@@ -313,8 +314,6 @@ make_multichunk_db(Xapian::WritableDatabase &db, const string &)
 // Test use of compact on a database which has multiple chunks for a term.
 // This is a regression test for ticket #427
 DEFINE_TESTCASE(compactmultichunks1, compact && generated) {
-    XFAIL_FOR_BACKEND("honey", "Honey->honey compaction is currently buggy");
-
     string indbpath = get_database_path("compactmultichunks1in",
 					make_multichunk_db, "");
     string outdbpath = get_compaction_output_path("compactmultichunks1out");
@@ -334,10 +333,105 @@ DEFINE_TESTCASE(compactmultichunks1, compact && generated) {
     return true;
 }
 
+static void
+make_streamvbyte_db(Xapian::WritableDatabase &db, const string &)
+{
+    for (Xapian::docid did = 1; did <= 5000; ++did) {
+	Xapian::Document doc;
+	// Enough postings to need several chunks, with varying wdf.
+	doc.add_term("all", did % 13 + 1);
+	// Flat wdf apart from the first entry.
+	doc.add_term("flat", did == 1 ? 5 : 3);
+	// Zero wdf.
+	doc.add_boolean_term("Kbool");
+	if (did % 1000 == 7) {
+	    // Large docid deltas and wdfs which need more than 2 bytes.
+	    doc.add_term("sparse", 100000 + did);
+	}
+	if (did % 3 == 0) {
+	    doc.add_term("three", did % 200 + 1);
+	}
+	db.add_document(doc);
+    }
+    db.commit();
+}
+
+/// Check the postlists of @a term in @a db1 and @a db2 are the same.
+static void
+check_same_postlist(const Xapian::Database& db1,
+		    const Xapian::Database& db2,
+		    const string& term)
+{
+    tout << "term: " << term << endl;
+    TEST_EQUAL(db1.get_termfreq(term), db2.get_termfreq(term));
+    TEST_EQUAL(db1.get_collection_freq(term), db2.get_collection_freq(term));
+    auto p1 = db1.postlist_begin(term);
+    auto p2 = db2.postlist_begin(term);
+    while (p1 != db1.postlist_end(term)) {
+	TEST(p2 != db2.postlist_end(term));
+	TEST_EQUAL(*p1, *p2);
+	TEST_EQUAL(p1.get_wdf(), p2.get_wdf());
+	++p1;
+	++p2;
+    }
+    TEST(p2 == db2.postlist_end(term));
+
+    // Check skip_to() too.
+    p1 = db1.postlist_begin(term);
+    p2 = db2.postlist_begin(term);
+    for (Xapian::docid did = 2; did <= db1.get_lastdocid(); did += 331) {
+	p1.skip_to(did);
+	p2.skip_to(did);
+	if (p1 == db1.postlist_end(term)) {
+	    TEST(p2 == db2.postlist_end(term));
+	    break;
+	}
+	TEST_EQUAL(*p1, *p2);
+	TEST_EQUAL(p1.get_wdf(), p2.get_wdf());
+    }
+}
+
+/// Feature test for Xapian::DBCOMPACT_STREAM_VBYTE.
+DEFINE_TESTCASE(compactstreamvbyte1, compact && generated && !multi) {
+    string indbpath = get_database_path("compactstreamvbyte1in",
+					make_streamvbyte_db, "");
+    string outdbpath = get_compaction_output_path("compactstreamvbyte1out");
+    rm_rf(outdbpath);
+    string out2dbpath = get_compaction_output_path("compactstreamvbyte1out2");
+    rm_rf(out2dbpath);
+
+    Xapian::Database indb(indbpath);
+    indb.compact(outdbpath,
+		 Xapian::DB_BACKEND_HONEY | Xapian::DBCOMPACT_STREAM_VBYTE);
+    Xapian::Database outdb(outdbpath);
+    TEST_EQUAL(indb.get_doccount(), outdb.get_doccount());
+    dbcheck(outdb, outdb.get_doccount(), outdb.get_doccount());
+
+    // Check that converting back to the default encoding works.
+    outdb.compact(out2dbpath, Xapian::DB_BACKEND_HONEY);
+    Xapian::Database out2db(out2dbpath);
+
+    for (auto term : { "all", "flat", "Kbool", "sparse", "three" }) {
+	check_same_postlist(indb, outdb, term);
+	check_same_postlist(indb, out2db, term);
+    }
+
+    // Check searching gives the same results.
+    Xapian::Enquire enq1(indb), enq2(outdb);
+    Xapian::Query query(Xapian::Query::OP_OR,
+			Xapian::Query("three"), Xapian::Query("sparse"));
+    query &= Xapian::Query("all");
+    enq1.set_query(query);
+    enq2.set_query(query);
+    Xapian::MSet mset1 = enq1.get_mset(0, 20);
+    Xapian::MSet mset2 = enq2.get_mset(0, 20);
+    TEST(mset_range_is_same(mset1, 0, mset2, 0, mset1.size()));
+
+    return true;
+}
+
 // Test compacting from a stub database directory.
 DEFINE_TESTCASE(compactstub1, compact) {
-    XFAIL_FOR_BACKEND("honey", "Honey->honey compaction is currently buggy");
-
     const char * stubpath = ".stub/compactstub1";
     const char * stubpathfile = ".stub/compactstub1/XAPIANDB";
     mkdir(".stub", 0755);
@@ -367,8 +461,6 @@ DEFINE_TESTCASE(compactstub1, compact) {
 
 // Test compacting from a stub database file.
 DEFINE_TESTCASE(compactstub2, compact) {
-    XFAIL_FOR_BACKEND("honey", "Honey->honey compaction is currently buggy");
-
     const char * stubpath = ".stub/compactstub2";
     mkdir(".stub", 0755);
     ofstream stub(stubpath);
@@ -396,8 +488,6 @@ DEFINE_TESTCASE(compactstub2, compact) {
 
 // Test compacting a stub database file to itself.
 DEFINE_TESTCASE(compactstub3, compact) {
-    XFAIL_FOR_BACKEND("honey", "Honey->honey compaction is currently buggy");
-
     const char * stubpath = ".stub/compactstub3";
     mkdir(".stub", 0755);
     ofstream stub(stubpath);
@@ -423,8 +513,6 @@ DEFINE_TESTCASE(compactstub3, compact) {
 
 // Test compacting a stub database directory to itself.
 DEFINE_TESTCASE(compactstub4, compact) {
-    XFAIL_FOR_BACKEND("honey", "Honey->honey compaction is currently buggy");
-
     const char * stubpath = ".stub/compactstub4";
     const char * stubpathfile = ".stub/compactstub4/XAPIANDB";
     mkdir(".stub", 0755);
@@ -625,6 +713,36 @@ DEFINE_TESTCASE(compactmultipass1, compact && generated) {
     return true;
 }
 
+// Regression test - a term with two postings in one input lost the second
+// one when another input was merged after it for honey.
+DEFINE_TESTCASE(compactmerge2, compact && generated && !multi) {
+    string outdbpath = get_compaction_output_path("compactmerge2");
+    rm_rf(outdbpath);
+
+    // Docids 1, 183 and 365 all index the term "bb".
+    string a = get_database_path("compactmerge2a", make_sparse_db, "1 183");
+    string b = get_database_path("compactmerge2b", make_sparse_db, "365");
+
+    {
+	Xapian::Database db;
+	db.add_database(Xapian::Database(a));
+	db.add_database(Xapian::Database(b));
+	db.compact(outdbpath, Xapian::DBCOMPACT_NO_RENUMBER);
+    }
+
+    Xapian::Database outdb(outdbpath);
+    TEST_EQUAL(outdb.get_termfreq("bb"), 3);
+    vector<Xapian::docid> docids(outdb.postlist_begin("bb"),
+				 outdb.postlist_end("bb"));
+    TEST_EQUAL(docids.size(), 3);
+    TEST_EQUAL(docids[0], 1);
+    TEST_EQUAL(docids[1], 183);
+    TEST_EQUAL(docids[2], 365);
+    dbcheck(outdb, 3, 365);
+
+    return true;
+}
+
 // Test compacting to an fd.
 DEFINE_TESTCASE(compacttofd1, compact) {
     Xapian::Database indb(get_database("apitest_simpledata"));
@@ -774,3 +892,136 @@ DEFINE_TESTCASE(compact1, compact && writable) {
 
     return true;
 }
+
+/// Compactor which records the status messages reported.
+class StatusRecorder : public Xapian::Compactor {
+  public:
+    multiset<string> statuses;
+
+    void set_status(const string& table, const string& status) {
+	statuses.insert(table + ": " + status);
+    }
+};
+
+/// Check two compacted databases have the same contents.
+static void
+check_same_contents(const Xapian::Database& db1, const Xapian::Database& db2)
+{
+    TEST_EQUAL(db1.get_doccount(), db2.get_doccount());
+    TEST_EQUAL(db1.get_total_length(), db2.get_total_length());
+    TEST(equal(db1.allterms_begin(), db1.allterms_end(),
+	       db2.allterms_begin()));
+    for (auto t = db1.allterms_begin(); t != db1.allterms_end(); ++t) {
+	TEST_EQUAL(db1.get_termfreq(*t), db2.get_termfreq(*t));
+	TEST_EQUAL(db1.get_collection_freq(*t), db2.get_collection_freq(*t));
+	TEST(equal(db1.postlist_begin(*t), db1.postlist_end(*t),
+		   db2.postlist_begin(*t)));
+    }
+    for (Xapian::docid did = 1; did <= db1.get_lastdocid(); ++did) {
+	TEST_EQUAL(db1.get_document(did).get_data(),
+		   db2.get_document(did).get_data());
+	TEST_EQUAL(db1.get_doclength(did), db2.get_doclength(did));
+	TEST_EQUAL(db1.get_unique_terms(did), db2.get_unique_terms(did));
+	TEST(equal(db1.termlist_begin(did), db1.termlist_end(did),
+		   db2.termlist_begin(did)));
+    }
+    TEST_EQUAL(db1.get_unique_terms_lower_bound(),
+	       db2.get_unique_terms_lower_bound());
+    TEST_EQUAL(db1.get_unique_terms_upper_bound(),
+	       db2.get_unique_terms_upper_bound());
+    TEST(equal(db1.metadata_keys_begin(), db1.metadata_keys_end(),
+	       db2.metadata_keys_begin()));
+    for (auto k = db1.metadata_keys_begin(); k != db1.metadata_keys_end(); ++k) {
+	TEST_EQUAL(db1.get_metadata(*k), db2.get_metadata(*k));
+    }
+    TEST(equal(db1.valuestream_begin(0), db1.valuestream_end(0),
+	       db2.valuestream_begin(0)));
+}
+
+// Check compacting tables in parallel gives the same result as serially.
+DEFINE_TESTCASE(compactthreads1, compact) {
+    Xapian::Database indb(get_database("apitest_simpledata"));
+    string serial = get_compaction_output_path("compactthreads1serial");
+    string parallel = get_compaction_output_path("compactthreads1parallel");
+    rm_rf(serial);
+    rm_rf(parallel);
+
+    StatusRecorder serial_compactor;
+    indb.compact(serial, 0, 0, serial_compactor);
+
+    StatusRecorder parallel_compactor;
+    parallel_compactor.set_threads(4);
+    TEST_EQUAL(parallel_compactor.get_threads(), 4);
+    indb.compact(parallel, 0, 0, parallel_compactor);
+
+    TEST(serial_compactor.statuses == parallel_compactor.statuses);
+
+    Xapian::Database db1(serial);
+    Xapian::Database db2(parallel);
+    check_same_contents(db1, db2);
+    dbcheck(db2, db2.get_doccount(), db2.get_lastdocid());
+
+    return true;
+}
+
+static void
+make_manyterms_db(Xapian::WritableDatabase &db, const string & s)
+{
+    // Enough terms that the postlist table has several levels.
+    unsigned n = strtoul(s.c_str(), NULL, 10);
+    for (unsigned i = 1; i <= n; ++i) {
+	Xapian::Document doc;
+	doc.set_data(str(i));
+	doc.add_term("Q" + str(i + n));
+	doc.add_term("all");
+	doc.add_term("mod" + str(i % 97), i % 5 + 1);
+	doc.add_boolean_term(string(1, char(i % 3)) + "zero");
+	doc.add_value(0, str(i % 11));
+	db.add_document(doc);
+    }
+    db.set_metadata("key" + s, "value" + s);
+    db.set_metadata("key", "shared");
+    db.commit();
+}
+
+// Check merging postlists in parallel (only implemented for glass).
+DEFINE_TESTCASE(compactthreads2, compact && generated && !honey) {
+    vector<string> inputs;
+    for (auto spec : { "3000", "2000", "4000", "1000", "500" }) {
+	inputs.push_back(get_database_path(string("compactthreads2_") + spec,
+					   make_manyterms_db, spec));
+    }
+
+    for (unsigned flags : { 0u, unsigned(Xapian::DBCOMPACT_MULTIPASS) }) {
+	for (size_t n_inputs : { size_t(1), inputs.size() }) {
+	    tout << "flags=" << flags << " n_inputs=" << n_inputs << endl;
+	    Xapian::Database indb;
+	    for (size_t i = 0; i != n_inputs; ++i) {
+		indb.add_database(Xapian::Database(inputs[i]));
+	    }
+
+	    string serial = get_compaction_output_path("compactthreads2serial");
+	    string parallel =
+		get_compaction_output_path("compactthreads2parallel");
+	    rm_rf(serial);
+	    rm_rf(parallel);
+
+	    Xapian::Compactor serial_compactor;
+	    indb.compact(serial, flags, 0, serial_compactor);
+
+	    for (unsigned threads : { 2, 3, 8 }) {
+		Xapian::Compactor parallel_compactor;
+		parallel_compactor.set_threads(threads);
+		indb.compact(parallel, flags, 0, parallel_compactor);
+
+		Xapian::Database db1(serial);
+		Xapian::Database db2(parallel);
+		check_same_contents(db1, db2);
+		TEST_EQUAL(Xapian::Database::check(parallel, 0, &tout), 0);
+		rm_rf(parallel);
+	    }
+	}
+    }
+
+    return true;
+}
@@ -0,0 +1,184 @@
+/** @file api_filtercache.cc
+ * @brief Test caching of boolean filters.
+ */
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "api_filtercache.h"
+
+#include <xapian.h>
+
+#include "apitest.h"
+#include "str.h"
+#include "testutils.h"
+
+#include <vector>
+
+using namespace std;
+
+static void
+make_filtercache_db(Xapian::WritableDatabase& db, const string&)
+{
+    // Enough documents for the filters to need both sparse and dense blocks
+    // in the bitmaps.
+    for (unsigned i = 1; i <= 20000; ++i) {
+	Xapian::Document doc;
+	if (i % 3 == 0) doc.add_term("three", 1 + i % 4);
+	if (i % 7 == 0) doc.add_term("seven");
+	doc.add_boolean_term("S" + str(i % 5));
+	doc.add_boolean_term("L" + str(i % 2));
+	if (i % 1000 == 0) doc.add_boolean_term("Xrare");
+	db.add_document(doc);
+    }
+}
+
+/// Check that an MSet from using the filter cache matches one without it.
+static void
+check_filter_query(Xapian::Enquire& enquire,
+		   Xapian::Enquire& enquire_cached,
+		   const Xapian::Query& query)
+{
+    enquire.set_query(query);
+    enquire_cached.set_query(query);
+    Xapian::MSet mset1 = enquire.get_mset(0, 20);
+    Xapian::MSet mset2 = enquire_cached.get_mset(0, 20);
+    TEST_EQUAL(mset1.size(), mset2.size());
+    if (!mset1.empty()) {
+	TEST(mset_range_is_same(mset1, 0, mset2, 0, mset1.size()));
+	TEST(mset_range_is_same_weights(mset1, 0, mset2, 0, mset1.size()));
+    }
+    for (Xapian::doccount i = 0; i != mset1.size(); ++i) {
+	TEST_EQUAL(mset1[i].get_percent(), mset2[i].get_percent());
+    }
+    // Check all the matches too.
+    mset1 = enquire.get_mset(0, 20000);
+    mset2 = enquire_cached.get_mset(0, 20000);
+    TEST_EQUAL(mset1.size(), mset2.size());
+    if (!mset1.empty())
+	TEST(mset_range_is_same(mset1, 0, mset2, 0, mset1.size()));
+}
+
+/// Test that filtering with the cache gives the same results as without.
+DEFINE_TESTCASE(filtercache1, generated) {
+    Xapian::Database db = get_database("filtercache", make_filtercache_db);
+    Xapian::Enquire enquire(db);
+    Xapian::Enquire enquire_cached(db);
+    Xapian::FilterCache cache(16 * 1024 * 1024);
+    enquire_cached.set_filter_cache(cache);
+
+    typedef Xapian::Query Q;
+    Q sites(Q::OP_OR, Q("S1"), Q("S3"));
+    Q text(Q::OP_OR, Q("three"), Q("seven"));
+    vector<Q> filters = {
+	sites,
+	Q(Q::OP_AND, sites, Q("L0")),
+	Q(Q::OP_AND_NOT, Q("L1"), Q("S2")),
+	Q(Q::OP_OR, Q("Xrare"), Q("S4")),
+	Q(Q::OP_AND, Q("Xrare"), Q("S0")),
+	Q(Q::OP_AND, Q("Xrare"), Q("Xnonexistent")),
+    };
+    for (int pass = 0; pass != 2; ++pass) {
+	for (auto&& filter : filters) {
+	    check_filter_query(enquire, enquire_cached,
+			       Q(Q::OP_FILTER, text, filter));
+	    // Filters nested in an AND are handled differently.
+	    check_filter_query(enquire, enquire_cached,
+			       Q(Q::OP_AND, Q("three"),
+				 Q(Q::OP_FILTER, Q("seven"), filter)));
+	}
+    }
+    // Databases which can't report their revision (or might change without
+    // the revision changing) aren't cached.
+    size_t entries = cache.get_entry_count();
+    if (entries != 0) {
+	TEST_EQUAL(entries % filters.size(), 0);
+	TEST_EQUAL(cache.get_misses(), entries);
+	TEST_EQUAL(cache.get_hits(), 7 * entries);
+    }
+
+    // More than one filter subquery is cached as a whole.
+    Q multi[] = { text, Q("L0"), Q("S3") };
+    check_filter_query(enquire, enquire_cached,
+		       Q(Q::OP_FILTER, multi, multi + 3));
+    if (entries != 0) {
+	TEST_REL(cache.get_entry_count(), >, entries);
+    }
+
+    // A single term filter isn't cached.
+    size_t misses = cache.get_misses();
+    check_filter_query(enquire, enquire_cached,
+		       Q(Q::OP_FILTER, text, Q("L1")));
+    TEST_EQUAL(cache.get_misses(), misses);
+
+    // Setting a default constructed cache stops caching.
+    enquire_cached.set_filter_cache(Xapian::FilterCache());
+    check_filter_query(enquire, enquire_cached,
+		       Q(Q::OP_FILTER, text, sites));
+    TEST_EQUAL(cache.get_misses(), misses);
+
+    return true;
+}
+
+/// Test the size limit and that a new revision doesn't use old entries.
+DEFINE_TESTCASE(filtercache2, glass) {
+    Xapian::WritableDatabase wdb = get_named_writable_database("filtercache2");
+    make_filtercache_db(wdb, string());
+    wdb.commit();
+
+    Xapian::Database db = get_writable_database_as_database();
+    Xapian::FilterCache cache(16 * 1024 * 1024);
+    Xapian::Enquire enquire(db);
+    enquire.set_filter_cache(cache);
+    typedef Xapian::Query Q;
+    Q query(Q::OP_FILTER, Q("three"), Q(Q::OP_OR, Q("S1"), Q("S3")));
+    enquire.set_query(query);
+    Xapian::doccount count = enquire.get_mset(0, 30000).size();
+    TEST_EQUAL(cache.get_entry_count(), 1);
+    TEST_REL(cache.get_size(), >, 0);
+    TEST_REL(cache.get_size(), <=, cache.get_max_size());
+
+    // A writable database isn't cached.
+    Xapian::Enquire enquire_w(wdb);
+    enquire_w.set_filter_cache(cache);
+    enquire_w.set_query(query);
+    TEST_EQUAL(enquire_w.get_mset(0, 30000).size(), count);
+    TEST_EQUAL(cache.get_misses(), 1);
+
+    // After a change, the reopened database shouldn't use the old entry.
+    Xapian::Document doc;
+    doc.add_term("three");
+    doc.add_boolean_term("S1");
+    wdb.add_document(doc);
+    wdb.commit();
+    TEST(db.reopen());
+    TEST_EQUAL(enquire.get_mset(0, 30000).size(), count + 1);
+    TEST_EQUAL(cache.get_misses(), 2);
+    TEST_EQUAL(cache.get_entry_count(), 2);
+
+    // Entries which don't fit aren't cached.
+    Xapian::FilterCache small_cache(64);
+    enquire.set_filter_cache(small_cache);
+    TEST_EQUAL(enquire.get_mset(0, 30000).size(), count + 1);
+    TEST_EQUAL(small_cache.get_entry_count(), 0);
+    TEST_EQUAL(small_cache.get_misses(), 1);
+
+    cache.clear();
+    TEST_EQUAL(cache.get_entry_count(), 0);
+    TEST_EQUAL(cache.get_size(), 0);
+
+    return true;
+}
@@ -177,6 +177,91 @@ DEFINE_TESTCASE(matchspy2, generated)
     return true;
 }
 
+/// Test ValueCountMatchSpy counting using value dictionaries.
+DEFINE_TESTCASE(matchspydict1, generated)
+{
+    Xapian::Database db = get_database("matchspy2", make_matchspy2_db);
+    Xapian::Database db_dict = get_database("matchspy2", make_matchspy2_db);
+    db_dict.add_value_dictionary(0);
+    db_dict.add_value_dictionary(1);
+    db_dict.add_value_dictionary(3);
+
+    Xapian::Query query(Xapian::Query::OP_OR,
+			Xapian::Query("XFACT2"), Xapian::Query("XFACT3"));
+    for (Xapian::valueno slot : {0, 1, 3}) {
+	Xapian::ValueCountMatchSpy spy(slot), spy_dict(slot);
+	Xapian::Enquire enq(db), enq_dict(db_dict);
+	enq.set_query(query);
+	enq_dict.set_query(query);
+	enq.add_matchspy(&spy);
+	enq_dict.add_matchspy(&spy_dict);
+	// Counts should accumulate over several matches.
+	for (int i = 0; i != 2; ++i) {
+	    (void)enq.get_mset(0, 10, db.get_doccount());
+	    (void)enq_dict.get_mset(0, 10, db.get_doccount());
+	}
+	TEST_EQUAL(spy_dict.get_total(), spy.get_total());
+	TEST_STRINGS_EQUAL(values_to_repr(spy_dict), values_to_repr(spy));
+
+	Xapian::TermIterator t = spy.top_values_begin(3);
+	Xapian::TermIterator t_dict = spy_dict.top_values_begin(3);
+	while (t != spy.top_values_end(3)) {
+	    TEST(t_dict != spy_dict.top_values_end(3));
+	    TEST_EQUAL(*t_dict, *t);
+	    TEST_EQUAL(t_dict.get_termfreq(), t.get_termfreq());
+	    ++t;
+	    ++t_dict;
+	}
+	TEST(t_dict == spy_dict.top_values_end(3));
+
+	TEST_EQUAL(spy_dict.serialise_results(), spy.serialise_results());
+    }
+
+    return true;
+}
+
+/// Check that value dictionaries reflect changes to a writable database.
+DEFINE_TESTCASE(matchspydict2, writable && !inmemory) {
+    Xapian::WritableDatabase db = get_writable_database();
+    for (int i = 1; i <= 20; ++i) {
+	Xapian::Document doc;
+	doc.add_term("all");
+	if (i % 4 != 0)
+	    doc.add_value(0, str(i % 3));
+	db.add_document(doc);
+    }
+    db.commit();
+    db.add_value_dictionary(0);
+
+    Xapian::Enquire enq(db);
+    enq.set_query(Xapian::Query("all"));
+    Xapian::ValueCountMatchSpy spy(0);
+    enq.add_matchspy(&spy);
+    (void)enq.get_mset(0, 10, db.get_doccount());
+    TEST_STRINGS_EQUAL(values_to_repr(spy), "|0:5|1:5|2:5|");
+
+    // Change the database, and check a match after the change counts the
+    // new values, including in the same match spy.
+    Xapian::Document doc;
+    doc.add_term("all");
+    doc.add_value(0, "new");
+    db.replace_document(4, doc);
+    db.replace_document(5, doc);
+    db.delete_document(6);
+    (void)enq.get_mset(0, 10, db.get_doccount());
+    TEST_STRINGS_EQUAL(values_to_repr(spy), "|0:9|1:10|2:9|new:2|");
+
+    Xapian::ValueCountMatchSpy spy2(0);
+    enq.clear_matchspies();
+    enq.add_matchspy(&spy2);
+    db.commit();
+    (void)enq.get_mset(0, 10, db.get_doccount());
+    TEST_EQUAL(spy2.get_total(), 19);
+    TEST_STRINGS_EQUAL(values_to_repr(spy2), "|0:4|1:5|2:4|new:2|");
+
+    return true;
+}
+
 DEFINE_TESTCASE(matchspy4, generated)
 {
     Xapian::Database db = get_database("matchspy2", make_matchspy2_db);
@@ -0,0 +1,235 @@
+/** @file api_msetcache.cc
+ * @brief Test caching of MSet objects.
+ */
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "api_msetcache.h"
+
+#include <xapian.h>
+
+#include "apitest.h"
+#include "testutils.h"
+
+using namespace std;
+
+/// Check that a cached MSet matches one from running the match.
+static void
+check_same_mset(const Xapian::MSet& mset1, const Xapian::MSet& mset2)
+{
+    TEST_EQUAL(mset1.size(), mset2.size());
+    TEST(mset_range_is_same(mset1, 0, mset2, 0, mset1.size()));
+    TEST(mset_range_is_same_weights(mset1, 0, mset2, 0, mset1.size()));
+    TEST_EQUAL(mset1.get_firstitem(), mset2.get_firstitem());
+    TEST_EQUAL(mset1.get_matches_lower_bound(),
+	       mset2.get_matches_lower_bound());
+    TEST_EQUAL(mset1.get_matches_estimated(), mset2.get_matches_estimated());
+    TEST_EQUAL(mset1.get_matches_upper_bound(),
+	       mset2.get_matches_upper_bound());
+    TEST_EQUAL(mset1.get_max_possible(), mset2.get_max_possible());
+    TEST_EQUAL(mset1.get_max_attained(), mset2.get_max_attained());
+    for (Xapian::doccount i = 0; i != mset1.size(); ++i) {
+	TEST_EQUAL(mset1[i].get_percent(), mset2[i].get_percent());
+	TEST_EQUAL(mset1[i].get_document().get_data(),
+		   mset2[i].get_document().get_data());
+    }
+    TEST_EQUAL(mset1.get_termfreq("this"), mset2.get_termfreq("this"));
+    TEST_EQUAL(mset1.get_termweight("this"), mset2.get_termweight("this"));
+}
+
+/// Test that cached results are the same as those from running the match.
+DEFINE_TESTCASE(msetcache1, backend) {
+    Xapian::Database db(get_database("apitest_simpledata"));
+    Xapian::Enquire enquire(db);
+    enquire.set_query(Xapian::Query(Xapian::Query::OP_OR,
+				    Xapian::Query("this"),
+				    Xapian::Query("paragraph")));
+    Xapian::MSet mset1 = enquire.get_mset(0, 10);
+
+    Xapian::MSetCache cache(1024 * 1024);
+    enquire.set_mset_cache(cache);
+    Xapian::MSet mset2 = enquire.get_mset(0, 10);
+    check_same_mset(mset1, mset2);
+    // Databases which can't report their revision (or might change without
+    // the revision changing) aren't cached.
+    bool cacheable = (cache.get_entry_count() != 0);
+    TEST_EQUAL(cache.get_misses(), cacheable ? 1 : 0);
+    TEST_EQUAL(cache.get_hits(), 0);
+
+    Xapian::MSet mset3 = enquire.get_mset(0, 10);
+    check_same_mset(mset1, mset3);
+    TEST_EQUAL(cache.get_hits(), cacheable ? 1 : 0);
+
+    // The MSet from the cache should still be usable for snippets, etc.
+    if (mset3.size() != 0) {
+	TEST_EQUAL(mset3.snippet("this paragraph"),
+		   mset1.snippet("this paragraph"));
+    }
+
+    // A different range shouldn't get the cached result.
+    Xapian::MSet mset4 = enquire.get_mset(1, 3);
+    check_same_mset(mset4, enquire.get_mset(1, 3));
+    TEST(mset_range_is_same(mset4, 0, mset1, 1, mset4.size()));
+    TEST_EQUAL(cache.get_hits(), cacheable ? 2 : 0);
+    TEST_EQUAL(cache.get_misses(), cacheable ? 2 : 0);
+
+    // Things which can't be included in the key bypass the cache.
+    Xapian::RSet rset;
+    rset.add_document(1);
+    (void)enquire.get_mset(0, 10, &rset);
+    TEST_EQUAL(cache.get_hits(), cacheable ? 2 : 0);
+    TEST_EQUAL(cache.get_misses(), cacheable ? 2 : 0);
+
+    // Setting a default constructed cache stops caching.
+    enquire.set_mset_cache(Xapian::MSetCache());
+    (void)enquire.get_mset(0, 10);
+    TEST_EQUAL(cache.get_hits(), cacheable ? 2 : 0);
+    TEST_EQUAL(cache.get_misses(), cacheable ? 2 : 0);
+
+    return true;
+}
+
+/// Test the cache key and the size limit.
+DEFINE_TESTCASE(msetcache2, path && !remote) {
+    Xapian::Database db(get_database("etext"));
+    Xapian::MSetCache cache(1024 * 1024);
+
+    Xapian::Enquire enquire1(db);
+    enquire1.set_query(Xapian::Query("the"));
+    enquire1.set_mset_cache(cache);
+    Xapian::MSet mset1 = enquire1.get_mset(0, 10);
+    TEST_EQUAL(cache.get_misses(), 1);
+    TEST_EQUAL(cache.get_entry_count(), 1);
+
+    // Another Enquire sharing the cache should find the cached entry.
+    Xapian::Enquire enquire2(db);
+    enquire2.set_query(Xapian::Query("the"));
+    enquire2.set_mset_cache(cache);
+    check_same_mset(mset1, enquire2.get_mset(0, 10));
+    TEST_EQUAL(cache.get_hits(), 1);
+
+    // Changing the weighting scheme should change the key.
+    enquire2.set_weighting_scheme(Xapian::TradWeight());
+    Xapian::MSet mset2 = enquire2.get_mset(0, 10);
+    TEST_EQUAL(cache.get_hits(), 1);
+    TEST_EQUAL(cache.get_misses(), 2);
+    check_same_mset(mset2, enquire2.get_mset(0, 10));
+    TEST_EQUAL(cache.get_hits(), 2);
+
+    // As should changing the sort order.
+    enquire1.set_docid_order(Xapian::Enquire::DESCENDING);
+    (void)enquire1.get_mset(0, 10);
+    TEST_EQUAL(cache.get_misses(), 3);
+    enquire1.set_docid_order(Xapian::Enquire::ASCENDING);
+    check_same_mset(mset1, enquire1.get_mset(0, 10));
+    TEST_EQUAL(cache.get_hits(), 3);
+    TEST_EQUAL(cache.get_entry_count(), 3);
+    TEST_REL(cache.get_size(), <=, cache.get_max_size());
+
+    cache.clear();
+    TEST_EQUAL(cache.get_entry_count(), 0);
+    TEST_EQUAL(cache.get_size(), 0);
+    (void)enquire1.get_mset(0, 10);
+    TEST_EQUAL(cache.get_hits(), 3);
+    TEST_EQUAL(cache.get_misses(), 4);
+
+    // Check that entries get discarded to keep within the size limit.
+    Xapian::MSetCache small_cache(4096);
+    enquire1.set_mset_cache(small_cache);
+    for (Xapian::doccount first = 0; first != 50; ++first) {
+	(void)enquire1.get_mset(first, 10);
+	TEST_REL(small_cache.get_size(), <=, 4096);
+    }
+    TEST_REL(small_cache.get_entry_count(), <, 50);
+    TEST_REL(small_cache.get_entry_count(), >, 0);
+    // The most recently added entry should still be there.
+    (void)enquire1.get_mset(49, 10);
+    TEST_EQUAL(small_cache.get_hits(), 1);
+    // But the first one should have been discarded.
+    (void)enquire1.get_mset(0, 10);
+    TEST_EQUAL(small_cache.get_hits(), 1);
+
+    // An MSet bigger than the whole cache isn't stored.
+    Xapian::MSetCache tiny_cache(16);
+    enquire1.set_mset_cache(tiny_cache);
+    (void)enquire1.get_mset(0, 10);
+    TEST_EQUAL(tiny_cache.get_entry_count(), 0);
+    TEST_EQUAL(tiny_cache.get_size(), 0);
+
+    return true;
+}
+
+/// Test that cached entries aren't used after the database is reopened.
+DEFINE_TESTCASE(msetcache3, glass) {
+    Xapian::WritableDatabase wdb = get_named_writable_database("msetcache3");
+    for (int i = 1; i <= 20; ++i) {
+	Xapian::Document doc;
+	doc.add_term("all");
+	wdb.add_document(doc);
+    }
+    wdb.commit();
+
+    Xapian::Database db(get_named_writable_database_path("msetcache3"));
+    Xapian::Enquire enquire(db);
+    enquire.set_query(Xapian::Query("all"));
+    Xapian::MSetCache cache(1024 * 1024);
+    enquire.set_mset_cache(cache);
+    TEST_EQUAL(enquire.get_mset(0, 100).size(), 20);
+    TEST_EQUAL(enquire.get_mset(0, 100).size(), 20);
+    TEST_EQUAL(cache.get_hits(), 1);
+
+    Xapian::Document doc;
+    doc.add_term("all");
+    wdb.add_document(doc);
+    wdb.commit();
+
+    // Without reopen() we still see the old revision, so the entry is valid.
+    TEST_EQUAL(enquire.get_mset(0, 100).size(), 20);
+    TEST_EQUAL(cache.get_hits(), 2);
+
+    TEST(db.reopen());
+    TEST_EQUAL(enquire.get_mset(0, 100).size(), 21);
+    TEST_EQUAL(cache.get_hits(), 2);
+    TEST_EQUAL(cache.get_misses(), 2);
+
+    // Searching a WritableDatabase bypasses the cache.
+    Xapian::Enquire wenquire(wdb);
+    wenquire.set_query(Xapian::Query("all"));
+    wenquire.set_mset_cache(cache);
+    TEST_EQUAL(wenquire.get_mset(0, 100).size(), 21);
+    TEST_EQUAL(cache.get_hits(), 2);
+    TEST_EQUAL(cache.get_misses(), 2);
+
+    return true;
+}
+
+/// Test MSetCache without a database.
+DEFINE_TESTCASE(msetcache4, !backend) {
+    Xapian::MSetCache cache(1000);
+    TEST_EQUAL(cache.get_max_size(), 1000);
+    TEST_EQUAL(cache.get_size(), 0);
+    TEST_EQUAL(cache.get_entry_count(), 0);
+    TEST_STRINGS_EQUAL(cache.get_description(),
+		       "MSetCache(max_size=1000, size=0, entries=0, hits=0, "
+		       "misses=0)");
+
+    Xapian::MSetCache copy = cache;
+    TEST_EQUAL(copy.get_max_size(), 1000);
+    TEST_EQUAL(Xapian::MSetCache().get_max_size(), 0);
+
+    return true;
+}
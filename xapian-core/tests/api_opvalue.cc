@@ -28,10 +28,15 @@
 #include <xapian.h>
 
 #include "apitest.h"
+#include "str.h"
 #include "testsuite.h"
 #include "testutils.h"
 
+#include <fstream>
+#include <map>
+#include <set>
 #include <string>
+#include <vector>
 
 using namespace std;
 
@@ -288,6 +293,202 @@ DEFINE_TESTCASE(valuerange7, generated) {
     return true;
 }
 
+/// Make a value which sorts in numeric order.
+static string
+make_sortable_value(unsigned n)
+{
+    string value = str(n);
+    return string(6 - value.size(), '0') + value;
+}
+
+static void
+make_valuerangechunks_db(Xapian::WritableDatabase &db, const string &)
+{
+    // Enough documents to need many value stream chunks, with slot 0
+    // increasing (like a date) and slot 1 scattered.
+    for (unsigned i = 1; i <= 3000; ++i) {
+	Xapian::Document doc;
+	if (i % 5 == 0) doc.add_term("five");
+	doc.add_value(0, make_sortable_value(i));
+	if (i % 3) doc.add_value(1, make_sortable_value(i * 7919 % 1000));
+	db.add_document(doc);
+    }
+}
+
+/// Read all the values in a slot.
+static map<Xapian::docid, string>
+get_slot_values(const Xapian::Database& db, Xapian::valueno slot)
+{
+    map<Xapian::docid, string> values;
+    for (auto i = db.valuestream_begin(slot); i != db.valuestream_end(slot);
+	 ++i) {
+	values.insert(make_pair(i.get_docid(), *i));
+    }
+    return values;
+}
+
+/** Check the documents matching a value range query against those found
+ *  by checking every document's value.
+ *
+ *  If @a term is non-empty, the value range is used to filter it.
+ */
+static void
+check_value_range_matches(const Xapian::Database& db,
+			  const map<Xapian::docid, string>& values,
+			  Xapian::Query::op op, Xapian::valueno slot,
+			  const string& lo, const string& hi,
+			  const string& term = string())
+{
+    Xapian::Query query;
+    if (op == Xapian::Query::OP_VALUE_RANGE) {
+	query = Xapian::Query(op, slot, lo, hi);
+    } else {
+	query = Xapian::Query(op, slot, op == Xapian::Query::OP_VALUE_GE ?
+					  lo : hi);
+    }
+    if (!term.empty()) {
+	query = Xapian::Query(Xapian::Query::OP_FILTER,
+			      Xapian::Query(term), query);
+    }
+    Xapian::Enquire enq(db);
+    enq.set_query(query);
+    enq.set_weighting_scheme(Xapian::BoolWeight());
+    enq.set_docid_order(Xapian::Enquire::ASCENDING);
+    Xapian::MSet mset = enq.get_mset(0, db.get_doccount());
+
+    vector<Xapian::docid> expected;
+    for (auto&& i : values) {
+	const string& value = i.second;
+	if ((lo.empty() || value >= lo) && (hi.empty() || value <= hi)) {
+	    expected.push_back(i.first);
+	}
+    }
+    if (!term.empty()) {
+	vector<Xapian::docid> filtered;
+	for (auto did : expected) {
+	    Xapian::PostingIterator p = db.postlist_begin(term);
+	    p.skip_to(did);
+	    if (p != db.postlist_end(term) && *p == did)
+		filtered.push_back(did);
+	}
+	swap(expected, filtered);
+    }
+
+    tout << query.get_description() << endl;
+    TEST_EQUAL(mset.size(), expected.size());
+    auto e = expected.begin();
+    for (auto m = mset.begin(); m != mset.end(); ++m, ++e) {
+	TEST_EQUAL(*m, *e);
+    }
+}
+
+/// Check value range queries which can skip whole chunks of values.
+DEFINE_TESTCASE(valuerange8, generated) {
+    Xapian::Database db = get_database("valuerangechunks",
+				       make_valuerangechunks_db);
+    const auto OP_VALUE_RANGE = Xapian::Query::OP_VALUE_RANGE;
+    const auto OP_VALUE_GE = Xapian::Query::OP_VALUE_GE;
+    const auto OP_VALUE_LE = Xapian::Query::OP_VALUE_LE;
+    static const unsigned ranges[][2] = {
+	{ 1, 1 }, { 1500, 1510 }, { 2990, 3000 }, { 2000, 2000 },
+	{ 0, 0 }, { 10, 900 }, { 400, 1200 }, { 3001, 4000 }
+    };
+    for (Xapian::valueno slot = 0; slot != 2; ++slot) {
+	auto values = get_slot_values(db, slot);
+	for (auto&& range : ranges) {
+	    string lo = make_sortable_value(range[0]);
+	    string hi = make_sortable_value(range[1]);
+	    check_value_range_matches(db, values, OP_VALUE_RANGE, slot,
+				      lo, hi);
+	    check_value_range_matches(db, values, OP_VALUE_GE, slot,
+				      lo, string());
+	    check_value_range_matches(db, values, OP_VALUE_LE, slot,
+				      string(), hi);
+	    // Filtering a term uses skip_to() and check() on the value range.
+	    check_value_range_matches(db, values, OP_VALUE_RANGE, slot,
+				      lo, hi, "five");
+	}
+    }
+    return true;
+}
+
+/// Check the bounds of value chunks are kept up to date by changes.
+DEFINE_TESTCASE(valuerange9, glass) {
+    Xapian::WritableDatabase db = get_named_writable_database("valuerange9");
+    make_valuerangechunks_db(db, string());
+    db.commit();
+
+    // Change values in the middle of the stream, so chunks which could
+    // previously be skipped now have to be read, and delete a run of
+    // documents.
+    for (Xapian::docid did = 1000; did < 1010; ++did) {
+	Xapian::Document doc = db.get_document(did);
+	doc.add_value(0, make_sortable_value(2995));
+	doc.add_value(1, make_sortable_value(5));
+	db.replace_document(did, doc);
+    }
+    for (Xapian::docid did = 2000; did < 2400; ++did) {
+	db.delete_document(did);
+    }
+    db.commit();
+
+    const auto OP_VALUE_RANGE = Xapian::Query::OP_VALUE_RANGE;
+    string v2995 = make_sortable_value(2995);
+    string v5 = make_sortable_value(5);
+    auto values0 = get_slot_values(db, 0);
+    check_value_range_matches(db, values0, OP_VALUE_RANGE, 0, v2995, v2995);
+    check_value_range_matches(db, get_slot_values(db, 1), OP_VALUE_RANGE, 1,
+			      v5, v5);
+    check_value_range_matches(db, values0, OP_VALUE_RANGE, 0,
+			      make_sortable_value(1990),
+			      make_sortable_value(2410));
+    TEST_EQUAL(Xapian::Database::check(get_named_writable_database_path(
+					   "valuerange9")), 0);
+    return true;
+}
+
+/** Check a glass database in the previous format stays in that format.
+ *
+ *  Older versions don't know about value chunk bounds, so we mustn't write
+ *  them to a database which older versions can still open.
+ */
+DEFINE_TESTCASE(valuerange10, glass) {
+    Xapian::WritableDatabase db = get_named_writable_database("valuerange10");
+    string path = get_named_writable_database_path("valuerange10");
+    db.close();
+
+    // Mark the empty database as being in the previous format (2016-03-14).
+    const char old_format[2] = { '\x04', '\x6e' };
+    {
+	fstream f(path + "/iamglass", ios::in | ios::out | ios::binary);
+	TEST(f.is_open());
+	f.seekp(14);
+	f.write(old_format, 2);
+	TEST(f.good());
+    }
+
+    db = Xapian::WritableDatabase(path, Xapian::DB_OPEN);
+    make_valuerangechunks_db(db, string());
+    db.commit();
+    db.close();
+
+    {
+	ifstream f(path + "/iamglass", ios::binary);
+	char format[2];
+	f.seekg(14);
+	TEST(f.read(format, 2));
+	TEST_EQUAL(string(format, 2), string(old_format, 2));
+    }
+
+    Xapian::Database rdb(path);
+    const auto OP_VALUE_RANGE = Xapian::Query::OP_VALUE_RANGE;
+    check_value_range_matches(rdb, get_slot_values(rdb, 0), OP_VALUE_RANGE, 0,
+			      make_sortable_value(1990),
+			      make_sortable_value(2410));
+    TEST_EQUAL(Xapian::Database::check(path), 0);
+    return true;
+}
+
 // Feature test for Query::OP_VALUE_GE.
 DEFINE_TESTCASE(valuege1, backend) {
     Xapian::Database db(get_database("apitest_phrase"));
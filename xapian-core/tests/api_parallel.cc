@@ -0,0 +1,320 @@
+/** @file api_parallel.cc
+ * @brief Test matching in parallel.
+ */
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "api_parallel.h"
+
+#include <xapian.h>
+
+#include "apitest.h"
+#include "str.h"
+#include "testutils.h"
+
+#include <vector>
+
+using namespace std;
+
+/// Check that matching with threads gives the same results as without.
+static void
+check_threaded_mset(Xapian::Enquire& enquire,
+		    Xapian::doccount first,
+		    Xapian::doccount maxitems)
+{
+    enquire.set_match_threads(0);
+    Xapian::MSet mset1 = enquire.get_mset(first, maxitems);
+    enquire.set_match_threads(4);
+    Xapian::MSet mset2 = enquire.get_mset(first, maxitems);
+    // The exact number of matches.
+    Xapian::doccount exact = enquire.get_mset(0, Xapian::doccount(-1)).size();
+    enquire.set_match_threads(0);
+
+    TEST_EQUAL(mset1.size(), mset2.size());
+    TEST(mset_range_is_same(mset1, 0, mset2, 0, mset1.size()));
+    TEST_REL(mset2.get_matches_lower_bound(), <=, exact);
+    TEST_REL(mset2.get_matches_upper_bound(), >=, exact);
+    if (mset2.size() < maxitems) {
+	// We didn't fill the MSet so the counts must be exact.
+	TEST_EQUAL(mset2.get_matches_lower_bound(),
+		   mset1.get_matches_lower_bound());
+	TEST_EQUAL(mset2.get_matches_upper_bound(),
+		   mset1.get_matches_upper_bound());
+    }
+}
+
+/// Test matching shards in parallel gives the same results.
+DEFINE_TESTCASE(matchthreads1, backend) {
+    Xapian::Database db(get_database("etext"));
+    Xapian::Enquire enquire(db);
+    static const char* const terms[] = {
+	"the", "of", "and", "time", "river", "bridg", "king"
+    };
+    Xapian::Query query(Xapian::Query::OP_OR, begin(terms), end(terms));
+    enquire.set_query(query);
+
+    for (Xapian::doccount first : {0, 3, 25}) {
+	tout << "first = " << first << endl;
+	enquire.set_sort_by_relevance();
+	check_threaded_mset(enquire, first, 10);
+	check_threaded_mset(enquire, first, 1000);
+
+	enquire.set_sort_by_relevance_then_value(13, false);
+	check_threaded_mset(enquire, first, 10);
+
+	enquire.set_sort_by_value(11, true);
+	check_threaded_mset(enquire, first, 10);
+
+	enquire.set_sort_by_value_then_relevance(12, false);
+	check_threaded_mset(enquire, first, 10);
+
+	enquire.set_sort_by_relevance();
+	enquire.set_collapse_key(12);
+	check_threaded_mset(enquire, first, 10);
+	enquire.set_collapse_key(Xapian::BAD_VALUENO);
+
+	enquire.set_cutoff(50);
+	check_threaded_mset(enquire, first, 10);
+	enquire.set_cutoff(0);
+
+	enquire.set_weighting_scheme(Xapian::BoolWeight());
+	enquire.set_docid_order(Xapian::Enquire::DESCENDING);
+	check_threaded_mset(enquire, first, 10);
+	enquire.set_docid_order(Xapian::Enquire::ASCENDING);
+	check_threaded_mset(enquire, first, 10);
+	enquire.set_weighting_scheme(Xapian::BM25Weight());
+    }
+
+    // A query with terms which don't exist in every shard.
+    enquire.set_query(Xapian::Query("jjjjjjjjjjjjjjjj") | Xapian::Query("fish"));
+    check_threaded_mset(enquire, 0, 10);
+
+    // Terms from a wildcard have their weights calculated lazily.
+    enquire.set_query(Xapian::Query(Xapian::Query::OP_WILDCARD, "riv") |
+		      Xapian::Query("king"));
+    check_threaded_mset(enquire, 0, 10);
+    enquire.set_cutoff(50);
+    check_threaded_mset(enquire, 0, 10);
+    enquire.set_cutoff(0);
+
+    return true;
+}
+
+/// Test that matching in parallel is turned off when using a MatchSpy.
+DEFINE_TESTCASE(matchthreads2, backend) {
+    Xapian::Database db(get_database("etext"));
+    Xapian::Enquire enquire(db);
+    enquire.set_query(Xapian::Query("the"));
+
+    Xapian::ValueCountMatchSpy spy1(12);
+    enquire.add_matchspy(&spy1);
+    Xapian::MSet mset1 = enquire.get_mset(0, 10, db.get_doccount());
+    enquire.clear_matchspies();
+
+    Xapian::ValueCountMatchSpy spy2(12);
+    enquire.add_matchspy(&spy2);
+    enquire.set_match_threads(4);
+    Xapian::MSet mset2 = enquire.get_mset(0, 10, db.get_doccount());
+
+    TEST(mset_range_is_same(mset1, 0, mset2, 0, mset1.size()));
+    TEST_EQUAL(spy1.get_total(), spy2.get_total());
+    TEST_EQUAL(spy1.get_description(), spy2.get_description());
+
+    return true;
+}
+
+/// PostingSource which matches every other document and doesn't clone().
+class EveryOtherPostingSource : public Xapian::PostingSource {
+    Xapian::docid did = 0;
+
+    Xapian::docid last_docid = 0;
+
+  public:
+    void reset(const Xapian::Database& db, Xapian::doccount) {
+	did = 0;
+	last_docid = db.get_lastdocid();
+	set_maxweight(2.0);
+    }
+
+    Xapian::doccount get_termfreq_min() const { return 0; }
+
+    Xapian::doccount get_termfreq_est() const { return last_docid / 2; }
+
+    Xapian::doccount get_termfreq_max() const { return last_docid; }
+
+    void next(double) {
+	did += (did & 1) ? 2 : 1;
+    }
+
+    void skip_to(Xapian::docid to_did, double) {
+	if (to_did > did)
+	    did = to_did | 1;
+    }
+
+    bool at_end() const { return did > last_docid; }
+
+    Xapian::docid get_docid() const { return did; }
+
+    double get_weight() const { return (did % 7) * 0.25; }
+};
+
+/// Test splitting a single shard with PostingSource objects in the query.
+DEFINE_TESTCASE(matchthreads3, backend && !remote && !multi) {
+    Xapian::Database db(get_database("etext"));
+    Xapian::Enquire enquire(db);
+
+    // ValueWeightPostingSource implements clone().
+    Xapian::ValueWeightPostingSource vwps(11);
+    enquire.set_query(Xapian::Query(Xapian::Query::OP_AND_MAYBE,
+				    Xapian::Query("the"),
+				    Xapian::Query(&vwps)));
+    check_threaded_mset(enquire, 0, 10);
+    check_threaded_mset(enquire, 5, 100);
+
+    // A PostingSource which doesn't implement clone() should disable
+    // splitting the shard.
+    EveryOtherPostingSource eops;
+    enquire.set_query(Xapian::Query(Xapian::Query::OP_OR,
+				    Xapian::Query("river"),
+				    Xapian::Query(&eops)));
+    check_threaded_mset(enquire, 0, 10);
+    check_threaded_mset(enquire, 5, 100);
+
+    return true;
+}
+
+/// Test matching with threads when the database on disk has been modified.
+DEFINE_TESTCASE(matchthreads4, glass) {
+    Xapian::WritableDatabase wdb = get_named_writable_database("matchthreads4");
+    for (int i = 1; i <= 100; ++i) {
+	Xapian::Document doc;
+	doc.add_term("all");
+	if (i % 3 == 0)
+	    doc.add_term("three", i % 5 + 1);
+	wdb.add_document(doc);
+    }
+    wdb.commit();
+
+    Xapian::Database db(get_named_writable_database_path("matchthreads4"));
+    Xapian::Enquire enquire(db);
+    enquire.set_query(Xapian::Query("all") | Xapian::Query("three"));
+    check_threaded_mset(enquire, 0, 10);
+
+    // Modify the database so the revision on disk no longer matches.
+    for (Xapian::docid did = 1; did <= 50; ++did) {
+	wdb.delete_document(did);
+    }
+    wdb.commit();
+    check_threaded_mset(enquire, 0, 10);
+    TEST_EQUAL(enquire.get_mset(0, 10).get_matches_estimated(), 100);
+
+    // After reopening, the Database objects used for matching each range
+    // need to be at the new revision too.
+    TEST(db.reopen());
+    check_threaded_mset(enquire, 0, 10);
+    enquire.set_match_threads(4);
+    TEST_EQUAL(enquire.get_mset(0, 10).get_matches_estimated(), 50);
+
+    // Search the WritableDatabase with uncommitted changes.
+    for (Xapian::docid did = 51; did <= 60; ++did) {
+	wdb.delete_document(did);
+    }
+    Xapian::Enquire wenquire(wdb);
+    wenquire.set_query(Xapian::Query("all") | Xapian::Query("three"));
+    check_threaded_mset(wenquire, 0, 10);
+    wenquire.set_match_threads(4);
+    TEST_EQUAL(wenquire.get_mset(0, 10).get_matches_estimated(), 40);
+
+    return true;
+}
+
+/// Test matching ranges in parallel with DB_CACHE_DOC_STATS.
+DEFINE_TESTCASE(matchthreads5, glass) {
+    Xapian::WritableDatabase wdb = get_named_writable_database("matchthreads5");
+    for (int i = 1; i <= 1000; ++i) {
+	Xapian::Document doc;
+	doc.add_term("all", i % 4 + 1);
+	doc.add_term("pad", i % 11);
+	if (i % 3 == 0)
+	    doc.add_term("three", i % 5 + 1);
+	wdb.add_document(doc);
+    }
+    wdb.commit();
+
+    // The range copies share the cached document lengths, which the threads
+    // load and read concurrently.
+    string path = get_named_writable_database_path("matchthreads5");
+    Xapian::Database db(path, Xapian::DB_CACHE_DOC_STATS);
+    Xapian::Enquire enquire(db);
+    enquire.set_query(Xapian::Query("all") | Xapian::Query("three"));
+    check_threaded_mset(enquire, 0, 10);
+    check_threaded_mset(enquire, 0, 1000);
+
+    // After reopening, the ranges need the new document lengths.
+    for (Xapian::docid did = 1; did <= 1000; did += 2) {
+	Xapian::Document doc;
+	doc.add_term("all", 20);
+	wdb.replace_document(did, doc);
+    }
+    wdb.commit();
+    TEST(db.reopen());
+    check_threaded_mset(enquire, 0, 10);
+    check_threaded_mset(enquire, 0, 1000);
+
+    return true;
+}
+
+static void
+make_wideor_ranges_db(Xapian::WritableDatabase& db, const string&)
+{
+    // Docids in two bitmap blocks, so some ranges start and end part way
+    // through a block.
+    for (Xapian::docid did = 1; did <= 80000; did += 7) {
+	Xapian::Document doc;
+	doc.add_boolean_term("T" + str(did % 50));
+	if (did % 3 == 0) doc.add_term("three");
+	db.replace_document(did, doc);
+    }
+}
+
+/// Test matching ranges in parallel with an OR decoded into a bitmap.
+DEFINE_TESTCASE(matchthreads6, generated) {
+    Xapian::Database db = get_database("matchthreads6",
+				       make_wideor_ranges_db);
+    vector<Xapian::Query> terms;
+    for (int i = 0; i != 30; ++i) {
+	terms.emplace_back("T" + str(i));
+    }
+    Xapian::Query wide_or(Xapian::Query::OP_OR, terms.begin(), terms.end());
+
+    // Each range only decodes the part of the OR in that range.
+    Xapian::Enquire enquire(db);
+    enquire.set_weighting_scheme(Xapian::BoolWeight());
+    enquire.set_query(wide_or);
+    check_threaded_mset(enquire, 0, 10);
+    check_threaded_mset(enquire, 0, db.get_doccount());
+
+    enquire.set_query(Xapian::Query(Xapian::Query::OP_FILTER,
+				    Xapian::Query("three"), wide_or));
+    check_threaded_mset(enquire, 0, db.get_doccount());
+
+    enquire.set_query(Xapian::Query(Xapian::Query::OP_AND_NOT,
+				    Xapian::Query("three"), wide_or));
+    check_threaded_mset(enquire, 0, db.get_doccount());
+
+    return true;
+}
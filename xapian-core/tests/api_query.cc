@@ -25,6 +25,7 @@
 
 #include <xapian.h>
 
+#include "str.h"
 #include "testsuite.h"
 #include "testutils.h"
 
@@ -1190,3 +1191,70 @@ DEFINE_TESTCASE(emptymaybe1, backend) {
     TEST_EQUAL(mset.size(), 1);
     return true;
 }
+
+static void
+make_wideor_db(Xapian::WritableDatabase& db, const string&)
+{
+    for (Xapian::docid did = 1; did <= 20000; ++did) {
+	Xapian::Document doc;
+	doc.add_boolean_term("T" + str(did % 500));
+	if (did % 3 == 0) doc.add_term("three");
+	db.replace_document(did, doc);
+    }
+    // Some sparse docids in a later block.
+    for (Xapian::docid k = 0; k != 100; ++k) {
+	Xapian::Document doc;
+	doc.add_boolean_term("T" + str(k));
+	db.replace_document(100000 + k, doc);
+    }
+}
+
+/// Test an unweighted OR of many terms (which may be decoded into a bitmap).
+DEFINE_TESTCASE(wideor1, generated) {
+    Xapian::Database db = get_database("wideor1", make_wideor_db);
+    vector<Xapian::Query> terms;
+    for (int i = 0; i != 250; ++i) {
+	terms.emplace_back("T" + str(i));
+    }
+    Xapian::Query wide_or(Xapian::Query::OP_OR, terms.begin(), terms.end());
+    auto in_or = [](Xapian::docid did) {
+	return did > 20000 || did % 500 < 250;
+    };
+
+    Xapian::Enquire enq(db);
+    enq.set_docid_order(enq.ASCENDING);
+    enq.set_query(Xapian::Query(Xapian::Query::OP_SCALE_WEIGHT, wide_or, 0.0));
+    Xapian::MSet mset = enq.get_mset(0, db.get_doccount());
+    TEST_EQUAL(mset.size(), 10100);
+    TEST_EQUAL(mset.get_matches_estimated(), mset.size());
+    Xapian::docid prev = 0;
+    for (Xapian::docid did : mset) {
+	TEST_REL(did, >, prev);
+	TEST(in_or(did));
+	prev = did;
+    }
+
+    // Check the OR works when it's only used to test docids.
+    Xapian::doccount expected = 0;
+    for (Xapian::docid did = 3; did <= 20000; did += 3) {
+	if (in_or(did)) ++expected;
+    }
+    enq.set_query(Xapian::Query(Xapian::Query::OP_FILTER,
+				Xapian::Query("three"), wide_or));
+    mset = enq.get_mset(0, db.get_doccount());
+    TEST_EQUAL(mset.size(), expected);
+    for (auto i = mset.begin(); i != mset.end(); ++i) {
+	TEST(in_or(*i));
+	TEST_EQUAL(i.get_percent(), 100);
+    }
+
+    enq.set_query(Xapian::Query(Xapian::Query::OP_AND_NOT,
+				Xapian::Query("three"), wide_or));
+    mset = enq.get_mset(0, db.get_doccount());
+    TEST_EQUAL(mset.size(), 20000 / 3 - expected);
+    for (Xapian::docid did : mset) {
+	TEST(!in_or(did));
+    }
+
+    return true;
+}
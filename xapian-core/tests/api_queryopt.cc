@@ -26,10 +26,12 @@
 
 #include <xapian.h>
 
+#include "str.h"
 #include "testsuite.h"
 #include "testutils.h"
 
 #include "apitest.h"
+#include <map>
 #include <vector>
 
 using namespace std;
@@ -150,3 +152,86 @@ DEFINE_TESTCASE(boolandmaybe2, backend) {
 
     return true;
 }
+
+static void
+gen_leafand1_db(Xapian::WritableDatabase& db, const string&)
+{
+    static const Xapian::termcount moduli[] = { 2, 3, 5, 7, 11, 101 };
+    for (Xapian::docid did = 1; did <= 3000; ++did) {
+	Xapian::Document doc;
+	for (Xapian::termcount m : moduli) {
+	    if (did % m == 0)
+		doc.add_term("m" + str(m), did % 4 + 1);
+	}
+	doc.add_term("pad", did % 13 + 1);
+	db.add_document(doc);
+    }
+}
+
+/// Test ANDs of terms, which get intersected in blocks.
+DEFINE_TESTCASE(leafand1, generated) {
+    Xapian::Database db = get_database("leafand1", gen_leafand1_db);
+    Xapian::Enquire enquire(db);
+
+    // Weight of each term for each document it indexes.
+    map<string, map<Xapian::docid, double>> term_weights;
+    for (auto t = db.allterms_begin(); t != db.allterms_end(); ++t) {
+	enquire.set_query(Xapian::Query(*t));
+	Xapian::MSet mset = enquire.get_mset(0, db.get_doccount());
+	for (Xapian::MSetIterator i = mset.begin(); i != mset.end(); ++i) {
+	    term_weights[*t][*i] = i.get_weight();
+	}
+    }
+
+    static const vector<string> queries[] = {
+	{ "m2", "m3" },
+	{ "m2", "m101" },
+	{ "m101", "pad" },
+	{ "m2", "m3", "m5" },
+	{ "m7", "m2", "pad" },
+	{ "m2", "m3", "m5", "m7", "m11" },
+	{ "m3", "m5", "m7", "m11", "m101" },
+	{ "m2", "m3", "m5", "m7", "pad" },
+    };
+    for (auto&& terms : queries) {
+	Xapian::Query query(Xapian::Query::OP_AND, terms.begin(), terms.end());
+	tout << query.get_description() << endl;
+
+	// Calculate the expected result by intersecting the weights.
+	map<Xapian::docid, double> expected = term_weights[terms[0]];
+	for (size_t j = 1; j != terms.size(); ++j) {
+	    const map<Xapian::docid, double>& w = term_weights[terms[j]];
+	    for (auto e = expected.begin(); e != expected.end(); ) {
+		auto it = w.find(e->first);
+		if (it == w.end()) {
+		    e = expected.erase(e);
+		} else {
+		    e->second += it->second;
+		    ++e;
+		}
+	    }
+	}
+
+	enquire.set_query(query);
+	Xapian::MSet mset = enquire.get_mset(0, db.get_doccount());
+	TEST_EQUAL(mset.size(), expected.size());
+	for (Xapian::MSetIterator i = mset.begin(); i != mset.end(); ++i) {
+	    TEST_EQUAL_DOUBLE(i.get_weight(), expected[*i]);
+	}
+
+	// Check skip_to() on the AND, which OP_AND_MAYBE uses.
+	enquire.set_query(Xapian::Query(Xapian::Query::OP_AND_MAYBE,
+					Xapian::Query("m11"), query));
+	mset = enquire.get_mset(0, db.get_doccount());
+	const map<Xapian::docid, double>& m11 = term_weights["m11"];
+	TEST_EQUAL(mset.size(), m11.size());
+	for (Xapian::MSetIterator i = mset.begin(); i != mset.end(); ++i) {
+	    double weight = m11.find(*i)->second;
+	    auto e = expected.find(*i);
+	    if (e != expected.end()) weight += e->second;
+	    TEST_EQUAL_DOUBLE(i.get_weight(), weight);
+	}
+    }
+
+    return true;
+}
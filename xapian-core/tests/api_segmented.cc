@@ -0,0 +1,240 @@
+/** @file
+ * @brief Tests of Xapian::SegmentedDatabase.
+ */
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "api_segmented.h"
+
+#include <xapian.h>
+
+#include "apitest.h"
+#include "str.h"
+#include "testutils.h"
+#include "unixcmds.h"
+
+#include <fstream>
+
+using namespace std;
+
+/// Make the document to add with a given index.
+static Xapian::Document
+make_doc(unsigned i, const string& data)
+{
+    Xapian::Document doc;
+    doc.set_data(data);
+    doc.add_boolean_term("Q" + str(i));
+    doc.add_term("mod" + str(i % 7));
+    doc.add_term("all");
+    return doc;
+}
+
+/** Check the documents with ids 1 to @a n in the database at @a path.
+ *
+ *  Those in [@a deleted_begin, @a deleted_end) should have been deleted, and
+ *  those below @a replaced_end replaced.
+ */
+static void
+check_segmented_db(const string& path, unsigned n,
+		   unsigned deleted_begin, unsigned deleted_end,
+		   unsigned replaced_end)
+{
+    Xapian::Database db(path);
+    TEST_EQUAL(db.get_termfreq("all"), db.get_doccount());
+    for (unsigned i = 1; i <= n; ++i) {
+	string term = "Q" + str(i);
+	if (i >= deleted_begin && i < deleted_end) {
+	    TEST(!db.term_exists(term));
+	    continue;
+	}
+	TEST_EQUAL(db.get_termfreq(term), 1);
+	Xapian::docid did = *db.postlist_begin(term);
+	string data = (i < replaced_end ? "new " : "doc ") + str(i);
+	TEST_EQUAL(db.get_document(did).get_data(), data);
+    }
+}
+
+/// Check adding, replacing and deleting documents with merges.
+DEFINE_TESTCASE(segmented1, glass) {
+    string path = get_compaction_output_path("segmented1");
+    rm_rf(path);
+    const unsigned N = 200;
+    {
+	Xapian::SegmentedDatabase db(path, 5, 3);
+	for (unsigned i = 1; i <= N; ++i) {
+	    db.add_document(make_doc(i, "doc " + str(i)));
+	    if (i % 3 == 0) db.commit();
+	}
+	db.commit();
+	db.wait_for_merges();
+	// 200 documents in segments of 5 (or 6, since we only commit every
+	// third document) merged 3 at a time should leave a handful.
+	TEST_REL(db.get_segment_count(), <, 15);
+	TEST_EQUAL(Xapian::Database(path).size(), db.get_segment_count());
+	TEST_EQUAL(Xapian::Database(path).get_doccount(), N);
+	check_segmented_db(path, N, 0, 0, 0);
+
+	// Replace and delete documents in sealed segments, and in the
+	// active one.
+	for (unsigned i = 1; i < 20; ++i) {
+	    db.replace_document("Q" + str(i), make_doc(i, "new " + str(i)));
+	}
+	for (unsigned i = 20; i < 40; ++i) {
+	    db.delete_document("Q" + str(i));
+	}
+	db.replace_document("Q" + str(N), make_doc(N, "doc " + str(N)));
+	db.delete_document("Q" + str(N - 1));
+	db.delete_document("Qnonexistent");
+	db.commit();
+	db.wait_for_merges();
+	Xapian::Database rdb(path);
+	TEST_EQUAL(rdb.get_doccount(), N - 21);
+	TEST(!rdb.term_exists("Q" + str(N - 1)));
+	TEST_EQUAL(rdb.get_termfreq("Q" + str(N)), 1);
+	check_segmented_db(path, N - 2, 20, 40, 20);
+	db.close();
+	TEST_EXCEPTION(Xapian::InvalidOperationError,
+		       db.add_document(make_doc(0, "")));
+	TEST_EXCEPTION(Xapian::InvalidOperationError, db.commit());
+    }
+
+    // Reopen the database and add some more documents.
+    {
+	Xapian::SegmentedDatabase db(path, 5, 3);
+	for (unsigned i = N + 1; i <= N + 50; ++i) {
+	    db.add_document(make_doc(i, "doc " + str(i)));
+	    db.commit();
+	}
+	db.delete_document("Q" + str(N - 1));
+	db.delete_document("Q" + str(N));
+    }
+    Xapian::Database db(path);
+    TEST_EQUAL(db.get_doccount(), N + 50 - 22);
+    for (unsigned i = N + 1; i <= N + 50; ++i) {
+	TEST_EQUAL(db.get_termfreq("Q" + str(i)), 1);
+    }
+    TEST(!db.term_exists("Q" + str(N)));
+    check_segmented_db(path, N - 2, 20, 40, 20);
+    return true;
+}
+
+/// Check SegmentedDatabase with no documents, and error cases.
+DEFINE_TESTCASE(segmented2, glass) {
+    string path = get_compaction_output_path("segmented2");
+    rm_rf(path);
+    TEST_EXCEPTION(Xapian::InvalidArgumentError,
+		   Xapian::SegmentedDatabase(path, 10, 1));
+    {
+	Xapian::SegmentedDatabase db(path);
+	TEST_EQUAL(db.get_segment_count(), 0);
+	TEST_EQUAL(Xapian::Database(path).get_doccount(), 0);
+	// Only one SegmentedDatabase can have the database open.
+	TEST_EXCEPTION(Xapian::DatabaseLockError,
+		       Xapian::SegmentedDatabase db2(path));
+	db.add_document(make_doc(1, "doc 1"));
+	TEST_EQUAL(db.get_segment_count(), 1);
+	TEST_EXCEPTION(Xapian::InvalidArgumentError, db.delete_document(""));
+    }
+    // The destructor commits.
+    TEST_EQUAL(Xapian::Database(path).get_doccount(), 1);
+    {
+	Xapian::SegmentedDatabase db(path);
+	TEST_EQUAL(db.get_segment_count(), 1);
+    }
+    return true;
+}
+
+/// Check changes are committed atomically, and segments aren't modified.
+DEFINE_TESTCASE(segmented3, glass) {
+    string path = get_compaction_output_path("segmented3");
+    rm_rf(path);
+    // Use a large merge_factor so no merges happen.
+    Xapian::SegmentedDatabase db(path, 10, 100);
+    for (unsigned i = 1; i <= 20; ++i) {
+	db.add_document(make_doc(i, "doc " + str(i)));
+	if (i % 5 == 0) db.commit();
+    }
+    TEST_EQUAL(db.get_segment_count(), 4);
+
+    // Replacing and deleting isn't visible until we commit.
+    db.replace_document("Q5", make_doc(5, "new 5"));
+    db.delete_document("Q6");
+    {
+	Xapian::Database rdb(path);
+	TEST_EQUAL(rdb.get_doccount(), 20);
+	TEST_EQUAL(rdb.get_termfreq("Q5"), 1);
+	TEST_EQUAL(rdb.get_document(*rdb.postlist_begin("Q5")).get_data(),
+		   "doc 5");
+	TEST(rdb.term_exists("Q6"));
+    }
+    db.commit();
+    {
+	Xapian::Database rdb(path);
+	TEST_EQUAL(rdb.get_doccount(), 19);
+	TEST_EQUAL(rdb.get_termfreq("all"), 19);
+	TEST_EQUAL(rdb.get_collection_freq("all"), 19);
+	TEST_EQUAL(rdb.get_termfreq("Q5"), 1);
+	TEST_EQUAL(rdb.get_document(*rdb.postlist_begin("Q5")).get_data(),
+		   "new 5");
+	TEST(!rdb.term_exists("Q6"));
+	TEST(rdb.postlist_begin("Q6") == rdb.postlist_end("Q6"));
+	TEST(rdb.allterms_begin("Q6") == rdb.allterms_end("Q6"));
+	// Documents 6, 13 and 20 index mod6.
+	TEST_EQUAL(rdb.get_termfreq("mod6"), 2);
+	TEST_EQUAL(rdb.get_collection_freq("mod6"), 2);
+	// Each document has length 2, as the Q term is boolean.
+	TEST_EQUAL(rdb.get_total_length(), 19 * 2);
+
+	Xapian::Enquire enquire(rdb);
+	enquire.set_query(Xapian::Query("all"));
+	Xapian::MSet mset = enquire.get_mset(0, 20);
+	TEST_EQUAL(mset.size(), 19);
+	for (auto m = mset.begin(); m != mset.end(); ++m) {
+	    TEST_NOT_EQUAL(m.get_document().get_data(), "doc 6");
+	}
+    }
+
+    // The sealed segments are honey, with deletions in deletion lists.
+    {
+	ifstream stub(path + "/XAPIANDB");
+	string line;
+	size_t segments = 0;
+	while (getline(stub, line)) {
+	    if (startswith(line, "honey ")) {
+		++segments;
+	    } else if (!startswith(line, "#")) {
+		TEST(startswith(line, "deleted "));
+	    }
+	}
+	TEST_EQUAL(segments, db.get_segment_count());
+    }
+
+    // A reader which was already open isn't affected by a deletion, and
+    // once committed the document's docid isn't valid in a new reader (the
+    // shards are the same as no segment was added).
+    Xapian::Database old_rdb(path);
+    Xapian::docid did = *old_rdb.postlist_begin("Q7");
+    db.delete_document("Q7");
+    db.commit();
+    Xapian::Database rdb(path);
+    TEST_EQUAL(rdb.size(), old_rdb.size());
+    TEST_EXCEPTION(Xapian::DocNotFoundError, rdb.get_document(did));
+    TEST_EXCEPTION(Xapian::DocNotFoundError, rdb.get_doclength(did));
+    TEST_EQUAL(old_rdb.get_document(did).get_data(), "doc 7");
+    TEST_EQUAL(rdb.get_doccount(), 18);
+    return true;
+}
@@ -650,3 +650,130 @@ DEFINE_TESTCASE(decvalwtsource5, writable) {
 
     return true;
 }
+
+/// Check the value stream, value sort and value counts for a slot match.
+static void
+check_value_column(const Xapian::Database& db,
+		   const Xapian::Database& db_col,
+		   Xapian::valueno slot)
+{
+    Xapian::ValueIterator it = db.valuestream_begin(slot);
+    Xapian::ValueIterator it_col = db_col.valuestream_begin(slot);
+    while (it != db.valuestream_end(slot)) {
+	TEST(it_col != db_col.valuestream_end(slot));
+	TEST_EQUAL(it.get_docid(), it_col.get_docid());
+	TEST_EQUAL(*it, *it_col);
+	++it;
+	++it_col;
+    }
+    TEST(it_col == db_col.valuestream_end(slot));
+
+    Xapian::MSet mset[2];
+    Xapian::ValueCountMatchSpy spy[2] = {
+	Xapian::ValueCountMatchSpy(slot), Xapian::ValueCountMatchSpy(slot)
+    };
+    const Xapian::Database* dbs[2] = { &db, &db_col };
+    for (int i = 0; i != 2; ++i) {
+	Xapian::Enquire enq(*dbs[i]);
+	enq.set_query(Xapian::Query::MatchAll);
+	enq.set_sort_by_value(slot, true);
+	enq.add_matchspy(&spy[i]);
+	mset[i] = enq.get_mset(0, 100);
+    }
+    TEST_EQUAL(mset[0].size(), mset[1].size());
+    for (Xapian::doccount i = 0; i != mset[0].size(); ++i) {
+	TEST_EQUAL(mset[0][i], mset[1][i]);
+    }
+    TEST_EQUAL(spy[0].get_total(), spy[1].get_total());
+    Xapian::TermIterator t = spy[0].values_begin();
+    Xapian::TermIterator t_col = spy[1].values_begin();
+    while (t != spy[0].values_end()) {
+	TEST(t_col != spy[1].values_end());
+	TEST_EQUAL(*t, *t_col);
+	TEST_EQUAL(t.get_termfreq(), t_col.get_termfreq());
+	++t;
+	++t_col;
+    }
+    TEST(t_col == spy[1].values_end());
+
+    // With a small MSet, most candidates are rejected by their sort key
+    // alone.
+    for (bool reverse : { false, true }) {
+	for (int i = 0; i != 2; ++i) {
+	    Xapian::Enquire enq(*dbs[i]);
+	    enq.set_query(Xapian::Query::MatchAll);
+	    enq.set_sort_by_value_then_relevance(slot, reverse);
+	    mset[i] = enq.get_mset(0, 3);
+	}
+	TEST_EQUAL(mset[0].size(), mset[1].size());
+	for (Xapian::doccount i = 0; i != mset[0].size(); ++i) {
+	    TEST_EQUAL(mset[0][i], mset[1][i]);
+	}
+    }
+}
+
+/// Check that value columns give the same results as the value streams.
+DEFINE_TESTCASE(valuecolumn1, backend) {
+    Xapian::Database db = get_database("apitest_simpledata");
+    Xapian::Database db_col = get_database("apitest_simpledata");
+    for (Xapian::valueno slot = 0; slot < 15; ++slot) {
+	// Use narrow cells so that some values are too long to fit.
+	db_col.add_value_column(slot, 1 + slot % 3);
+	check_value_column(db, db_col, slot);
+    }
+
+    TEST_EXCEPTION(Xapian::InvalidArgumentError,
+		   db_col.add_value_column(0, 0));
+    TEST_EXCEPTION(Xapian::InvalidArgumentError,
+		   db_col.add_value_column(0, 255));
+
+    return true;
+}
+
+/// Check that a value column reflects changes to a writable database.
+DEFINE_TESTCASE(valuecolumn2, writable && !inmemory) {
+    Xapian::WritableDatabase db = get_writable_database();
+    for (Xapian::docid did = 1; did <= 30; ++did) {
+	Xapian::Document doc;
+	if (did % 4 != 0)
+	    doc.add_value(0, Xapian::sortable_serialise(did * 7 % 11));
+	if (did % 5 == 0)
+	    doc.add_value(0, "a value which is too long for a cell");
+	db.add_document(doc);
+    }
+    db.commit();
+    db.add_value_column(0);
+
+    Xapian::Database db_plain = get_writable_database_as_database();
+    check_value_column(db_plain, db, 0);
+
+    // Changes should be seen before they're committed.
+    Xapian::Document doc;
+    doc.add_value(0, Xapian::sortable_serialise(100));
+    db.replace_document(3, doc);
+    db.replace_document(4, doc);
+    db.delete_document(6);
+    db.add_document(doc);
+    {
+	Xapian::ValueIterator it = db.valuestream_begin(0);
+	TEST(it.check(4));
+	TEST_EQUAL(it.get_docid(), 4);
+	TEST_EQUAL(*it, doc.get_value(0));
+	++it;
+	TEST_EQUAL(it.get_docid(), 5);
+	++it;
+	TEST_EQUAL(it.get_docid(), 7);
+	TEST(!it.check(8) || it.get_docid() != 8);
+	TEST(it.check(31));
+	TEST_EQUAL(it.get_docid(), 31);
+	TEST_EQUAL(*it, doc.get_value(0));
+	++it;
+	TEST(it == db.valuestream_end(0));
+    }
+
+    db.commit();
+    TEST(db_plain.reopen());
+    check_value_column(db_plain, db, 0);
+
+    return true;
+}
@@ -23,7 +23,9 @@
 #include <config.h>
 
 #include "api_weight.h"
+#include <algorithm>
 #include <cmath>
+#include <map>
 
 #include <xapian.h>
 
@@ -1690,3 +1692,123 @@ DEFINE_TESTCASE(dicecoeffweight2, backend) {
 
     return true;
 }
+
+static void
+gen_blockmaxweight1_db(Xapian::WritableDatabase& db, const string&)
+{
+    for (Xapian::docid did = 1; did <= 5000; ++did) {
+	Xapian::Document doc;
+	// Use a much higher wdf for "common" in a few runs of documents so that
+	// most chunks of its posting list can't compete with those.
+	bool high = (did / 500) % 4 == 1;
+	doc.add_term("common", high ? did % 7 + 10 : did % 3 + 1);
+	doc.add_term("flat");
+	if (did % 97 == 0)
+	    doc.add_term("rare", did % 5 + 1);
+	doc.add_term("pad", did % 11 + 1);
+	db.add_document(doc);
+    }
+}
+
+/// Check the top n results match those from the full ranking.
+static void
+check_blockmaxweight(const Xapian::Database& db, const Xapian::Weight& wt)
+{
+    Xapian::Enquire enquire(db);
+    enquire.set_weighting_scheme(wt);
+    const Xapian::Query queries[] = {
+	Xapian::Query("common") | Xapian::Query("rare"),
+	Xapian::Query(Xapian::Query::OP_AND_MAYBE,
+		      Xapian::Query("common"), Xapian::Query("rare")),
+	Xapian::Query(Xapian::Query::OP_AND_MAYBE,
+		      Xapian::Query("rare"), Xapian::Query("common")),
+	Xapian::Query("common") | Xapian::Query("flat"),
+	Xapian::Query("common") & Xapian::Query("pad")
+    };
+    for (const Xapian::Query& query : queries) {
+	tout << wt.name() << " " << query.get_description() << endl;
+	enquire.set_query(query);
+	Xapian::MSet full = enquire.get_mset(0, db.get_doccount());
+	for (Xapian::doccount n : {1, 10, 50}) {
+	    Xapian::MSet mset = enquire.get_mset(0, n);
+	    TEST_EQUAL(mset.size(), min(n, full.size()));
+	    TEST(mset_range_is_same(mset, 0, full, 0, mset.size()));
+	}
+    }
+}
+
+/// Test that skipping over blocks of postings which can't match doesn't
+//  change the results.
+DEFINE_TESTCASE(blockmaxweight1, generated) {
+    Xapian::Database db = get_database("blockmaxweight1",
+				       gen_blockmaxweight1_db);
+    check_blockmaxweight(db, Xapian::BM25Weight());
+    check_blockmaxweight(db, Xapian::BM25Weight(1, 0, 1, 0.5, 0.5));
+    check_blockmaxweight(db, Xapian::BM25PlusWeight());
+    check_blockmaxweight(db, Xapian::TfIdfWeight());
+    check_blockmaxweight(db, Xapian::TradWeight());
+
+    // Skipping to a later chunk of a posting list where the wdf is the same
+    // for every entry after the first.
+    Xapian::Enquire enquire(db);
+    enquire.set_query(Xapian::Query("rare") & Xapian::Query("flat"));
+    Xapian::MSet mset = enquire.get_mset(0, 100);
+    TEST_EQUAL(mset.size(), 5000 / 97);
+    for (Xapian::MSetIterator i = mset.begin(); i != mset.end(); ++i) {
+	TEST_EQUAL(*i % 97, 0);
+    }
+
+    return true;
+}
+
+/// Check OR gives the sum of the weights for each subquery.
+static void
+check_batchweight(const Xapian::Database& db, const Xapian::Weight& wt)
+{
+    tout << wt.name() << endl;
+    Xapian::Enquire enquire(db);
+    enquire.set_weighting_scheme(wt);
+    const char* terms[] = { "common", "rare", "pad" };
+    map<Xapian::docid, double> expected;
+    for (const char* term : terms) {
+	enquire.set_query(Xapian::Query(term));
+	Xapian::MSet mset = enquire.get_mset(0, db.get_doccount());
+	for (Xapian::MSetIterator i = mset.begin(); i != mset.end(); ++i) {
+	    expected[*i] += i.get_weight();
+	}
+    }
+
+    enquire.set_query(Xapian::Query(Xapian::Query::OP_OR,
+				    terms, terms + 3));
+    Xapian::MSet mset = enquire.get_mset(0, db.get_doccount());
+    TEST_EQUAL(mset.size(), expected.size());
+    for (Xapian::MSetIterator i = mset.begin(); i != mset.end(); ++i) {
+	TEST_EQUAL_DOUBLE(i.get_weight(), expected[*i]);
+    }
+}
+
+/// Test weights calculated for batches of postings under OP_OR.
+DEFINE_TESTCASE(batchweight1, generated) {
+    Xapian::Database db = get_database("blockmaxweight1",
+				       gen_blockmaxweight1_db);
+    check_batchweight(db, Xapian::BM25Weight());
+    check_batchweight(db, Xapian::BM25PlusWeight());
+    check_batchweight(db, Xapian::TfIdfWeight());
+    check_batchweight(db, Xapian::TfIdfWeight("ltn"));
+    check_batchweight(db, Xapian::TfIdfWeight("Ptn"));
+    check_batchweight(db, Xapian::CoordWeight());
+    return true;
+}
+
+/// Test batch weighting using document lengths held in memory.
+DEFINE_TESTCASE(batchweight2, glass) {
+    get_database("blockmaxweight1", gen_blockmaxweight1_db);
+    string path = get_database_path("blockmaxweight1", gen_blockmaxweight1_db);
+    Xapian::Database db(path, Xapian::DB_CACHE_DOC_STATS);
+    check_batchweight(db, Xapian::BM25Weight());
+    check_batchweight(db, Xapian::BM25PlusWeight());
+    check_batchweight(db, Xapian::TfIdfWeight("ntn"));
+    check_blockmaxweight(db, Xapian::BM25Weight());
+    check_blockmaxweight(db, Xapian::BM25PlusWeight());
+    return true;
+}
@@ -41,10 +41,12 @@
 #include "apitest.h"
 
 #include "safeunistd.h"
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 #include <map>
 #include <string>
+#include <vector>
 
 using namespace std;
 
@@ -2028,3 +2030,82 @@ DEFINE_TESTCASE(protocolbug1, remote && writable) {
 
     return true;
 }
+
+/// Check add_documents() gives the same result as add_document().
+DEFINE_TESTCASE(adddocuments1, writable) {
+    Xapian::WritableDatabase db1 = get_writable_database();
+    Xapian::WritableDatabase db2 = get_named_writable_database("adddocuments1b");
+    TEST_EQUAL(db1.add_documents(vector<Xapian::Document>()), 0);
+
+    Xapian::Document first;
+    first.add_term("first", 2);
+    first.add_value(1, "one");
+    first.set_data("first");
+    db1.add_document(first);
+    db2.add_document(first);
+    db1.commit();
+
+    vector<Xapian::Document> docs;
+    for (unsigned i = 0; i != 50; ++i) {
+	Xapian::Document doc;
+	doc.set_data("doc " + str(i));
+	for (unsigned j = 0; j <= i % 7; ++j) {
+	    doc.add_posting("term" + str(j), i + j + 1);
+	    doc.add_posting("all", j + 1);
+	}
+	doc.add_boolean_term("Q" + str(i));
+	doc.add_term("wdf", i);
+	if (i % 3) doc.add_value(i % 3, str(i));
+	docs.push_back(doc);
+    }
+    // A Document object appearing twice, and one read from a database.
+    docs.push_back(docs[3]);
+    Xapian::Database src = get_database("apitest_simpledata");
+    docs.push_back(src.get_document(2));
+    docs.push_back(Xapian::Document());
+
+    TEST_EQUAL(db1.add_documents(docs, 4), 2);
+    for (auto& doc : docs) {
+	db2.add_document(doc);
+    }
+    db1.commit();
+    db2.commit();
+
+    TEST_EQUAL(db1.get_doccount(), db2.get_doccount());
+    TEST_EQUAL(db1.get_lastdocid(), db2.get_lastdocid());
+    TEST_EQUAL(db1.get_total_length(), db2.get_total_length());
+    TEST_EQUAL(db1.get_wdf_upper_bound("wdf"), db2.get_wdf_upper_bound("wdf"));
+    for (Xapian::docid did = 1; did <= db1.get_lastdocid(); ++did) {
+	Xapian::Document doc1 = db1.get_document(did);
+	Xapian::Document doc2 = db2.get_document(did);
+	TEST_EQUAL(doc1.get_data(), doc2.get_data());
+	TEST_EQUAL(doc1.serialise(), doc2.serialise());
+	TEST_EQUAL(db1.get_doclength(did), db2.get_doclength(did));
+	Xapian::TermIterator t1 = db1.termlist_begin(did);
+	Xapian::TermIterator t2 = db2.termlist_begin(did);
+	for ( ; t1 != db1.termlist_end(did); ++t1, ++t2) {
+	    TEST(t2 != db2.termlist_end(did));
+	    TEST_EQUAL(*t1, *t2);
+	    TEST_EQUAL(t1.get_wdf(), t2.get_wdf());
+	    TEST(equal(db1.positionlist_begin(did, *t1),
+		       db1.positionlist_end(did, *t1),
+		       db2.positionlist_begin(did, *t2)));
+	}
+	TEST(t2 == db2.termlist_end(did));
+    }
+    for (Xapian::valueno slot = 0; slot != 3; ++slot) {
+	TEST_EQUAL(db1.get_value_freq(slot), db2.get_value_freq(slot));
+    }
+    return true;
+}
+
+/// Check add_documents() rejects a batch with a term which is too long.
+DEFINE_TESTCASE(adddocuments2, writable) {
+    // Inmemory doesn't impose a limit.
+    SKIP_TEST_FOR_BACKEND("inmemory");
+    Xapian::WritableDatabase db = get_writable_database();
+    vector<Xapian::Document> docs(10);
+    docs[7].add_term(string(300, 'x'));
+    TEST_EXCEPTION(Xapian::InvalidArgumentError, db.add_documents(docs, 4));
+    return true;
+}
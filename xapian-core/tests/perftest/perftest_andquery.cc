@@ -0,0 +1,109 @@
+/** @file perftest_andquery.cc
+ * @brief performance tests for AND queries
+ */
+/* This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ */
+
+#include <config.h>
+
+#include "perftest/perftest_andquery.h"
+
+#include <xapian.h>
+
+#include "backendmanager.h"
+#include "perftest.h"
+#include "str.h"
+#include "testrunner.h"
+#include "testsuite.h"
+#include "testutils.h"
+
+#include <vector>
+
+using namespace std;
+
+static void
+builddb_andquery1(Xapian::WritableDatabase &db, const string & dbname)
+{
+    logger.testcase_begin(dbname);
+    unsigned int runsize = 1000000;
+
+    // Rebuild the database.
+    std::map<std::string, std::string> params;
+    params["runsize"] = str(runsize);
+    logger.indexing_begin(dbname, params);
+    static const unsigned int moduli[] = { 2, 3, 5, 7, 11, 13, 101 };
+    for (unsigned int i = 1; i <= runsize; ++i) {
+	Xapian::Document doc;
+	doc.set_data("test document " + str(i));
+	for (unsigned int m : moduli) {
+	    if (i % m == 0)
+		doc.add_term("M" + str(m), i % 3 + 1);
+	}
+	doc.add_term("Q" + str(i));
+	db.add_document(doc);
+	logger.indexing_add();
+    }
+    db.commit();
+    logger.indexing_end();
+    logger.testcase_end();
+}
+
+// Test the performance of ANDs of terms with various frequencies.
+DEFINE_TESTCASE(andquery1, writable && !remote && !inmemory) {
+    Xapian::Database db;
+    db = backendmanager->get_database("andquery1", builddb_andquery1,
+				      "andquery1");
+
+    logger.testcase_begin("andquery1");
+    Xapian::Enquire enquire(db);
+    Xapian::doccount runsize = db.get_doccount();
+
+    static const vector<string> queries[] = {
+	{ "M2", "M3" },
+	{ "M2", "M101" },
+	{ "M2", "M3", "M5" },
+	{ "M3", "M7", "M101" },
+	{ "M2", "M3", "M5", "M7", "M11" },
+	{ "M2", "M3", "M5", "M13", "M101" },
+    };
+    for (auto&& terms : queries) {
+	Xapian::Query query(Xapian::Query::OP_AND, terms.begin(), terms.end());
+	enquire.set_query(query);
+
+	logger.searching_start("AND of " + str(terms.size()) + " terms, top 10");
+	for (int i = 0; i != 5; ++i) {
+	    logger.search_start();
+	    Xapian::MSet mset = enquire.get_mset(0, 10);
+	    logger.search_end(query, mset);
+	    TEST_REL(mset.get_matches_lower_bound(),<=,runsize);
+	}
+	logger.searching_end();
+
+	logger.searching_start("AND of " + str(terms.size()) + " terms, "
+			       "count all matches");
+	for (int i = 0; i != 5; ++i) {
+	    logger.search_start();
+	    Xapian::MSet mset = enquire.get_mset(0, 0, runsize);
+	    logger.search_end(query, mset);
+	    TEST_EQUAL(mset.get_matches_lower_bound(),
+		       mset.get_matches_upper_bound());
+	}
+	logger.searching_end();
+    }
+
+    logger.testcase_end();
+    return true;
+}
@@ -133,12 +133,43 @@ BM25PlusWeight::get_sumpart(Xapian::termcount wdf, Xapian::termcount len,
     RETURN(termweight * ((param_k1 + 1) * wdf_double / denom + param_delta));
 }
 
+void
+BM25PlusWeight::get_sumparts(Xapian::doccount n,
+			     const Xapian::termcount* wdfs,
+			     const Xapian::termcount* doclens,
+			     const Xapian::termcount*,
+			     double* sumparts) const
+{
+    LOGCALL_VOID(WTCALC, "BM25PlusWeight::get_sumparts", n | wdfs | doclens | sumparts);
+    // Copy the members to locals so the compiler knows they don't change
+    // when we store to sumparts.
+    const double k1 = param_k1;
+    const double b = param_b;
+    const double delta = param_delta;
+    const double min_normlen = param_min_normlen;
+    const double factor = len_factor;
+    const double tw = termweight;
+    for (Xapian::doccount i = 0; i != n; ++i) {
+	Xapian::doclength normlen = max(doclens[i] * factor, min_normlen);
+	double wdf_double = wdfs[i];
+	double denom = k1 * (normlen * b + (1 - b)) + wdf_double;
+	sumparts[i] = tw * ((k1 + 1) * wdf_double / denom + delta);
+    }
+}
+
 double
 BM25PlusWeight::get_maxpart() const
 {
     LOGCALL(WTCALC, double, "BM25PlusWeight::get_maxpart", NO_ARGS);
+    RETURN(get_maxpart_for_wdf(get_wdf_upper_bound()));
+}
+
+double
+BM25PlusWeight::get_maxpart_for_wdf(Xapian::termcount wdf_max) const
+{
+    LOGCALL(WTCALC, double, "BM25PlusWeight::get_maxpart_for_wdf", wdf_max);
+    wdf_max = min(wdf_max, get_wdf_upper_bound());
     double denom = param_k1;
-    Xapian::termcount wdf_max = get_wdf_upper_bound();
     if (param_k1 != 0.0) {
 	if (param_b != 0.0) {
 	    // "Upper-bound Approximations for Dynamic Pruning" Craig
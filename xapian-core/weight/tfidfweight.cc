@@ -23,6 +23,7 @@
 #include <config.h>
 
 #include "xapian/weight.h"
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 
@@ -153,12 +154,43 @@ TfIdfWeight::get_sumpart(Xapian::termcount wdf, Xapian::termcount doclen,
     return get_wtn(wdfn * idfn, normalizations[2]) * wqf_factor;
 }
 
+void
+TfIdfWeight::get_sumparts(Xapian::doccount n,
+			  const Xapian::termcount* wdfs,
+			  const Xapian::termcount* doclens,
+			  const Xapian::termcount* uniqterms,
+			  double* sumparts) const
+{
+    if (normalizations[0] == 'n' && normalizations[2] == 'n') {
+	// Fast path for the default normalizations, where the weight is just
+	// the wdf scaled by a constant.
+	const double idf = idfn;
+	const double factor = wqf_factor;
+	for (Xapian::doccount i = 0; i != n; ++i) {
+	    double wdfn = wdfs[i];
+	    sumparts[i] = (wdfn * idf) * factor;
+	}
+	return;
+    }
+    for (Xapian::doccount i = 0; i != n; ++i) {
+	double wdfn = get_wdfn(wdfs[i], doclens[i], uniqterms[i],
+			       normalizations[0]);
+	sumparts[i] = get_wtn(wdfn * idfn, normalizations[2]) * wqf_factor;
+    }
+}
+
 // An upper bound can be calculated simply on the basis of wdf_max as termfreq
 // and N are constants.
 double
 TfIdfWeight::get_maxpart() const
 {
-    Xapian::termcount wdf_max = get_wdf_upper_bound();
+    return get_maxpart_for_wdf(get_wdf_upper_bound());
+}
+
+double
+TfIdfWeight::get_maxpart_for_wdf(Xapian::termcount wdf_max) const
+{
+    wdf_max = min(wdf_max, get_wdf_upper_bound());
     Xapian::termcount len_min = get_doclength_lower_bound();
     double wdfn = get_wdfn(wdf_max, len_min, len_min, normalizations[0]);
     return get_wtn(wdfn * idfn, normalizations[2]) * wqf_factor;
@@ -147,6 +147,24 @@ Weight::unserialise(const string &) const
     throw Xapian::UnimplementedError("unserialise() not supported for this Xapian::Weight subclass");
 }
 
+void
+Weight::get_sumparts(Xapian::doccount n,
+		     const Xapian::termcount* wdfs,
+		     const Xapian::termcount* doclens,
+		     const Xapian::termcount* uniqterms,
+		     double* sumparts) const
+{
+    for (Xapian::doccount i = 0; i != n; ++i) {
+	sumparts[i] = get_sumpart(wdfs[i], doclens[i], uniqterms[i]);
+    }
+}
+
+double
+Weight::get_maxpart_for_wdf(Xapian::termcount) const
+{
+    return get_maxpart();
+}
+
 const Weight *
 Weight::create(const string & s, const Registry & reg)
 {